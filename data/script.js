@@ -1,7 +1,16 @@
-let gateway = `ws://${window.location.hostname}:81/`;
+// Open the page with ?format=binary to receive telemetry as compact binary frames (see decodeTelemetryFrame)
+const binaryTelemetry = new URLSearchParams(window.location.search).get('format') === 'binary';
+let gateway = `ws://${window.location.host}/ws` + (binaryTelemetry ? '?format=binary' : '');
 let websocket;
 const MAX_CURVE_POINTS_UI = 8;
 let initialDataLoaded = false; 
+let renderedChannelCount = 0;
+let selectedCurveChannel = 0;
+let lastChannels = [];
+let statusState = null; // Last telemetry snapshot with every later delta merged in
+let statusSeq = null;
+let configState = null; // Last config document (sent on connect and on change)
+let pingTimer = null;
 
 window.addEventListener('load', onLoad);
 
@@ -17,6 +26,7 @@ function onLoad(event) {
 function initWebSocket() {
   console.log('Trying to open a WebSocket connection...');
   websocket = new WebSocket(gateway);
+  websocket.binaryType = 'arraybuffer';
   websocket.onopen    = onOpen;
   websocket.onclose   = onClose;
   websocket.onmessage = onMessage;
@@ -24,9 +34,20 @@ function initWebSocket() {
 
 function onOpen(event) { 
     console.log('Connection opened'); 
+    sendPing();
+    pingTimer = setInterval(sendPing, 10000);
+}
+
+// Message round trip through the controller (AsyncTCP task and networkTask), shown as wsRttMs
+function sendPing() {
+  sendCommand({action: 'ping', t: Math.round(performance.now())});
 }
 function onClose(event) { 
     console.log('Connection closed'); 
+    clearInterval(pingTimer);
+    statusState = null;
+    statusSeq = null;
+    configState = null;
     if (initialDataLoaded) {
         document.getElementById('loadingOverlay').style.display = 'flex';
         const mainContent = document.querySelector('.main-content-wrapper');
@@ -37,11 +58,99 @@ function onClose(event) {
 }
 
 function onMessage(event) {
-  let data;
+  if (event.data instanceof ArrayBuffer) {
+    const frame = decodeTelemetryFrame(new DataView(event.data));
+    if (frame === null || statusState === null) return; // The JSON snapshot comes first
+    mergeStatusDelta(statusState, frame); // Frames are complete for their fields, so no gap check
+    updateUI(combinedState());
+    return;
+  }
+  let msg;
   try {
-    data = JSON.parse(event.data);
+    msg = JSON.parse(event.data);
   } catch (e) { console.error("Error parsing JSON:", e, event.data); return; }
 
+  if (msg.type === 'pong') {
+    document.getElementById('wsRttMs').textContent = Math.max(0, Math.round(performance.now()) - msg.t);
+    return;
+  }
+  if (msg.type === 'config') {
+    configState = msg;
+    if (statusState === null) return; // Telemetry snapshot follows
+  } else if (msg.type === 'delta') {
+    if (statusState === null) return; // The full snapshot is still on its way
+    if (msg.seq !== statusSeq + 1) { // Missed an update: start over from a new snapshot
+      console.log(`Status gap (expected ${statusSeq + 1}, got ${msg.seq}), requesting resync`);
+      statusState = null;
+      statusSeq = null;
+      sendCommand({action: 'resync'});
+      return;
+    }
+    mergeStatusDelta(statusState, msg);
+    statusSeq = msg.seq;
+  } else {
+    statusState = msg;
+    statusSeq = msg.seq;
+  }
+  updateUI(combinedState());
+}
+
+// Config and telemetry as one object, channel entries merged by index
+function combinedState() {
+  const view = Object.assign({}, configState || {}, statusState);
+  const configChannels = (configState && configState.channels) || [];
+  view.channels = (statusState.channels || []).map((channel, ch) => Object.assign({}, configChannels[ch], channel));
+  return view;
+}
+
+// Binary telemetry frame, layout as in src/telemetry_frame.h (little-endian). Returns the fields it carries
+// in the JSON telemetry shape, or null for a frame this page does not understand.
+const CAL_STATUS_NAMES = ['NONE', 'RUNNING', 'FAILED', 'DONE'];
+function decodeTelemetryFrame(view) {
+  if (view.byteLength < 12 || view.getUint8(0) !== 0x46 || view.getUint8(1) !== 1) return null;
+  const channelCount = view.getUint8(2);
+  if (view.byteLength < 12 + 8 * channelCount) return null;
+  const flags = view.getUint8(3);
+  const sensor = (flags & 1) !== 0;
+  const ota = (flags & 2) !== 0;
+  const frame = {
+    seq: view.getUint32(4, true),
+    temperature: sensor ? view.getInt16(8, true) / 10 : null,
+    tempSensorFound: sensor,
+    otaInProgress: ota,
+    otaPercent: ota ? view.getUint8(10) : null,
+    channels: []
+  };
+  for (let ch = 0; ch < channelCount; ch++) {
+    const offset = 12 + 8 * ch;
+    const modes = view.getUint8(offset + 2);
+    frame.channels.push({
+      fanSpeed: view.getUint8(offset),
+      manualFanSpeed: view.getUint8(offset + 1),
+      isAutoMode: (modes & 1) !== 0,
+      isPidMode: (modes & 2) !== 0,
+      isRpmMode: (modes & 4) !== 0,
+      calStatus: CAL_STATUS_NAMES[view.getUint8(offset + 3)] || 'NONE',
+      fanRpm: view.getUint16(offset + 4, true),
+      targetRpm: view.getUint16(offset + 6, true)
+    });
+  }
+  return frame;
+}
+
+// Deltas carry only changed fields; channel entries carry only their changed fields
+function mergeStatusDelta(target, delta) {
+  for (const [key, value] of Object.entries(delta)) {
+    if (key === 'channels' && Array.isArray(target.channels) && value.length === target.channels.length) {
+      value.forEach((channel, ch) => Object.assign(target.channels[ch], channel));
+    } else {
+      target[key] = value;
+    }
+  }
+}
+
+function updateUI(data) {
+
   if (!initialDataLoaded) {
       const loadingOverlay = document.getElementById('loadingOverlay');
       const mainContentWrapper = document.querySelector('.main-content-wrapper');
@@ -71,21 +180,14 @@ function onMessage(event) {
 
   if (data.tempSensorFound !== undefined) {
     const curveEditor = document.getElementById('curveEditorContainer');
-    const autoModeNotice = document.getElementById('autoModeNotice');
     const tempDisplay = document.getElementById('temp');
 
     if (data.tempSensorFound) {
       tempDisplay.innerText = data.temperature !== undefined && data.temperature !== null && data.temperature > -990 ? data.temperature.toFixed(1) : 'N/A';
       if (curveEditor) curveEditor.classList.remove('hidden');
-      if (autoModeNotice) autoModeNotice.innerText = '';
     } else {
       tempDisplay.innerText = 'N/A';
       if (curveEditor) curveEditor.classList.add('hidden');
-       if (data.isAutoMode && autoModeNotice) { 
-        autoModeNotice.innerText = '(Sensor N/A - Fixed Speed)';
-      } else if (autoModeNotice) {
-        autoModeNotice.innerText = '';
-      }
     }
   } else if (data.temperature !== undefined) { 
      document.getElementById('temp').innerText = data.temperature !== null && data.temperature > -990 ? data.temperature.toFixed(1) : 'N/A';
@@ -96,39 +198,49 @@ function onMessage(event) {
     if (fwVersionEl) fwVersionEl.innerText = data.firmwareVersion;
   }
 
-  if(data.fanSpeed !== undefined) document.getElementById('fanSpeed').innerText = data.fanSpeed;
-  if(data.fanRpm !== undefined) document.getElementById('rpm').innerText = data.fanRpm;
-  
-  if(data.isAutoMode !== undefined) {
-    const modeStr = data.isAutoMode ? "AUTO" : "MANUAL";
-    document.getElementById('mode').innerText = modeStr;
-    document.getElementById('manualControl').style.display = data.isAutoMode ? 'none' : 'block';
-    const autoModeNotice = document.getElementById('autoModeNotice');
-    if (autoModeNotice) { 
-        if (data.isAutoMode && data.tempSensorFound === false) {
-            autoModeNotice.innerText = '(Sensor N/A - Fixed Speed)';
-        } else if (data.isAutoMode && data.tempSensorFound === true) {
-             autoModeNotice.innerText = ''; 
-        } else if (!data.isAutoMode) {
-             autoModeNotice.innerText = ''; 
-        }
+  if (data.channels && Array.isArray(data.channels)) {
+    lastChannels = data.channels;
+    renderFanChannels(data.channels, data.tempSensorFound);
+    const curveChannel = data.channels[selectedCurveChannel];
+    if (curveChannel && Array.isArray(curveChannel.fanCurve) && data.tempSensorFound) { 
+      displayFanCurve(curveChannel.fanCurve); 
     }
   }
-  
-  if(data.manualFanSpeed !== undefined && !data.isAutoMode) {
-    document.getElementById('speedSlider').value = data.manualFanSpeed;
-    document.getElementById('manualSpeedValue').innerText = data.manualFanSpeed;
-  }
-
-  if(data.fanCurve && Array.isArray(data.fanCurve) && data.tempSensorFound) { 
-    displayFanCurve(data.fanCurve); 
-  } else if (!data.tempSensorFound) {
+  if (data.tempSensorFound === false) {
     const curvePointsContainer = document.getElementById('fanCurvePointsContainer');
     if (curvePointsContainer) { 
         curvePointsContainer.innerHTML = '<p class="placeholder">Fan curve editor disabled: Temperature sensor not detected.</p>';
     }
   }
 
+  // Only fill the PID fields while the user is not editing them
+  const pidContainer = document.getElementById('pidConfigContainer');
+  if (pidContainer && !pidContainer.contains(document.activeElement)) {
+    if (data.pidSetpoint !== undefined) document.getElementById('pidSetpoint').value = data.pidSetpoint;
+    if (data.pidKp !== undefined) document.getElementById('pidKp').value = data.pidKp;
+    if (data.pidKi !== undefined) document.getElementById('pidKi').value = data.pidKi;
+    if (data.pidKd !== undefined) document.getElementById('pidKd').value = data.pidKd;
+  }
+
+  const outputContainer = document.getElementById('outputConfigContainer');
+  if (outputContainer && !outputContainer.contains(document.activeElement)) {
+    if (data.rampUpPercentPerS !== undefined) document.getElementById('rampUp').value = data.rampUpPercentPerS;
+    if (data.rampDownPercentPerS !== undefined) document.getElementById('rampDown').value = data.rampDownPercentPerS;
+    if (data.hysteresisC !== undefined) document.getElementById('hysteresis').value = data.hysteresisC;
+  }
+  if (data.fanOutputWrites !== undefined) document.getElementById('fanOutputWrites').textContent = data.fanOutputWrites;
+  if (data.suppressedOutputChanges !== undefined) document.getElementById('suppressedOutputChanges').textContent = data.suppressedOutputChanges;
+  if (data.suppressedBroadcasts !== undefined) document.getElementById('suppressedBroadcasts').textContent = data.suppressedBroadcasts;
+  ['cmdApplied', 'cmdDropped', 'cmdQueueMaxDepth', 'cmdLatencyAvgUs', 'cmdLatencyMaxUs', 'cmdToPwmP50Us', 'cmdToPwmP99Us', 'cmdToPwmMaxUs',
+   'ctlPeriodMinUs', 'ctlPeriodMaxUs', 'ctlJitterP99Us', 'ctlJitterMaxUs', 'ctlExecMaxUs', 'ctlOverruns',
+   'nvsWrites', 'nvsWritesAvoided', 'nvsBytesWritten', 'nvsPending', 'wifiBootOnlineMs', 'wifiLastConnectMs', 'wifiDrops',
+   'wsBytesPerMin', 'wsFullBytesPerMin', 'wsBroadcastAvgUs', 'sseClients', 'sseQueueMax', 'sseDropped', 'sseSkipped',
+   'heapFree', 'heapMinFree', 'heapLargestBlock', 'heapFragPct', 'jsonArenaPeak', 'jsonArenaSize', 'statusDropped'].forEach(key => {
+    if (data[key] !== undefined) document.getElementById(key).textContent = data[key];
+  });
+
+  if (data.wifiFastJoin !== undefined) document.getElementById('wifiJoinType').textContent = data.wifiFastJoin ? 'cached' : 'scan';
+
   if (data.isMqttEnabled !== undefined) {
     document.getElementById('mqttEnable').checked = data.isMqttEnabled;
     toggleMqttFields(); 
@@ -158,7 +270,25 @@ function onMessage(event) {
     } else {
         if (otaButton) otaButton.innerText = "Check for Updates & Install";
     }
+    updateOtaProgress(data);
+  }
+}
+
+// Download progress, sent only while an update runs
+function updateOtaProgress(data) {
+  const progressEl = document.getElementById('otaProgress');
+  if (!progressEl) return;
+  if (!data.otaInProgress || !data.otaBytes) {
+    progressEl.classList.add('hidden');
+    return;
   }
+  progressEl.classList.remove('hidden');
+  document.getElementById('otaProgressBar').value = data.otaPercent || 0;
+  let text = `${Math.round(data.otaBytes / 1024)}`;
+  if (data.otaTotalBytes) text += ` / ${Math.round(data.otaTotalBytes / 1024)}`;
+  text += ` kB, ${(data.otaBytesPerS / 1024).toFixed(1)} kB/s`;
+  if (data.otaEtaS != null) text += `, ${data.otaEtaS} s left`;
+  document.getElementById('otaProgressText').textContent = text;
 }
 
 function sendCommand(commandPayload) {
@@ -166,10 +296,109 @@ function sendCommand(commandPayload) {
     websocket.send(JSON.stringify(commandPayload));
   } else { console.log("WebSocket not open or WiFi disabled on ESP32."); }
 }
-function updateSliderValueDisplay(value) { document.getElementById('manualSpeedValue').innerText = value; }
-function setManualSpeed(value) {
-  updateSliderValueDisplay(value); 
-  sendCommand({ action: 'setManualSpeed', value: parseInt(value) });
+function buildFanChannelCards(count) {
+  const container = document.getElementById('fanChannelsContainer');
+  if (!container) return;
+  container.innerHTML = '';
+  const select = document.getElementById('curveChannelSelect');
+  if (select) select.innerHTML = '';
+  for (let ch = 0; ch < count; ch++) {
+    const div = document.createElement('div');
+    div.classList.add('fan-channel');
+    div.innerHTML = `
+      ${count > 1 ? `<h3>Fan ${ch + 1}</h3>` : ''}
+      <div class="data-grid">
+        <span class="data-label">Fan Speed:</span> <span id="fanSpeed_${ch}" class="data-value">--</span> %
+        <span class="data-label">Fan RPM:</span> <span id="rpm_${ch}" class="data-value">--</span> RPM
+        <span class="data-label">Mode:</span> <span id="mode_${ch}" class="data-value">--</span> <span id="autoModeNotice_${ch}" class="data-value" style="font-size:0.8em; color:#e67e22;"></span>
+      </div>
+      <button onclick="sendCommand({action: 'setModeAuto', channel: ${ch}})">Auto Mode</button>
+      <button onclick="sendCommand({action: 'setModePid', channel: ${ch}})">PID Mode</button>
+      <button onclick="sendCommand({action: 'setModeManual', channel: ${ch}})">Manual Mode</button>
+      <button id="rpmModeButton_${ch}" onclick="setTargetRpm(${ch})">RPM Mode</button>
+      <div class="slider-container" id="manualControl_${ch}" style="display:none;">
+        <p>Manual Fan Speed: <span id="manualSpeedValue_${ch}">50</span>%</p>
+        <input type="range" min="0" max="100" value="50" id="speedSlider_${ch}" oninput="updateSliderValueDisplay(${ch}, this.value)" onchange="setManualSpeed(${ch}, this.value)">
+      </div>
+      <div class="config-item" id="rpmControl_${ch}">
+        <label for="targetRpm_${ch}">Target RPM:</label>
+        <input type="number" id="targetRpm_${ch}" min="0" max="20000" step="50">
+        <span class="data-value" style="font-size:0.8em;">Learned: <span id="rpmModelPoints_${ch}">0</span> pts</span>
+        <button onclick="sendCommand({action: 'resetRpmModel', channel: ${ch}})" class="secondary">Relearn</button>
+      </div>
+      <div class="config-item" id="calControl_${ch}">
+        <span class="data-label">Calibration:</span> <span id="calStatus_${ch}" class="data-value">--</span>
+        <button id="calStartButton_${ch}" onclick="startCalibration(${ch})" class="secondary">Calibrate</button>
+        <button id="calCancelButton_${ch}" onclick="sendCommand({action: 'cancelCalibration', channel: ${ch}})" class="secondary" style="display:none;">Cancel</button>
+        <button onclick="sendCommand({action: 'clearCalibration', channel: ${ch}})" class="secondary">Clear</button>
+      </div>`;
+    container.appendChild(div);
+    if (select) {
+      const option = document.createElement('option');
+      option.value = ch;
+      option.innerText = `Fan ${ch + 1}`;
+      select.appendChild(option);
+    }
+  }
+  if (select) {
+    if (selectedCurveChannel >= count) selectedCurveChannel = 0;
+    select.value = selectedCurveChannel;
+    select.parentElement.classList.toggle('hidden', count <= 1);
+  }
+  renderedChannelCount = count;
+}
+function renderFanChannels(channels, tempSensorFound) {
+  if (channels.length !== renderedChannelCount) buildFanChannelCards(channels.length);
+  channels.forEach((channel, ch) => {
+    if (channel.fanSpeed !== undefined) document.getElementById(`fanSpeed_${ch}`).innerText = channel.fanSpeed;
+    if (channel.fanRpm !== undefined) document.getElementById(`rpm_${ch}`).innerText = channel.fanRpm;
+    if (channel.isAutoMode !== undefined) {
+      document.getElementById(`mode_${ch}`).innerText = !channel.isAutoMode ? (channel.isRpmMode ? "RPM" : "MANUAL") : (channel.isPidMode ? "PID" : "AUTO");
+      document.getElementById(`manualControl_${ch}`).style.display = (channel.isAutoMode || channel.isRpmMode) ? 'none' : 'block';
+      document.getElementById(`autoModeNotice_${ch}`).innerText =
+        (channel.isAutoMode && tempSensorFound === false) ? '(Sensor N/A - Fixed Speed)' : '';
+    }
+    if (channel.hasTach !== undefined) {
+      document.getElementById(`rpmModeButton_${ch}`).style.display = channel.hasTach ? '' : 'none';
+      document.getElementById(`rpmControl_${ch}`).style.display = channel.hasTach ? '' : 'none';
+      document.getElementById(`calControl_${ch}`).style.display = channel.hasTach ? '' : 'none';
+    }
+    if (channel.calStatus !== undefined) {
+      const running = channel.calStatus === 'RUNNING';
+      document.getElementById(`calStatus_${ch}`).innerText = channel.calStatus === 'DONE'
+        ? `start ${channel.calStartDuty}%, stall ${channel.calStallDuty}%, max ${channel.calMaxRpm} RPM`
+        : (running ? 'Running...' : (channel.calStatus === 'FAILED' ? 'Failed' : 'Not calibrated'));
+      document.getElementById(`calStartButton_${ch}`).style.display = running ? 'none' : '';
+      document.getElementById(`calCancelButton_${ch}`).style.display = running ? '' : 'none';
+    }
+    const targetRpmInput = document.getElementById(`targetRpm_${ch}`);
+    if (channel.targetRpm !== undefined && document.activeElement !== targetRpmInput) targetRpmInput.value = channel.targetRpm;
+    if (channel.rpmModelPoints !== undefined) document.getElementById(`rpmModelPoints_${ch}`).innerText = channel.rpmModelPoints;
+    if (channel.manualFanSpeed !== undefined && !channel.isAutoMode) {
+      document.getElementById(`speedSlider_${ch}`).value = channel.manualFanSpeed;
+      document.getElementById(`manualSpeedValue_${ch}`).innerText = channel.manualFanSpeed;
+    }
+  });
+}
+function onCurveChannelChange() {
+  const select = document.getElementById('curveChannelSelect');
+  selectedCurveChannel = parseInt(select.value) || 0;
+  const channel = lastChannels[selectedCurveChannel];
+  if (channel && Array.isArray(channel.fanCurve)) displayFanCurve(channel.fanCurve);
+}
+function updateSliderValueDisplay(channel, value) { document.getElementById(`manualSpeedValue_${channel}`).innerText = value; }
+function setTargetRpm(channel) {
+  const targetRpm = parseInt(document.getElementById(`targetRpm_${channel}`).value);
+  if (isNaN(targetRpm) || targetRpm < 0 || targetRpm > 20000) { alert("Target RPM must be between 0 and 20000."); return; }
+  sendCommand({ action: 'setModeRpm', channel: channel, targetRpm: targetRpm });
+}
+function startCalibration(channel) {
+  if (!confirm(`Calibrate Fan ${channel + 1}? It is stopped and swept from 0 to 100% over a few minutes, ignoring the current mode.`)) return;
+  sendCommand({ action: 'startCalibration', channel: channel });
+}
+function setManualSpeed(channel, value) {
+  updateSliderValueDisplay(channel, value); 
+  sendCommand({ action: 'setManualSpeed', channel: channel, value: parseInt(value) });
 }
 function displayFanCurve(curvePoints) {
   const container = document.getElementById('fanCurvePointsContainer');
@@ -253,10 +482,41 @@ function saveFanCurve() {
     alert(`Maximum ${MAX_CURVE_POINTS_UI} points allowed for a fan curve.`); 
     return; 
   }
-  sendCommand({ action: 'setCurve', curve: points });
+  sendCommand({ action: 'setCurve', channel: selectedCurveChannel, curve: points });
   alert("Fan curve sent to device. It will be validated and saved by the ESP32.");
 }
 
+function savePidConfig() {
+  const pidConfig = {
+    action: 'setPidConfig',
+    setpoint: parseFloat(document.getElementById('pidSetpoint').value),
+    kp: parseFloat(document.getElementById('pidKp').value),
+    ki: parseFloat(document.getElementById('pidKi').value),
+    kd: parseFloat(document.getElementById('pidKd').value)
+  };
+  if ([pidConfig.setpoint, pidConfig.kp, pidConfig.ki, pidConfig.kd].some(isNaN)) {
+    alert("All PID fields must be numbers."); return;
+  }
+  if (pidConfig.setpoint < 0 || pidConfig.setpoint > 120) { alert("Setpoint must be between 0 and 120 C."); return; }
+  if (pidConfig.kp < 0 || pidConfig.ki < 0 || pidConfig.kd < 0) { alert("PID gains cannot be negative."); return; }
+  sendCommand(pidConfig);
+}
+
+function saveOutputConfig() {
+  const outputConfig = {
+    action: 'setOutputConfig',
+    rampUp: parseFloat(document.getElementById('rampUp').value),
+    rampDown: parseFloat(document.getElementById('rampDown').value),
+    hysteresis: parseFloat(document.getElementById('hysteresis').value)
+  };
+  if ([outputConfig.rampUp, outputConfig.rampDown, outputConfig.hysteresis].some(isNaN)) {
+    alert("All smoothing fields must be numbers."); return;
+  }
+  if (outputConfig.rampUp < 0 || outputConfig.rampDown < 0) { alert("Ramp limits cannot be negative."); return; }
+  if (outputConfig.hysteresis < 0 || outputConfig.hysteresis > 10) { alert("Hysteresis must be between 0 and 10 C."); return; }
+  sendCommand(outputConfig);
+}
+
 function toggleMqttFields() {
   const mqttEnableCheckbox = document.getElementById('mqttEnable');
   const mqttFieldsContainer = document.getElementById('mqttFieldsContainer');
@@ -0,0 +1,21 @@
+#include "byte_rate.h"
+
+void byteRateAdd(ByteRate* rate, uint32_t bytes, uint32_t nowMs) {
+    uint32_t slot = nowMs / BYTE_RATE_BUCKET_MS;
+    int i = slot % BYTE_RATE_BUCKETS;
+    if (rate->slot[i] != slot) { // Bucket last used a full window ago (or never)
+        rate->slot[i] = slot;
+        rate->bytes[i] = 0;
+    }
+    rate->bytes[i] += bytes;
+    rate->total += bytes;
+}
+
+uint32_t byteRatePerMinute(const ByteRate* rate, uint32_t nowMs) {
+    uint32_t slot = nowMs / BYTE_RATE_BUCKET_MS;
+    uint32_t sum = 0;
+    for (int i = 0; i < BYTE_RATE_BUCKETS; i++) {
+        if (slot - rate->slot[i] < (uint32_t)BYTE_RATE_BUCKETS) sum += rate->bytes[i];
+    }
+    return sum;
+}
@@ -0,0 +1,22 @@
+#ifndef BYTE_RATE_H
+#define BYTE_RATE_H
+
+#include <stdint.h>
+
+// Bytes per minute over a sliding window of BYTE_RATE_BUCKETS ten-second buckets, for wire-traffic stats.
+// Single writer; byteRatePerMinute() only reads, so other tasks may call it (a bucket caught mid-update
+// only skews one report).
+
+const int BYTE_RATE_BUCKETS = 6;
+const uint32_t BYTE_RATE_BUCKET_MS = 10000;
+
+struct ByteRate {
+    uint32_t bytes[BYTE_RATE_BUCKETS];
+    uint32_t slot[BYTE_RATE_BUCKETS];  // nowMs / BYTE_RATE_BUCKET_MS the bucket was last filled in
+    uint32_t total;                    // All bytes ever added (wraps)
+};
+
+void byteRateAdd(ByteRate* rate, uint32_t bytes, uint32_t nowMs);
+uint32_t byteRatePerMinute(const ByteRate* rate, uint32_t nowMs); // Last 60 s, the current bucket included
+
+#endif // BYTE_RATE_H
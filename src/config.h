@@ -5,7 +5,6 @@
 #include <WiFi.h>
 #include <AsyncTCP.h>
 #include <ESPAsyncWebServer.h>
-#include <WebSocketsServer.h>
 #include <Wire.h>
 #include <Adafruit_BMP280.h>
 #include <LiquidCrystal_I2C.h>
@@ -15,6 +14,11 @@
 #include <HTTPClient.h>   // For OTA from URL
 #include <HTTPUpdate.h>   // For OTA from URL
 #include <SPIFFS.h>       // For loading CA from SPIFFS
+#include "controller_state.h"
+#include "control_command_queue.h"
+#include "nvs_save_scheduler.h"
+#include "ota_progress.h"
+#include "wifi_link.h"
 
 // --- Firmware Version ---
 #define FIRMWARE_VERSION "0.1.2" // Define firmware version
@@ -28,11 +32,21 @@
 
 // --- OTA Update Status ---
 extern volatile bool ota_in_progress;
-extern String ota_status_message; 
 extern String GITHUB_API_ROOT_CA_STRING; // Extern declaration
 
+// --- Fan Channels ---
+// Number of fans wired to this controller. Override with a build flag, e.g. -DFAN_CHANNEL_COUNT=4
+#ifndef FAN_CHANNEL_COUNT
+#define FAN_CHANNEL_COUNT 1
+#endif
+const int MAX_FAN_CHANNELS = 8;
+static_assert(MAX_FAN_CHANNELS <= CONTROLLER_STATE_MAX_CHANNELS, "ControllerState must hold every fan channel");
+const int NUM_FAN_CHANNELS = FAN_CHANNEL_COUNT;
+static_assert(FAN_CHANNEL_COUNT >= 1 && FAN_CHANNEL_COUNT <= MAX_FAN_CHANNELS, "FAN_CHANNEL_COUNT must be 1-8");
+
 // --- Pin Definitions ---
-extern const int FAN_PWM_PIN;
+extern const int FAN_PWM_PINS[MAX_FAN_CHANNELS];
+extern const int FAN_TACH_PINS[MAX_FAN_CHANNELS]; // -1 = channel has no tachometer wired
 extern const int BTN_MENU_PIN;    
 extern const int BTN_UP_PIN;      
 extern const int BTN_DOWN_PIN;    
@@ -40,28 +54,64 @@ extern const int BTN_SELECT_PIN;
 extern const int BTN_BACK_PIN;     
 extern const int DEBUG_ENABLE_PIN; 
 extern const int LED_DEBUG_PIN;    
-extern const int FAN_TACH_PIN_ACTUAL; 
 
 // --- Fan Control Constants ---
-extern const int PWM_CHANNEL;
+extern const int FAN_LEDC_CHANNELS[MAX_FAN_CHANNELS];
 extern const int PWM_FREQ;
 extern const int PWM_RESOLUTION_BITS;
 extern const int AUTO_MODE_NO_SENSOR_FAN_PERCENTAGE;
 extern const int PULSES_PER_REVOLUTION;
+extern const unsigned long PID_CONTROL_PERIOD_MS;
+
+// --- Tachometer Counting ---
+// 1 = count tach edges in the PCNT peripheral (hardware glitch filter, no interrupt per edge).
+// 0 = per-edge GPIO interrupt (countPulse). Override with -DTACH_USE_PCNT=0.
+// With PCNT enabled, a channel whose PCNT unit fails to configure falls back to the interrupt.
+#ifndef TACH_USE_PCNT
+#define TACH_USE_PCNT 1
+#endif
+extern const int TACH_PCNT_FILTER_APB_CYCLES; // Pulses shorter than this (80 MHz APB cycles, max 1023) are ignored
+extern const int TACH_PERIOD_MAX_RPM;              // Inter-edge period estimate up to here, window counting above
+extern const unsigned long TACH_WINDOW_MS;         // Window counting span
+extern const unsigned long TACH_STALL_TIMEOUT_MS;  // No edge for this long reads as 0 RPM (period estimate)
+extern const unsigned long TACH_STALL_CHECK_MS;    // No pulses this long at a window rate predicting >= 4 reads as 0 RPM
+
+// --- RPM Target Mode ---
+extern const int FAN_RPM_TARGET_MAX;                   // Upper bound accepted for a target RPM
+extern const float FAN_RPM_KP;                         // % duty per RPM of error
+extern const float FAN_RPM_KI;                         // % duty per RPM of error per second
+extern const unsigned long FAN_RPM_SETTLE_MS;          // Duty must hold this long before its RPM is learned
+extern const unsigned long FAN_RPM_MODEL_SAVE_INTERVAL_MS; // Learned tables are written to NVS at most this often
+
+// --- Start Limits (active once a fan is calibrated) ---
+extern const int FAN_KICK_DUTY_PERCENT;           // Duty of the spin-up pulse for a fan at standstill
+extern const unsigned long FAN_KICK_MS;           // Length of the spin-up pulse
+extern const unsigned long FAN_KICK_RETRY_MS;     // Pause before kicking again a fan that still does not turn
+
+// --- PID Control (shared by every channel in PID mode, persisted in NVS) ---
+extern volatile float pidSetpointC; 
+extern volatile float pidKp; 
+extern volatile float pidKi; 
+extern volatile float pidKd; 
+
+// --- Output Conditioning (auto/PID output -> setFanSpeed, persisted in NVS) ---
+extern volatile float fanRampUpPercentPerS;   // 0 = no limit
+extern volatile float fanRampDownPercentPerS; // 0 = no limit
+extern volatile float fanHysteresisC;         // Curve mode only, 0 = off
+extern volatile unsigned long fanOutputWrites;            // PWM writes made by the control tick
+extern volatile unsigned long fanSuppressedOutputChanges; // Target changes absorbed without a PWM write
+extern volatile unsigned long fanSuppressedBroadcasts;    // Immediate broadcasts those writes would have triggered
 
 // --- Modes & States (Global Volatile Variables) ---
-extern volatile bool isAutoMode;
-extern volatile int manualFanSpeedPercentage;
 extern volatile bool isInMenuMode;
 extern volatile bool isWiFiEnabled; 
+extern const unsigned long WIFI_CONNECT_TIMEOUT_MS; // Attempt without an IP after this long is retried (wifi_manager.h)
+extern const unsigned long WIFI_FAST_CONNECT_TIMEOUT_MS; // Same for a join from the cached BSSID/channel
+extern const unsigned long WIFI_BACKOFF_MIN_MS;     // Retry wait after a failed attempt, doubled per failure...
+extern const unsigned long WIFI_BACKOFF_MAX_MS;     // ...up to this
 extern volatile bool serialDebugEnabled; 
 extern volatile float currentTemperature; 
 extern volatile bool tempSensorFound;      
-extern volatile int fanRpm;
-extern volatile int fanSpeedPercentage;
-extern volatile int fanSpeedPWM_Raw;
-extern volatile unsigned long pulseCount; // For ISR
-extern unsigned long lastRpmReadTime_Task; 
 
 // --- Menu System Variables ---
 enum MenuScreen { 
@@ -89,10 +139,27 @@ extern volatile char currentPasswordEditChar;
 
 // --- Fan Curve ---
 const int MAX_CURVE_POINTS = 8; 
-extern int tempPoints[MAX_CURVE_POINTS];
-extern int pwmPercentagePoints[MAX_CURVE_POINTS];
-extern int numCurvePoints;
-extern volatile bool fanCurveChanged; 
+static_assert(MAX_CURVE_POINTS <= CONTROLLER_STATE_MAX_CURVE_POINTS, "ControllerState must hold every curve point");
+static_assert(MAX_CURVE_POINTS <= CONTROL_COMMAND_MAX_CURVE_POINTS, "ControlCommand must hold every curve point");
+
+// --- Per-Channel Fan State ---
+// Struct-of-arrays: every field is a contiguous array indexed by channel, so one control
+// tick sweeps all channels field by field in a single pass.
+struct FanChannelState {
+    volatile bool isAutoMode[MAX_FAN_CHANNELS];
+    volatile bool isPidMode[MAX_FAN_CHANNELS]; // Auto mode sub-mode: PID on pidSetpointC instead of the curve
+    volatile bool isRpmMode[MAX_FAN_CHANNELS]; // Manual mode sub-mode: hold targetRpm instead of a fixed duty
+    volatile int targetRpm[MAX_FAN_CHANNELS];
+    volatile int manualSpeedPercentage[MAX_FAN_CHANNELS];
+    volatile int speedPercentage[MAX_FAN_CHANNELS];
+    volatile int pwmRaw[MAX_FAN_CHANNELS];
+    volatile int rpm[MAX_FAN_CHANNELS];
+    volatile unsigned long pulseCount[MAX_FAN_CHANNELS]; // Incremented by the tach ISR (channels not on PCNT)
+    int curveTempPoints[MAX_FAN_CHANNELS][MAX_CURVE_POINTS];
+    int curvePwmPoints[MAX_FAN_CHANNELS][MAX_CURVE_POINTS];
+    int curveNumPoints[MAX_FAN_CHANNELS];
+};
+extern FanChannelState fanChannels;
 
 // Staging Fan Curve for Serial Commands
 extern int stagingTempPoints[MAX_CURVE_POINTS];
@@ -100,7 +167,17 @@ extern int stagingPwmPercentagePoints[MAX_CURVE_POINTS];
 extern int stagingNumCurvePoints;
 
 // --- Task Communication ---
-extern volatile bool needsImmediateBroadcast; 
+extern const unsigned long CONTROL_TASK_PERIOD_MS;  // Fixed period of controlTask; queued commands wake it in between
+extern const unsigned long MAIN_APP_TASK_PERIOD_MS; // Serial/button polling of mainAppTask; button edges wake it in between
+extern const unsigned long NETWORK_TASK_POLL_MS;    // Longest networkTask sleep while MQTT is enabled (PubSubClient is polled)
+extern const unsigned long NETWORK_TASK_IDLE_MS;    // Longest sleep otherwise (WiFi timers, periodic broadcast)
+extern const unsigned long NETWORK_LONG_POLL_BROADCAST_MS; // Periodic broadcast while a /api/status long-poll waits (else 5 s)
+extern std::atomic<bool> needsImmediateBroadcast; // Consumed by controlTask, which bumps controllerState's broadcastSeq
+extern ControllerStateSeqlock controllerState; // Published by controlTask every pass, read by networkTask
+extern ControlCommandQueue controlCommandQueue; // Control changes from any task, drained by controlTask
+extern const unsigned long NVS_SAVE_DEBOUNCE_MS;  // A changed setting is written once it has been quiet this long
+extern const unsigned long NVS_SAVE_MAX_DELAY_MS; // ...or at the latest this long after its first change
+extern NvsSaveScheduler nvsSaveScheduler; // Dirty settings sections, written by nvsPersistenceTask
 extern volatile bool rebootNeeded; 
 
 // --- MQTT Configuration ---
@@ -119,16 +196,23 @@ extern char mqttDeviceName[64];
 
 // --- OTA Update Status ---
 extern volatile bool ota_in_progress;
-extern String ota_status_message; 
+extern OtaProgress otaProgress; // Download of the current image, written by the OTA task (status message: ota_updater.h)
+extern const unsigned long OTA_PROGRESS_REPORT_MS; // Progress is pushed to WebSocket/MQTT at most this often
 extern String GITHUB_API_ROOT_CA_STRING; // Will hold the CA loaded from SPIFFS
 
+// --- Server-Sent Events (/events, network_handler.h) ---
+extern const unsigned long SSE_CLIENT_MIN_INTERVAL_MS; // Telemetry events per client at most this often
+extern const size_t SSE_CLIENT_MAX_QUEUED;             // A client with this many messages waiting gets no more...
+extern const unsigned long SSE_CLIENT_STALL_DROP_MS;   // ...and is closed if its queue stays full this long
+
 
 // --- Global Objects (declared extern, defined in main.cpp) ---
 extern Preferences preferences;
 extern Adafruit_BMP280 bmp;
 extern LiquidCrystal_I2C lcd;
 extern AsyncWebServer server;
-extern WebSocketsServer webSocket;
+extern AsyncWebSocket webSocket; // /ws on the port 80 server
+extern AsyncEventSource events;  // /events (Server-Sent Events) on the port 80 server
 extern WiFiClient espClient; 
 extern PubSubClient mqttClient; 
 
@@ -140,6 +224,8 @@ extern const long longPressDelay;
 
 // --- SSID and Password (defined in main.cpp, might be loaded from NVS) ---
 extern char current_ssid[64]; 
+extern WifiJoinCache wifiJoinCache;     // Last successful join (wifi-cfg/join), updated by networkTask
+extern WifiStaticIpConfig wifiStaticIp; // Optional static address (wifi-cfg), used instead of DHCP when enabled
 extern char current_password[64]; 
 
 #endif // CONFIG_H
@@ -0,0 +1,78 @@
+#include "control_command_queue.h"
+#include <math.h>
+#include <string.h>
+
+ControlCommand makeControlCommand(ControlCommandType type, int channel, ControlCommandSource source) {
+    ControlCommand command;
+    memset(&command, 0, sizeof(command));
+    command.type = type;
+    command.source = source;
+    command.channel = (int8_t)channel;
+    command.value = CONTROL_COMMAND_KEEP;
+    for (int i = 0; i < 4; i++) command.params[i] = NAN;
+    return command;
+}
+
+void controlCommandQueueInit(ControlCommandQueue* queue) {
+    for (uint32_t i = 0; i < CONTROL_COMMAND_QUEUE_SIZE; i++) queue->cells[i].sequence.store(i, std::memory_order_relaxed);
+    queue->enqueuePos.store(0, std::memory_order_relaxed);
+    queue->dequeuePos.store(0, std::memory_order_relaxed);
+    queue->enqueued.store(0, std::memory_order_relaxed);
+    queue->dropped.store(0, std::memory_order_relaxed);
+    queue->maxDepth.store(0, std::memory_order_relaxed);
+    queue->applied = 0;
+    queue->latencyMaxUs = 0;
+    queue->latencyTotalUs = 0;
+    std::atomic_thread_fence(std::memory_order_release);
+}
+
+bool controlCommandQueuePush(ControlCommandQueue* queue, const ControlCommand& command, uint32_t nowMicros) {
+    ControlCommandQueueCell* cell;
+    uint32_t pos = queue->enqueuePos.load(std::memory_order_relaxed);
+    for (;;) {
+        cell = &queue->cells[pos & (CONTROL_COMMAND_QUEUE_SIZE - 1)];
+        int32_t diff = (int32_t)(cell->sequence.load(std::memory_order_acquire) - pos);
+        if (diff == 0) {
+            if (queue->enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+        } else if (diff < 0) {
+            queue->dropped.fetch_add(1, std::memory_order_relaxed); // Slot still holds an undrained command: full
+            return false;
+        } else {
+            pos = queue->enqueuePos.load(std::memory_order_relaxed); // Another producer took this slot
+        }
+    }
+    cell->command = command;
+    cell->command.enqueuedMicros = nowMicros;
+    cell->sequence.store(pos + 1, std::memory_order_release);
+
+    queue->enqueued.fetch_add(1, std::memory_order_relaxed);
+    uint32_t depth = pos + 1 - queue->dequeuePos.load(std::memory_order_relaxed);
+    uint32_t seen = queue->maxDepth.load(std::memory_order_relaxed);
+    while (depth > seen && !queue->maxDepth.compare_exchange_weak(seen, depth, std::memory_order_relaxed)) {}
+    return true;
+}
+
+bool controlCommandQueuePop(ControlCommandQueue* queue, ControlCommand* out, uint32_t nowMicros) {
+    uint32_t pos = queue->dequeuePos.load(std::memory_order_relaxed);
+    ControlCommandQueueCell* cell = &queue->cells[pos & (CONTROL_COMMAND_QUEUE_SIZE - 1)];
+    if ((int32_t)(cell->sequence.load(std::memory_order_acquire) - (pos + 1)) < 0) return false; // Empty, or claimed but not yet written
+    *out = cell->command;
+    cell->sequence.store(pos + CONTROL_COMMAND_QUEUE_SIZE, std::memory_order_release); // Free for the next lap
+    queue->dequeuePos.store(pos + 1, std::memory_order_relaxed);
+
+    uint32_t latency = nowMicros - out->enqueuedMicros;
+    queue->applied++;
+    queue->latencyTotalUs += latency;
+    if (latency > queue->latencyMaxUs) queue->latencyMaxUs = latency;
+    return true;
+}
+
+void controlCommandQueueGetStats(const ControlCommandQueue* queue, ControlCommandQueueStats* stats) {
+    stats->depth = queue->enqueuePos.load(std::memory_order_relaxed) - queue->dequeuePos.load(std::memory_order_relaxed);
+    stats->maxDepth = queue->maxDepth.load(std::memory_order_relaxed);
+    stats->enqueued = queue->enqueued.load(std::memory_order_relaxed);
+    stats->dropped = queue->dropped.load(std::memory_order_relaxed);
+    stats->applied = queue->applied;
+    stats->latencyAvgUs = queue->applied ? (uint32_t)(queue->latencyTotalUs / queue->applied) : 0;
+    stats->latencyMaxUs = queue->latencyMaxUs;
+}
@@ -0,0 +1,84 @@
+#ifndef CONTROL_COMMAND_QUEUE_H
+#define CONTROL_COMMAND_QUEUE_H
+
+#include <stdint.h>
+#include <atomic>
+
+// Typed control commands and the bounded lock-free queue that carries them from the WebSocket, MQTT and
+// serial handlers (any task, any core) to controlTask, which drains and applies them at the top of its tick.
+// Multi-producer / single-consumer ring after Vyukov's bounded queue: producers claim a slot with one CAS,
+// every slot has its own sequence number, and nothing ever blocks. A full queue drops the new command.
+
+const uint32_t CONTROL_COMMAND_QUEUE_SIZE = 32; // Power of two
+const int CONTROL_COMMAND_MAX_CURVE_POINTS = 8;
+const int CONTROL_COMMAND_ALL_CHANNELS = -1;
+const int CONTROL_COMMAND_KEEP = -1; // value: keep the current setting
+
+enum ControlCommandType : uint8_t {
+    CMD_SET_MODE_AUTO,
+    CMD_SET_MODE_PID,
+    CMD_SET_MODE_MANUAL,      // value: manual speed % (CONTROL_COMMAND_KEEP = keep, 50 % if the fan is stopped at 0 %)
+    CMD_SET_MANUAL_SPEED,     // value: speed %, ignored by channels not in manual mode
+    CMD_SET_RPM_TARGET,       // value: target RPM (CONTROL_COMMAND_KEEP = last target), switches to RPM mode
+    CMD_FAN_ON,               // Manual mode at the last manual speed (50 % if that was 0)
+    CMD_FAN_OFF,              // Manual mode at 0 %
+    CMD_SET_CURVE,            // curve points, saved to NVS
+    CMD_LOAD_DEFAULT_CURVE,
+    CMD_SET_PID,              // params: setpoint, kp, ki, kd (NaN = keep)
+    CMD_SET_OUTPUT_CONFIG,    // params: ramp up, ramp down, hysteresis (NaN = keep)
+    CMD_RESET_RPM_MODEL,
+    CMD_CALIBRATION_START,
+    CMD_CALIBRATION_CANCEL,
+    CMD_CALIBRATION_CLEAR
+};
+
+enum ControlCommandSource : uint8_t { CMD_SOURCE_WEBSOCKET, CMD_SOURCE_MQTT, CMD_SOURCE_SERIAL };
+
+struct ControlCommand {
+    uint8_t type;            // ControlCommandType
+    uint8_t source;          // ControlCommandSource, for logging
+    int8_t channel;          // 0-based fan channel or CONTROL_COMMAND_ALL_CHANNELS
+    uint8_t curveNumPoints;
+    uint32_t enqueuedMicros; // Stamped by controlCommandQueuePush
+    int32_t value;
+    float params[4];
+    uint8_t curveTemp[CONTROL_COMMAND_MAX_CURVE_POINTS];
+    uint8_t curvePwm[CONTROL_COMMAND_MAX_CURVE_POINTS];
+};
+
+struct ControlCommandQueueCell {
+    std::atomic<uint32_t> sequence; // == position: free for that enqueue; == position + 1: holds its command
+    ControlCommand command;
+};
+
+struct ControlCommandQueue {
+    ControlCommandQueueCell cells[CONTROL_COMMAND_QUEUE_SIZE];
+    std::atomic<uint32_t> enqueuePos;
+    std::atomic<uint32_t> dequeuePos; // Advanced by the consumer only, read by producers for the depth
+    std::atomic<uint32_t> enqueued;
+    std::atomic<uint32_t> dropped;
+    std::atomic<uint32_t> maxDepth;
+    uint32_t applied;                 // Consumer-side counters
+    uint32_t latencyMaxUs;
+    uint64_t latencyTotalUs;
+};
+
+struct ControlCommandQueueStats {
+    uint32_t depth;
+    uint32_t maxDepth;
+    uint32_t enqueued;
+    uint32_t dropped;
+    uint32_t applied;
+    uint32_t latencyAvgUs; // Enqueue -> dequeue
+    uint32_t latencyMaxUs;
+};
+
+// Zeroed command of the given type, value CONTROL_COMMAND_KEEP and every param NaN.
+ControlCommand makeControlCommand(ControlCommandType type, int channel, ControlCommandSource source);
+
+void controlCommandQueueInit(ControlCommandQueue* queue); // Before any producer or consumer runs
+bool controlCommandQueuePush(ControlCommandQueue* queue, const ControlCommand& command, uint32_t nowMicros); // False (and counted) if full
+bool controlCommandQueuePop(ControlCommandQueue* queue, ControlCommand* out, uint32_t nowMicros); // Single consumer; false if empty
+void controlCommandQueueGetStats(const ControlCommandQueue* queue, ControlCommandQueueStats* stats);
+
+#endif // CONTROL_COMMAND_QUEUE_H
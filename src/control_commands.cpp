@@ -0,0 +1,198 @@
+#include "control_commands.h"
+#include "fan_control.h"
+#include "nvs_handler.h"
+#include "tasks.h"
+
+static LatencyHistogram commandOutputLatency; // Enqueue -> end of the control pass after the apply
+static uint32_t pendingOutputStamps[CONTROL_COMMAND_QUEUE_SIZE]; // Enqueue times of commands applied since that pass
+static int pendingOutputCount = 0;
+static volatile bool commandOutputLatencyResetPending = false;
+
+void setupControlCommands() {
+    controlCommandQueueInit(&controlCommandQueue);
+    latencyHistogramReset(&commandOutputLatency);
+}
+
+const char* getControlCommandSourceName(uint8_t source) {
+    switch (source) {
+        case CMD_SOURCE_WEBSOCKET: return "WebSocket";
+        case CMD_SOURCE_MQTT: return "MQTT";
+        case CMD_SOURCE_SERIAL: return "Serial";
+        default: return "?";
+    }
+}
+
+bool enqueueControlCommand(const ControlCommand& command) {
+    if (controlCommandQueuePush(&controlCommandQueue, command, micros())) {
+        wakeControlTask(CONTROL_TASK_WAKE_COMMAND);
+        return true;
+    }
+    if(serialDebugEnabled) Serial.printf("[CMD_ERR] Command queue full, %s command %d dropped.\n", getControlCommandSourceName(command.source), command.type);
+    return false;
+}
+
+// NaN fields keep the current value
+static float paramOrCurrent(float param, float current) {
+    return isnan(param) ? current : param;
+}
+
+static void applyControlCommand(const ControlCommand& cmd) {
+    const char* source = getControlCommandSourceName(cmd.source);
+    int firstCh = (cmd.channel == CONTROL_COMMAND_ALL_CHANNELS) ? 0 : cmd.channel;
+    int lastCh = (cmd.channel == CONTROL_COMMAND_ALL_CHANNELS) ? NUM_FAN_CHANNELS - 1 : cmd.channel;
+    if (cmd.channel != CONTROL_COMMAND_ALL_CHANNELS && !isValidFanChannel(cmd.channel)) {
+        if(serialDebugEnabled) Serial.printf("[CMD_ERR] Invalid fan channel %d from %s.\n", cmd.channel, source);
+        return;
+    }
+
+    switch (cmd.type) {
+        case CMD_SET_MODE_AUTO:
+        case CMD_SET_MODE_PID:
+            for (int ch = firstCh; ch <= lastCh; ch++) setFanMode(ch, true, cmd.type == CMD_SET_MODE_PID);
+            if(serialDebugEnabled) Serial.printf("[SYSTEM] Mode changed to %s via %s.\n", cmd.type == CMD_SET_MODE_PID ? "PID" : "AUTO", source);
+            break;
+        case CMD_SET_MODE_MANUAL:
+            for (int ch = firstCh; ch <= lastCh; ch++) {
+                setFanMode(ch, false, false);
+                if (cmd.value >= 0) fanChannels.manualSpeedPercentage[ch] = cmd.value;
+                else if (fanChannels.speedPercentage[ch] == 0 && fanChannels.manualSpeedPercentage[ch] == 0) fanChannels.manualSpeedPercentage[ch] = 50;
+            }
+            if(serialDebugEnabled) Serial.printf("[SYSTEM] Mode changed to MANUAL via %s.\n", source);
+            break;
+        case CMD_SET_MANUAL_SPEED:
+            for (int ch = firstCh; ch <= lastCh; ch++) {
+                if (!fanChannels.isAutoMode[ch]) {
+                    fanChannels.manualSpeedPercentage[ch] = cmd.value;
+                    if(serialDebugEnabled) Serial.printf("[SYSTEM] Fan %d manual speed target set to %d%% via %s.\n", ch + 1, cmd.value, source);
+                } else {
+                    if(serialDebugEnabled) Serial.printf("[CMD_WARN] Ignored manual speed for fan %d, not in manual mode.\n", ch + 1);
+                }
+            }
+            break;
+        case CMD_SET_RPM_TARGET:
+            for (int ch = firstCh; ch <= lastCh; ch++) {
+                int targetRpm = cmd.value;
+                if (targetRpm == CONTROL_COMMAND_KEEP) {
+                    // targetRpm is not persisted, so after boot there is no last target: hold the current
+                    // speed instead, and refuse rather than read "keep" as 0 RPM (stop)
+                    targetRpm = fanChannels.targetRpm[ch] > 0 ? fanChannels.targetRpm[ch] : fanChannels.rpm[ch];
+                    if (targetRpm <= 0) {
+                        if(serialDebugEnabled) Serial.printf("[CMD_ERR] RPM mode rejected for fan %d: no previous target and the fan is not turning, send a target RPM.\n", ch + 1);
+                        continue;
+                    }
+                }
+                if (setFanRpmTarget(ch, targetRpm)) {
+                    if(serialDebugEnabled) Serial.printf("[SYSTEM] Fan %d mode changed to RPM, target %d via %s.\n", ch + 1, targetRpm, source);
+                } else {
+                    if(serialDebugEnabled) Serial.printf("[CMD_ERR] RPM mode rejected for fan %d (no tachometer or target out of range).\n", ch + 1);
+                }
+            }
+            break;
+        case CMD_FAN_ON:
+        case CMD_FAN_OFF:
+            // The control tick writes the new duty right after the drain
+            for (int ch = firstCh; ch <= lastCh; ch++) {
+                setFanMode(ch, false, false);
+                if (cmd.type == CMD_FAN_OFF) fanChannels.manualSpeedPercentage[ch] = 0;
+                else if (fanChannels.manualSpeedPercentage[ch] == 0) fanChannels.manualSpeedPercentage[ch] = 50;
+            }
+            if(serialDebugEnabled) Serial.printf("[SYSTEM] Fan turned %s via %s.\n", cmd.type == CMD_FAN_ON ? "ON" : "OFF", source);
+            break;
+        case CMD_SET_CURVE:
+            for (int ch = firstCh; ch <= lastCh; ch++) {
+                fanChannels.curveNumPoints[ch] = cmd.curveNumPoints;
+                for (int k = 0; k < cmd.curveNumPoints; k++) {
+                    fanChannels.curveTempPoints[ch][k] = cmd.curveTemp[k];
+                    fanChannels.curvePwmPoints[ch][k] = cmd.curvePwm[k];
+                }
+                requestNvsSave(NVS_SECTION_FAN_CURVE, ch);
+                invalidateFanCurveLut(ch);
+            }
+            if(serialDebugEnabled) Serial.printf("[SYSTEM] Fan curve updated via %s.\n", source);
+            break;
+        case CMD_LOAD_DEFAULT_CURVE:
+            for (int ch = firstCh; ch <= lastCh; ch++) { setDefaultFanCurve(ch); requestNvsSave(NVS_SECTION_FAN_CURVE, ch); }
+            if(serialDebugEnabled) Serial.printf("[SYSTEM] Default fan curve loaded via %s.\n", source);
+            break;
+        case CMD_SET_PID: {
+            float sp = paramOrCurrent(cmd.params[0], pidSetpointC);
+            float kp = paramOrCurrent(cmd.params[1], pidKp);
+            float ki = paramOrCurrent(cmd.params[2], pidKi);
+            float kd = paramOrCurrent(cmd.params[3], pidKd);
+            if (!isValidPidConfig(sp, kp, ki, kd)) {
+                if(serialDebugEnabled) Serial.printf("[CMD_ERR] PID config from %s rejected, values out of range.\n", source);
+                return;
+            }
+            pidSetpointC = sp; pidKp = kp; pidKi = ki; pidKd = kd;
+            requestNvsSave(NVS_SECTION_PID);
+            if(serialDebugEnabled) Serial.printf("[SYSTEM] PID config updated via %s: Setpoint=%.1f C, Kp=%.3f, Ki=%.3f, Kd=%.3f\n", source, sp, kp, ki, kd);
+            break;
+        }
+        case CMD_SET_OUTPUT_CONFIG: {
+            float up = paramOrCurrent(cmd.params[0], fanRampUpPercentPerS);
+            float down = paramOrCurrent(cmd.params[1], fanRampDownPercentPerS);
+            float hyst = paramOrCurrent(cmd.params[2], fanHysteresisC);
+            if (!isValidFanOutputConfig(up, down, hyst)) {
+                if(serialDebugEnabled) Serial.printf("[CMD_ERR] Output config from %s rejected, values out of range.\n", source);
+                return;
+            }
+            fanRampUpPercentPerS = up; fanRampDownPercentPerS = down; fanHysteresisC = hyst;
+            requestNvsSave(NVS_SECTION_FAN_OUTPUT);
+            if(serialDebugEnabled) Serial.printf("[SYSTEM] Output conditioning updated via %s: Ramp up %.1f %%/s, Ramp down %.1f %%/s, Hysteresis %.1f C\n", source, up, down, hyst);
+            break;
+        }
+        case CMD_RESET_RPM_MODEL:
+            for (int ch = firstCh; ch <= lastCh; ch++) requestFanRpmModelReset(ch);
+            if(serialDebugEnabled) Serial.printf("[SYSTEM] PWM -> RPM table cleared via %s.\n", source);
+            break;
+        case CMD_CALIBRATION_START:
+            for (int ch = firstCh; ch <= lastCh; ch++) {
+                if (requestFanCalibration(ch)) {
+                    if(serialDebugEnabled) Serial.printf("[SYSTEM] Fan %d calibration started via %s (takes a few minutes).\n", ch + 1, source);
+                } else {
+                    if(serialDebugEnabled) Serial.printf("[CMD_ERR] Fan %d has no tachometer, calibration unavailable.\n", ch + 1);
+                }
+            }
+            break;
+        case CMD_CALIBRATION_CANCEL:
+            for (int ch = firstCh; ch <= lastCh; ch++) requestFanCalibrationCancel(ch);
+            if(serialDebugEnabled) Serial.printf("[SYSTEM] Calibration cancelled via %s.\n", source);
+            break;
+        case CMD_CALIBRATION_CLEAR:
+            for (int ch = firstCh; ch <= lastCh; ch++) requestFanCalibrationClear(ch);
+            if(serialDebugEnabled) Serial.printf("[SYSTEM] Calibration cleared via %s.\n", source);
+            break;
+        default:
+            if(serialDebugEnabled) Serial.printf("[CMD_ERR] Unknown command %d from %s.\n", cmd.type, source);
+            return;
+    }
+    needsImmediateBroadcast = true;
+}
+
+void drainControlCommands() {
+    // Bounded to one queue's worth per tick, so a producer that keeps pushing cannot stall the control loop
+    ControlCommand command;
+    for (uint32_t i = 0; i < CONTROL_COMMAND_QUEUE_SIZE; i++) {
+        if (!controlCommandQueuePop(&controlCommandQueue, &command, micros())) break;
+        applyControlCommand(command);
+        if (pendingOutputCount < (int)CONTROL_COMMAND_QUEUE_SIZE) pendingOutputStamps[pendingOutputCount++] = command.enqueuedMicros;
+    }
+}
+
+void recordControlCommandOutputLatency() {
+    if (commandOutputLatencyResetPending) {
+        commandOutputLatencyResetPending = false;
+        latencyHistogramReset(&commandOutputLatency);
+    }
+    uint32_t now = micros();
+    for (int i = 0; i < pendingOutputCount; i++) latencyHistogramRecord(&commandOutputLatency, now - pendingOutputStamps[i]);
+    pendingOutputCount = 0;
+}
+
+const LatencyHistogram* getControlCommandOutputLatency() {
+    return &commandOutputLatency;
+}
+
+void resetControlCommandOutputLatency() {
+    commandOutputLatencyResetPending = true;
+}
@@ -0,0 +1,17 @@
+#ifndef CONTROL_COMMANDS_H
+#define CONTROL_COMMANDS_H
+
+#include "config.h"
+#include "latency_histogram.h"
+
+// Control changes from the WebSocket, MQTT and serial handlers travel through controlCommandQueue as typed
+// commands; only controlTask touches the control state, when it drains the queue at the top of its pass.
+void setupControlCommands(); // In setup(), before the tasks start
+bool enqueueControlCommand(const ControlCommand& command); // Any task; false (and logged) if the queue is full
+void drainControlCommands(); // controlTask only
+void recordControlCommandOutputLatency(); // controlTask, after the control pass that follows the drain
+const LatencyHistogram* getControlCommandOutputLatency(); // Receipt -> PWM pass, written by controlTask
+void resetControlCommandOutputLatency(); // Any task; applied on the next record
+const char* getControlCommandSourceName(uint8_t source);
+
+#endif // CONTROL_COMMANDS_H
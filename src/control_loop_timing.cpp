@@ -0,0 +1,27 @@
+#include "control_loop_timing.h"
+#include <string.h>
+
+void controlLoopTimingInit(ControlLoopTiming* timing, uint32_t periodUs) {
+    memset(timing, 0, sizeof(*timing));
+    timing->periodUs = periodUs;
+    latencyHistogramReset(&timing->jitter);
+}
+
+void controlLoopTimingPassStart(ControlLoopTiming* timing, uint32_t nowUs) {
+    if (timing->passes > 0) {
+        uint32_t period = nowUs - timing->lastStartUs;
+        uint32_t jitter = period > timing->periodUs ? period - timing->periodUs : timing->periodUs - period;
+        latencyHistogramRecord(&timing->jitter, jitter);
+        if (timing->minPeriodUs == 0 || period < timing->minPeriodUs) timing->minPeriodUs = period;
+        if (period > timing->maxPeriodUs) timing->maxPeriodUs = period;
+    }
+    timing->lastStartUs = nowUs;
+    timing->passStartUs = nowUs;
+    timing->passes++;
+}
+
+void controlLoopTimingPassEnd(ControlLoopTiming* timing, uint32_t nowUs) {
+    uint32_t exec = nowUs - timing->passStartUs;
+    if (exec > timing->maxExecUs) timing->maxExecUs = exec;
+    if (exec > timing->periodUs) timing->overruns++;
+}
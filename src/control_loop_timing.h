@@ -0,0 +1,26 @@
+#ifndef CONTROL_LOOP_TIMING_H
+#define CONTROL_LOOP_TIMING_H
+
+#include <stdint.h>
+#include "latency_histogram.h"
+
+// Period jitter and overrun bookkeeping for a fixed-period loop. Call PassStart when a periodic pass wakes and
+// PassEnd when its work is done; jitter is |measured start-to-start period - nominal period|.
+
+struct ControlLoopTiming {
+    uint32_t periodUs;       // Nominal period
+    uint32_t lastStartUs;
+    uint32_t passStartUs;
+    uint32_t passes;         // Periodic passes started since init
+    uint32_t overruns;       // Passes whose work took longer than the period
+    uint32_t minPeriodUs;    // Measured start-to-start, 0 until two passes ran
+    uint32_t maxPeriodUs;
+    uint32_t maxExecUs;
+    LatencyHistogram jitter;
+};
+
+void controlLoopTimingInit(ControlLoopTiming* timing, uint32_t periodUs); // Also clears the statistics
+void controlLoopTimingPassStart(ControlLoopTiming* timing, uint32_t nowUs);
+void controlLoopTimingPassEnd(ControlLoopTiming* timing, uint32_t nowUs);
+
+#endif // CONTROL_LOOP_TIMING_H
@@ -0,0 +1,47 @@
+#include "controller_state.h"
+#include <string.h>
+
+void controllerStateClear(ControllerState* state) {
+    memset(state, 0, sizeof(*state));
+}
+
+bool controllerStatePublish(ControllerStateSeqlock* lock, ControllerState* next, bool immediateBroadcast) {
+    const ControllerState& current = lock->state; // Safe to read here, only this writer modifies it
+    next->version = current.version;
+    next->broadcastSeq = current.broadcastSeq;
+    bool changed = memcmp(next, &current, sizeof(ControllerState)) != 0;
+    if (!changed && !immediateBroadcast) return false;
+    if (changed) next->version++;
+    if (immediateBroadcast) next->broadcastSeq++;
+
+    uint32_t seq = lock->sequence.load(std::memory_order_relaxed);
+    lock->sequence.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release); // Odd sequence is visible before any state byte
+    memcpy(&lock->state, next, sizeof(ControllerState));
+    lock->sequence.store(seq + 2, std::memory_order_release);
+    return true;
+}
+
+bool controllerStateRead(const ControllerStateSeqlock* lock, ControllerState* out, int maxTries) {
+    for (int i = 0; i < maxTries; i++) {
+        uint32_t before = lock->sequence.load(std::memory_order_acquire);
+        if (before & 1) continue; // Writer mid-copy
+        memcpy(out, &lock->state, sizeof(ControllerState));
+        std::atomic_thread_fence(std::memory_order_acquire); // Copy completes before the re-check
+        if (lock->sequence.load(std::memory_order_relaxed) == before) return true;
+    }
+    return false;
+}
+
+uint32_t controllerStateCurveFingerprint(const ControllerState* state, int numChannels) {
+    uint32_t hash = 2166136261u;
+    for (int ch = 0; ch < numChannels; ch++) {
+        const ControllerChannelSnapshot& fan = state->channels[ch];
+        const uint8_t* parts[2] = {fan.curveTemp, fan.curvePwm};
+        hash = (hash ^ fan.curveNumPoints) * 16777619u;
+        for (const uint8_t* part : parts) {
+            for (int i = 0; i < fan.curveNumPoints; i++) hash = (hash ^ part[i]) * 16777619u;
+        }
+    }
+    return hash;
+}
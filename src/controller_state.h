@@ -0,0 +1,89 @@
+#ifndef CONTROLLER_STATE_H
+#define CONTROLLER_STATE_H
+
+#include <stdint.h>
+#include <atomic>
+
+// Versioned snapshot of everything the network side reports, published by controlTask (core 1) once per
+// tick through a seqlock and copied whole by networkTask (core 0). Readers never see a mix of two ticks,
+// and the version only moves when the content changed, so an unchanged state need not be serialized again.
+
+const int CONTROLLER_STATE_MAX_CHANNELS = 8;
+const int CONTROLLER_STATE_MAX_CURVE_POINTS = 8;
+
+struct ControllerChannelSnapshot {
+    const char* modeName;          // Static string from getFanModeName()
+    const char* calibrationStatus; // Static string from getFanCalibrationStatus()
+    int32_t rpm;
+    int32_t targetRpm;
+    int16_t speedPercent;
+    int16_t manualSpeedPercent;
+    uint16_t calMaxRpm;
+    uint8_t calStartDuty;
+    uint8_t calStallDuty;
+    uint8_t rpmModelPoints;
+    bool isAutoMode;
+    bool isPidMode;
+    bool isRpmMode;
+    bool hasTach;
+    uint8_t curveNumPoints;
+    uint8_t curveTemp[CONTROLLER_STATE_MAX_CURVE_POINTS];
+    uint8_t curvePwm[CONTROLLER_STATE_MAX_CURVE_POINTS];
+};
+
+struct ControllerState {
+    uint32_t version;       // Bumped by every publish whose content differs from the previous one
+    uint32_t broadcastSeq;  // Bumped by every publish that asked for an immediate broadcast
+    float temperature;
+    bool tempSensorFound;
+    float pidSetpointC;
+    float pidKp;
+    float pidKi;
+    float pidKd;
+    float rampUpPercentPerS;
+    float rampDownPercentPerS;
+    float hysteresisC;
+    uint32_t outputWrites;
+    uint32_t suppressedOutputChanges;
+    uint32_t suppressedBroadcasts;
+    uint32_t commandsApplied;       // Control command queue counters
+    uint32_t commandsDropped;
+    uint32_t commandQueueMaxDepth;
+    uint32_t commandLatencyAvgUs;
+    uint32_t commandLatencyMaxUs;
+    uint32_t commandToOutputP50Us;  // Command receipt -> PWM pass (histogram estimates)
+    uint32_t commandToOutputP99Us;
+    uint32_t commandToOutputMaxUs;
+    uint32_t controlPeriodMinUs;    // controlTask start-to-start period and jitter
+    uint32_t controlPeriodMaxUs;
+    uint32_t controlJitterP99Us;
+    uint32_t controlJitterMaxUs;
+    uint32_t controlExecMaxUs;
+    uint32_t controlOverruns;
+    uint32_t nvsWrites;             // Deferred settings persistence
+    uint32_t nvsWritesAvoided;      // Save requests folded into another write
+    uint32_t nvsBytesWritten;
+    uint32_t nvsPending;            // Dirty sections not yet written
+    ControllerChannelSnapshot channels[CONTROLLER_STATE_MAX_CHANNELS];
+};
+
+struct ControllerStateSeqlock {
+    std::atomic<uint32_t> sequence; // Odd while the writer is copying
+    ControllerState state;          // Written only by the single publisher
+};
+
+// Zeroes a state (padding included, the change check compares bytes). Fill every field after this.
+void controllerStateClear(ControllerState* state);
+
+// Single writer. Fills in next->version / next->broadcastSeq and copies it in, unless nothing changed and
+// no broadcast was asked for, in which case readers are not disturbed at all. Returns true if it wrote.
+bool controllerStatePublish(ControllerStateSeqlock* lock, ControllerState* next, bool immediateBroadcast);
+
+// Any number of readers. Copies a consistent state; false if the writer kept it busy for maxTries attempts
+// (*out is then unspecified).
+bool controllerStateRead(const ControllerStateSeqlock* lock, ControllerState* out, int maxTries);
+
+// FNV-1a over the used curve points of the first numChannels channels: changes exactly when a curve does
+uint32_t controllerStateCurveFingerprint(const ControllerState* state, int numChannels);
+
+#endif // CONTROLLER_STATE_H
@@ -1,11 +1,19 @@
 #include "display_handler.h"
 #include "config.h" // For global variables and lcd object
+#include "fan_control.h"
+#include "ota_updater.h"
 
 void updateLCD_NormalMode() { 
+    // With several fans the 16x2 screen cycles through them, one every 3 s
+    int ch = (millis() / 3000) % NUM_FAN_CHANNELS;
+    int fanSpeedPercentage = fanChannels.speedPercentage[ch];
+    int fanRpm = fanChannels.rpm[ch];
+
     lcd.clear();
     lcd.setCursor(0, 0);
     String line0 = "";
-    line0 += (isAutoMode ? "AUTO" : "MANUAL");
+    if (NUM_FAN_CHANNELS > 1) line0 += String(ch + 1) + ":";
+    line0 += getFanModeName(ch);
     
     if (isWiFiEnabled && WiFi.status() == WL_CONNECTED) {
         String ipStr = WiFi.localIP().toString();
@@ -311,7 +319,14 @@ void displayOtaUpdateMenu() {
     if (ota_in_progress) {
         lcd.print("OTA In Progress:");
         lcd.setCursor(0, 1);
-        lcd.print(ota_status_message.substring(0, 16));
+        if (otaProgress.bytesDone > 0) { // Downloading: percent and time left
+            char line[17];
+            if (otaProgress.etaS != OTA_PROGRESS_ETA_UNKNOWN) snprintf(line, sizeof(line), "%3u%% ETA %lus", otaProgressPercent(&otaProgress), (unsigned long)otaProgress.etaS);
+            else snprintf(line, sizeof(line), "%lu kB", (unsigned long)(otaProgress.bytesDone / 1024));
+            lcd.print(String(line) + "                ");
+        } else {
+            lcd.print(getOtaStatusMessage().substring(0, 16));
+        }
     } else {
         lcd.print("Firmware Update");
         lcd.setCursor(0, 1);
@@ -320,7 +335,7 @@ void displayOtaUpdateMenu() {
         } else if (selectedMenuItem == 1) {
             lcd.print(">Back to Main");
         } else { // Default or when status is shown
-             lcd.print(ota_status_message.substring(0,16));
+             lcd.print(getOtaStatusMessage().substring(0,16));
         }
     }
 }
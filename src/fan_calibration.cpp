@@ -0,0 +1,106 @@
+#include "fan_calibration.h"
+
+static void beginStep(FanCalibration* cal, int duty, unsigned long nowMs) {
+    cal->duty = duty;
+    cal->phaseStartMs = nowMs;
+    cal->stableSinceMs = nowMs;
+    cal->referenceRpm = -1;
+}
+
+void fanCalibrationStart(FanCalibration* cal, unsigned long nowMs) {
+    cal->result = {0, 0, 0, 0, 0};
+    cal->phase = FAN_CAL_STOPPING;
+    beginStep(cal, 0, nowMs);
+}
+
+void fanCalibrationCancel(FanCalibration* cal) {
+    if (fanCalibrationRunning(cal)) cal->phase = FAN_CAL_IDLE;
+}
+
+bool fanCalibrationRunning(const FanCalibration* cal) {
+    return cal->phase == FAN_CAL_STOPPING || cal->phase == FAN_CAL_RISING || cal->phase == FAN_CAL_FALLING;
+}
+
+// True once the reading has stayed within max(30 RPM, 2 %) of the reference for FAN_CAL_STABLE_MS
+static bool stepSettled(FanCalibration* cal, int rpm, unsigned long nowMs) {
+    int tolerance = cal->referenceRpm / 50;
+    if (tolerance < 30) tolerance = 30;
+    int diff = rpm - cal->referenceRpm;
+    if (diff < 0) diff = -diff;
+    if (cal->referenceRpm < 0 || diff > tolerance) {
+        cal->referenceRpm = rpm;
+        cal->stableSinceMs = nowMs;
+    }
+    return nowMs - cal->stableSinceMs >= FAN_CAL_STABLE_MS || nowMs - cal->phaseStartMs >= FAN_CAL_STEP_TIMEOUT_MS;
+}
+
+int fanCalibrationUpdate(FanCalibration* cal, int rpm, unsigned long nowMs, int* settledDuty, int* settledRpm) {
+    *settledDuty = -1;
+    *settledRpm = -1;
+    if (!fanCalibrationRunning(cal)) return 0;
+
+    if (cal->phase == FAN_CAL_STOPPING) {
+        if (rpm > 0) cal->stableSinceMs = nowMs;
+        if (nowMs - cal->stableSinceMs >= FAN_CAL_STABLE_MS) {
+            cal->phase = FAN_CAL_RISING;
+            beginStep(cal, FAN_CAL_STEP_PERCENT, nowMs);
+        } else if (nowMs - cal->phaseStartMs >= FAN_CAL_STOP_TIMEOUT_MS) {
+            cal->phase = FAN_CAL_FAILED; // Still turning at 0 %: fan ignores PWM (3-pin fan?) or tach is noisy
+            return 0;
+        }
+        return cal->duty;
+    }
+
+    if (!stepSettled(cal, rpm, nowMs)) return cal->duty;
+
+    // Step settled
+    unsigned long settleMs = cal->stableSinceMs - cal->phaseStartMs;
+    *settledDuty = cal->duty;
+    *settledRpm = rpm;
+    if (rpm > 0 && settleMs > cal->result.settleMs) cal->result.settleMs = (uint16_t)(settleMs > 65535 ? 65535 : settleMs);
+
+    if (cal->phase == FAN_CAL_RISING) {
+        if (rpm > 0 && cal->result.startDuty == 0) cal->result.startDuty = (uint8_t)cal->duty;
+        if (cal->duty >= 100) {
+            cal->result.maxRpm = (uint16_t)(rpm > 65535 ? 65535 : rpm);
+            if (rpm <= 0) { cal->phase = FAN_CAL_FAILED; return 0; }
+            cal->result.stallDuty = 100;
+            cal->phase = FAN_CAL_FALLING;
+            beginStep(cal, 100 - FAN_CAL_STEP_PERCENT, nowMs);
+        } else {
+            int next = cal->duty + FAN_CAL_STEP_PERCENT;
+            beginStep(cal, next > 100 ? 100 : next, nowMs);
+        }
+        return cal->duty;
+    }
+
+    // Falling: the stall duty is the lowest step that still turned
+    if (rpm > 0) cal->result.stallDuty = (uint8_t)cal->duty;
+    if (rpm <= 0 || cal->duty <= FAN_CAL_STEP_PERCENT) {
+        cal->result.valid = 1;
+        cal->phase = FAN_CAL_DONE;
+        return 0;
+    }
+    beginStep(cal, cal->duty - FAN_CAL_STEP_PERCENT, nowMs);
+    return cal->duty;
+}
+
+int fanApplyStartLimits(const FanCalibrationResult& cal, FanStartState* start, int targetDuty, int currentRpm,
+                        unsigned long nowMs, unsigned long kickMs, unsigned long kickRetryMs, int kickDuty) {
+    if (targetDuty <= 0) {
+        start->kicked = false;
+        return 0;
+    }
+    if (!cal.valid) return targetDuty;
+    if (start->kicked && nowMs - start->kickStartMs < kickMs) return kickDuty;
+    if (currentRpm > 0) start->kicked = false;
+
+    int duty = targetDuty < cal.stallDuty ? cal.stallDuty : targetDuty;
+    bool mayKick = !start->kicked || nowMs - start->kickStartMs >= kickMs + kickRetryMs;
+    if (currentRpm <= 0 && duty < cal.startDuty && kickMs > 0 && mayKick) {
+        start->kicked = true;
+        start->kickStartMs = nowMs;
+        return kickDuty;
+    }
+    return duty;
+}
@@ -0,0 +1,56 @@
+#ifndef FAN_CALIBRATION_H
+#define FAN_CALIBRATION_H
+
+#include <stdint.h>
+
+// Characterization sweep for one fan: stops it, steps the duty 0 -> 100 % and back down, waits for the
+// RPM to settle at every step, and derives
+//  - startDuty: lowest duty that spins the fan up from standstill (rising sweep)
+//  - stallDuty: lowest duty that keeps an already spinning fan turning (falling sweep)
+//  - maxRpm and the longest settle time of a step
+// The caller feeds RPM readings every control tick and writes back the returned duty.
+
+const int FAN_CAL_STEP_PERCENT = 2;
+const unsigned long FAN_CAL_STABLE_MS = 1000;     // RPM within tolerance for this long = settled
+const unsigned long FAN_CAL_STEP_TIMEOUT_MS = 6000; // Take the reading anyway after this long
+const unsigned long FAN_CAL_STOP_TIMEOUT_MS = 15000; // Initial spin-down
+
+struct FanCalibrationResult {
+    uint8_t valid;
+    uint8_t startDuty;
+    uint8_t stallDuty;
+    uint16_t maxRpm;
+    uint16_t settleMs;
+};
+
+enum FanCalibrationPhase { FAN_CAL_IDLE, FAN_CAL_STOPPING, FAN_CAL_RISING, FAN_CAL_FALLING, FAN_CAL_DONE, FAN_CAL_FAILED };
+
+struct FanCalibration {
+    FanCalibrationPhase phase;
+    int duty;
+    unsigned long phaseStartMs; // Start of the current step (or of the spin-down)
+    unsigned long stableSinceMs;
+    int referenceRpm;           // Reading the stability window is measured against
+    FanCalibrationResult result;
+};
+
+void fanCalibrationStart(FanCalibration* cal, unsigned long nowMs);
+void fanCalibrationCancel(FanCalibration* cal);
+bool fanCalibrationRunning(const FanCalibration* cal);
+
+// Advances the sweep with the latest RPM reading and returns the duty to apply. When a step settles,
+// *settledDuty / *settledRpm are set to it (otherwise -1), so the caller can feed other models.
+int fanCalibrationUpdate(FanCalibration* cal, int rpm, unsigned long nowMs, int* settledDuty, int* settledRpm);
+
+struct FanStartState {
+    bool kicked;              // A kick was issued since the fan was last seen turning (or switched off)
+    unsigned long kickStartMs;
+};
+
+// Duty to actually command for a target, given a valid calibration: targets between 0 and the stall point
+// are raised to it, and a fan at standstill that the target would not start gets kickDuty for kickMs.
+// A fan that still does not turn is kicked again at most every kickRetryMs.
+int fanApplyStartLimits(const FanCalibrationResult& cal, FanStartState* start, int targetDuty, int currentRpm,
+                        unsigned long nowMs, unsigned long kickMs, unsigned long kickRetryMs, int kickDuty);
+
+#endif // FAN_CALIBRATION_H
@@ -1,45 +1,517 @@
 #include "fan_control.h"
 #include "config.h" // For global variables
+#include "fan_curve_lut.h"
+#include "pid_controller.h"
+#include "fan_output_conditioner.h"
+#include "tach_counter.h"
+#include "fan_rpm_model.h"
+#include "fan_calibration.h"
+#if TACH_USE_PCNT
+#include "driver/pcnt.h"
+#endif
 
-void setDefaultFanCurve() {
-    numCurvePoints = 5;
+// Each channel's curve compiled to one entry per 0.1 C. Rebuilt lazily on the first evaluation
+// after a curve change. Sized by NUM_FAN_CHANNELS (not MAX) since each table is 1.2 KB.
+static uint8_t fanCurveLut[NUM_FAN_CHANNELS][FAN_CURVE_LUT_SIZE];
+static volatile bool fanCurveLutDirty[NUM_FAN_CHANNELS];
+
+// PID state per channel. pidActive is cleared whenever a channel leaves PID mode (or loses the sensor)
+// so the next PID tick restarts bumplessly from the current fan speed.
+static PidState fanPidState[NUM_FAN_CHANNELS];
+static bool fanPidActive[NUM_FAN_CHANNELS];
+static volatile int fanPidOutputPercentage[NUM_FAN_CHANNELS];
+
+// Output conditioning per channel. Reset on mode changes and curve edits so a new target is not held
+// back by hysteresis state that belongs to the old one.
+static FanOutputConditionerState fanOutputState[NUM_FAN_CHANNELS];
+static int fanLastTarget[NUM_FAN_CHANNELS];
+static const char* fanLastModeName[NUM_FAN_CHANNELS];
+static volatile bool fanOutputResetPending[NUM_FAN_CHANNELS];
+
+// How each channel's tach pulses are counted. PCNT channels use unit == channel index and keep the
+// last raw counter value, since the counter free-runs and is never cleared.
+enum FanTachSource { FAN_TACH_NONE, FAN_TACH_PCNT, FAN_TACH_ISR };
+static FanTachSource fanTachSource[NUM_FAN_CHANNELS];
+static int fanTachLastCount[NUM_FAN_CHANNELS];
+
+// RPM estimation. Edge timestamps are written by the tach ISRs into a ring per channel. ISR channels
+// always timestamp; PCNT channels attach tachEdgeIsr only while the fan is slow enough for the period
+// estimate (few edges per second), so fast fans still cost no interrupts.
+static volatile uint32_t fanTachEdgeMicros[NUM_FAN_CHANNELS][TACH_EDGE_HISTORY];
+static volatile uint32_t fanTachEdgeCount[NUM_FAN_CHANNELS];
+static uint32_t fanTachEdgeBase[NUM_FAN_CHANNELS]; // Edge count when capture (re)started; older edges are ignored
+static bool fanTachEdgeCapture[NUM_FAN_CHANNELS];
+static unsigned long fanTachTotalPulses[NUM_FAN_CHANNELS];
+static TachWindow fanTachWindow[NUM_FAN_CHANNELS];
+
+// RPM target mode. The model is learned whenever a channel's duty has held for FAN_RPM_SETTLE_MS.
+static FanRpmModel fanRpmModels[NUM_FAN_CHANNELS];
+static FanRpmControlState fanRpmControlState[NUM_FAN_CHANNELS];
+static bool fanRpmControlActive[NUM_FAN_CHANNELS];
+static int fanRpmLastTarget[NUM_FAN_CHANNELS];
+static float fanRpmLastFeedforward[NUM_FAN_CHANNELS];
+static int fanRpmLearnDuty[NUM_FAN_CHANNELS];
+static unsigned long fanRpmDutyStableSince[NUM_FAN_CHANNELS];
+static unsigned long fanRpmLastLearnTime[NUM_FAN_CHANNELS];
+static volatile bool fanRpmModelDirty[NUM_FAN_CHANNELS];
+static volatile bool fanRpmModelResetPending[NUM_FAN_CHANNELS];
+
+// Characterization sweep and its stored result. While a sweep runs it owns the channel's PWM output;
+// afterwards every mode's output is kept out of the band between 0 and the stall duty, and a fan at
+// standstill is kicked when its new duty is too low to start it.
+enum FanCalibrationRequest { FAN_CAL_REQ_NONE, FAN_CAL_REQ_START, FAN_CAL_REQ_CANCEL, FAN_CAL_REQ_CLEAR };
+static FanCalibration fanCalibration[NUM_FAN_CHANNELS];
+static FanCalibrationResult fanCalibrationResults[NUM_FAN_CHANNELS];
+static FanStartState fanStartState[NUM_FAN_CHANNELS];
+static volatile FanCalibrationRequest fanCalibrationRequest[NUM_FAN_CHANNELS];
+static volatile bool fanCalibrationDirty[NUM_FAN_CHANNELS];
+
+bool isValidFanChannel(int channel) {
+    return channel >= 0 && channel < NUM_FAN_CHANNELS;
+}
+
+#if TACH_USE_PCNT
+static bool setupTachPcnt(int channel) {
+    pcnt_unit_t unit = (pcnt_unit_t)channel;
+    pcnt_config_t pcntConfig = {};
+    pcntConfig.pulse_gpio_num = FAN_TACH_PINS[channel];
+    pcntConfig.ctrl_gpio_num = PCNT_PIN_NOT_USED;
+    pcntConfig.channel = PCNT_CHANNEL_0;
+    pcntConfig.unit = unit;
+    pcntConfig.pos_mode = PCNT_COUNT_DIS; // Count falling edges, like the ISR
+    pcntConfig.neg_mode = PCNT_COUNT_INC;
+    pcntConfig.lctrl_mode = PCNT_MODE_KEEP;
+    pcntConfig.hctrl_mode = PCNT_MODE_KEEP;
+    pcntConfig.counter_h_lim = TACH_PCNT_WRAP_LIMIT;
+    pcntConfig.counter_l_lim = 0;
+    if (pcnt_unit_config(&pcntConfig) != ESP_OK) return false;
+    pcnt_set_filter_value(unit, TACH_PCNT_FILTER_APB_CYCLES);
+    pcnt_filter_enable(unit);
+    pcnt_counter_pause(unit);
+    pcnt_counter_clear(unit);
+    pcnt_counter_resume(unit);
+    fanTachLastCount[channel] = 0;
+    return true;
+}
+#endif
+
+void setupFanChannels() {
+    for (int ch = 0; ch < NUM_FAN_CHANNELS; ch++) {
+        setFanMode(ch, true, false);
+        fanChannels.manualSpeedPercentage[ch] = 50;
+
+        ledcSetup(FAN_LEDC_CHANNELS[ch], PWM_FREQ, PWM_RESOLUTION_BITS);
+        ledcAttachPin(FAN_PWM_PINS[ch], FAN_LEDC_CHANNELS[ch]);
+        ledcWrite(FAN_LEDC_CHANNELS[ch], 0);
+        fanChannels.speedPercentage[ch] = 0;
+        fanChannels.pwmRaw[ch] = 0;
+
+        fanTachSource[ch] = FAN_TACH_NONE;
+        if (FAN_TACH_PINS[ch] >= 0) {
+            pinMode(FAN_TACH_PINS[ch], INPUT_PULLUP);
+#if TACH_USE_PCNT
+            if (setupTachPcnt(ch)) {
+                fanTachSource[ch] = FAN_TACH_PCNT;
+            } else if(serialDebugEnabled) {
+                Serial.printf("[INIT_ERR] Fan %d: PCNT setup failed, falling back to tach interrupt.\n", ch + 1);
+            }
+#endif
+            if (fanTachSource[ch] == FAN_TACH_NONE) {
+                attachInterruptArg(digitalPinToInterrupt(FAN_TACH_PINS[ch]), countPulse, (void*)(intptr_t)ch, FALLING);
+                fanTachSource[ch] = FAN_TACH_ISR;
+                fanTachEdgeCapture[ch] = true;
+            }
+        }
+        tachWindowReset(&fanTachWindow[ch]);
+        if(serialDebugEnabled) Serial.printf("[INIT] Fan %d: PWM GPIO %d (LEDC %d), Tach GPIO %d (%s). Set to 0%%.\n", ch + 1, FAN_PWM_PINS[ch], FAN_LEDC_CHANNELS[ch], FAN_TACH_PINS[ch], getFanTachSourceName(ch));
+    }
+}
+
+void setDefaultFanCurve(int channel) {
+    int* tempPoints = fanChannels.curveTempPoints[channel];
+    int* pwmPercentagePoints = fanChannels.curvePwmPoints[channel];
+    fanChannels.curveNumPoints[channel] = 5;
     tempPoints[0] = 25; pwmPercentagePoints[0] = 0;  
     tempPoints[1] = 35; pwmPercentagePoints[1] = 20; 
     tempPoints[2] = 45; pwmPercentagePoints[2] = 50; 
     tempPoints[3] = 55; pwmPercentagePoints[3] = 80; 
     tempPoints[4] = 60; pwmPercentagePoints[4] = 100;
-    if(serialDebugEnabled) Serial.println("[SYSTEM] Default fan curve set.");
+    invalidateFanCurveLut(channel);
+    if(serialDebugEnabled) Serial.printf("[SYSTEM] Default fan curve set for fan %d.\n", channel + 1);
+}
+
+void invalidateFanCurveLut(int channel) {
+    fanCurveLutDirty[channel] = true;
+    fanOutputResetPending[channel] = true;
+}
+
+static void rebuildFanCurveLut(int channel) {
+    fanCurveLutDirty[channel] = false; // Cleared first so a change made during the rebuild is not lost
+    buildFanCurveLut(fanCurveLut[channel], fanChannels.curveTempPoints[channel], fanChannels.curvePwmPoints[channel], fanChannels.curveNumPoints[channel]);
+    if(serialDebugEnabled) Serial.printf("[SYSTEM] Fan %d curve table rebuilt (%d points).\n", channel + 1, fanChannels.curveNumPoints[channel]);
 }
 
-int calculateAutoFanPWMPercentage(float temp) {
+int calculateAutoFanPWMPercentageDeciC(int channel, int tempDeciC) {
     if (!tempSensorFound) { 
         return AUTO_MODE_NO_SENSOR_FAN_PERCENTAGE;
     }
-    if (numCurvePoints == 0) return 0; 
-    if (temp <= tempPoints[0]) return pwmPercentagePoints[0];
-    if (temp >= tempPoints[numCurvePoints - 1]) return pwmPercentagePoints[numCurvePoints - 1];
+    if (fanCurveLutDirty[channel]) rebuildFanCurveLut(channel);
+    return lookupFanCurveLut(fanCurveLut[channel], tempDeciC);
+}
 
-    for (int i = 0; i < numCurvePoints - 1; i++) {
-        if (temp >= tempPoints[i] && temp < tempPoints[i+1]) {
-            float tempRange = tempPoints[i+1] - tempPoints[i];
-            float pwmRange = pwmPercentagePoints[i+1] - pwmPercentagePoints[i];
-            if (tempRange <= 0) return pwmPercentagePoints[i]; 
-            float tempOffset = temp - tempPoints[i];
-            int calculatedPwm = pwmPercentagePoints[i] + (tempOffset / tempRange) * pwmRange;
-            return calculatedPwm;
-        }
-    }
-    return pwmPercentagePoints[numCurvePoints - 1]; 
+int calculateAutoFanPWMPercentage(int channel, float temp) {
+    return calculateAutoFanPWMPercentageDeciC(channel, temperatureToDeciC(temp));
 }
 
-void setFanSpeed(int percentage) {
-    fanSpeedPercentage = constrain(percentage, 0, 100);
-    fanSpeedPWM_Raw = map(fanSpeedPercentage, 0, 100, 0, (1 << PWM_RESOLUTION_BITS) - 1);
-    ledcWrite(PWM_CHANNEL, fanSpeedPWM_Raw);
+static void writeFanOutput(int channel, int percentage) {
+    int speed = constrain(percentage, 0, 100);
+    int raw = map(speed, 0, 100, 0, (1 << PWM_RESOLUTION_BITS) - 1);
+    fanChannels.speedPercentage[channel] = speed;
+    fanChannels.pwmRaw[channel] = raw;
+    ledcWrite(FAN_LEDC_CHANNELS[channel], raw);
+}
+
+void setFanSpeed(int channel, int percentage) {
+    writeFanOutput(channel, percentage);
     needsImmediateBroadcast = true; // Signal for web update
     // LCD update is handled by mainAppTask or displayMenu
 }
 
-void IRAM_ATTR countPulse() {
-  pulseCount++;
+#if TACH_USE_PCNT
+static void IRAM_ATTR tachEdgeIsr(void* arg) {
+    int ch = (intptr_t)arg;
+    uint32_t n = fanTachEdgeCount[ch];
+    fanTachEdgeMicros[ch][n & (TACH_EDGE_HISTORY - 1)] = micros();
+    fanTachEdgeCount[ch] = n + 1;
+}
+
+// Edge timestamps on a PCNT channel only while the fan is in the period estimator's range
+static void updateTachEdgeCapture(int channel, int rpm) {
+    if (!fanTachEdgeCapture[channel] && rpm <= TACH_PERIOD_MAX_RPM) {
+        fanTachEdgeBase[channel] = fanTachEdgeCount[channel];
+        attachInterruptArg(digitalPinToInterrupt(FAN_TACH_PINS[channel]), tachEdgeIsr, (void*)(intptr_t)channel, FALLING);
+        fanTachEdgeCapture[channel] = true;
+    } else if (fanTachEdgeCapture[channel] && rpm > TACH_PERIOD_MAX_RPM + TACH_PERIOD_MAX_RPM / 4) {
+        detachInterrupt(digitalPinToInterrupt(FAN_TACH_PINS[channel]));
+        fanTachEdgeCapture[channel] = false;
+    }
+}
+#endif
+
+bool updateFanRpm(unsigned long nowMillis) {
+    unsigned long pulses[NUM_FAN_CHANNELS];
+    uint32_t edges[NUM_FAN_CHANNELS][TACH_EDGE_HISTORY];
+    int numEdges[NUM_FAN_CHANNELS];
+    noInterrupts(); 
+    uint32_t nowMicros = micros();
+    for (int ch = 0; ch < NUM_FAN_CHANNELS; ch++) {
+        pulses[ch] = fanChannels.pulseCount[ch]; // Stays 0 on PCNT channels
+        fanChannels.pulseCount[ch] = 0;
+        // Copy the captured edges oldest first
+        uint32_t count = fanTachEdgeCount[ch];
+        uint32_t available = count - fanTachEdgeBase[ch];
+        numEdges[ch] = fanTachEdgeCapture[ch] ? (int)(available < (uint32_t)TACH_EDGE_HISTORY ? available : TACH_EDGE_HISTORY) : 0;
+        for (int i = 0; i < numEdges[ch]; i++) {
+            edges[ch][i] = fanTachEdgeMicros[ch][(count - numEdges[ch] + i) & (TACH_EDGE_HISTORY - 1)];
+        }
+    }
+    interrupts(); 
+
+#if TACH_USE_PCNT
+    for (int ch = 0; ch < NUM_FAN_CHANNELS; ch++) {
+        if (fanTachSource[ch] != FAN_TACH_PCNT) continue;
+        int16_t count = 0;
+        if (pcnt_get_counter_value((pcnt_unit_t)ch, &count) != ESP_OK) continue;
+        pulses[ch] = tachCounterDelta(fanTachLastCount[ch], count, TACH_PCNT_WRAP_LIMIT);
+        fanTachLastCount[ch] = count;
+    }
+#endif
+
+    bool changed = false;
+    for (int ch = 0; ch < NUM_FAN_CHANNELS; ch++) {
+        if (fanTachSource[ch] == FAN_TACH_NONE) continue;
+        fanTachTotalPulses[ch] += pulses[ch];
+        tachWindowPush(&fanTachWindow[ch], fanTachTotalPulses[ch], nowMillis, TACH_WINDOW_MS);
+        int windowRpm = tachWindowRpm(&fanTachWindow[ch], PULSES_PER_REVOLUTION, TACH_STALL_CHECK_MS);
+        int periodRpm = tachPeriodRpm(edges[ch], numEdges[ch], nowMicros, PULSES_PER_REVOLUTION, TACH_STALL_TIMEOUT_MS * 1000UL);
+        int newRpm = tachSelectRpm(periodRpm, windowRpm, TACH_PERIOD_MAX_RPM);
+#if TACH_USE_PCNT
+        if (fanTachSource[ch] == FAN_TACH_PCNT) updateTachEdgeCapture(ch, newRpm);
+#endif
+        if (newRpm == 0 && fanChannels.rpm[ch] > 0) needsImmediateBroadcast = true; // Stall, report at once
+        if (newRpm != fanChannels.rpm[ch]) {
+            fanChannels.rpm[ch] = newRpm;
+            changed = true;
+        }
+    }
+    return changed;
+}
+
+void setFanMode(int channel, bool autoMode, bool pidMode) {
+    fanChannels.isRpmMode[channel] = false;
+    fanChannels.isAutoMode[channel] = autoMode;
+    fanChannels.isPidMode[channel] = autoMode && pidMode;
+}
+
+bool setFanRpmTarget(int channel, int targetRpm) {
+    if (!fanHasTach(channel) || targetRpm < 0 || targetRpm > FAN_RPM_TARGET_MAX) return false;
+    fanChannels.targetRpm[channel] = targetRpm;
+    fanChannels.isAutoMode[channel] = false;
+    fanChannels.isPidMode[channel] = false;
+    fanChannels.isRpmMode[channel] = true;
+    return true;
+}
+
+const char* getFanModeName(int channel) {
+    if (!fanChannels.isAutoMode[channel]) return fanChannels.isRpmMode[channel] ? "RPM" : "MANUAL";
+    return fanChannels.isPidMode[channel] ? "PID" : "AUTO";
+}
+
+FanRpmModel* getFanRpmModel(int channel) {
+    return &fanRpmModels[channel];
+}
+
+void requestFanRpmModelReset(int channel) {
+    fanRpmModelResetPending[channel] = true;
+}
+
+bool takeFanRpmModelDirty(int channel) {
+    if (!fanRpmModelDirty[channel]) return false;
+    fanRpmModelDirty[channel] = false;
+    return true;
+}
+
+// Feeds the model once a second while the duty holds steady (any mode)
+static void learnFanRpm(int channel, unsigned long now) {
+    int duty = fanChannels.speedPercentage[channel];
+    if (duty != fanRpmLearnDuty[channel]) {
+        fanRpmLearnDuty[channel] = duty;
+        fanRpmDutyStableSince[channel] = now;
+        return;
+    }
+    if (now - fanRpmDutyStableSince[channel] < FAN_RPM_SETTLE_MS || now - fanRpmLastLearnTime[channel] < 1000) return;
+    fanRpmLastLearnTime[channel] = now;
+    if (fanRpmModelLearn(&fanRpmModels[channel], duty, fanChannels.rpm[channel])) fanRpmModelDirty[channel] = true;
+}
+
+// Feedforward from the learned table plus PI feedback on the measured RPM
+static int runFanRpmControl(int channel, float dtSeconds) {
+    int targetRpm = fanChannels.targetRpm[channel];
+    if (targetRpm <= 0) {
+        fanRpmControlActive[channel] = false;
+        return 0;
+    }
+    float feedforward = fanRpmModelDutyFor(&fanRpmModels[channel], targetRpm);
+    if (!fanRpmControlActive[channel] || targetRpm != fanRpmLastTarget[channel]) {
+        fanRpmControlReset(&fanRpmControlState[channel], fanChannels.speedPercentage[channel], feedforward);
+        fanRpmControlActive[channel] = true;
+        fanRpmLastTarget[channel] = targetRpm;
+    } else if (feedforward != fanRpmLastFeedforward[channel]) {
+        fanRpmControlRebase(&fanRpmControlState[channel], fanRpmLastFeedforward[channel], feedforward); // Model learned more
+    }
+    fanRpmLastFeedforward[channel] = feedforward;
+    FanRpmControlGains gains = {FAN_RPM_KP, FAN_RPM_KI};
+    float outMin = fanCalibrationResults[channel].valid ? fanCalibrationResults[channel].stallDuty : 0.0f; // Start limits raise anything lower anyway
+    float duty = fanRpmControlUpdate(&fanRpmControlState[channel], gains, feedforward, targetRpm, fanChannels.rpm[channel], dtSeconds, outMin, 100.0f);
+    return (int)(duty + 0.5f);
+}
+
+// The PID output is clamped to the channel's curve range, so the curve still sets the floor and ceiling
+static void getFanCurveOutputRange(int channel, int* outMin, int* outMax) {
+    int numPoints = fanChannels.curveNumPoints[channel];
+    if (numPoints == 0) { *outMin = 0; *outMax = 100; return; }
+    *outMin = *outMax = fanChannels.curvePwmPoints[channel][0];
+    for (int i = 1; i < numPoints; i++) {
+        int p = fanChannels.curvePwmPoints[channel][i];
+        if (p < *outMin) *outMin = p;
+        if (p > *outMax) *outMax = p;
+    }
+}
+
+void runFanPidTick(float tempC, float dtSeconds) {
+    PidGains gains = {pidKp, pidKi, pidKd};
+    for (int ch = 0; ch < NUM_FAN_CHANNELS; ch++) {
+        if (!fanChannels.isAutoMode[ch] || !fanChannels.isPidMode[ch]) {
+            fanPidActive[ch] = false;
+            continue;
+        }
+        int outMin, outMax;
+        getFanCurveOutputRange(ch, &outMin, &outMax);
+        if (!fanPidActive[ch]) {
+            pidReset(&fanPidState[ch], gains, pidSetpointC, fanChannels.speedPercentage[ch], tempC, outMin, outMax);
+            fanPidActive[ch] = true;
+        }
+        float output = pidUpdate(&fanPidState[ch], gains, pidSetpointC, tempC, dtSeconds, outMin, outMax);
+        fanPidOutputPercentage[ch] = (int)(output + 0.5f);
+    }
+}
+
+static void processFanCalibrationRequest(int channel, unsigned long now) {
+    FanCalibrationRequest request = fanCalibrationRequest[channel];
+    if (request == FAN_CAL_REQ_NONE) return;
+    fanCalibrationRequest[channel] = FAN_CAL_REQ_NONE;
+    if (request == FAN_CAL_REQ_START) {
+        fanCalibrationStart(&fanCalibration[channel], now);
+        if(serialDebugEnabled) Serial.printf("[CAL] Fan %d: calibration started.\n", channel + 1);
+    } else if (request == FAN_CAL_REQ_CANCEL) {
+        if (!fanCalibrationRunning(&fanCalibration[channel])) return;
+        fanCalibrationCancel(&fanCalibration[channel]);
+        fanOutputResetPending[channel] = true;
+        if(serialDebugEnabled) Serial.printf("[CAL] Fan %d: calibration cancelled, previous result kept.\n", channel + 1);
+    } else {
+        fanCalibrationResults[channel] = FanCalibrationResult{};
+        fanCalibrationDirty[channel] = true;
+        if(serialDebugEnabled) Serial.printf("[CAL] Fan %d: calibration cleared, start limits off.\n", channel + 1);
+    }
+    needsImmediateBroadcast = true;
+}
+
+// One sweep step; settled readings also feed the PWM -> RPM table
+static void runFanCalibration(int channel, unsigned long now) {
+    FanCalibration* cal = &fanCalibration[channel];
+    int settledDuty, settledRpm;
+    int duty = fanCalibrationUpdate(cal, fanChannels.rpm[channel], now, &settledDuty, &settledRpm);
+    if (settledDuty >= 0 && fanRpmModelLearn(&fanRpmModels[channel], settledDuty, settledRpm)) fanRpmModelDirty[channel] = true;
+    if (cal->phase == FAN_CAL_DONE) {
+        fanCalibrationResults[channel] = cal->result;
+        fanCalibrationDirty[channel] = true;
+        fanOutputResetPending[channel] = true;
+        needsImmediateBroadcast = true;
+        if(serialDebugEnabled) Serial.printf("[CAL] Fan %d: done. Start %d%%, stall %d%%, max %d RPM, settle %d ms.\n", channel + 1,
+                                             cal->result.startDuty, cal->result.stallDuty, cal->result.maxRpm, cal->result.settleMs);
+    } else if (cal->phase == FAN_CAL_FAILED) {
+        fanOutputResetPending[channel] = true;
+        needsImmediateBroadcast = true;
+        if(serialDebugEnabled) Serial.printf("[CAL_ERR] Fan %d: calibration failed (fan did not stop or never turned), previous result kept.\n", channel + 1);
+    }
+    if (!fanCalibrationRunning(cal)) return; // The mode takes the output back on the next tick
+    if (duty != fanChannels.speedPercentage[channel]) {
+        writeFanOutput(channel, duty);
+        fanOutputWrites++;
+    }
+}
+
+void runFanControlTick(int tempDeciC, float dtSeconds) {
+    FanOutputConditionerConfig outputConfig = {fanRampUpPercentPerS, fanRampDownPercentPerS, (int)(fanHysteresisC * 10.0f + 0.5f)};
+    unsigned long now = millis();
+    for (int ch = 0; ch < NUM_FAN_CHANNELS; ch++) {
+        if (fanRpmModelResetPending[ch]) {
+            fanRpmModelResetPending[ch] = false;
+            fanRpmModelReset(&fanRpmModels[ch]);
+            fanRpmModelDirty[ch] = true;
+        }
+        processFanCalibrationRequest(ch, now);
+        if (fanCalibrationRunning(&fanCalibration[ch])) {
+            fanRpmControlActive[ch] = false;
+            runFanCalibration(ch, now);
+            continue;
+        }
+        if (fanTachSource[ch] != FAN_TACH_NONE) learnFanRpm(ch, now);
+
+        int target;
+        bool curveMode = false;
+        if (fanChannels.isRpmMode[ch] && !fanChannels.isAutoMode[ch]) {
+            target = runFanRpmControl(ch, dtSeconds);
+        } else if (!fanChannels.isAutoMode[ch]) {
+            fanRpmControlActive[ch] = false;
+            target = fanChannels.manualSpeedPercentage[ch];
+        } else if (fanChannels.isPidMode[ch] && tempSensorFound && fanPidActive[ch]) {
+            fanRpmControlActive[ch] = false;
+            target = fanPidOutputPercentage[ch];
+        } else {
+            fanRpmControlActive[ch] = false;
+            // Curve mode, or PID waiting for its first tick / a sensor.
+            // Auto mode without a sensor falls back to AUTO_MODE_NO_SENSOR_FAN_PERCENTAGE inside the lookup.
+            if (!tempSensorFound) fanPidActive[ch] = false;
+            target = calculateAutoFanPWMPercentageDeciC(ch, tempDeciC);
+            curveMode = true;
+        }
+
+        const char* modeName = getFanModeName(ch);
+        int current = fanChannels.speedPercentage[ch];
+        if (modeName != fanLastModeName[ch] || fanOutputResetPending[ch]) {
+            fanLastModeName[ch] = modeName;
+            fanOutputResetPending[ch] = false;
+            resetFanOutputConditioner(&fanOutputState[ch], current, tempDeciC);
+        }
+
+        int conditioned;
+        if (!fanChannels.isAutoMode[ch]) {
+            conditioned = target; // Manual commands (and the RPM loop, which has its own dynamics) apply at once
+            resetFanOutputConditioner(&fanOutputState[ch], target, tempDeciC);
+        } else {
+            conditioned = conditionFanOutput(&fanOutputState[ch], outputConfig, target, tempDeciC, curveMode && tempSensorFound, dtSeconds);
+        }
+        int output = conditioned;
+        if (fanCalibrationResults[ch].valid) {
+            output = fanApplyStartLimits(fanCalibrationResults[ch], &fanStartState[ch], conditioned, fanChannels.rpm[ch], now,
+                                         FAN_KICK_MS, FAN_KICK_RETRY_MS, FAN_KICK_DUTY_PERCENT);
+        }
+
+        if (output != current) {
+            writeFanOutput(ch, output);
+            fanOutputWrites++;
+            // Broadcast once the output settles on its target; intermediate ramp steps ride the periodic broadcast
+            if (conditioned == fanOutputState[ch].heldTarget) needsImmediateBroadcast = true;
+        } else if (target != fanLastTarget[ch]) {
+            // The unconditioned loop would have written (and broadcast) this change
+            fanSuppressedOutputChanges++;
+            if (!needsImmediateBroadcast) fanSuppressedBroadcasts++;
+        }
+        fanLastTarget[ch] = target;
+    }
+}
+
+bool requestFanCalibration(int channel) {
+    if (!fanHasTach(channel)) return false;
+    fanCalibrationRequest[channel] = FAN_CAL_REQ_START;
+    return true;
+}
+
+void requestFanCalibrationCancel(int channel) {
+    fanCalibrationRequest[channel] = FAN_CAL_REQ_CANCEL;
+}
+
+void requestFanCalibrationClear(int channel) {
+    fanCalibrationRequest[channel] = FAN_CAL_REQ_CLEAR;
+}
+
+bool isFanCalibrating(int channel) {
+    return fanCalibrationRunning(&fanCalibration[channel]) || fanCalibrationRequest[channel] == FAN_CAL_REQ_START;
+}
+
+const char* getFanCalibrationStatus(int channel) {
+    if (isFanCalibrating(channel)) return "RUNNING";
+    if (fanCalibration[channel].phase == FAN_CAL_FAILED) return "FAILED";
+    return fanCalibrationResults[channel].valid ? "DONE" : "NONE";
+}
+
+FanCalibrationResult* getFanCalibrationResult(int channel) {
+    return &fanCalibrationResults[channel];
+}
+
+bool takeFanCalibrationDirty(int channel) {
+    if (!fanCalibrationDirty[channel]) return false;
+    fanCalibrationDirty[channel] = false;
+    return true;
+}
+
+bool fanHasTach(int channel) {
+    return fanTachSource[channel] != FAN_TACH_NONE;
+}
+
+const char* getFanTachSourceName(int channel) {
+    switch (fanTachSource[channel]) {
+        case FAN_TACH_PCNT: return "PCNT";
+        case FAN_TACH_ISR: return "ISR";
+        default: return "NONE";
+    }
+}
+
+void IRAM_ATTR countPulse(void* arg) {
+  int ch = (intptr_t)arg;
+  fanChannels.pulseCount[ch]++;
+  uint32_t n = fanTachEdgeCount[ch];
+  fanTachEdgeMicros[ch][n & (TACH_EDGE_HISTORY - 1)] = micros();
+  fanTachEdgeCount[ch] = n + 1;
 }
@@ -2,10 +2,41 @@
 #define FAN_CONTROL_H
 
 #include "config.h"
+#include "fan_rpm_model.h"
+#include "fan_calibration.h"
 
-void setDefaultFanCurve();
-int calculateAutoFanPWMPercentage(float temp);
-void setFanSpeed(int percentage);
-void IRAM_ATTR countPulse(); // ISR for tachometer
+const int ALL_FAN_CHANNELS = -1; // Channel argument meaning "apply to every channel"
+static_assert(ALL_FAN_CHANNELS == CONTROL_COMMAND_ALL_CHANNELS, "Commands carry the channel argument unchanged");
+
+void setupFanChannels(); // LEDC + tachometer setup for channels 0..NUM_FAN_CHANNELS-1
+void setDefaultFanCurve(int channel);
+int calculateAutoFanPWMPercentage(int channel, float temp);
+int calculateAutoFanPWMPercentageDeciC(int channel, int tempDeciC); // Table lookup, temp in 0.1 C units
+void invalidateFanCurveLut(int channel); // Call whenever a channel's curve points change
+void setFanSpeed(int channel, int percentage);
+bool updateFanRpm(unsigned long nowMillis); // Per-tick RPM estimate for all channels; true if any RPM changed
+void runFanControlTick(int tempDeciC, float dtSeconds); // One pass over all channels: mode -> target % -> conditioning -> PWM
+void runFanPidTick(float tempC, float dtSeconds); // Fixed-period PID step for channels in PID mode
+void setFanMode(int channel, bool autoMode, bool pidMode);
+const char* getFanModeName(int channel); // "AUTO", "PID", "RPM" or "MANUAL"
+bool isValidFanChannel(int channel);
+void IRAM_ATTR countPulse(void* arg); // Tachometer ISR (fallback path), arg is the channel index
+const char* getFanTachSourceName(int channel); // "PCNT", "ISR" or "NONE"
+bool fanHasTach(int channel);
+
+// RPM target mode and the learned PWM -> RPM table (learned in every mode while the duty holds steady)
+bool setFanRpmTarget(int channel, int targetRpm); // Switches to RPM mode; false if the fan has no tach or rpm is out of range
+FanRpmModel* getFanRpmModel(int channel);
+void requestFanRpmModelReset(int channel); // Applied on the next control tick (safe from any task)
+bool takeFanRpmModelDirty(int channel); // True once per change worth saving to NVS
+
+// Characterization sweep (start / stall duty, max RPM). Requests are applied on the next control tick.
+bool requestFanCalibration(int channel); // False if the fan has no tach
+void requestFanCalibrationCancel(int channel);
+void requestFanCalibrationClear(int channel); // Forget the result, which turns the start limits off
+bool isFanCalibrating(int channel);
+const char* getFanCalibrationStatus(int channel); // "RUNNING", "DONE", "FAILED" or "NONE"
+FanCalibrationResult* getFanCalibrationResult(int channel);
+bool takeFanCalibrationDirty(int channel); // True once per new or cleared result
 
 #endif // FAN_CONTROL_H
@@ -0,0 +1,33 @@
+#include "fan_curve_lut.h"
+
+void buildFanCurveLut(uint8_t* lut, const int* temps, const int* pwmPercents, int numPoints) {
+    if (numPoints <= 0) {
+        for (int d = 0; d < FAN_CURVE_LUT_SIZE; d++) lut[d] = 0;
+        return;
+    }
+
+    const int firstDeciC = temps[0] * 10;
+    const int lastDeciC = temps[numPoints - 1] * 10;
+    int seg = 0; // Current segment is [temps[seg], temps[seg + 1])
+
+    for (int d = 0; d < FAN_CURVE_LUT_SIZE; d++) {
+        if (d <= firstDeciC) { lut[d] = pwmPercents[0]; continue; }
+        if (d >= lastDeciC) { lut[d] = pwmPercents[numPoints - 1]; continue; }
+
+        // Zero-length segments are skipped, matching the first-match scan of the old code
+        while (seg < numPoints - 2 && d >= temps[seg + 1] * 10) seg++;
+
+        float tempRange = temps[seg + 1] - temps[seg];
+        if (tempRange <= 0) { lut[d] = pwmPercents[seg]; continue; }
+        // Same float expression the old per-tick interpolation used, so every step matches it bit for bit.
+        // This only runs on a rebuild; lookups never touch the FPU.
+        float pwmRange = pwmPercents[seg + 1] - pwmPercents[seg];
+        float tempOffset = d / 10.0f - temps[seg];
+        lut[d] = (int)(pwmPercents[seg] + (tempOffset / tempRange) * pwmRange);
+    }
+}
+
+int temperatureToDeciC(float temp) {
+    float scaled = temp * 10.0f;
+    return (int)(scaled >= 0 ? scaled + 0.5f : scaled - 0.5f);
+}
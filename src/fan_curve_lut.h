@@ -0,0 +1,24 @@
+#ifndef FAN_CURVE_LUT_H
+#define FAN_CURVE_LUT_H
+
+#include <stdint.h>
+
+// Dense fixed-point fan curve table: one PWM % entry per 0.1 C step from 0.0 to 120.0 C.
+const int FAN_CURVE_LUT_MAX_DECI_C = 1200; // 120.0 C, same upper bound as curve point validation
+const int FAN_CURVE_LUT_SIZE = FAN_CURVE_LUT_MAX_DECI_C + 1;
+
+// Compiles curve points (temps in whole C, increasing) into the table.
+// Produces exactly the values the old float interpolation gave at every 0.1 C step.
+void buildFanCurveLut(uint8_t* lut, const int* temps, const int* pwmPercents, int numPoints);
+
+// Converts a temperature in C to the table's 0.1 C fixed-point scale, rounded to nearest.
+int temperatureToDeciC(float temp);
+
+// One clamped, indexed load. No FPU work.
+inline uint8_t lookupFanCurveLut(const uint8_t* lut, int tempDeciC) {
+    if (tempDeciC < 0) tempDeciC = 0;
+    else if (tempDeciC > FAN_CURVE_LUT_MAX_DECI_C) tempDeciC = FAN_CURVE_LUT_MAX_DECI_C;
+    return lut[tempDeciC];
+}
+
+#endif // FAN_CURVE_LUT_H
@@ -0,0 +1,37 @@
+#include "fan_output_conditioner.h"
+
+void resetFanOutputConditioner(FanOutputConditionerState* state, int currentPercent, int tempDeciC) {
+    state->output = (float)currentPercent;
+    state->heldTarget = currentPercent;
+    state->heldTempDeciC = tempDeciC;
+}
+
+int conditionFanOutput(FanOutputConditionerState* state, const FanOutputConditionerConfig& config,
+                       int targetPercent, int tempDeciC, bool applyHysteresis, float dtSeconds) {
+    // Hysteresis stage
+    if (!applyHysteresis || config.hysteresisDeciC <= 0 || targetPercent > state->heldTarget) {
+        state->heldTarget = targetPercent;
+        state->heldTempDeciC = tempDeciC;
+    } else if (targetPercent < state->heldTarget) {
+        if (tempDeciC <= state->heldTempDeciC - config.hysteresisDeciC) {
+            state->heldTarget = targetPercent;
+            state->heldTempDeciC = tempDeciC;
+        }
+    } else if (tempDeciC > state->heldTempDeciC) {
+        state->heldTempDeciC = tempDeciC; // Same level, track the peak
+    }
+
+    // Slew-rate stage
+    const float target = (float)state->heldTarget;
+    const float delta = target - state->output;
+    const float rate = delta > 0.0f ? config.rampUpPercentPerS : config.rampDownPercentPerS;
+    if (rate <= 0.0f) {
+        state->output = target;
+    } else if (dtSeconds > 0.0f) {
+        const float maxStep = rate * dtSeconds;
+        if (delta > maxStep) state->output += maxStep;
+        else if (delta < -maxStep) state->output -= maxStep;
+        else state->output = target;
+    }
+    return (int)(state->output + 0.5f);
+}
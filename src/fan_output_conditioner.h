@@ -0,0 +1,28 @@
+#ifndef FAN_OUTPUT_CONDITIONER_H
+#define FAN_OUTPUT_CONDITIONER_H
+
+// Output-conditioning stage between the auto/PID target and setFanSpeed():
+//  - temperature hysteresis: a higher target is taken at once, a lower one only after the temperature
+//    has fallen hysteresisDeciC below the peak seen at the current level (curve mode only)
+//  - slew-rate limit: the applied output moves towards the target at most rampUp/rampDown % per second
+
+struct FanOutputConditionerConfig {
+    float rampUpPercentPerS;   // 0 = no limit
+    float rampDownPercentPerS; // 0 = no limit
+    int hysteresisDeciC;       // 0 = no hysteresis
+};
+
+struct FanOutputConditionerState {
+    float output;      // Slewed output, fractional so slow ramps still progress every tick
+    int heldTarget;    // Target accepted by the hysteresis stage
+    int heldTempDeciC; // Peak temperature seen while holding heldTarget
+};
+
+// Restarts from currentPercent with no pending ramp (call on mode or curve changes).
+void resetFanOutputConditioner(FanOutputConditionerState* state, int currentPercent, int tempDeciC);
+
+// Returns the percentage to apply this tick.
+int conditionFanOutput(FanOutputConditionerState* state, const FanOutputConditionerConfig& config,
+                       int targetPercent, int tempDeciC, bool applyHysteresis, float dtSeconds);
+
+#endif // FAN_OUTPUT_CONDITIONER_H
@@ -0,0 +1,92 @@
+#include "fan_rpm_model.h"
+
+void fanRpmModelReset(FanRpmModel* model) {
+    for (int i = 0; i < FAN_RPM_MODEL_POINTS; i++) model->rpm[i] = 0;
+}
+
+bool fanRpmModelLearn(FanRpmModel* model, int dutyPercent, int rpm) {
+    if (dutyPercent <= 0 || dutyPercent >= FAN_RPM_MODEL_POINTS || rpm <= 0 || rpm > 65535) return false;
+    int old = model->rpm[dutyPercent];
+    int blended = (old == 0) ? rpm : old + (rpm - old) / 4; // EMA, alpha 1/4
+    if (blended <= 0) blended = 1;
+    model->rpm[dutyPercent] = (uint16_t)blended;
+    int diff = blended - old;
+    if (diff < 0) diff = -diff;
+    return old == 0 || diff * 100 >= old;
+}
+
+int fanRpmModelLearnedPoints(const FanRpmModel* model) {
+    int n = 0;
+    for (int i = 1; i < FAN_RPM_MODEL_POINTS; i++) if (model->rpm[i] > 0) n++;
+    return n;
+}
+
+float fanRpmModelDutyFor(const FanRpmModel* model, int targetRpm) {
+    if (fanRpmModelLearnedPoints(model) < 2) return -1.0f;
+    int prevDuty = -1, prevRpm = 0;
+    int lastDuty = -1, lastRpm = 0; // The two fastest points, for extrapolation
+    for (int d = 1; d < FAN_RPM_MODEL_POINTS; d++) {
+        int r = model->rpm[d];
+        if (r == 0) continue;
+        if (prevDuty >= 0 && r < prevRpm) r = prevRpm; // Monotonic envelope
+        if (r >= targetRpm) {
+            if (prevDuty < 0 || r == prevRpm) return (float)d;
+            return prevDuty + (float)(targetRpm - prevRpm) * (d - prevDuty) / (r - prevRpm);
+        }
+        lastDuty = prevDuty; lastRpm = prevRpm;
+        prevDuty = d; prevRpm = r;
+    }
+    // Faster than anything learned: extend the slope of the last two points
+    if (lastDuty < 0 || prevRpm <= lastRpm) return 100.0f;
+    float duty = prevDuty + (float)(targetRpm - prevRpm) * (prevDuty - lastDuty) / (prevRpm - lastRpm);
+    return duty > 100.0f ? 100.0f : duty;
+}
+
+void fanRpmControlReset(FanRpmControlState* state, float currentDuty, float feedforwardDuty) {
+    // With a model the feedforward jumps straight to the target's duty; without one, continue from where the fan is
+    state->integral = (feedforwardDuty < 0.0f) ? currentDuty : 0.0f;
+}
+
+void fanRpmControlRebase(FanRpmControlState* state, float oldFeedforwardDuty, float newFeedforwardDuty) {
+    if (oldFeedforwardDuty < 0.0f) oldFeedforwardDuty = 0.0f;
+    if (newFeedforwardDuty < 0.0f) newFeedforwardDuty = 0.0f;
+    state->integral += oldFeedforwardDuty - newFeedforwardDuty;
+}
+
+float fanRpmControlUpdate(FanRpmControlState* state, const FanRpmControlGains& gains, float feedforwardDuty,
+                          int targetRpm, int measuredRpm, float dtSeconds, float outMin, float outMax) {
+    bool haveModel = feedforwardDuty >= 0.0f;
+    if (!haveModel) feedforwardDuty = 0.0f; // No model yet: pure feedback
+    float error = (float)(targetRpm - measuredRpm);
+    float base = feedforwardDuty + gains.kp * error;
+    float output = base + state->integral;
+    bool saturatedHigh = output >= outMax && error > 0.0f;
+    bool saturatedLow = output <= outMin && error < 0.0f;
+    // With a model, a large error means the fan is still spinning up or down to the feedforward duty;
+    // integrating it would only cause overshoot
+    float absError = error < 0.0f ? -error : error;
+    bool transient = haveModel && absError * FAN_RPM_CONTROL_TRANSIENT_DIVISOR > (float)targetRpm;
+    if (!saturatedHigh && !saturatedLow && !transient && dtSeconds > 0.0f) {
+        state->integral += gains.ki * error * dtSeconds;
+        output = base + state->integral;
+    }
+    // Integrator never needs to reach further than the full output range
+    float span = outMax - outMin;
+    if (state->integral > span) state->integral = span;
+    if (state->integral < -span) state->integral = -span;
+    if (output > outMax) output = outMax;
+    if (output < outMin) output = outMin;
+    return output;
+}
+
+bool parseFanRpmTarget(const char* text, int maxRpm, int* rpm) {
+    if (!text || !*text) return false;
+    int value = 0;
+    for (const char* p = text; *p; p++) {
+        if (*p < '0' || *p > '9') return false;
+        value = value * 10 + (*p - '0');
+        if (value > maxRpm) return false;
+    }
+    *rpm = value;
+    return true;
+}
@@ -0,0 +1,57 @@
+#ifndef FAN_RPM_MODEL_H
+#define FAN_RPM_MODEL_H
+
+#include <stdint.h>
+
+// Learned PWM -> RPM characteristic of one fan plus the controller for RPM target mode.
+// The model holds the settled RPM for each whole duty percentage. It fills in while the fan runs,
+// in any mode. RPM target mode inverts it for a feedforward duty, and a PI term on the measured
+// RPM trims the remaining error.
+
+const int FAN_RPM_MODEL_POINTS = 101; // Duty 0..100 %
+const int FAN_RPM_CONTROL_TRANSIENT_DIVISOR = 5; // With a model, integrate only within 1/5 of the target
+
+struct FanRpmModel {
+    uint16_t rpm[FAN_RPM_MODEL_POINTS]; // Settled RPM at each duty, 0 = not learned
+};
+
+void fanRpmModelReset(FanRpmModel* model);
+
+// Blends a settled reading into the entry for dutyPercent (first reading is taken as is).
+// Returns true if the stored value moved by at least 1 %, i.e. the model is worth saving.
+bool fanRpmModelLearn(FanRpmModel* model, int dutyPercent, int rpm);
+
+int fanRpmModelLearnedPoints(const FanRpmModel* model);
+
+// Duty that should give targetRpm, interpolated over the learned points (kept monotonic, so a noisy
+// entry cannot fold the curve back). Extrapolates above the fastest point, clamps to the slowest one
+// below it. -1 with fewer than 2 learned points.
+float fanRpmModelDutyFor(const FanRpmModel* model, int targetRpm);
+
+struct FanRpmControlGains {
+    float kp; // % per RPM of error
+    float ki; // % per RPM of error per second
+};
+
+struct FanRpmControlState {
+    float integral; // Feedback correction on top of the feedforward duty, %
+};
+
+// Start of RPM target mode (or a new target). With a model (feedforwardDuty >= 0) the correction starts at 0 so
+// the output jumps to the feedforward duty; without one it is seeded so the output continues from currentDuty.
+void fanRpmControlReset(FanRpmControlState* state, float currentDuty, float feedforwardDuty);
+
+// Keeps the output continuous when the model (and so the feedforward for the same target) changes.
+void fanRpmControlRebase(FanRpmControlState* state, float oldFeedforwardDuty, float newFeedforwardDuty);
+
+// One step: feedforward + kp * error + integral, clamped to [outMin, outMax]. Integration is held
+// while the output is saturated in the direction of the error, and (with a model) while the error is
+// still large, since the feedforward covers the transient.
+float fanRpmControlUpdate(FanRpmControlState* state, const FanRpmControlGains& gains, float feedforwardDuty,
+                          int targetRpm, int measuredRpm, float dtSeconds, float outMin, float outMax);
+
+// Target RPM typed by a user (MQTT rpm/set, serial set_mode rpm): digits only, 0..maxRpm. False for empty
+// or non-numeric text, so a typo is rejected instead of becoming a 0 RPM (stopped) target.
+bool parseFanRpmTarget(const char* text, int maxRpm, int* rpm);
+
+#endif // FAN_RPM_MODEL_H
@@ -0,0 +1,62 @@
+#include "http_cache.h"
+#include <string.h>
+
+static bool isSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+bool etagMatches(const char* ifNoneMatch, const char* etag) {
+    if (!ifNoneMatch || !etag) return false;
+    size_t etagLength = strlen(etag);
+    const char* p = ifNoneMatch;
+    for (;;) {
+        while (isSpace(*p) || *p == ',') p++;
+        if (*p == '\0') return false;
+        if (*p == '*') return true;
+        if (p[0] == 'W' && p[1] == '/') p += 2;
+        if (*p != '"') return false; // Malformed: never matches, so the client gets the full response
+        const char* tag = ++p;
+        while (*p && *p != '"') p++;
+        if (*p != '"') return false;
+        if ((size_t)(p - tag) == etagLength && strncmp(tag, etag, etagLength) == 0) return true;
+        p++;
+    }
+}
+
+// Copies the next space-separated word; false if there is none or it does not fit
+static bool nextWord(const char*& p, char* out, size_t size) {
+    while (isSpace(*p)) p++;
+    const char* start = p;
+    while (*p && !isSpace(*p)) p++;
+    size_t length = (size_t)(p - start);
+    if (length == 0 || length >= size) return false;
+    memcpy(out, start, length);
+    out[length] = '\0';
+    return true;
+}
+
+HttpPollResult httpPollDecide(bool ready, bool unchanged, uint32_t elapsedMs, uint32_t waitMs) {
+    bool waiting = elapsedMs < waitMs;
+    if (!ready) return waiting ? HTTP_POLL_WAIT : HTTP_POLL_UNAVAILABLE;
+    if (!unchanged) return HTTP_POLL_SEND;
+    return waiting ? HTTP_POLL_WAIT : HTTP_POLL_NOT_MODIFIED;
+}
+
+uint32_t parseWaitSeconds(const char* text, uint32_t maxSeconds) {
+    if (!text) return 0;
+    uint32_t seconds = 0;
+    for (const char* p = text; *p; p++) {
+        if (*p < '0' || *p > '9') return 0;
+        seconds = seconds * 10 + (uint32_t)(*p - '0');
+        if (seconds > maxSeconds) return maxSeconds;
+    }
+    return seconds;
+}
+
+bool parseAssetManifestLine(const char* line, char* url, size_t urlSize, char* etag, size_t etagSize) {
+    const char* p = line;
+    if (!nextWord(p, url, urlSize) || url[0] != '/') return false;
+    if (!nextWord(p, etag, etagSize)) return false;
+    while (isSpace(*p)) p++;
+    return *p == '\0';
+}
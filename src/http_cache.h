@@ -0,0 +1,31 @@
+#ifndef HTTP_CACHE_H
+#define HTTP_CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Conditional-request helpers: ETag comparison, the web asset manifest that tools/build_web_assets.py
+// writes ("<url> <etag>" per line, etag without quotes) and the long-poll (?wait=) decision of the REST API.
+
+// True if an If-None-Match header value names etag: "*", or a list of quoted tags, weak ones (W/) included
+// since If-None-Match uses weak comparison
+bool etagMatches(const char* ifNoneMatch, const char* etag);
+
+// Parses one manifest line; false for a blank, malformed or too long one
+bool parseAssetManifestLine(const char* line, char* url, size_t urlSize, char* etag, size_t etagSize);
+
+enum HttpPollResult : uint8_t {
+    HTTP_POLL_SEND,          // 200 with the current document
+    HTTP_POLL_NOT_MODIFIED,  // 304: the client's copy is current and its wait is over
+    HTTP_POLL_WAIT,          // Keep the request parked
+    HTTP_POLL_UNAVAILABLE    // 503: no document yet and the wait is over
+};
+
+// ready: the document exists; unchanged: If-None-Match named its current ETag. A request without a wait
+// (waitMs 0) is answered at once; a waiting one as soon as the document changes or elapsedMs reaches waitMs.
+HttpPollResult httpPollDecide(bool ready, bool unchanged, uint32_t elapsedMs, uint32_t waitMs);
+
+// ?wait= in seconds, clamped to maxSeconds; 0 when missing or not a number
+uint32_t parseWaitSeconds(const char* text, uint32_t maxSeconds);
+
+#endif // HTTP_CACHE_H
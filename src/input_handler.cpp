@@ -3,8 +3,43 @@
 #include "nvs_handler.h"    
 #include "display_handler.h"
 #include "fan_control.h" 
+#include "control_commands.h"
+#include "tasks.h" // wakeMainAppTaskFromISR, getControlLoopTiming
 #include "mqtt_handler.h" 
 #include "ota_updater.h" // For triggerOTAUpdateCheck()
+#include "wifi_manager.h" // requestWiFiReconnect/Disconnect
+#include "network_handler.h" // getWebSocketWireRates, getApiStats, getEventStreamStats
+#include "status_memory.h" // getStatusMemoryStats
+#include "web_assets.h" // getWebAssetStats
+
+// Parses an optional trailing fan channel argument (0-based). Empty means every channel.
+static bool parseFanChannelArg(String arg, int& firstCh, int& lastCh) {
+    arg.trim();
+    if (arg.length() == 0) { firstCh = 0; lastCh = NUM_FAN_CHANNELS - 1; return true; }
+    int ch = arg.toInt();
+    if (String(ch) != arg || !isValidFanChannel(ch)) {
+        Serial.printf("[SERIAL_CMD_ERR] Invalid fan channel '%s' (0-%d).\n", arg.c_str(), NUM_FAN_CHANNELS - 1);
+        return false;
+    }
+    firstCh = lastCh = ch;
+    return true;
+}
+
+// Queues a serial control command for the channel range parsed above
+static void enqueueSerialCommand(ControlCommand cmd, int firstCh, int lastCh) {
+    cmd.channel = (firstCh == lastCh) ? firstCh : CONTROL_COMMAND_ALL_CHANNELS;
+    cmd.source = CMD_SOURCE_SERIAL;
+    if (!enqueueControlCommand(cmd)) Serial.println("[SERIAL_CMD_ERR] Command queue full, try again.");
+}
+
+static void IRAM_ATTR onButtonEdge() {
+    wakeMainAppTaskFromISR(MAIN_TASK_WAKE_BUTTON);
+}
+
+void setupButtonWakeInterrupts() {
+    int button_pins[5] = {BTN_MENU_PIN, BTN_UP_PIN, BTN_DOWN_PIN, BTN_SELECT_PIN, BTN_BACK_PIN};
+    for (int i = 0; i < 5; ++i) attachInterrupt(digitalPinToInterrupt(button_pins[i]), onButtonEdge, FALLING);
+}
 
 // --- Button Input Handling for LCD Menu ---
 void handleMenuInput() {
@@ -24,7 +59,7 @@ void handleMenuInput() {
                     if(serialDebugEnabled) Serial.println("[MENU_LCD] Entered Menu Mode.");
                     currentMenuScreen = MAIN_MENU; 
                     selectedMenuItem = 0;
-                    ota_status_message = "OTA Idle"; // Reset OTA message when entering menu
+                    setOtaStatusMessage("OTA Idle"); // Reset OTA message when entering menu
                 } else {
                     if(serialDebugEnabled) Serial.println("[MENU_LCD] Exited Menu Mode.");
                     if (rebootNeeded) { 
@@ -99,11 +134,11 @@ void handleMenuInput() {
                     if (currentMenuScreen == MAIN_MENU) {
                         if (selectedMenuItem == 0) { currentMenuScreen = WIFI_SETTINGS; selectedMenuItem = 0; }
                         else if (selectedMenuItem == 1) { currentMenuScreen = MQTT_SETTINGS; selectedMenuItem = 0; }
-                        else if (selectedMenuItem == 2) { currentMenuScreen = OTA_UPDATE_SCREEN; selectedMenuItem = 0; ota_status_message = "Press SEL to check"; } 
+                        else if (selectedMenuItem == 2) { currentMenuScreen = OTA_UPDATE_SCREEN; selectedMenuItem = 0; setOtaStatusMessage("Press SEL to check"); } 
                         else if (selectedMenuItem == 3) { isInMenuMode = false; if(rebootNeeded){currentMenuScreen = CONFIRM_REBOOT; isInMenuMode=true; selectedMenuItem=0;}}
                     } 
                     else if (currentMenuScreen == WIFI_SETTINGS) {
-                        if (selectedMenuItem == 0) { isWiFiEnabled = !isWiFiEnabled; saveWiFiConfig(); rebootNeeded = true; currentMenuScreen = CONFIRM_REBOOT; selectedMenuItem = 0; } 
+                        if (selectedMenuItem == 0) { isWiFiEnabled = !isWiFiEnabled; requestNvsSave(NVS_SECTION_WIFI); } // Applied live by the WiFi manager
                         else if (selectedMenuItem == 1) { currentMenuScreen = WIFI_SCAN; selectedMenuItem = 0; performWiFiScan(); } 
                         else if (selectedMenuItem == 2) { currentMenuScreen = WIFI_SCAN; selectedMenuItem = 0; performWiFiScan(); } 
                         else if (selectedMenuItem == 3) { passwordCharIndex = 0; currentPasswordEditChar = 'a'; memset(passwordInputBuffer, 0, sizeof(passwordInputBuffer)); currentMenuScreen = WIFI_PASSWORD_ENTRY; selectedMenuItem = 0; } 
@@ -128,12 +163,12 @@ void handleMenuInput() {
                              strncpy(current_password, passwordInputBuffer, sizeof(current_password) -1);
                              current_password[sizeof(current_password)-1] = '\0';
                              if(serialDebugEnabled) Serial.printf("[MENU_LCD] WiFi Password Entered (length %d)\n", strlen(current_password));
-                             saveWiFiConfig(); 
+                             requestNvsSave(NVS_SECTION_WIFI); 
                              currentMenuScreen = WIFI_SETTINGS; selectedMenuItem = 4; 
                         }
                     }
                     else if (currentMenuScreen == MQTT_SETTINGS) {
-                        if (selectedMenuItem == 0) { isMqttEnabled = !isMqttEnabled; saveMqttConfig(); rebootNeeded = true; currentMenuScreen = CONFIRM_REBOOT; selectedMenuItem = 0; } 
+                        if (selectedMenuItem == 0) { isMqttEnabled = !isMqttEnabled; requestNvsSave(NVS_SECTION_MQTT); rebootNeeded = true; currentMenuScreen = CONFIRM_REBOOT; selectedMenuItem = 0; } 
                         else if (selectedMenuItem == 1) { memset(generalInputBuffer, 0, sizeof(generalInputBuffer)); strncpy(generalInputBuffer, mqttServer, sizeof(generalInputBuffer)-1); generalInputCharIndex = strlen(generalInputBuffer); currentGeneralEditChar = (generalInputCharIndex > 0 && generalInputBuffer[generalInputCharIndex-1] != ' ') ? generalInputBuffer[generalInputCharIndex-1] : 'a'; currentMenuScreen = MQTT_SERVER_ENTRY; selectedMenuItem = 0; } 
                         else if (selectedMenuItem == 2) { memset(generalInputBuffer, 0, sizeof(generalInputBuffer)); String(mqttPort).toCharArray(generalInputBuffer, sizeof(generalInputBuffer)); generalInputCharIndex = strlen(generalInputBuffer); currentGeneralEditChar = '0'; currentMenuScreen = MQTT_PORT_ENTRY; selectedMenuItem = 0; } 
                         else if (selectedMenuItem == 3) { memset(generalInputBuffer, 0, sizeof(generalInputBuffer)); strncpy(generalInputBuffer, mqttUser, sizeof(generalInputBuffer)-1); generalInputCharIndex = strlen(generalInputBuffer); currentGeneralEditChar = 'a'; currentMenuScreen = MQTT_USER_ENTRY; selectedMenuItem = 0; } 
@@ -150,11 +185,11 @@ void handleMenuInput() {
                             generalInputCharIndex++;
                             currentGeneralEditChar = (currentGeneralEditChar == '.') ? 'a' : currentGeneralEditChar; // Cycle char or reset
                         } else { // Entry complete for this field
-                            if (currentMenuScreen == MQTT_SERVER_ENTRY) { strncpy(mqttServer, generalInputBuffer, sizeof(mqttServer)-1); mqttServer[sizeof(mqttServer)-1] = '\0'; saveMqttConfig(); rebootNeeded = true; currentMenuScreen = MQTT_SETTINGS; selectedMenuItem = 1;}
-                            else if (currentMenuScreen == MQTT_USER_ENTRY) { strncpy(mqttUser, generalInputBuffer, sizeof(mqttUser)-1); mqttUser[sizeof(mqttUser)-1] = '\0'; saveMqttConfig(); rebootNeeded = true; currentMenuScreen = MQTT_SETTINGS; selectedMenuItem = 3;}
-                            else if (currentMenuScreen == MQTT_TOPIC_ENTRY) { strncpy(mqttBaseTopic, generalInputBuffer, sizeof(mqttBaseTopic)-1); mqttBaseTopic[sizeof(mqttBaseTopic)-1] = '\0'; saveMqttConfig(); rebootNeeded = true; currentMenuScreen = MQTT_SETTINGS; selectedMenuItem = 5;}
-                            else if (currentMenuScreen == MQTT_PASS_ENTRY) { strncpy(mqttPassword, generalInputBuffer, sizeof(mqttPassword)-1); mqttPassword[sizeof(mqttPassword)-1] = '\0'; saveMqttConfig(); rebootNeeded = true; currentMenuScreen = MQTT_SETTINGS; selectedMenuItem = 4;}
-                            else if (currentMenuScreen == MQTT_DISCOVERY_PREFIX_ENTRY) { strncpy(mqttDiscoveryPrefix, generalInputBuffer, sizeof(mqttDiscoveryPrefix)-1); mqttDiscoveryPrefix[sizeof(mqttDiscoveryPrefix)-1] = '\0'; saveMqttDiscoveryConfig(); rebootNeeded = true; currentMenuScreen = MQTT_DISCOVERY_SETTINGS; selectedMenuItem = 1;}
+                            if (currentMenuScreen == MQTT_SERVER_ENTRY) { strncpy(mqttServer, generalInputBuffer, sizeof(mqttServer)-1); mqttServer[sizeof(mqttServer)-1] = '\0'; requestNvsSave(NVS_SECTION_MQTT); rebootNeeded = true; currentMenuScreen = MQTT_SETTINGS; selectedMenuItem = 1;}
+                            else if (currentMenuScreen == MQTT_USER_ENTRY) { strncpy(mqttUser, generalInputBuffer, sizeof(mqttUser)-1); mqttUser[sizeof(mqttUser)-1] = '\0'; requestNvsSave(NVS_SECTION_MQTT); rebootNeeded = true; currentMenuScreen = MQTT_SETTINGS; selectedMenuItem = 3;}
+                            else if (currentMenuScreen == MQTT_TOPIC_ENTRY) { strncpy(mqttBaseTopic, generalInputBuffer, sizeof(mqttBaseTopic)-1); mqttBaseTopic[sizeof(mqttBaseTopic)-1] = '\0'; requestNvsSave(NVS_SECTION_MQTT); rebootNeeded = true; currentMenuScreen = MQTT_SETTINGS; selectedMenuItem = 5;}
+                            else if (currentMenuScreen == MQTT_PASS_ENTRY) { strncpy(mqttPassword, generalInputBuffer, sizeof(mqttPassword)-1); mqttPassword[sizeof(mqttPassword)-1] = '\0'; requestNvsSave(NVS_SECTION_MQTT); rebootNeeded = true; currentMenuScreen = MQTT_SETTINGS; selectedMenuItem = 4;}
+                            else if (currentMenuScreen == MQTT_DISCOVERY_PREFIX_ENTRY) { strncpy(mqttDiscoveryPrefix, generalInputBuffer, sizeof(mqttDiscoveryPrefix)-1); mqttDiscoveryPrefix[sizeof(mqttDiscoveryPrefix)-1] = '\0'; requestNvsSave(NVS_SECTION_MQTT_DISCOVERY); rebootNeeded = true; currentMenuScreen = MQTT_DISCOVERY_SETTINGS; selectedMenuItem = 1;}
                         }
                     }
                     else if (currentMenuScreen == MQTT_PORT_ENTRY) {
@@ -165,13 +200,13 @@ void handleMenuInput() {
                         } else { // Port entry complete
                             mqttPort = atoi(generalInputBuffer);
                             if (mqttPort == 0 && strlen(generalInputBuffer) > 0 && generalInputBuffer[0] != '0') mqttPort = 1883; // Basic validation
-                            saveMqttConfig();
+                            requestNvsSave(NVS_SECTION_MQTT);
                             rebootNeeded = true;
                             currentMenuScreen = MQTT_SETTINGS; selectedMenuItem = 2;
                         }
                     }
                     else if (currentMenuScreen == MQTT_DISCOVERY_SETTINGS) {
-                        if (selectedMenuItem == 0) { isMqttDiscoveryEnabled = !isMqttDiscoveryEnabled; saveMqttDiscoveryConfig(); rebootNeeded = true; currentMenuScreen = CONFIRM_REBOOT; selectedMenuItem = 0; } 
+                        if (selectedMenuItem == 0) { isMqttDiscoveryEnabled = !isMqttDiscoveryEnabled; requestNvsSave(NVS_SECTION_MQTT_DISCOVERY); rebootNeeded = true; currentMenuScreen = CONFIRM_REBOOT; selectedMenuItem = 0; } 
                         else if (selectedMenuItem == 1) { memset(generalInputBuffer, 0, sizeof(generalInputBuffer)); strncpy(generalInputBuffer, mqttDiscoveryPrefix, sizeof(generalInputBuffer)-1); generalInputCharIndex = strlen(generalInputBuffer); currentGeneralEditChar = (generalInputCharIndex > 0 && generalInputBuffer[generalInputCharIndex-1] != ' ') ? generalInputBuffer[generalInputCharIndex-1] : 'h'; currentMenuScreen = MQTT_DISCOVERY_PREFIX_ENTRY; selectedMenuItem = 0; } 
                         else if (selectedMenuItem == 2) { currentMenuScreen = MQTT_SETTINGS; selectedMenuItem = 6; }
                     }
@@ -185,7 +220,7 @@ void handleMenuInput() {
                                 selectedMenuItem = 0; 
                             } else if (selectedMenuItem == 1) { // "Back to Main"
                                 currentMenuScreen = MAIN_MENU; selectedMenuItem = 2; 
-                                ota_status_message = "OTA Idle"; 
+                                setOtaStatusMessage("OTA Idle"); 
                             }
                         }
                     }
@@ -193,7 +228,7 @@ void handleMenuInput() {
                         if(selectedMenuItem == 0) { 
                             if(serialDebugEnabled) Serial.println("[SYSTEM_LCD] Rebooting now...");
                             lcd.clear(); lcd.print("Rebooting..."); 
-                            delay(1000); ESP.restart();
+                            flushNvsSaves(); delay(1000); ESP.restart();
                         } else { 
                             rebootNeeded = false; currentMenuScreen = MAIN_MENU; selectedMenuItem = 0;
                         }
@@ -205,7 +240,7 @@ void handleMenuInput() {
                              if(serialDebugEnabled) Serial.println("[MENU_LCD] Cannot go back, OTA in progress.");
                         } else {
                             currentMenuScreen = MAIN_MENU; selectedMenuItem = 2; 
-                            ota_status_message = "OTA Idle";
+                            setOtaStatusMessage("OTA Idle");
                         }
                      }
                      else if (currentMenuScreen == WIFI_PASSWORD_ENTRY) { 
@@ -269,13 +304,29 @@ void handleSerialCommands() {
         if (command.equalsIgnoreCase("help")) {
             Serial.println("--- Available Serial Commands ---");
             Serial.println("status                     : View current status");
-            Serial.println("set_mode auto              : Set Auto fan mode");
-            Serial.println("set_mode manual <0-100>    : Set Manual fan mode and speed %");
-            Serial.println("wifi_enable                : Enable WiFi (reboot needed)");
-            Serial.println("wifi_disable               : Disable WiFi (reboot needed)");
+            Serial.printf("  ([ch] = optional fan channel 0-%d, all fans if omitted)\n", NUM_FAN_CHANNELS - 1);
+            Serial.println("set_mode auto [ch]         : Set Auto fan mode");
+            Serial.println("set_mode manual <0-100> [ch] : Set Manual fan mode and speed %");
+            Serial.println("set_mode pid [ch]          : Set PID mode (holds the PID setpoint)");
+            Serial.println("set_mode rpm <rpm> [ch]    : Hold a target RPM (fans with a tachometer)");
+            Serial.println("view_rpm_model [ch]        : View learned PWM -> RPM table");
+            Serial.println("reset_rpm_model [ch]       : Forget learned PWM -> RPM table");
+            Serial.println("calibrate [ch]             : Sweep duty 0-100-0% to find start/stall duty and max RPM");
+            Serial.println("calibrate_cancel [ch]      : Stop a running calibration");
+            Serial.println("view_calibration [ch]      : View calibration results");
+            Serial.println("clear_calibration [ch]     : Forget calibration (turns start limits off)");
+            Serial.println("set_pid <sp> <kp> <ki> <kd>: Set PID setpoint (C) and gains");
+            Serial.println("view_pid                   : View PID configuration");
+            Serial.println("view_latency               : Command receipt -> PWM latency histogram");
+            Serial.println("reset_latency              : Clear the latency histogram and control loop timing");
+            Serial.println("set_output <up> <down> <hyst> : Set ramp limits (%/s, 0 = off) and curve hysteresis (C)");
+            Serial.println("wifi_enable                : Enable WiFi");
+            Serial.println("wifi_disable               : Disable WiFi");
             Serial.println("set_ssid <your_ssid>       : Set WiFi SSID");
             Serial.println("set_pass <your_password>   : Set WiFi Password");
-            Serial.println("connect_wifi               : Attempt WiFi connection (prompts reboot on success)");
+            Serial.println("set_static_ip <ip> <gw> <mask> [dns] : Use a static address instead of DHCP");
+            Serial.println("static_ip_off              : Use DHCP again");
+            Serial.println("connect_wifi               : (Re)connect WiFi in the background");
             Serial.println("disconnect_wifi            : Disconnect from current WiFi");
             Serial.println("scan_wifi                  : Scan for WiFi networks");
             Serial.println("mqtt_enable                : Enable MQTT (reboot needed)");
@@ -289,27 +340,83 @@ void handleSerialCommands() {
             Serial.println("mqtt_discovery_disable     : Disable MQTT HA Discovery (reboot needed)");
             Serial.println("set_mqtt_discovery_prefix <prefix> : Set MQTT Discovery Prefix (reboot needed)");
             Serial.println("ota_update                 : Check for and apply OTA firmware update from GitHub"); 
-            Serial.println("view_curve                 : View current fan curve");
+            Serial.println("view_curve [ch]            : View current fan curve");
             Serial.println("clear_staging_curve        : Clear temporary fan curve for editing");
             Serial.println("stage_curve_point <t> <p>  : Add point (temp pwm%) to staging curve");
-            Serial.println("apply_staged_curve         : Apply and save staged fan curve");
-            Serial.println("load_default_curve         : Load default fan curve");
+            Serial.println("apply_staged_curve [ch]    : Apply and save staged fan curve");
+            Serial.println("load_default_curve [ch]    : Load default fan curve");
             Serial.println("reboot                     : Reboot the ESP32");
             Serial.println("-------------------------------");
         } else if (command.equalsIgnoreCase("status")) {
             Serial.println("--- Current Status ---");
-            Serial.printf("Mode: %s\n", isAutoMode ? "AUTO" : "MANUAL");
-            Serial.printf("Fan Speed: %d%%\n", fanSpeedPercentage);
             Serial.printf("Temperature: %.1f C %s\n", tempSensorFound ? currentTemperature : -999.0, tempSensorFound ? "" : "(N/A)");
-            Serial.printf("Fan RPM: %d\n", fanRpm);
+            for (int ch = 0; ch < NUM_FAN_CHANNELS; ch++) {
+                Serial.printf("Fan %d (ch %d): Mode %s, Speed %d%%, RPM %d (tach %s)", ch + 1, ch,
+                              getFanModeName(ch), fanChannels.speedPercentage[ch], fanChannels.rpm[ch], getFanTachSourceName(ch));
+                if (fanChannels.isRpmMode[ch]) Serial.printf(", Target %d RPM", fanChannels.targetRpm[ch]);
+                if (isFanCalibrating(ch)) Serial.print(", calibrating");
+                Serial.println();
+            }
+            Serial.printf("PID: Setpoint %.1f C, Kp %.3f, Ki %.3f, Kd %.3f\n", pidSetpointC, pidKp, pidKi, pidKd);
+            Serial.printf("Output: Ramp up %.1f %%/s, Ramp down %.1f %%/s, Hysteresis %.1f C\n", fanRampUpPercentPerS, fanRampDownPercentPerS, fanHysteresisC);
+            Serial.printf("Output writes: %lu, Suppressed changes: %lu, Suppressed broadcasts: %lu\n", fanOutputWrites, fanSuppressedOutputChanges, fanSuppressedBroadcasts);
+            ControlCommandQueueStats commandStats;
+            controlCommandQueueGetStats(&controlCommandQueue, &commandStats);
+            Serial.printf("Commands: %u applied, %u dropped, queue depth %u (max %u/%u), latency avg %u us, max %u us\n",
+                          commandStats.applied, commandStats.dropped, commandStats.depth, commandStats.maxDepth, CONTROL_COMMAND_QUEUE_SIZE,
+                          commandStats.latencyAvgUs, commandStats.latencyMaxUs);
+            const LatencyHistogram* outputLatency = getControlCommandOutputLatency();
+            Serial.printf("Command -> PWM: p50 %u us, p99 %u us, max %u us (%u commands, see view_latency)\n",
+                          latencyHistogramPercentile(outputLatency, 50), latencyHistogramPercentile(outputLatency, 99), outputLatency->maxUs, outputLatency->total);
+            const ControlLoopTiming* timing = getControlLoopTiming();
+            Serial.printf("Control loop: %lu ms period, %u passes, period %u-%u us, jitter p99 %u us / max %u us, longest pass %u us, %u overruns\n",
+                          CONTROL_TASK_PERIOD_MS, timing->passes, timing->minPeriodUs, timing->maxPeriodUs,
+                          latencyHistogramPercentile(&timing->jitter, 99), timing->jitter.maxUs, timing->maxExecUs, timing->overruns);
+            Serial.printf("NVS: %u writes, %u avoided, %u bytes written, %d pending (debounce %lu ms, max delay %lu ms)\n",
+                          nvsSaveScheduler.writes.load(), nvsSaveSchedulerWritesAvoided(&nvsSaveScheduler), nvsSaveScheduler.bytesWritten.load(),
+                          nvsSaveSchedulerPending(&nvsSaveScheduler), NVS_SAVE_DEBOUNCE_MS, NVS_SAVE_MAX_DELAY_MS);
             Serial.printf("WiFi Enabled: %s\n", isWiFiEnabled ? "Yes" : "No");
             if (isWiFiEnabled) {
-                Serial.printf("WiFi Status: %s\n", WiFi.status() == WL_CONNECTED ? "Connected" : "Disconnected/Connecting");
+                const WifiLink* link = getWifiLink();
+                Serial.printf("WiFi Status: %s (%lu attempts, %lu failed, %lu drops, last connect %lu ms)\n",
+                              wifiLinkStateName(link->state), (unsigned long)link->attempts, (unsigned long)link->failures,
+                              (unsigned long)link->drops, (unsigned long)link->lastConnectMs);
                 if (WiFi.status() == WL_CONNECTED) {
                     Serial.print("IP Address: "); Serial.println(WiFi.localIP());
                 }
                 Serial.print("Configured SSID: "); Serial.println(current_ssid);
+                if (link->firstOnlineMs) Serial.printf("Boot to online: %lu ms\n", (unsigned long)link->firstOnlineMs);
+                Serial.printf("Fast join: %s (%lu attempts, %lu fell back), Static IP: %s\n",
+                              wifiJoinCacheUsable(&wifiJoinCache, current_ssid) ? "cached" : "no cache",
+                              (unsigned long)link->fastAttempts, (unsigned long)link->fastFailures,
+                              wifiStaticIp.enabled ? IPAddress(wifiStaticIp.ip).toString().c_str() : "Off (DHCP)");
+                uint32_t wsSentPerMin, wsFullPerMin;
+                getWebSocketWireRates(&wsSentPerMin, &wsFullPerMin);
+                Serial.printf("WebSocket: %lu bytes/min sent (%lu bytes/min as full documents), %lu us per broadcast\n",
+                              (unsigned long)wsSentPerMin, (unsigned long)wsFullPerMin, (unsigned long)getWebSocketBroadcastAvgUs());
             }
+            StatusMemoryStats memory;
+            getStatusMemoryStats(&memory);
+            Serial.printf("Heap: %lu bytes free (low %lu), largest block %lu, %u%% fragmented\n", (unsigned long)memory.heapFree,
+                          (unsigned long)memory.heapMinFree, (unsigned long)memory.heapLargestBlock, memory.heapFragPercent);
+            Serial.printf("Status JSON arena: %lu / %lu bytes peak, %lu messages dropped, %lu passes left it in use\n",
+                          (unsigned long)memory.arenaPeakBytes, (unsigned long)memory.arenaCapacity, (unsigned long)memory.dropped,
+                          (unsigned long)memory.scratchLeaks);
+            uint32_t assetFull, assetNotModified;
+            bool assetsFromSpiffs;
+            getWebAssetStats(&assetFull, &assetNotModified, &assetsFromSpiffs);
+            Serial.printf("Web UI files (%s): %lu sent, %lu answered 304 Not Modified\n", assetsFromSpiffs ? "SPIFFS override" : "firmware",
+                          (unsigned long)assetFull, (unsigned long)assetNotModified);
+            uint32_t apiSent, apiNotModified, apiRejected;
+            getApiStats(&apiSent, &apiNotModified, &apiRejected);
+            Serial.printf("REST API: %lu sent, %lu answered 304 Not Modified, %lu rejected (busy)\n", (unsigned long)apiSent,
+                          (unsigned long)apiNotModified, (unsigned long)apiRejected);
+            EventStreamStats sse;
+            getEventStreamStats(&sse);
+            Serial.printf("Event stream (/events): %lu clients, queue depths", (unsigned long)sse.clients);
+            for (uint32_t i = 0; i < sse.clients && i < SSE_MAX_CLIENTS; i++) Serial.printf(" %lu", (unsigned long)sse.queueDepth[i]);
+            Serial.printf(" (limit %u); %lu dropped as slow, %lu events skipped, %lu refused\n", (unsigned)SSE_CLIENT_MAX_QUEUED,
+                          (unsigned long)sse.dropped, (unsigned long)sse.skipped, (unsigned long)sse.refused);
             Serial.printf("MQTT Enabled: %s\n", isMqttEnabled ? "Yes" : "No");
             if (isMqttEnabled) {
                 Serial.printf("MQTT Server: %s:%d\n", mqttServer, mqttPort);
@@ -320,104 +427,251 @@ void handleSerialCommands() {
                 Serial.printf("MQTT Discovery Prefix: %s\n", mqttDiscoveryPrefix);
             }
             Serial.printf("Reboot Needed: %s\n", rebootNeeded ? "Yes" : "No");
-            Serial.printf("OTA Status: %s\n", ota_status_message.c_str());
+            Serial.printf("OTA Status: %s\n", getOtaStatusMessage().c_str());
             Serial.printf("OTA In Progress: %s\n", ota_in_progress ? "Yes" : "No");
             Serial.println("----------------------");
-        } else if (command.equalsIgnoreCase("set_mode auto")) {
-            isAutoMode = true;
-            needsImmediateBroadcast = true; 
-            Serial.println("[SERIAL_CMD] Mode set to AUTO.");
-        } else if (command.startsWith("set_mode manual ")) {
-            int val = command.substring(16).toInt();
-            if (val >= 0 && val <= 100) {
-                isAutoMode = false;
-                manualFanSpeedPercentage = val;
-                needsImmediateBroadcast = true;
-                Serial.printf("[SERIAL_CMD] Mode set to MANUAL, speed %d%%.\n", val);
+        } else if (command.equalsIgnoreCase("set_mode auto") || command.startsWith("set_mode auto ")) {
+            int firstCh, lastCh;
+            if (parseFanChannelArg(command.substring(13), firstCh, lastCh)) {
+                enqueueSerialCommand(makeControlCommand(CMD_SET_MODE_AUTO, firstCh, CMD_SOURCE_SERIAL), firstCh, lastCh);
+            }
+        } else if (command.equalsIgnoreCase("set_mode pid") || command.startsWith("set_mode pid ")) {
+            int firstCh, lastCh;
+            if (parseFanChannelArg(command.substring(12), firstCh, lastCh)) {
+                enqueueSerialCommand(makeControlCommand(CMD_SET_MODE_PID, firstCh, CMD_SOURCE_SERIAL), firstCh, lastCh);
+            }
+        } else if (command.startsWith("set_pid ")) {
+            float sp, kp, ki, kd;
+            if (sscanf(command.c_str(), "set_pid %f %f %f %f", &sp, &kp, &ki, &kd) != 4) {
+                Serial.println("[SERIAL_CMD_ERR] Format: set_pid <setpoint> <kp> <ki> <kd>");
+            } else if (!isValidPidConfig(sp, kp, ki, kd)) {
+                Serial.println("[SERIAL_CMD_ERR] Invalid PID values (setpoint 0-120, kp 0-100, ki 0-10, kd 0-500).");
+            } else {
+                ControlCommand cmd = makeControlCommand(CMD_SET_PID, ALL_FAN_CHANNELS, CMD_SOURCE_SERIAL);
+                cmd.params[0] = sp; cmd.params[1] = kp; cmd.params[2] = ki; cmd.params[3] = kd;
+                enqueueSerialCommand(cmd, 0, NUM_FAN_CHANNELS - 1);
+            }
+        } else if (command.startsWith("set_output ")) {
+            float up, down, hyst;
+            if (sscanf(command.c_str(), "set_output %f %f %f", &up, &down, &hyst) != 3) {
+                Serial.println("[SERIAL_CMD_ERR] Format: set_output <ramp_up %/s> <ramp_down %/s> <hysteresis C>");
+            } else if (!isValidFanOutputConfig(up, down, hyst)) {
+                Serial.println("[SERIAL_CMD_ERR] Invalid output values (ramps 0-1000 %/s, hysteresis 0-10 C).");
             } else {
+                ControlCommand cmd = makeControlCommand(CMD_SET_OUTPUT_CONFIG, ALL_FAN_CHANNELS, CMD_SOURCE_SERIAL);
+                cmd.params[0] = up; cmd.params[1] = down; cmd.params[2] = hyst;
+                enqueueSerialCommand(cmd, 0, NUM_FAN_CHANNELS - 1);
+            }
+        } else if (command.equalsIgnoreCase("view_pid")) {
+            Serial.printf("--- PID Configuration ---\nSetpoint: %.1f C\nKp: %.3f\nKi: %.3f\nKd: %.3f\nControl period: %lu ms\n-------------------------\n",
+                          pidSetpointC, pidKp, pidKi, pidKd, PID_CONTROL_PERIOD_MS);
+        } else if (command.equalsIgnoreCase("view_latency")) {
+            const LatencyHistogram* outputLatency = getControlCommandOutputLatency();
+            Serial.printf("--- Command -> PWM latency (%u commands, avg %u us) ---\n", outputLatency->total, latencyHistogramAverage(outputLatency));
+            for (int b = 0; b < LATENCY_HISTOGRAM_BUCKETS; b++) {
+                if (b < LATENCY_HISTOGRAM_BUCKETS - 1) Serial.printf("  <= %6u us : %u\n", LATENCY_HISTOGRAM_BOUNDS_US[b], outputLatency->counts[b]);
+                else Serial.printf("   > %6u us : %u\n", LATENCY_HISTOGRAM_BOUNDS_US[b - 1], outputLatency->counts[b]);
+            }
+            Serial.printf("p50 %u us, p99 %u us, max %u us\n-------------------------\n",
+                          latencyHistogramPercentile(outputLatency, 50), latencyHistogramPercentile(outputLatency, 99), outputLatency->maxUs);
+        } else if (command.equalsIgnoreCase("reset_latency")) {
+            resetControlCommandOutputLatency();
+            requestControlLoopTimingReset();
+            Serial.println("[SERIAL_CMD] Latency histogram and control loop timing cleared.");
+        } else if (command.startsWith("set_mode rpm ")) {
+            String args = command.substring(13); args.trim();
+            int spacePos = args.indexOf(' ');
+            String rpmArg = spacePos < 0 ? args : args.substring(0, spacePos);
+            int rpm, firstCh, lastCh;
+            if (!parseFanRpmTarget(rpmArg.c_str(), FAN_RPM_TARGET_MAX, &rpm)) {
+                Serial.printf("[SERIAL_CMD_ERR] Invalid target RPM (0-%d).\n", FAN_RPM_TARGET_MAX);
+            } else if (parseFanChannelArg(spacePos < 0 ? "" : args.substring(spacePos + 1), firstCh, lastCh)) {
+                ControlCommand cmd = makeControlCommand(CMD_SET_RPM_TARGET, firstCh, CMD_SOURCE_SERIAL);
+                cmd.value = rpm;
+                enqueueSerialCommand(cmd, firstCh, lastCh);
+            }
+        } else if (command.equalsIgnoreCase("view_rpm_model") || command.startsWith("view_rpm_model ")) {
+            int firstCh, lastCh;
+            if (parseFanChannelArg(command.substring(14), firstCh, lastCh)) {
+                for (int ch = firstCh; ch <= lastCh; ch++) {
+                    const FanRpmModel* model = getFanRpmModel(ch);
+                    Serial.printf("--- Fan %d (ch %d) PWM -> RPM (%d points learned) ---\n", ch + 1, ch, fanRpmModelLearnedPoints(model));
+                    for (int d = 1; d < FAN_RPM_MODEL_POINTS; d++) {
+                        if (model->rpm[d] > 0) Serial.printf("  %3d%% : %u RPM\n", d, model->rpm[d]);
+                    }
+                }
+                Serial.println("-------------------------");
+            }
+        } else if (command.equalsIgnoreCase("reset_rpm_model") || command.startsWith("reset_rpm_model ")) {
+            int firstCh, lastCh;
+            if (parseFanChannelArg(command.substring(15), firstCh, lastCh)) {
+                enqueueSerialCommand(makeControlCommand(CMD_RESET_RPM_MODEL, firstCh, CMD_SOURCE_SERIAL), firstCh, lastCh);
+            }
+        } else if (command.equalsIgnoreCase("calibrate") || command.startsWith("calibrate ")) {
+            int firstCh, lastCh;
+            if (parseFanChannelArg(command.substring(9), firstCh, lastCh)) {
+                enqueueSerialCommand(makeControlCommand(CMD_CALIBRATION_START, firstCh, CMD_SOURCE_SERIAL), firstCh, lastCh);
+            }
+        } else if (command.equalsIgnoreCase("calibrate_cancel") || command.startsWith("calibrate_cancel ")) {
+            int firstCh, lastCh;
+            if (parseFanChannelArg(command.substring(16), firstCh, lastCh)) {
+                enqueueSerialCommand(makeControlCommand(CMD_CALIBRATION_CANCEL, firstCh, CMD_SOURCE_SERIAL), firstCh, lastCh);
+            }
+        } else if (command.equalsIgnoreCase("view_calibration") || command.startsWith("view_calibration ")) {
+            int firstCh, lastCh;
+            if (parseFanChannelArg(command.substring(16), firstCh, lastCh)) {
+                for (int ch = firstCh; ch <= lastCh; ch++) {
+                    const FanCalibrationResult* result = getFanCalibrationResult(ch);
+                    Serial.printf("Fan %d (ch %d): %s", ch + 1, ch, getFanCalibrationStatus(ch));
+                    if (result->valid) Serial.printf(", start %d%%, stall %d%%, max %d RPM, settle %d ms",
+                                                     result->startDuty, result->stallDuty, result->maxRpm, result->settleMs);
+                    Serial.println();
+                }
+            }
+        } else if (command.equalsIgnoreCase("clear_calibration") || command.startsWith("clear_calibration ")) {
+            int firstCh, lastCh;
+            if (parseFanChannelArg(command.substring(17), firstCh, lastCh)) {
+                enqueueSerialCommand(makeControlCommand(CMD_CALIBRATION_CLEAR, firstCh, CMD_SOURCE_SERIAL), firstCh, lastCh);
+            }
+        } else if (command.startsWith("set_mode manual ")) {
+            String args = command.substring(16); args.trim();
+            int spacePos = args.indexOf(' ');
+            int val = (spacePos < 0 ? args : args.substring(0, spacePos)).toInt();
+            int firstCh, lastCh;
+            if (val < 0 || val > 100) {
                 Serial.println("[SERIAL_CMD_ERR] Invalid percentage for manual mode (0-100).");
+            } else if (parseFanChannelArg(spacePos < 0 ? "" : args.substring(spacePos + 1), firstCh, lastCh)) {
+                ControlCommand cmd = makeControlCommand(CMD_SET_MODE_MANUAL, firstCh, CMD_SOURCE_SERIAL);
+                cmd.value = val;
+                enqueueSerialCommand(cmd, firstCh, lastCh);
             }
         } else if (command.equalsIgnoreCase("wifi_enable")) {
-            if (!isWiFiEnabled) { isWiFiEnabled = true; saveWiFiConfig(); rebootNeeded = true; Serial.println("[SERIAL_CMD] WiFi ENABLED. Reboot required. Type 'reboot'."); } 
+            if (!isWiFiEnabled) { isWiFiEnabled = true; requestNvsSave(NVS_SECTION_WIFI); Serial.println("[SERIAL_CMD] WiFi ENABLED. Connecting in the background."); } 
             else { Serial.println("[SERIAL_CMD] WiFi is already enabled."); }
         } else if (command.equalsIgnoreCase("wifi_disable")) {
-            if (isWiFiEnabled) { isWiFiEnabled = false; saveWiFiConfig(); rebootNeeded = true; Serial.println("[SERIAL_CMD] WiFi DISABLED. Reboot required. Type 'reboot'."); } 
+            if (isWiFiEnabled) { isWiFiEnabled = false; requestNvsSave(NVS_SECTION_WIFI); Serial.println("[SERIAL_CMD] WiFi DISABLED."); } 
             else { Serial.println("[SERIAL_CMD] WiFi is already disabled."); }
         } else if (command.startsWith("set_ssid ")) {
             String newSsid = command.substring(9); newSsid.trim();
-            if (newSsid.length() > 0 && newSsid.length() < sizeof(current_ssid)) { strcpy(current_ssid, newSsid.c_str()); saveWiFiConfig(); Serial.printf("[SERIAL_CMD] SSID set to: '%s'.\n", current_ssid); } 
+            if (newSsid.length() > 0 && newSsid.length() < sizeof(current_ssid)) { strcpy(current_ssid, newSsid.c_str()); requestNvsSave(NVS_SECTION_WIFI); Serial.printf("[SERIAL_CMD] SSID set to: '%s'.\n", current_ssid); } 
             else { Serial.println("[SERIAL_CMD_ERR] Invalid SSID length."); }
         } else if (command.startsWith("set_pass ")) {
             String newPass = command.substring(9);
-             if (newPass.length() < sizeof(current_password)) { strcpy(current_password, newPass.c_str()); saveWiFiConfig(); Serial.println("[SERIAL_CMD] Password set."); } 
+             if (newPass.length() < sizeof(current_password)) { strcpy(current_password, newPass.c_str()); requestNvsSave(NVS_SECTION_WIFI); Serial.println("[SERIAL_CMD] Password set."); } 
              else { Serial.println("[SERIAL_CMD_ERR] Password too long."); }
+        } else if (command.startsWith("set_static_ip ")) {
+            String args = command.substring(14); args.trim();
+            IPAddress addrs[4];
+            int count = 0;
+            bool valid = true;
+            while (args.length() > 0 && count < 4) {
+                int spacePos = args.indexOf(' ');
+                String part = spacePos < 0 ? args : args.substring(0, spacePos);
+                args = spacePos < 0 ? String("") : args.substring(spacePos + 1);
+                args.trim();
+                if (!addrs[count++].fromString(part.c_str())) valid = false;
+            }
+            if (!valid || count < 3 || args.length() > 0 || (uint32_t)addrs[0] == 0 || (uint32_t)addrs[2] == 0) {
+                Serial.println("[SERIAL_CMD_ERR] Usage: set_static_ip <ip> <gateway> <subnet> [dns]");
+            } else {
+                wifiStaticIp.ip = (uint32_t)addrs[0];
+                wifiStaticIp.gateway = (uint32_t)addrs[1];
+                wifiStaticIp.subnet = (uint32_t)addrs[2];
+                wifiStaticIp.dns = count > 3 ? (uint32_t)addrs[3] : 0;
+                wifiStaticIp.enabled = 1;
+                requestNvsSave(NVS_SECTION_WIFI);
+                Serial.printf("[SERIAL_CMD] Static IP set to %s.\n", addrs[0].toString().c_str());
+                if (isWiFiEnabled) requestWiFiReconnect();
+            }
+        } else if (command.equalsIgnoreCase("static_ip_off")) {
+            if (wifiStaticIp.enabled) {
+                wifiStaticIp.enabled = 0;
+                requestNvsSave(NVS_SECTION_WIFI);
+                Serial.println("[SERIAL_CMD] Static IP disabled, using DHCP.");
+                if (isWiFiEnabled) requestWiFiReconnect();
+            } else { Serial.println("[SERIAL_CMD] Static IP is already disabled."); }
         } else if (command.equalsIgnoreCase("connect_wifi")) {
-            if (!isWiFiEnabled) { Serial.println("[SERIAL_CMD] Cannot connect, WiFi is disabled. Use 'wifi_enable' then 'reboot'."); } 
+            if (!isWiFiEnabled) { Serial.println("[SERIAL_CMD] Cannot connect, WiFi is disabled. Use 'wifi_enable'."); } 
             else if (strlen(current_ssid) == 0 || strcmp(current_ssid, "YOUR_WIFI_SSID") == 0) { Serial.println("[SERIAL_CMD] Cannot connect, SSID not configured. Use 'set_ssid'."); } 
-            else { Serial.println("[SERIAL_CMD] Attempting WiFi connection..."); attemptWiFiConnection(); if (WiFi.status() == WL_CONNECTED && rebootNeeded) { Serial.println("[SERIAL_CMD] Connection successful. Reboot recommended. Type 'reboot'."); } else if (WiFi.status() != WL_CONNECTED) { Serial.println("[SERIAL_CMD] Connection attempt finished. Check status."); } }
+            else { attemptWiFiConnection(); Serial.println("[SERIAL_CMD] Connecting in the background. Check 'status'."); }
         } else if (command.equalsIgnoreCase("disconnect_wifi")) {
-            Serial.println("[SERIAL_CMD] Disconnecting WiFi..."); WiFi.disconnect(true); delay(100); Serial.println("[SERIAL_CMD] WiFi disconnected.");
+            disconnectWiFi(); Serial.println("[SERIAL_CMD] WiFi disconnected. Use 'connect_wifi' to reconnect.");
         } else if (command.equalsIgnoreCase("scan_wifi")) {
             Serial.println("[SERIAL_CMD] Starting WiFi Scan..."); WiFi.disconnect(); delay(100); int n = WiFi.scanNetworks(); Serial.printf("[WiFi_SCAN_SERIAL] Scan found %d networks:\n", n);
             if (n == 0) { Serial.println("  No networks found."); } 
             else { for (int k = 0; k < min(n, 15); ++k) { Serial.printf("  %d: %s (%d dBm) %s\n", k + 1, WiFi.SSID(k).c_str(), WiFi.RSSI(k), WiFi.encryptionType(k) == WIFI_AUTH_OPEN ? " " : "*"); } }
         } 
         else if (command.equalsIgnoreCase("mqtt_enable")) {
-            if (!isMqttEnabled) { isMqttEnabled = true; saveMqttConfig(); rebootNeeded = true; Serial.println("[SERIAL_CMD] MQTT ENABLED. Reboot required. Type 'reboot'."); } 
+            if (!isMqttEnabled) { isMqttEnabled = true; requestNvsSave(NVS_SECTION_MQTT); rebootNeeded = true; Serial.println("[SERIAL_CMD] MQTT ENABLED. Reboot required. Type 'reboot'."); } 
             else { Serial.println("[SERIAL_CMD] MQTT is already enabled."); }
         } else if (command.equalsIgnoreCase("mqtt_disable")) {
-            if (isMqttEnabled) { isMqttEnabled = false; saveMqttConfig(); rebootNeeded = true; Serial.println("[SERIAL_CMD] MQTT DISABLED. Reboot required. Type 'reboot'."); } 
+            if (isMqttEnabled) { isMqttEnabled = false; requestNvsSave(NVS_SECTION_MQTT); rebootNeeded = true; Serial.println("[SERIAL_CMD] MQTT DISABLED. Reboot required. Type 'reboot'."); } 
             else { Serial.println("[SERIAL_CMD] MQTT is already disabled."); }
         } else if (command.startsWith("set_mqtt_server ")) {
             String val = command.substring(16); val.trim();
-            if (val.length() > 0 && val.length() < sizeof(mqttServer)) { strcpy(mqttServer, val.c_str()); saveMqttConfig(); rebootNeeded = true; Serial.printf("[SERIAL_CMD] MQTT Server set to: %s. Reboot needed.\n", mqttServer); } 
+            if (val.length() > 0 && val.length() < sizeof(mqttServer)) { strcpy(mqttServer, val.c_str()); requestNvsSave(NVS_SECTION_MQTT); rebootNeeded = true; Serial.printf("[SERIAL_CMD] MQTT Server set to: %s. Reboot needed.\n", mqttServer); } 
             else Serial.println("[SERIAL_CMD_ERR] Invalid MQTT server address length.");
         } else if (command.startsWith("set_mqtt_port ")) {
             int val = command.substring(14).toInt();
-            if (val > 0 && val <= 65535) { mqttPort = val; saveMqttConfig(); rebootNeeded = true; Serial.printf("[SERIAL_CMD] MQTT Port set to: %d. Reboot needed.\n", mqttPort); } 
+            if (val > 0 && val <= 65535) { mqttPort = val; requestNvsSave(NVS_SECTION_MQTT); rebootNeeded = true; Serial.printf("[SERIAL_CMD] MQTT Port set to: %d. Reboot needed.\n", mqttPort); } 
             else Serial.println("[SERIAL_CMD_ERR] Invalid MQTT port (1-65535).");
         } else if (command.startsWith("set_mqtt_user ")) {
             String val = command.substring(14); val.trim();
-            if (val.length() < sizeof(mqttUser)) { strcpy(mqttUser, val.c_str()); saveMqttConfig(); rebootNeeded = true; Serial.printf("[SERIAL_CMD] MQTT User set to: %s. Reboot needed.\n", strlen(mqttUser) > 0 ? mqttUser : "N/A"); } 
+            if (val.length() < sizeof(mqttUser)) { strcpy(mqttUser, val.c_str()); requestNvsSave(NVS_SECTION_MQTT); rebootNeeded = true; Serial.printf("[SERIAL_CMD] MQTT User set to: %s. Reboot needed.\n", strlen(mqttUser) > 0 ? mqttUser : "N/A"); } 
             else Serial.println("[SERIAL_CMD_ERR] MQTT username too long.");
         } else if (command.startsWith("set_mqtt_pass ")) {
             String val = command.substring(14); 
-            if (val.length() < sizeof(mqttPassword)) { strcpy(mqttPassword, val.c_str()); saveMqttConfig(); rebootNeeded = true; Serial.println("[SERIAL_CMD] MQTT Password set. Reboot needed."); } 
+            if (val.length() < sizeof(mqttPassword)) { strcpy(mqttPassword, val.c_str()); requestNvsSave(NVS_SECTION_MQTT); rebootNeeded = true; Serial.println("[SERIAL_CMD] MQTT Password set. Reboot needed."); } 
             else Serial.println("[SERIAL_CMD_ERR] MQTT password too long.");
         } else if (command.startsWith("set_mqtt_topic ")) {
             String val = command.substring(15); val.trim();
-            if (val.length() > 0 && val.length() < sizeof(mqttBaseTopic)) { strcpy(mqttBaseTopic, val.c_str()); saveMqttConfig(); rebootNeeded = true; Serial.printf("[SERIAL_CMD] MQTT Base Topic set to: %s. Reboot needed.\n", mqttBaseTopic); } 
+            if (val.length() > 0 && val.length() < sizeof(mqttBaseTopic)) { strcpy(mqttBaseTopic, val.c_str()); requestNvsSave(NVS_SECTION_MQTT); rebootNeeded = true; Serial.printf("[SERIAL_CMD] MQTT Base Topic set to: %s. Reboot needed.\n", mqttBaseTopic); } 
             else Serial.println("[SERIAL_CMD_ERR] Invalid MQTT base topic length.");
         }
         else if (command.equalsIgnoreCase("mqtt_discovery_enable")) {
-            if (!isMqttDiscoveryEnabled) { isMqttDiscoveryEnabled = true; saveMqttDiscoveryConfig(); rebootNeeded = true; Serial.println("[SERIAL_CMD] MQTT Discovery ENABLED. Reboot required. Type 'reboot'."); } 
+            if (!isMqttDiscoveryEnabled) { isMqttDiscoveryEnabled = true; requestNvsSave(NVS_SECTION_MQTT_DISCOVERY); rebootNeeded = true; Serial.println("[SERIAL_CMD] MQTT Discovery ENABLED. Reboot required. Type 'reboot'."); } 
             else { Serial.println("[SERIAL_CMD] MQTT Discovery is already enabled."); }
         } else if (command.equalsIgnoreCase("mqtt_discovery_disable")) {
-            if (isMqttDiscoveryEnabled) { isMqttDiscoveryEnabled = false; saveMqttDiscoveryConfig(); rebootNeeded = true; Serial.println("[SERIAL_CMD] MQTT Discovery DISABLED. Reboot required. Type 'reboot'."); } 
+            if (isMqttDiscoveryEnabled) { isMqttDiscoveryEnabled = false; requestNvsSave(NVS_SECTION_MQTT_DISCOVERY); rebootNeeded = true; Serial.println("[SERIAL_CMD] MQTT Discovery DISABLED. Reboot required. Type 'reboot'."); } 
             else { Serial.println("[SERIAL_CMD] MQTT Discovery is already disabled."); }
         } else if (command.startsWith("set_mqtt_discovery_prefix ")) {
             String val = command.substring(26); val.trim();
-            if (val.length() > 0 && val.length() < sizeof(mqttDiscoveryPrefix)) { strcpy(mqttDiscoveryPrefix, val.c_str()); saveMqttDiscoveryConfig(); rebootNeeded = true; Serial.printf("[SERIAL_CMD] MQTT Discovery Prefix set to: %s. Reboot needed.\n", mqttDiscoveryPrefix); } 
+            if (val.length() > 0 && val.length() < sizeof(mqttDiscoveryPrefix)) { strcpy(mqttDiscoveryPrefix, val.c_str()); requestNvsSave(NVS_SECTION_MQTT_DISCOVERY); rebootNeeded = true; Serial.printf("[SERIAL_CMD] MQTT Discovery Prefix set to: %s. Reboot needed.\n", mqttDiscoveryPrefix); } 
             else { Serial.println("[SERIAL_CMD_ERR] Invalid MQTT Discovery Prefix length."); }
         }
-        else if (command.equalsIgnoreCase("view_curve")) {
-            Serial.println("--- Current Fan Curve ---");
-            if (numCurvePoints == 0) { Serial.println("  No curve points defined."); }
-            for (int k = 0; k < numCurvePoints; k++) { Serial.printf("  Point %d: Temp = %d C, PWM = %d%%\n", k, tempPoints[k], pwmPercentagePoints[k]); }
-            Serial.println("-------------------------");
+        else if (command.equalsIgnoreCase("view_curve") || command.startsWith("view_curve ")) {
+            int firstCh, lastCh;
+            if (parseFanChannelArg(command.substring(10), firstCh, lastCh)) {
+                for (int ch = firstCh; ch <= lastCh; ch++) {
+                    Serial.printf("--- Fan %d (ch %d) Curve ---\n", ch + 1, ch);
+                    if (fanChannels.curveNumPoints[ch] == 0) { Serial.println("  No curve points defined."); }
+                    for (int k = 0; k < fanChannels.curveNumPoints[ch]; k++) { Serial.printf("  Point %d: Temp = %d C, PWM = %d%%\n", k, fanChannels.curveTempPoints[ch][k], fanChannels.curvePwmPoints[ch][k]); }
+                }
+                Serial.println("-------------------------");
+            }
         } else if (command.equalsIgnoreCase("clear_staging_curve")) {
             stagingNumCurvePoints = 0; Serial.println("[SERIAL_CMD] Staging fan curve cleared.");
         } else if (command.startsWith("stage_curve_point ")) {
             if (stagingNumCurvePoints >= MAX_CURVE_POINTS) { Serial.println("[SERIAL_CMD_ERR] Max staging curve points reached."); } 
             else { int temp, pwm; if (sscanf(command.c_str(), "stage_curve_point %d %d", &temp, &pwm) == 2) { if (temp >= 0 && temp <= 120 && pwm >= 0 && pwm <= 100) { if (stagingNumCurvePoints > 0 && temp <= stagingTempPoints[stagingNumCurvePoints -1]){ Serial.println("[SERIAL_CMD_ERR] Temperature must be greater than previous point."); } else { stagingTempPoints[stagingNumCurvePoints] = temp; stagingPwmPercentagePoints[stagingNumCurvePoints] = pwm; stagingNumCurvePoints++; Serial.printf("[SERIAL_CMD] Staged point %d: Temp=%d, PWM=%d. Total: %d\n", stagingNumCurvePoints -1, temp, pwm, stagingNumCurvePoints); } } else { Serial.println("[SERIAL_CMD_ERR] Invalid temp (0-120) or PWM (0-100)."); } } else { Serial.println("[SERIAL_CMD_ERR] Format: stage_curve_point <temp> <pwm%>"); } }
-        } else if (command.equalsIgnoreCase("apply_staged_curve")) {
+        } else if (command.equalsIgnoreCase("apply_staged_curve") || command.startsWith("apply_staged_curve ")) {
+            int firstCh, lastCh;
             if (stagingNumCurvePoints < 2) { Serial.println("[SERIAL_CMD_ERR] Need at least 2 points."); } 
-            else { numCurvePoints = stagingNumCurvePoints; for (int k = 0; k < numCurvePoints; k++) { tempPoints[k] = stagingTempPoints[k]; pwmPercentagePoints[k] = stagingPwmPercentagePoints[k]; } saveFanCurveToNVS(); stagingNumCurvePoints = 0; needsImmediateBroadcast = true; fanCurveChanged = true; Serial.println("[SERIAL_CMD] Staged fan curve applied and saved."); }
-        } else if (command.equalsIgnoreCase("load_default_curve")) {
-            setDefaultFanCurve(); saveFanCurveToNVS(); needsImmediateBroadcast = true; fanCurveChanged = true; Serial.println("[SERIAL_CMD] Default fan curve loaded and saved.");
+            else if (parseFanChannelArg(command.substring(18), firstCh, lastCh)) {
+                ControlCommand cmd = makeControlCommand(CMD_SET_CURVE, firstCh, CMD_SOURCE_SERIAL);
+                cmd.curveNumPoints = stagingNumCurvePoints;
+                for (int k = 0; k < stagingNumCurvePoints; k++) { cmd.curveTemp[k] = stagingTempPoints[k]; cmd.curvePwm[k] = stagingPwmPercentagePoints[k]; }
+                enqueueSerialCommand(cmd, firstCh, lastCh);
+                stagingNumCurvePoints = 0;
+            }
+        } else if (command.equalsIgnoreCase("load_default_curve") || command.startsWith("load_default_curve ")) {
+            int firstCh, lastCh;
+            if (parseFanChannelArg(command.substring(18), firstCh, lastCh)) {
+                enqueueSerialCommand(makeControlCommand(CMD_LOAD_DEFAULT_CURVE, firstCh, CMD_SOURCE_SERIAL), firstCh, lastCh);
+            }
         }
          else if (command.equalsIgnoreCase("reboot")) {
-            Serial.println("[SERIAL_CMD] Rebooting device now..."); delay(100); ESP.restart();
+            Serial.println("[SERIAL_CMD] Rebooting device now..."); flushNvsSaves(); delay(100); ESP.restart();
         }
         else if (command.equalsIgnoreCase("ota_update")) { 
             if (ota_in_progress) {
@@ -471,37 +725,16 @@ void attemptWiFiConnection() {
         return;
     }
 
-    if(serialDebugEnabled) Serial.printf("[WiFi_Util] Attempting to connect to SSID: %s\n", current_ssid);
-    if(isInMenuMode) { lcd.clear(); lcd.print("Connecting to:"); lcd.setCursor(0,1); lcd.print(String(current_ssid).substring(0,16));} 
-    
-    WiFi.disconnect(true); 
-    delay(100);
-    WiFi.begin(current_ssid, current_password);
-    
-    int timeout = 0;
-    while(WiFi.status() != WL_CONNECTED && timeout < 30) { 
-        delay(500);
-        if(serialDebugEnabled) Serial.print("."); 
-        if(isInMenuMode) { /* could update LCD with dots */ }
-        timeout++;
-    }
-
-    if(WiFi.status() == WL_CONNECTED) {
-        if(serialDebugEnabled) Serial.println("\n[WiFi_Util] Connection successful!");
-        if(isInMenuMode) {lcd.clear(); lcd.print("Connected!"); lcd.setCursor(0,1); lcd.print(WiFi.localIP());}
-        rebootNeeded = true; 
-        if(isInMenuMode) {currentMenuScreen = CONFIRM_REBOOT; selectedMenuItem = 0;}
-    } else {
-        if(serialDebugEnabled) Serial.println("\n[WiFi_Util] Connection failed.");
-        if(isInMenuMode) {lcd.clear(); lcd.print("Connect Failed"); delay(2000); currentMenuScreen = WIFI_SETTINGS; selectedMenuItem = 0; }
+    if(serialDebugEnabled) Serial.printf("[WiFi_Util] Requesting connection to SSID: %s\n", current_ssid);
+    requestWiFiReconnect(); // networkTask connects in the background; services start once the link is up
+    if(isInMenuMode) {
+        lcd.clear(); lcd.print("Connecting to:"); lcd.setCursor(0,1); lcd.print(String(current_ssid).substring(0,16));
+        delay(1500); currentMenuScreen = WIFI_SETTINGS; selectedMenuItem = 0; displayMenu();
     }
-    if(isInMenuMode) displayMenu(); // Update menu after attempt
 }
 
 void disconnectWiFi(){ 
     if(serialDebugEnabled) Serial.println("[WiFi_Util] Disconnecting WiFi via menu/serial...");
-    WiFi.disconnect(true); 
-    delay(100); 
+    requestWiFiDisconnect();
     if(isInMenuMode) {lcd.clear(); lcd.print("WiFi Dscnnctd"); delay(1000); currentMenuScreen = WIFI_SETTINGS; selectedMenuItem = 0; displayMenu();}
-    else if(serialDebugEnabled) {Serial.println("[WiFi_Util] Disconnected.");}
 }
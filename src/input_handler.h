@@ -5,6 +5,7 @@
 #include "ota_updater.h" // Include for triggerOTAUpdateCheck
 
 void handleMenuInput();
+void setupButtonWakeInterrupts(); // Button edges wake mainAppTask (debouncing stays in handleMenuInput)
 void handleSerialCommands();
 void performWiFiScan(); 
 void attemptWiFiConnection(); 
@@ -0,0 +1,39 @@
+#include "latency_histogram.h"
+#include <string.h>
+
+const uint32_t LATENCY_HISTOGRAM_BOUNDS_US[LATENCY_HISTOGRAM_BUCKETS - 1] = {
+    100, 200, 500, 1000, 2000, 5000, 10000, 20000, 50000, 100000, 200000
+};
+
+void latencyHistogramReset(LatencyHistogram* histogram) {
+    memset(histogram, 0, sizeof(*histogram));
+}
+
+void latencyHistogramRecord(LatencyHistogram* histogram, uint32_t latencyUs) {
+    int bucket = 0;
+    while (bucket < LATENCY_HISTOGRAM_BUCKETS - 1 && latencyUs > LATENCY_HISTOGRAM_BOUNDS_US[bucket]) bucket++;
+    histogram->counts[bucket]++;
+    histogram->total++;
+    histogram->sumUs += latencyUs;
+    if (latencyUs > histogram->maxUs) histogram->maxUs = latencyUs;
+}
+
+uint32_t latencyHistogramPercentile(const LatencyHistogram* histogram, int percentile) {
+    if (histogram->total == 0) return 0;
+    // Smallest rank covering the percentile, rounded up (p99 of 10 samples is the 10th)
+    uint32_t rank = (uint32_t)(((uint64_t)histogram->total * percentile + 99) / 100);
+    if (rank < 1) rank = 1;
+    uint32_t seen = 0;
+    for (int bucket = 0; bucket < LATENCY_HISTOGRAM_BUCKETS - 1; bucket++) {
+        seen += histogram->counts[bucket];
+        if (seen >= rank) {
+            uint32_t bound = LATENCY_HISTOGRAM_BOUNDS_US[bucket];
+            return bound < histogram->maxUs ? bound : histogram->maxUs;
+        }
+    }
+    return histogram->maxUs;
+}
+
+uint32_t latencyHistogramAverage(const LatencyHistogram* histogram) {
+    return histogram->total ? (uint32_t)(histogram->sumUs / histogram->total) : 0;
+}
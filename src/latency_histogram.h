@@ -0,0 +1,26 @@
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+#include <stdint.h>
+
+// Fixed-bucket latency histogram (microseconds, 1-2-5 steps from 100 us to 200 ms plus an overflow bucket).
+// Recording is a handful of compares, so it can sit in the control loop; one writer, no locking.
+
+const int LATENCY_HISTOGRAM_BUCKETS = 12;
+extern const uint32_t LATENCY_HISTOGRAM_BOUNDS_US[LATENCY_HISTOGRAM_BUCKETS - 1]; // Inclusive upper bounds; the last bucket is open
+
+struct LatencyHistogram {
+    uint32_t counts[LATENCY_HISTOGRAM_BUCKETS];
+    uint32_t total;
+    uint32_t maxUs;
+    uint64_t sumUs;
+};
+
+void latencyHistogramReset(LatencyHistogram* histogram);
+void latencyHistogramRecord(LatencyHistogram* histogram, uint32_t latencyUs);
+
+// Upper bound of the bucket holding the given percentile (1-100), capped at the largest value seen. 0 if empty.
+uint32_t latencyHistogramPercentile(const LatencyHistogram* histogram, int percentile);
+uint32_t latencyHistogramAverage(const LatencyHistogram* histogram);
+
+#endif // LATENCY_HISTOGRAM_H
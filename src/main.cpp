@@ -8,10 +8,14 @@
 #include "tasks.h"
 #include "mqtt_handler.h"   
 #include "ota_updater.h"    
+#include "control_commands.h"
 
 // --- Global Variable Definitions (these are declared extern in config.h) ---
 // Pin Definitions
-const int FAN_PWM_PIN = 18;
+// Channel N uses FAN_PWM_PINS[N] / FAN_TACH_PINS[N]; only the first NUM_FAN_CHANNELS entries are used.
+// GPIO 34-39 are input-only without internal pull-ups, so those tach lines need an external pull-up.
+const int FAN_PWM_PINS[MAX_FAN_CHANNELS]  = {18, 25, 26, 27, 32, 33, 13, 14};
+const int FAN_TACH_PINS[MAX_FAN_CHANNELS] = {15, 34, 35, 36, 39, 16, 17, -1};
 const int BTN_MENU_PIN = 19;    
 const int BTN_UP_PIN = 23;      
 const int BTN_DOWN_PIN = 22;    
@@ -19,28 +23,59 @@ const int BTN_SELECT_PIN = 21;
 const int BTN_BACK_PIN = 5;     
 const int DEBUG_ENABLE_PIN = 4; 
 const int LED_DEBUG_PIN = 2;    
-const int FAN_TACH_PIN_ACTUAL = 15; 
 
 // Fan Control Constants
-const int PWM_CHANNEL = 0;
+const int FAN_LEDC_CHANNELS[MAX_FAN_CHANNELS] = {0, 1, 2, 3, 4, 5, 6, 7};
 const int PWM_FREQ = 25000;
 const int PWM_RESOLUTION_BITS = 8;
 const int AUTO_MODE_NO_SENSOR_FAN_PERCENTAGE = 60;
 const int PULSES_PER_REVOLUTION = 2;
+const int TACH_PCNT_FILTER_APB_CYCLES = 1000; // 12.5 us; tach pulses are milliseconds long even at 10000 RPM
+const int TACH_PERIOD_MAX_RPM = 1500; // 50 edges/s at 2 pulses/rev
+const unsigned long TACH_WINDOW_MS = 1000;
+const unsigned long TACH_STALL_TIMEOUT_MS = 1000; // Below 30 RPM (2 pulses/rev) reads as stopped
+const unsigned long TACH_STALL_CHECK_MS = 200;
+const int FAN_RPM_TARGET_MAX = 20000;
+const float FAN_RPM_KP = 0.01f;
+const float FAN_RPM_KI = 0.02f;
+const unsigned long FAN_RPM_SETTLE_MS = 3000;
+const unsigned long FAN_RPM_MODEL_SAVE_INTERVAL_MS = 600000; // 10 minutes, learning is continuous
+const int FAN_KICK_DUTY_PERCENT = 100;
+const unsigned long FAN_KICK_MS = 500;
+const unsigned long FAN_KICK_RETRY_MS = 5000;
+const unsigned long PID_CONTROL_PERIOD_MS = 1000;
+const unsigned long CONTROL_TASK_PERIOD_MS = 50;
+const unsigned long MAIN_APP_TASK_PERIOD_MS = 50;
+const unsigned long NETWORK_TASK_POLL_MS = 50;
+const unsigned long NETWORK_TASK_IDLE_MS = 250;
+const unsigned long NETWORK_LONG_POLL_BROADCAST_MS = 1000;
+const unsigned long NVS_SAVE_DEBOUNCE_MS = 2000;
+const unsigned long NVS_SAVE_MAX_DELAY_MS = 10000;
+
+// PID Control (defaults, overwritten by loadPidConfig())
+volatile float pidSetpointC = 40.0f; 
+volatile float pidKp = 8.0f; 
+volatile float pidKi = 0.2f; 
+volatile float pidKd = 20.0f; 
+
+// Output Conditioning (defaults, overwritten by loadFanOutputConfig())
+volatile float fanRampUpPercentPerS = 20.0f; 
+volatile float fanRampDownPercentPerS = 5.0f; 
+volatile float fanHysteresisC = 1.0f; 
+volatile unsigned long fanOutputWrites = 0; 
+volatile unsigned long fanSuppressedOutputChanges = 0; 
+volatile unsigned long fanSuppressedBroadcasts = 0; 
 
 // Modes & States
-volatile bool isAutoMode = true;
-volatile int manualFanSpeedPercentage = 50;
 volatile bool isInMenuMode = false;
 volatile bool isWiFiEnabled = false; 
+const unsigned long WIFI_CONNECT_TIMEOUT_MS = 15000;
+const unsigned long WIFI_FAST_CONNECT_TIMEOUT_MS = 3000;
+const unsigned long WIFI_BACKOFF_MIN_MS = 1000;
+const unsigned long WIFI_BACKOFF_MAX_MS = 60000;
 volatile bool serialDebugEnabled = false; 
 volatile float currentTemperature = -999.0; 
 volatile bool tempSensorFound = false;      
-volatile int fanRpm = 0;
-volatile int fanSpeedPercentage = 0;
-volatile int fanSpeedPWM_Raw = 0;
-volatile unsigned long pulseCount = 0;
-unsigned long lastRpmReadTime_Task = 0; 
 
 // Menu System Variables
 volatile MenuScreen currentMenuScreen = MAIN_MENU;
@@ -55,11 +90,8 @@ volatile char currentGeneralEditChar = 'a';
 volatile int passwordCharIndex = 0; 
 volatile char currentPasswordEditChar = 'a'; 
 
-// Fan Curve
-int tempPoints[MAX_CURVE_POINTS];
-int pwmPercentagePoints[MAX_CURVE_POINTS];
-int numCurvePoints = 0;
-volatile bool fanCurveChanged = false; 
+// Per-Channel Fan State (modes set in setupFanChannels(), curves loaded from NVS in setup())
+FanChannelState fanChannels = {};
 
 // Staging Fan Curve for Serial Commands
 int stagingTempPoints[MAX_CURVE_POINTS];
@@ -67,7 +99,10 @@ int stagingPwmPercentagePoints[MAX_CURVE_POINTS];
 int stagingNumCurvePoints = 0;
 
 // Task Communication
-volatile bool needsImmediateBroadcast = false;
+std::atomic<bool> needsImmediateBroadcast(false);
+ControllerStateSeqlock controllerState;
+ControlCommandQueue controlCommandQueue;
+NvsSaveScheduler nvsSaveScheduler;
 volatile bool rebootNeeded = false; 
 
 // MQTT Configuration
@@ -87,7 +122,13 @@ char mqttDeviceName[64] = "ESP32 Fan Controller";
 
 // OTA Update Status
 volatile bool ota_in_progress = false;
-String ota_status_message = "OTA Idle"; 
+OtaProgress otaProgress;
+const unsigned long OTA_PROGRESS_REPORT_MS = 1000;
+
+// Server-Sent Events (/events)
+const unsigned long SSE_CLIENT_MIN_INTERVAL_MS = 1000;
+const size_t SSE_CLIENT_MAX_QUEUED = 4;
+const unsigned long SSE_CLIENT_STALL_DROP_MS = 15000;
 String GITHUB_API_ROOT_CA_STRING = ""; // <<< Actual definition of the global variable
 
 
@@ -96,7 +137,8 @@ Preferences preferences;
 Adafruit_BMP280 bmp;
 LiquidCrystal_I2C lcd(0x27, 16, 2);
 AsyncWebServer server(80);
-WebSocketsServer webSocket(81);
+AsyncWebSocket webSocket("/ws");
+AsyncEventSource events("/events");
 WiFiClient espClient; 
 PubSubClient mqttClient(espClient); 
 
@@ -109,10 +151,14 @@ const long longPressDelay = 1000;
 
 // SSID and Password
 char current_ssid[64] = "YOUR_WIFI_SSID"; 
+WifiJoinCache wifiJoinCache = {};
+WifiStaticIpConfig wifiStaticIp = {};
 char current_password[64] = "YOUR_WIFI_PASSWORD"; 
 
 TaskHandle_t networkTaskHandle = NULL; 
 TaskHandle_t mainAppTaskHandle = NULL;
+TaskHandle_t controlTaskHandle = NULL;
+TaskHandle_t nvsPersistenceTaskHandle = NULL;
 
 
 // Function to load Root CA from SPIFFS
@@ -159,7 +205,7 @@ void setup() {
 
     if(serialDebugEnabled) Serial.println("[INIT] Initializing SPIFFS...");
     if(!SPIFFS.begin(true)){ 
-        if(serialDebugEnabled) Serial.println("[INIT_ERR] SPIFFS Mount Failed! Web server may not work.");
+        if(serialDebugEnabled) Serial.println("[INIT_ERR] SPIFFS Mount Failed! Serving the embedded web UI; GitHub OTA has no root CA.");
     } else {
         if(serialDebugEnabled) Serial.println("[INIT] SPIFFS Mounted Successfully.");
         loadRootCA(); // Load CA after SPIFFS is initialized
@@ -168,6 +214,8 @@ void setup() {
     loadWiFiConfig(); 
     loadMqttConfig(); 
     loadMqttDiscoveryConfig(); 
+    loadPidConfig(); 
+    loadFanOutputConfig(); 
 
     uint8_t mac[6];
     esp_read_mac(mac, ESP_MAC_WIFI_STA); 
@@ -211,23 +259,16 @@ void setup() {
     delay(1500);
     if(serialDebugEnabled) Serial.println("[INIT] LCD Initialized.");
 
-    if(serialDebugEnabled) Serial.println("[INIT] Setting up LEDC PWM for fan...");
-    ledcSetup(PWM_CHANNEL, PWM_FREQ, PWM_RESOLUTION_BITS);
-    ledcAttachPin(FAN_PWM_PIN, PWM_CHANNEL);             
-    if(serialDebugEnabled) Serial.println("[INIT] LEDC PWM Setup Complete.");
-    
-    if(serialDebugEnabled) Serial.println("[INIT] Setting up Fan Tachometer Interrupt...");
-    pinMode(FAN_TACH_PIN_ACTUAL, INPUT_PULLUP); 
-    attachInterrupt(digitalPinToInterrupt(FAN_TACH_PIN_ACTUAL), countPulse, FALLING); 
-    if(serialDebugEnabled) Serial.println("[INIT] Fan Tachometer Interrupt Setup Complete.");
+    if(serialDebugEnabled) Serial.printf("[INIT] Setting up %d fan channel(s) (LEDC PWM + tachometer)...\n", NUM_FAN_CHANNELS);
+    setupFanChannels(); // Also starts every channel at 0%
+    if(serialDebugEnabled) Serial.println("[INIT] Fan Channels Setup Complete.");
 
-    setDefaultFanCurve(); 
-    loadFanCurveFromNVS(); 
-    
-    ledcWrite(PWM_CHANNEL, 0); 
-    fanSpeedPercentage = 0;
-    fanSpeedPWM_Raw = 0;
-    if(serialDebugEnabled) Serial.println("[INIT] Fan set to 0% initially.");
+    for (int ch = 0; ch < NUM_FAN_CHANNELS; ch++) {
+        setDefaultFanCurve(ch); 
+        loadFanCurveFromNVS(ch); 
+        loadFanRpmModelFromNVS(ch); 
+        loadFanCalibrationFromNVS(ch);
+    }
 
     if(serialDebugEnabled) Serial.println("[INIT] Setting up Buttons...");
     pinMode(BTN_MENU_PIN, INPUT_PULLUP);
@@ -235,11 +276,17 @@ void setup() {
     pinMode(BTN_DOWN_PIN, INPUT_PULLUP);
     pinMode(BTN_SELECT_PIN, INPUT_PULLUP);
     pinMode(BTN_BACK_PIN, INPUT_PULLUP);
+    setupButtonWakeInterrupts();
     if(serialDebugEnabled) Serial.println("[INIT] Buttons Setup Complete.");
     
+    setupControlCommands(); // Queue must be ready before any producer task runs
+    setupNvsPersistence();
+
     if(serialDebugEnabled) Serial.println("[INIT] Creating FreeRTOS Tasks...");
     xTaskCreatePinnedToCore(networkTask, "NetworkTask", 12000, NULL, 1, &networkTaskHandle, 0); 
+    xTaskCreatePinnedToCore(controlTask, "ControlTask", 8192, NULL, 3, &controlTaskHandle, 1); // Above mainAppTask: UI work never delays a control pass
     xTaskCreatePinnedToCore(mainAppTask, "MainAppTask", 10000, NULL, 2, &mainAppTaskHandle, 1); 
+    xTaskCreatePinnedToCore(nvsPersistenceTask, "NvsTask", 4096, NULL, 0, &nvsPersistenceTaskHandle, 0); // Lowest: flash writes run when nothing else wants the CPU
 
     if(serialDebugEnabled) Serial.println("[INIT] Setup complete. Tasks launched.");
 }
@@ -1,14 +1,25 @@
 #include "mqtt_handler.h"
 #include "config.h" 
 #include "fan_control.h" 
+#include "control_commands.h"
 #include "nvs_handler.h" // For saving all configs
 #include "input_handler.h" // For attemptWiFiConnection, disconnectWiFi (though MQTT control removed)
+#include "ota_updater.h"
+#include "wifi_manager.h"
+#include "status_memory.h"
 #include <ArduinoJson.h> 
 
+// PubSubClient builds each packet in one buffer: fixed header (up to 5 bytes), topic length (2), topic
+// and payload. Sized for the largest status message plus the longest topic (discovery config topics)
+const size_t MQTT_TOPIC_BUDGET = 192;
+const size_t MQTT_PACKET_BUFFER_SIZE = STATUS_TEXT_BUFFER_SIZE + MQTT_TOPIC_BUDGET + 5 + 2;
+
 // Define MQTT Topics
 String mqttStatusTopic = "";
 String mqttModeCommandTopic = "";   
 String mqttSpeedCommandTopic = "";  
+String mqttRpmCommandTopic = ""; // Target RPM, switches to RPM mode
+String mqttCalibrateCommandTopic = ""; // START / CANCEL / CLEAR the characterization sweep
 String mqttAvailabilityTopic = ""; 
 String mqttFanCurveGetTopic = "";    
 String mqttFanCurveStatusTopic = ""; 
@@ -17,6 +28,9 @@ String mqttFanCommandTopic = "";
 String mqttDiscoveryConfigCommandTopic = ""; // For enabling/disabling discovery (the boolean setting)
 String mqttRebootCommandTopic = "";
 String mqttDiscoveryPrefixSetCommandTopic = ""; // To set the discovery prefix string
+String mqttPidCommandTopic = ""; // JSON {"setpoint","kp","ki","kd"}, missing fields unchanged
+String mqttOutputCommandTopic = ""; // JSON {"rampUp","rampDown","hysteresis"}, missing fields unchanged
+String mqttChannelTopicPrefix = ""; // "<base>/channel/"; per-fan topics are <prefix><N>/<command>
 
 
 // REMOVED: Definitions for problematic configuration command topics
@@ -76,6 +90,8 @@ void setupMQTT() {
     mqttStatusTopic = getFullTopic("status_json"); 
     mqttModeCommandTopic = getFullTopic("mode/set");
     mqttSpeedCommandTopic = getFullTopic("speed/set");
+    mqttRpmCommandTopic = getFullTopic("rpm/set");
+    mqttCalibrateCommandTopic = getFullTopic("calibrate/set");
     mqttAvailabilityTopic = getFullTopic("online_status");
     mqttFanCurveGetTopic = getFullTopic("fancurve/get");
     mqttFanCurveStatusTopic = getFullTopic("fancurve/status");
@@ -84,6 +100,9 @@ void setupMQTT() {
     mqttDiscoveryConfigCommandTopic = getFullTopic("discovery_enabled/set"); 
     mqttRebootCommandTopic = getFullTopic("reboot/set");
     mqttDiscoveryPrefixSetCommandTopic = getFullTopic("discovery_prefix/set");
+    mqttPidCommandTopic = getFullTopic("pid/set");
+    mqttOutputCommandTopic = getFullTopic("output/set");
+    mqttChannelTopicPrefix = getFullTopic("channel/");
 
 
     if (serialDebugEnabled) {
@@ -92,6 +111,8 @@ void setupMQTT() {
         Serial.printf("[MQTT] Status JSON Topic: %s\n", mqttStatusTopic.c_str());
         Serial.printf("[MQTT] Mode Command Topic: %s\n", mqttModeCommandTopic.c_str());
         Serial.printf("[MQTT] Speed Command Topic: %s\n", mqttSpeedCommandTopic.c_str());
+        Serial.printf("[MQTT] RPM Command Topic: %s\n", mqttRpmCommandTopic.c_str());
+        Serial.printf("[MQTT] Calibrate Command Topic: %s\n", mqttCalibrateCommandTopic.c_str());
         Serial.printf("[MQTT] Availability Topic: %s\n", mqttAvailabilityTopic.c_str());
         Serial.printf("[MQTT] Fan Curve Get Topic: %s\n", mqttFanCurveGetTopic.c_str());    
         Serial.printf("[MQTT] Fan Curve Status Topic: %s\n", mqttFanCurveStatusTopic.c_str()); 
@@ -100,12 +121,17 @@ void setupMQTT() {
         Serial.printf("[MQTT] Discovery Enabled Command Topic: %s\n", mqttDiscoveryConfigCommandTopic.c_str()); 
         Serial.printf("[MQTT] Reboot Command Topic: %s\n", mqttRebootCommandTopic.c_str()); 
         Serial.printf("[MQTT] Discovery Prefix Set Command Topic: %s\n", mqttDiscoveryPrefixSetCommandTopic.c_str());
+        Serial.printf("[MQTT] PID Command Topic: %s\n", mqttPidCommandTopic.c_str());
+        Serial.printf("[MQTT] Output Conditioning Command Topic: %s\n", mqttOutputCommandTopic.c_str());
+        Serial.printf("[MQTT] Per-Fan Topics: %s<0-%d>/...\n", mqttChannelTopicPrefix.c_str(), NUM_FAN_CHANNELS - 1);
         Serial.printf("[MQTT] Discovery Enabled Setting: %s, Prefix: %s\n", isMqttDiscoveryEnabled ? "Yes" : "No", mqttDiscoveryPrefix);
     }
 
     mqttClient.setServer(mqttServer, mqttPort);
     mqttClient.setCallback(mqttCallback);
-    mqttClient.setBufferSize(1536); 
+    if (!mqttClient.setBufferSize(MQTT_PACKET_BUFFER_SIZE) && serialDebugEnabled) {
+        Serial.printf("[MQTT_ERR] Could not allocate the %u byte packet buffer.\n", (unsigned)MQTT_PACKET_BUFFER_SIZE);
+    }
 }
 
 void connectMQTT() {
@@ -146,12 +172,19 @@ void connectMQTT() {
         // Subscribe to command topics
         mqttClient.subscribe(mqttModeCommandTopic.c_str());
         mqttClient.subscribe(mqttSpeedCommandTopic.c_str());
+        mqttClient.subscribe(mqttRpmCommandTopic.c_str());
+        mqttClient.subscribe(mqttCalibrateCommandTopic.c_str());
         mqttClient.subscribe(mqttFanCurveGetTopic.c_str());
         mqttClient.subscribe(mqttFanCurveSetTopic.c_str());
         mqttClient.subscribe(mqttFanCommandTopic.c_str());
         mqttClient.subscribe(mqttDiscoveryConfigCommandTopic.c_str()); 
         mqttClient.subscribe(mqttRebootCommandTopic.c_str());
         mqttClient.subscribe(mqttDiscoveryPrefixSetCommandTopic.c_str());
+        mqttClient.subscribe(mqttPidCommandTopic.c_str());
+        mqttClient.subscribe(mqttOutputCommandTopic.c_str());
+        // Per-fan commands (channel/<N>/mode/set, .../speed/set, .../fan/set, .../fancurve/set|get)
+        mqttClient.subscribe((mqttChannelTopicPrefix + "+/+/set").c_str());
+        mqttClient.subscribe((mqttChannelTopicPrefix + "+/fancurve/get").c_str());
         
         // REMOVED: Subscriptions to problematic config topics
         
@@ -159,8 +192,11 @@ void connectMQTT() {
             Serial.println("[MQTT] Subscribed to relevant command topics.");
         }
         
-        publishStatusMQTT(); 
-        publishFanCurveMQTT(); 
+        ControllerState state;
+        if (controllerStateRead(&controllerState, &state, 8)) {
+            publishStatusMQTT(state);
+            publishFanCurveMQTT(state);
+        }
 
         if (isMqttDiscoveryEnabled) { 
             publishMqttDiscovery(); 
@@ -199,26 +235,101 @@ void loopMQTT() {
     }
 }
 
-void publishStatusMQTT() {
+// Dotted station IP, formatted again only when the address changes
+static const char* localIpText() {
+    static char text[16] = "0.0.0.0";
+    static uint32_t formatted = 0;
+    uint32_t ip = (uint32_t)WiFi.localIP();
+    if (ip != formatted) {
+        snprintf(text, sizeof(text), "%u.%u.%u.%u", (unsigned)(ip & 0xFF), (unsigned)((ip >> 8) & 0xFF),
+                 (unsigned)((ip >> 16) & 0xFF), (unsigned)(ip >> 24));
+        formatted = ip;
+    }
+    return text;
+}
+
+void publishStatusMQTT(const ControllerState& state) {
     if (!isMqttEnabled || !mqttClient.connected()) {
         return;
     }
 
-    ArduinoJson::JsonDocument doc; 
-    if (tempSensorFound) {
-        doc["temperature"] = currentTemperature;
+    // Arena document and static text buffer (status_memory.h): no heap use per publish
+    ArduinoJson::JsonDocument doc(statusScratchAllocator());
+    if (state.tempSensorFound) {
+        doc["temperature"] = state.temperature;
     } else {
         doc["temperature"] = nullptr; 
     }
-    doc["tempSensorFound"] = tempSensorFound;
-    doc["fanSpeedPercent"] = fanSpeedPercentage;
-    doc["fanRpm"] = fanRpm;
-    doc["mode"] = isAutoMode ? "AUTO" : "MANUAL";
-    doc["manualSetSpeed"] = manualFanSpeedPercentage; 
-    doc["ipAddress"] = WiFi.status() == WL_CONNECTED ? WiFi.localIP().toString() : "0.0.0.0";
+    doc["tempSensorFound"] = state.tempSensorFound;
+    // Top-level fan fields mirror channel 0 for single-fan consumers; "channels" carries every fan
+    doc["fanSpeedPercent"] = state.channels[0].speedPercent;
+    doc["fanRpm"] = state.channels[0].rpm;
+    doc["mode"] = state.channels[0].modeName;
+    doc["manualSetSpeed"] = state.channels[0].manualSpeedPercent; 
+    doc["ipAddress"] = WiFi.status() == WL_CONNECTED ? localIpText() : "0.0.0.0";
     doc["wifiRSSI"] = WiFi.status() == WL_CONNECTED ? WiFi.RSSI() : 0;
-    doc["fan_state"] = (fanSpeedPercentage > 0) ? "ON" : "OFF"; 
+    doc["fan_state"] = (state.channels[0].speedPercent > 0) ? "ON" : "OFF"; 
+    JsonArray channelsArray = doc["channels"].to<JsonArray>();
+    for (int ch = 0; ch < NUM_FAN_CHANNELS; ch++) {
+        const ControllerChannelSnapshot& fan = state.channels[ch];
+        JsonObject channel = channelsArray.add<JsonObject>();
+        channel["fanSpeedPercent"] = fan.speedPercent;
+        channel["fanRpm"] = fan.rpm;
+        channel["mode"] = fan.modeName;
+        channel["manualSetSpeed"] = fan.manualSpeedPercent;
+        channel["targetRpm"] = fan.targetRpm;
+        channel["calibration"] = fan.calibrationStatus;
+        channel["calStartDuty"] = fan.calStartDuty;
+        channel["calStallDuty"] = fan.calStallDuty;
+        channel["calMaxRpm"] = fan.calMaxRpm;
+        channel["fan_state"] = (fan.speedPercent > 0) ? "ON" : "OFF";
+    }
     
+    doc["pidSetpoint"] = state.pidSetpointC;
+    doc["pidKp"] = state.pidKp;
+    doc["pidKi"] = state.pidKi;
+    doc["pidKd"] = state.pidKd;
+    doc["rampUpPercentPerS"] = state.rampUpPercentPerS;
+    doc["rampDownPercentPerS"] = state.rampDownPercentPerS;
+    doc["hysteresisC"] = state.hysteresisC;
+    doc["fanOutputWrites"] = state.outputWrites;
+    doc["suppressedOutputChanges"] = state.suppressedOutputChanges;
+    doc["suppressedBroadcasts"] = state.suppressedBroadcasts;
+    doc["cmdApplied"] = state.commandsApplied;
+    doc["cmdDropped"] = state.commandsDropped;
+    doc["cmdQueueMaxDepth"] = state.commandQueueMaxDepth;
+    doc["cmdLatencyAvgUs"] = state.commandLatencyAvgUs;
+    doc["cmdLatencyMaxUs"] = state.commandLatencyMaxUs;
+    doc["cmdToPwmP50Us"] = state.commandToOutputP50Us;
+    doc["cmdToPwmP99Us"] = state.commandToOutputP99Us;
+    doc["cmdToPwmMaxUs"] = state.commandToOutputMaxUs;
+    doc["ctlPeriodMinUs"] = state.controlPeriodMinUs;
+    doc["ctlPeriodMaxUs"] = state.controlPeriodMaxUs;
+    doc["ctlJitterP99Us"] = state.controlJitterP99Us;
+    doc["ctlJitterMaxUs"] = state.controlJitterMaxUs;
+    doc["ctlExecMaxUs"] = state.controlExecMaxUs;
+    doc["ctlOverruns"] = state.controlOverruns;
+    doc["nvsWrites"] = state.nvsWrites;
+    doc["nvsWritesAvoided"] = state.nvsWritesAvoided;
+    doc["nvsBytesWritten"] = state.nvsBytesWritten;
+    doc["nvsPending"] = state.nvsPending;
+    const WifiLink* wifiLink = getWifiLink();
+    doc["wifiBootOnlineMs"] = wifiLink->firstOnlineMs;
+    doc["wifiLastConnectMs"] = wifiLink->lastConnectMs;
+    doc["wifiFastJoin"] = wifiLink->attemptIsFast != 0;
+    doc["wifiDrops"] = wifiLink->drops;
+    char otaMessage[96];
+    copyOtaStatusMessage(otaMessage, sizeof(otaMessage));
+    doc["otaInProgress"] = ota_in_progress;
+    doc["otaStatusMessage"] = otaMessage;
+    if (ota_in_progress) {
+        doc["otaBytes"] = otaProgress.bytesDone;
+        doc["otaTotalBytes"] = otaProgress.bytesTotal;
+        doc["otaPercent"] = otaProgressPercent(&otaProgress);
+        doc["otaBytesPerS"] = otaProgress.bytesPerSec;
+        if (otaProgress.etaS != OTA_PROGRESS_ETA_UNKNOWN) doc["otaEtaS"] = otaProgress.etaS;
+    }
+
     doc["isWiFiEnabled"] = isWiFiEnabled; // State of the setting
     doc["wifiConnected"] = (WiFi.status() == WL_CONNECTED); // Actual connection status
     doc["serialDebugEnabled"] = serialDebugEnabled;
@@ -234,34 +345,62 @@ void publishStatusMQTT() {
     doc["mqttBaseTopic"] = mqttBaseTopic;
     doc["mqttDiscoveryPrefix"] = mqttDiscoveryPrefix; // Display current discovery prefix
 
-    String output;
-    serializeJson(doc, output);
+    StatusMemoryStats memory;
+    getStatusMemoryStats(&memory);
+    doc["heapFree"] = memory.heapFree;
+    doc["heapMinFree"] = memory.heapMinFree;
+    doc["heapLargestBlock"] = memory.heapLargestBlock;
+    doc["heapFragPct"] = memory.heapFragPercent;
+    doc["statusDropped"] = memory.dropped;
 
-    if (!mqttClient.publish(mqttStatusTopic.c_str(), output.c_str(), true)) { 
+    char* output = statusTextBuffer();
+    size_t length = serializeStatusJson(doc, output, STATUS_TEXT_BUFFER_SIZE);
+    if (length == 0) return;
+    if (!mqttClient.publish(mqttStatusTopic.c_str(), (const uint8_t*)output, length, true)) { 
+        countDroppedStatusMessage();
         if (serialDebugEnabled) Serial.printf("[MQTT_ERR] Failed to publish status to %s\n", mqttStatusTopic.c_str());
     }
 }
 
-void publishFanCurveMQTT() {
-    if (!isMqttEnabled || !mqttClient.connected()) {
-        return;
-    }
+String getFanChannelTopic(int channel, const char* command) {
+    return mqttChannelTopicPrefix + String(channel) + "/" + command;
+}
+
+// From the snapshot, not fanChannels: controlTask rewrites the live curve arrays on core 1
+static void publishFanCurveToTopic(const ControllerChannelSnapshot& fan, const String& topic) {
     ArduinoJson::JsonDocument curveDoc; 
     JsonArray curveArray = curveDoc.to<JsonArray>();
-    for (int i = 0; i < numCurvePoints; i++) {
+    for (int i = 0; i < fan.curveNumPoints; i++) {
         JsonObject point = curveArray.add<JsonObject>();
-        point["temp"] = tempPoints[i];
-        point["pwmPercent"] = pwmPercentagePoints[i];
+        point["temp"] = fan.curveTemp[i];
+        point["pwmPercent"] = fan.curvePwm[i];
     }
     String curveString;
     serializeJson(curveDoc, curveString);
-    if (!mqttClient.publish(mqttFanCurveStatusTopic.c_str(), curveString.c_str(), true)) { 
-        if (serialDebugEnabled) Serial.printf("[MQTT_ERR] Failed to publish fan curve to %s\n", mqttFanCurveStatusTopic.c_str());
+    if (!mqttClient.publish(topic.c_str(), curveString.c_str(), true)) { 
+        if (serialDebugEnabled) Serial.printf("[MQTT_ERR] Failed to publish fan curve to %s\n", topic.c_str());
     } else {
-        if (serialDebugEnabled) Serial.printf("[MQTT] Fan Curve Published to %s\n", mqttFanCurveStatusTopic.c_str());
+        if (serialDebugEnabled) Serial.printf("[MQTT] Fan Curve Published to %s\n", topic.c_str());
     }
 }
 
+void publishFanCurveMQTT(const ControllerState& state) {
+    if (!isMqttEnabled || !mqttClient.connected()) {
+        return;
+    }
+    publishFanCurveToTopic(state.channels[0], mqttFanCurveStatusTopic); // Legacy topic carries channel 0
+    for (int ch = 0; ch < NUM_FAN_CHANNELS; ch++) {
+        publishFanCurveToTopic(state.channels[ch], getFanChannelTopic(ch, "fancurve/status"));
+    }
+}
+
+// fancurve/get, from the MQTT callback (networkTask, inside loopMQTT())
+static void publishLatestFanCurveMQTT() {
+    ControllerState state;
+    if (controllerStateRead(&controllerState, &state, 8)) publishFanCurveMQTT(state);
+    else if (serialDebugEnabled) Serial.println("[MQTT_ERR] Fan curve request skipped, controller state busy.");
+}
+
 
 void publishMqttAvailability(bool available) {
     if (available && (!isMqttEnabled || !mqttClient.connected())) {
@@ -295,7 +434,7 @@ void publishMqttDiscovery() {
                 "binary_sensor/serial_debug_status", "binary_sensor/reboot_needed_status",
                 "sensor/manual_target_speed", "sensor/wifi_rssi", "sensor/ip_address", 
                 "switch/mqtt_discovery_enabled_switch", "button/reboot_button", 
-                "text/discovery_prefix_text", "text/fan_curve_text",
+                "text/discovery_prefix_text", "text/fan_curve_text", "number/pid_setpoint",
                 // Sensors for displaying config values (these are fine to clear if discovery is off)
                 "sensor/current_ssid_sensor", "sensor/mqtt_broker_server_sensor", 
                 "sensor/mqtt_broker_port_sensor", "sensor/mqtt_broker_user_sensor",
@@ -313,6 +452,16 @@ void publishMqttDiscovery() {
                     mqttClient.publish(configTopic.c_str(), "", true); 
                 }
             }
+            // Per-fan entities of channels 1..N-1 (channel 0 uses the unsuffixed IDs above)
+            const char* perFanObjectIds[] = { "fan/fan", "sensor/rpm", "sensor/manual_target_speed", "text/fan_curve_text" };
+            for (int ch = 1; ch < NUM_FAN_CHANNELS; ch++) {
+                for (const char* fullObjectId : perFanObjectIds) {
+                    String fullIdStr = String(fullObjectId);
+                    int slashPos = fullIdStr.indexOf('/');
+                    String configTopic = getFullTopic(fullIdStr.substring(0, slashPos) + "/" + String(mqttDeviceId) + "/" + fullIdStr.substring(slashPos + 1) + "_ch" + String(ch) + "/config", true);
+                    mqttClient.publish(configTopic.c_str(), "", true); 
+                }
+            }
         }
         return;
     }
@@ -343,52 +492,115 @@ void publishMqttDiscovery() {
         }
     };
 
-    // --- Core Fan Control Entities ---
-    // 1. Fan Entity
-    {
-        String objectId = "fan"; 
-        ArduinoJson::JsonDocument doc;
-        doc["name"] = entityNameBase; 
-        doc["unique_id"] = entityUniqueIdBase + "_" + objectId;
-        doc["availability_topic"] = mqttAvailabilityTopic;
-        doc["device"] = deviceObj; 
-        doc["state_topic"] = mqttStatusTopic;
-        doc["state_value_template"] = "{{ value_json.fan_state }}"; 
-        doc["command_topic"] = mqttFanCommandTopic; 
-        doc["percentage_state_topic"] = mqttStatusTopic;
-        doc["percentage_value_template"] = "{{ value_json.fanSpeedPercent }}";
-        doc["percentage_command_topic"] = mqttSpeedCommandTopic;
-        doc["preset_mode_state_topic"] = mqttStatusTopic;
-        doc["preset_mode_value_template"] = "{{ value_json.mode }}";
-        doc["preset_mode_command_topic"] = mqttModeCommandTopic;
-        JsonArray presetModes = doc["preset_modes"].to<JsonArray>();
-        presetModes.add("AUTO");
-        presetModes.add("MANUAL");
-        doc["qos"] = 0;
-        doc["optimistic"] = false; 
-        doc["speed_range_min"] = 0; 
-        doc["speed_range_max"] = 100;
-        publishDiscoveryEntity("fan", objectId, doc);
+    // --- Core Fan Control Entities (one set per fan channel) ---
+    // Channel 0 keeps the original object IDs so existing Home Assistant entities survive; 
+    // channel N adds an "_ch<N>" suffix. Commands go to the per-fan topics.
+    for (int ch = 0; ch < NUM_FAN_CHANNELS; ch++) {
+        String idSuffix = (ch == 0) ? "" : "_ch" + String(ch);
+        String fanName = (NUM_FAN_CHANNELS == 1) ? entityNameBase : entityNameBase + " Fan " + String(ch + 1);
+        String valuePrefix = "{{ value_json.channels[" + String(ch) + "].";
+
+        // 1. Fan Entity
+        {
+            String objectId = "fan" + idSuffix; 
+            ArduinoJson::JsonDocument doc;
+            doc["name"] = fanName; 
+            doc["unique_id"] = entityUniqueIdBase + "_" + objectId;
+            doc["availability_topic"] = mqttAvailabilityTopic;
+            doc["device"] = deviceObj; 
+            doc["state_topic"] = mqttStatusTopic;
+            doc["state_value_template"] = valuePrefix + "fan_state }}"; 
+            doc["command_topic"] = getFanChannelTopic(ch, "fan/set"); 
+            doc["percentage_state_topic"] = mqttStatusTopic;
+            doc["percentage_value_template"] = valuePrefix + "fanSpeedPercent }}";
+            doc["percentage_command_topic"] = getFanChannelTopic(ch, "speed/set");
+            doc["preset_mode_state_topic"] = mqttStatusTopic;
+            doc["preset_mode_value_template"] = valuePrefix + "mode }}";
+            doc["preset_mode_command_topic"] = getFanChannelTopic(ch, "mode/set");
+            JsonArray presetModes = doc["preset_modes"].to<JsonArray>();
+            presetModes.add("AUTO");
+            presetModes.add("MANUAL");
+            presetModes.add("PID");
+            if (fanHasTach(ch)) presetModes.add("RPM");
+            doc["qos"] = 0;
+            doc["optimistic"] = false; 
+            doc["speed_range_min"] = 0; 
+            doc["speed_range_max"] = 100;
+            publishDiscoveryEntity("fan", objectId, doc);
+        }
+        // 2. Fan Curve (Text Input for setting, Sensor for current value)
+        {
+            String objectId = "fan_curve_text" + idSuffix;
+            ArduinoJson::JsonDocument doc;
+            doc["name"] = fanName + " Fan Curve (JSON)";
+            doc["unique_id"] = entityUniqueIdBase + "_" + objectId;
+            doc["availability_topic"] = mqttAvailabilityTopic;
+            doc["device"] = deviceObj;
+            doc["state_topic"] = getFanChannelTopic(ch, "fancurve/status"); 
+            doc["command_topic"] = getFanChannelTopic(ch, "fancurve/set");
+            doc["icon"] = "mdi:chart-bell-curve-cumulative";
+            doc["entity_category"] = "config";
+            doc["qos"] = 0;
+            publishDiscoveryEntity("text", objectId, doc);
+        }
+        // 3. Fan RPM Sensor
+        {
+            String objectId = "rpm" + idSuffix;
+            ArduinoJson::JsonDocument doc;
+            doc["name"] = fanName + " Fan RPM";
+            doc["unique_id"] = entityUniqueIdBase + "_" + objectId;
+            doc["availability_topic"] = mqttAvailabilityTopic;
+            doc["device"] = deviceObj;
+            doc["state_topic"] = mqttStatusTopic;
+            doc["value_template"] = valuePrefix + "fanRpm }}";
+            doc["unit_of_measurement"] = "RPM";
+            doc["icon"] = "mdi:fan"; 
+            doc["qos"] = 0;
+            publishDiscoveryEntity("sensor", objectId, doc);
+        }
+        // 4. Manual Mode Target Speed (Sensor)
+        {
+            String objectId = "manual_target_speed" + idSuffix;
+            ArduinoJson::JsonDocument doc;
+            doc["name"] = fanName + " Manual Mode Target Speed";
+            doc["unique_id"] = entityUniqueIdBase + "_" + objectId;
+            doc["availability_topic"] = mqttAvailabilityTopic;
+            doc["device"] = deviceObj;
+            doc["state_topic"] = mqttStatusTopic;
+            doc["value_template"] = valuePrefix + "manualSetSpeed }}";
+            doc["unit_of_measurement"] = "%";
+            doc["icon"] = "mdi:speedometer-medium";
+            doc["entity_category"] = "diagnostic";
+            doc["qos"] = 0;
+            publishDiscoveryEntity("sensor", objectId, doc);
+        }
     }
-    // 2. Fan Curve (Text Input for setting, Sensor for current value)
+
+
+    // PID Setpoint (Number)
     {
-        String objectId = "fan_curve_text";
+        String objectId = "pid_setpoint";
         ArduinoJson::JsonDocument doc;
-        doc["name"] = entityNameBase + " Fan Curve (JSON)";
+        doc["name"] = entityNameBase + " PID Setpoint";
         doc["unique_id"] = entityUniqueIdBase + "_" + objectId;
         doc["availability_topic"] = mqttAvailabilityTopic;
         doc["device"] = deviceObj;
-        doc["state_topic"] = mqttFanCurveStatusTopic; 
-        doc["command_topic"] = mqttFanCurveSetTopic;
-        doc["icon"] = "mdi:chart-bell-curve-cumulative";
+        doc["state_topic"] = mqttStatusTopic;
+        doc["value_template"] = "{{ value_json.pidSetpoint }}";
+        doc["command_topic"] = mqttPidCommandTopic;
+        doc["command_template"] = "{\"setpoint\": {{ value }} }";
+        doc["min"] = 0;
+        doc["max"] = 120;
+        doc["step"] = 0.5;
+        doc["unit_of_measurement"] = "°C";
+        doc["icon"] = "mdi:thermometer-check";
         doc["entity_category"] = "config";
         doc["qos"] = 0;
-        publishDiscoveryEntity("text", objectId, doc);
+        publishDiscoveryEntity("number", objectId, doc);
     }
 
-
     // --- Sensor Readings ---
-    // 3. Temperature Sensor
+    // 5. Temperature Sensor
     if (tempSensorFound) { 
         String objectId = "temperature";
         ArduinoJson::JsonDocument doc;
@@ -407,39 +619,6 @@ void publishMqttDiscovery() {
         String configTopic = getFullTopic("sensor/" + String(mqttDeviceId) + "/temperature/config", true);
         mqttClient.publish(configTopic.c_str(), "", true); 
     }
-    // 4. Fan RPM Sensor
-    {
-        String objectId = "rpm";
-        ArduinoJson::JsonDocument doc;
-        // ... (same as before)
-        doc["name"] = entityNameBase + " Fan RPM";
-        doc["unique_id"] = entityUniqueIdBase + "_" + objectId;
-        doc["availability_topic"] = mqttAvailabilityTopic;
-        doc["device"] = deviceObj;
-        doc["state_topic"] = mqttStatusTopic;
-        doc["value_template"] = "{{ value_json.fanRpm }}";
-        doc["unit_of_measurement"] = "RPM";
-        doc["icon"] = "mdi:fan"; 
-        doc["qos"] = 0;
-        publishDiscoveryEntity("sensor", objectId, doc);
-    }
-    // 5. Manual Mode Target Speed (Sensor)
-    {
-        String objectId = "manual_target_speed";
-        ArduinoJson::JsonDocument doc;
-        // ... (same as before)
-        doc["name"] = entityNameBase + " Manual Mode Target Speed";
-        doc["unique_id"] = entityUniqueIdBase + "_" + objectId;
-        doc["availability_topic"] = mqttAvailabilityTopic;
-        doc["device"] = deviceObj;
-        doc["state_topic"] = mqttStatusTopic;
-        doc["value_template"] = "{{ value_json.manualSetSpeed }}";
-        doc["unit_of_measurement"] = "%";
-        doc["icon"] = "mdi:speedometer-medium";
-        doc["entity_category"] = "diagnostic";
-        doc["qos"] = 0;
-        publishDiscoveryEntity("sensor", objectId, doc);
-    }
 
     // --- Diagnostic Binary Sensors ---
     // 6. Temperature Sensor Found Status
@@ -680,92 +859,158 @@ void publishMqttDiscovery() {
 }
 
 
-void mqttCallback(char* topic, byte* payload, unsigned int length) {
-    if (serialDebugEnabled) {
-        Serial.print("[MQTT_RX] Message arrived [");
-        Serial.print(topic);
-        Serial.print("] ");
-    }
-    String messageTemp;
-    messageTemp.reserve(length + 1); 
-    for (unsigned int i = 0; i < length; i++) {
-        messageTemp += (char)payload[i];
-    }
-    if (serialDebugEnabled) Serial.println(messageTemp);
-
-    String topicStr = String(topic);
-
-    // --- Fan Control Commands ---
-    if (topicStr.equals(mqttModeCommandTopic)) {
-        if (messageTemp.equalsIgnoreCase("AUTO")) {
-            isAutoMode = true;
-        } else if (messageTemp.equalsIgnoreCase("MANUAL")) {
-            isAutoMode = false;
-            if (fanSpeedPercentage == 0 && manualFanSpeedPercentage == 0) manualFanSpeedPercentage = 50; 
+// Control changes are queued as commands and applied by controlTask on its next tick
+void handleFanChannelCommand(int channel, const String& command, const String& message) {
+    if (command.equals("mode/set")) {
+        if (message.equalsIgnoreCase("AUTO")) {
+            enqueueControlCommand(makeControlCommand(CMD_SET_MODE_AUTO, channel, CMD_SOURCE_MQTT));
+        } else if (message.equalsIgnoreCase("PID")) {
+            enqueueControlCommand(makeControlCommand(CMD_SET_MODE_PID, channel, CMD_SOURCE_MQTT));
+        } else if (message.equalsIgnoreCase("RPM")) {
+            enqueueControlCommand(makeControlCommand(CMD_SET_RPM_TARGET, channel, CMD_SOURCE_MQTT)); // Last target, else current RPM
+        } else if (message.equalsIgnoreCase("MANUAL")) {
+            enqueueControlCommand(makeControlCommand(CMD_SET_MODE_MANUAL, channel, CMD_SOURCE_MQTT));
         } else { if (serialDebugEnabled) Serial.println("[MQTT_CMD_ERR] Unknown mode payload.");}
-        needsImmediateBroadcast = true; 
-    } else if (topicStr.equals(mqttSpeedCommandTopic)) {
-        int speed = messageTemp.toInt();
+    } else if (command.equals("speed/set")) {
+        int speed = message.toInt();
         if (speed >= 0 && speed <= 100) {
-            isAutoMode = false; 
-            manualFanSpeedPercentage = speed;
-            needsImmediateBroadcast = true; 
+            ControlCommand cmd = makeControlCommand(CMD_SET_MODE_MANUAL, channel, CMD_SOURCE_MQTT);
+            cmd.value = speed;
+            enqueueControlCommand(cmd);
         } else { if (serialDebugEnabled) Serial.printf("[MQTT_CMD_ERR] Invalid speed payload %d.\n", speed);}
-    } else if (topicStr.equals(mqttFanCommandTopic)) {
-        if (messageTemp.equalsIgnoreCase("ON")) {
-            isAutoMode = false; 
-            if (manualFanSpeedPercentage == 0) manualFanSpeedPercentage = 50; 
-            setFanSpeed(manualFanSpeedPercentage); 
-        } else if (messageTemp.equalsIgnoreCase("OFF")) {
-            isAutoMode = false; 
-            manualFanSpeedPercentage = 0; 
-            setFanSpeed(0); 
+    } else if (command.equals("rpm/set")) {
+        String payload = message; payload.trim();
+        int rpm;
+        if (parseFanRpmTarget(payload.c_str(), FAN_RPM_TARGET_MAX, &rpm)) {
+            ControlCommand cmd = makeControlCommand(CMD_SET_RPM_TARGET, channel, CMD_SOURCE_MQTT);
+            cmd.value = rpm;
+            enqueueControlCommand(cmd);
+        } else { if (serialDebugEnabled) Serial.printf("[MQTT_CMD_ERR] Invalid target RPM payload '%s' (0-%d).\n", payload.c_str(), FAN_RPM_TARGET_MAX);}
+    } else if (command.equals("calibrate/set")) {
+        if (message.equalsIgnoreCase("START")) {
+            enqueueControlCommand(makeControlCommand(CMD_CALIBRATION_START, channel, CMD_SOURCE_MQTT));
+        } else if (message.equalsIgnoreCase("CANCEL")) {
+            enqueueControlCommand(makeControlCommand(CMD_CALIBRATION_CANCEL, channel, CMD_SOURCE_MQTT));
+        } else if (message.equalsIgnoreCase("CLEAR")) {
+            enqueueControlCommand(makeControlCommand(CMD_CALIBRATION_CLEAR, channel, CMD_SOURCE_MQTT));
+        } else { if (serialDebugEnabled) Serial.println("[MQTT_CMD_ERR] Unknown calibrate payload (START, CANCEL or CLEAR).");}
+    } else if (command.equals("fan/set")) {
+        if (message.equalsIgnoreCase("ON")) {
+            enqueueControlCommand(makeControlCommand(CMD_FAN_ON, channel, CMD_SOURCE_MQTT));
+        } else if (message.equalsIgnoreCase("OFF")) {
+            enqueueControlCommand(makeControlCommand(CMD_FAN_OFF, channel, CMD_SOURCE_MQTT));
         } else { if (serialDebugEnabled) Serial.println("[MQTT_CMD_ERR] Unknown fan command payload.");}
-        needsImmediateBroadcast = true; 
     }
     // --- Fan Curve Commands ---
-    else if (topicStr.equals(mqttFanCurveGetTopic)) {
-        publishFanCurveMQTT(); 
-    } else if (topicStr.equals(mqttFanCurveSetTopic)) {
+    else if (command.equals("fancurve/get")) {
+        publishLatestFanCurveMQTT(); 
+    } else if (command.equals("fancurve/set")) {
         if (!tempSensorFound) { if(serialDebugEnabled) Serial.println("[MQTT_CMD_WARN] Ignored setCurve, temp sensor not found."); return; }
         ArduinoJson::JsonDocument newCurveDoc; 
-        DeserializationError error = deserializeJson(newCurveDoc, messageTemp);
+        DeserializationError error = deserializeJson(newCurveDoc, message);
         if (error) { if(serialDebugEnabled) Serial.printf("[MQTT_CMD_ERR] deserializeJson() for fan curve failed: %s\n", error.c_str()); return; }
         JsonArray newCurveArray = newCurveDoc.as<JsonArray>();
         if (!newCurveArray || newCurveArray.size() < 2 || newCurveArray.size() > MAX_CURVE_POINTS) { if(serialDebugEnabled) Serial.printf("[MQTT_CMD_ERR] Invalid fan curve array. Size: %d (must be 2-%d).\n", newCurveArray.size(), MAX_CURVE_POINTS); return; }
         bool curveValid = true; int lastTemp = -100; 
-        int tempTempPointsValidation[MAX_CURVE_POINTS]; int tempPwmPercentagePointsValidation[MAX_CURVE_POINTS]; 
+        ControlCommand cmd = makeControlCommand(CMD_SET_CURVE, channel, CMD_SOURCE_MQTT);
         int newNumPoints = newCurveArray.size();
         for(int i=0; i < newNumPoints; ++i) {
             JsonObject point = newCurveArray[i];
             if (!point["temp"].is<int>() || !point["pwmPercent"].is<int>()) { curveValid = false; break; }
             int t = point["temp"].as<int>(); int p = point["pwmPercent"].as<int>();
             if (t < 0 || t > 120 || p < 0 || p > 100 || (i > 0 && t <= lastTemp) ) { curveValid = false; break; }
-            tempTempPointsValidation[i] = t; tempPwmPercentagePointsValidation[i] = p; lastTemp = t;
+            cmd.curveTemp[i] = t; cmd.curvePwm[i] = p; lastTemp = t;
         }
         if (curveValid) {
-            numCurvePoints = newNumPoints;
-            for(int i=0; i < numCurvePoints; ++i) { tempPoints[i] = tempTempPointsValidation[i]; pwmPercentagePoints[i] = tempPwmPercentagePointsValidation[i]; }
-            if(serialDebugEnabled) Serial.println("[SYSTEM] Fan curve updated and validated via MQTT.");
-            saveFanCurveToNVS(); fanCurveChanged = true; needsImmediateBroadcast = true; 
+            cmd.curveNumPoints = newNumPoints;
+            enqueueControlCommand(cmd);
         } else { if(serialDebugEnabled) Serial.println("[SYSTEM_ERR] New fan curve from MQTT rejected."); }
-    } 
+    } else {
+        if (serialDebugEnabled) Serial.printf("[MQTT_CMD_ERR] Unknown fan command '%s'.\n", command.c_str());
+    }
+}
+
+void mqttCallback(char* topic, byte* payload, unsigned int length) {
+    if (serialDebugEnabled) {
+        Serial.print("[MQTT_RX] Message arrived [");
+        Serial.print(topic);
+        Serial.print("] ");
+    }
+    String messageTemp;
+    messageTemp.reserve(length + 1); 
+    for (unsigned int i = 0; i < length; i++) {
+        messageTemp += (char)payload[i];
+    }
+    if (serialDebugEnabled) Serial.println(messageTemp);
+
+    String topicStr = String(topic);
+
+    // --- Fan Control Commands ---
+    // Legacy topics (mode/set, speed/set, fan/set, fancurve/*) address every fan;
+    // channel/<N>/<command> addresses a single fan.
+    if (topicStr.equals(mqttModeCommandTopic)) {
+        handleFanChannelCommand(ALL_FAN_CHANNELS, "mode/set", messageTemp);
+    } else if (topicStr.equals(mqttSpeedCommandTopic)) {
+        handleFanChannelCommand(ALL_FAN_CHANNELS, "speed/set", messageTemp);
+    } else if (topicStr.equals(mqttRpmCommandTopic)) {
+        handleFanChannelCommand(ALL_FAN_CHANNELS, "rpm/set", messageTemp);
+    } else if (topicStr.equals(mqttCalibrateCommandTopic)) {
+        handleFanChannelCommand(ALL_FAN_CHANNELS, "calibrate/set", messageTemp);
+    } else if (topicStr.equals(mqttFanCommandTopic)) {
+        handleFanChannelCommand(ALL_FAN_CHANNELS, "fan/set", messageTemp);
+    } else if (topicStr.equals(mqttFanCurveGetTopic)) {
+        publishLatestFanCurveMQTT(); 
+    } else if (topicStr.equals(mqttFanCurveSetTopic)) {
+        handleFanChannelCommand(ALL_FAN_CHANNELS, "fancurve/set", messageTemp);
+    } else if (topicStr.startsWith(mqttChannelTopicPrefix)) {
+        String rest = topicStr.substring(mqttChannelTopicPrefix.length()); // "<N>/<command>"
+        int slashPos = rest.indexOf('/');
+        int channel = (slashPos > 0) ? rest.substring(0, slashPos).toInt() : -1;
+        if (slashPos <= 0 || !isValidFanChannel(channel) || String(channel) != rest.substring(0, slashPos)) {
+            if (serialDebugEnabled) Serial.printf("[MQTT_CMD_ERR] Invalid fan channel in topic %s.\n", topic);
+            return;
+        }
+        handleFanChannelCommand(channel, rest.substring(slashPos + 1), messageTemp);
+    }
+    // --- PID Configuration ---
+    else if (topicStr.equals(mqttPidCommandTopic)) {
+        ArduinoJson::JsonDocument pidDoc;
+        DeserializationError error = deserializeJson(pidDoc, messageTemp);
+        if (error) { if(serialDebugEnabled) Serial.printf("[MQTT_CMD_ERR] deserializeJson() for PID config failed: %s\n", error.c_str()); return; }
+        ControlCommand cmd = makeControlCommand(CMD_SET_PID, ALL_FAN_CHANNELS, CMD_SOURCE_MQTT); // Missing fields keep their value
+        cmd.params[0] = pidDoc["setpoint"] | NAN;
+        cmd.params[1] = pidDoc["kp"] | NAN;
+        cmd.params[2] = pidDoc["ki"] | NAN;
+        cmd.params[3] = pidDoc["kd"] | NAN;
+        enqueueControlCommand(cmd);
+    }
+    // --- Output Conditioning ---
+    else if (topicStr.equals(mqttOutputCommandTopic)) {
+        ArduinoJson::JsonDocument outDoc;
+        DeserializationError error = deserializeJson(outDoc, messageTemp);
+        if (error) { if(serialDebugEnabled) Serial.printf("[MQTT_CMD_ERR] deserializeJson() for output config failed: %s\n", error.c_str()); return; }
+        ControlCommand cmd = makeControlCommand(CMD_SET_OUTPUT_CONFIG, ALL_FAN_CHANNELS, CMD_SOURCE_MQTT); // Missing fields keep their value
+        cmd.params[0] = outDoc["rampUp"] | NAN;
+        cmd.params[1] = outDoc["rampDown"] | NAN;
+        cmd.params[2] = outDoc["hysteresis"] | NAN;
+        enqueueControlCommand(cmd);
+    }
     // --- System & Sensible Config Commands ---
     else if (topicStr.equals(mqttDiscoveryConfigCommandTopic)) { // For isMqttDiscoveryEnabled
         bool newSetting = messageTemp.equalsIgnoreCase("ON");
         if (isMqttDiscoveryEnabled != newSetting) {
-            isMqttDiscoveryEnabled = newSetting; saveMqttDiscoveryConfig(); rebootNeeded = true; needsImmediateBroadcast = true;
+            isMqttDiscoveryEnabled = newSetting; requestNvsSave(NVS_SECTION_MQTT_DISCOVERY); rebootNeeded = true; needsImmediateBroadcast = true;
             if (serialDebugEnabled) Serial.printf("[MQTT_CMD] MQTT Discovery setting set to %s. Reboot needed.\n", isMqttDiscoveryEnabled ? "Enabled" : "Disabled");
         }
     } else if (topicStr.equals(mqttRebootCommandTopic)) {
-        if (messageTemp.equalsIgnoreCase("REBOOT")) { if (serialDebugEnabled) Serial.println("[MQTT_CMD] Reboot command received."); delay(500); ESP.restart(); }
+        if (messageTemp.equalsIgnoreCase("REBOOT")) { if (serialDebugEnabled) Serial.println("[MQTT_CMD] Reboot command received."); flushNvsSaves(); delay(500); ESP.restart(); }
     } else if (topicStr.equals(mqttDiscoveryPrefixSetCommandTopic)) { 
         if (messageTemp.length() < sizeof(mqttDiscoveryPrefix)) {
             // Basic validation for prefix (e.g., no spaces, valid MQTT topic characters) could be added here.
             // For now, just check length.
             if (strcmp(mqttDiscoveryPrefix, messageTemp.c_str()) != 0) {
                 strcpy(mqttDiscoveryPrefix, messageTemp.c_str()); 
-                saveMqttDiscoveryConfig(); 
+                requestNvsSave(NVS_SECTION_MQTT_DISCOVERY); 
                 rebootNeeded = true; 
                 needsImmediateBroadcast = true;
                 if (serialDebugEnabled) Serial.printf("[MQTT_CMD] MQTT Discovery Prefix set to '%s'. Reboot needed.\n", mqttDiscoveryPrefix);
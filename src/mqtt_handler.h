@@ -13,6 +13,8 @@ extern String mqttFanCurveGetTopic;
 extern String mqttFanCurveStatusTopic; 
 extern String mqttFanCurveSetTopic;    
 extern String mqttFanCommandTopic;     
+extern String mqttPidCommandTopic;
+extern String mqttChannelTopicPrefix; // Per-fan topics: <prefix><channel>/<command>
 
 // Topics for controllable entities (settings that make sense to control via HA)
 extern String mqttDiscoveryConfigCommandTopic; // For enabling/disabling discovery (the boolean setting)
@@ -35,8 +37,10 @@ extern String mqttDiscoveryPrefixSetCommandTopic; // To set the discovery prefix
 void setupMQTT();
 void connectMQTT();
 void loopMQTT();
-void publishStatusMQTT();
-void publishFanCurveMQTT(); 
+void publishStatusMQTT(const ControllerState& state);
+void publishFanCurveMQTT(const ControllerState& state); // Legacy fancurve/status (channel 0) plus channel/<N>/fancurve/status
+String getFanChannelTopic(int channel, const char* command);
+void handleFanChannelCommand(int channel, const String& command, const String& message); // channel may be ALL_FAN_CHANNELS
 void mqttCallback(char* topic, byte* payload, unsigned int length);
 void publishMqttAvailability(bool available);
 void publishMqttDiscovery(); 
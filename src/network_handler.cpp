@@ -1,41 +1,211 @@
 #include "network_handler.h"
 #include "config.h"      
 #include "nvs_handler.h" 
+#include "fan_control.h"
+#include "control_commands.h"
 #include <SPIFFS.h>
 #include <ArduinoJson.h> 
 #include "ota_updater.h" // For triggerOTAUpdateCheck
+#include "wifi_manager.h"
+#include "byte_rate.h"
+#include "telemetry_frame.h"
+#include "status_memory.h"
+#include "tasks.h"
+#include "web_assets.h"
+#include "http_cache.h"
+#include <atomic>
 
-void broadcastWebSocketData() {
-    if (!isWiFiEnabled || WiFi.status() != WL_CONNECTED) return;
-    
-    ArduinoJson::JsonDocument jsonDoc; 
+// Two streams. Telemetry (temperature, duty, RPM, modes, counters): a client first gets
+// {"type":"full","seq":n,...} with every field, then {"type":"delta","seq":n+1,...} with only the fields
+// that changed ("channels" entries carry only their changed fields; a field that disappeared is sent as
+// null). A client that sees a gap in seq sends {"action":"resync"} and gets a new full snapshot.
+// Configuration (curves, PID/output settings, MQTT, firmware version): {"type":"config",...}, sent whole on
+// connect and when it changes. A fingerprint of its inputs decides that, so it is not serialized otherwise.
+// Binary telemetry (opt-in, ws://host/ws?format=binary or {"action":"hello","format":"binary"}): the
+// client gets the same config and first full snapshot, then a telemetry_frame.h frame whenever one of its
+// fields changed instead of the JSON deltas, plus a JSON snapshot every WS_BINARY_SNAPSHOT_INTERVAL_MS for
+// the slow fields (counters, OTA message, calibration results) the frame leaves out.
+// Documents and messages live in status_memory.h arenas and buffers, so a broadcast does not use the heap.
+static ArduinoJson::JsonDocument wsBaseline(statusBaselineAllocator()); // Last telemetry sent; snapshots carry this
+static bool wsHaveBaseline = false;
+static uint32_t wsSeq = 0;
+static char wsConfigMessage[STATUS_TEXT_BUFFER_SIZE]; // Serialized once per change, replayed to each new client
+static size_t wsConfigLength = 0;
+static uint32_t wsConfigFingerprint = 0;
+static uint32_t wsConfigVersion = 0; // Counts rebuilt config messages (/events clients compare it)
+static ByteRate wsSentRate;   // Bytes actually sent (everything, times receiving clients)
+static ByteRate wsFullRate;   // What sending one combined full document on every broadcast would cost
+static uint32_t wsBroadcastAvgUs = 0; // Build, serialization and send per broadcast (EWMA, 1/8 weight)
+static uint8_t wsFrame[TELEMETRY_FRAME_MAX_SIZE]; // Last binary frame sent, replayed to new binary clients
+static size_t wsFrameLength = 0;
+static unsigned long wsBinarySnapshotMs = 0;
+static const unsigned long WS_BINARY_SNAPSHOT_INTERVAL_MS = 10000;
 
-    if (tempSensorFound) {
-        jsonDoc["temperature"] = currentTemperature;
-    } else {
-        jsonDoc["temperature"] = nullptr; 
+// Clients as networkTask knows them (connects and disconnects arrive through the inbox)
+static const size_t WS_MAX_CLIENTS = 8; // As AsyncWebSocket's default; older clients are closed beyond it
+struct WsClientSlot {
+    uint32_t id;
+    bool used;
+    bool binary; // Asked for binary telemetry
+};
+static WsClientSlot wsClients[WS_MAX_CLIENTS];
+static uint32_t wsBinaryCount = 0;
+static unsigned long wsCleanupMs = 0;
+
+// Send targets besides a single client id (AsyncWebSocket ids count up from 1)
+static const uint32_t WS_TO_ALL = 0xFFFFFFFF;
+static const uint32_t WS_TO_JSON = 0xFFFFFFFE;   // Clients on JSON telemetry
+static const uint32_t WS_TO_BINARY = 0xFFFFFFFD; // Clients on binary telemetry
+
+// AsyncWebSocket events arrive in the AsyncTCP task. webSocketEvent() only copies them into this queue and
+// wakes networkTask, which handles them in serviceWebSocketInbox(), so the broadcast state, the status arenas
+// and the settings the actions change keep networkTask as their only user.
+enum WsInboxType : uint8_t { WS_INBOX_CONNECT, WS_INBOX_DISCONNECT, WS_INBOX_TEXT };
+const size_t WS_INBOX_TEXT_MAX = 512; // Longest command (setCurve, setMqttConfig) with room to spare
+const UBaseType_t WS_INBOX_DEPTH = 8;
+struct WsInboxEvent {
+    uint32_t clientId;
+    WsInboxType type;
+    bool binary;        // Connect: opened with ?format=binary
+    uint16_t length;
+    char text[WS_INBOX_TEXT_MAX];
+};
+static StaticQueue_t wsInboxQueue;
+static uint8_t wsInboxStorage[WS_INBOX_DEPTH * sizeof(WsInboxEvent)];
+static QueueHandle_t wsInbox = nullptr;
+
+// REST API (/api/status, /api/curve, /api/config): the documents the WebSocket sends, over plain HTTP.
+// The AsyncTCP task parks each request (pause()) in a slot and wakes networkTask, which answers it from the
+// state it owns: at once, or, for a ?wait=<s> request whose If-None-Match is still current, when the
+// document changes or the wait runs out (304). A slot changes hands through its used flag: only the
+// AsyncTCP task sets it, only networkTask clears it.
+enum ApiResource : uint8_t { API_STATUS, API_CURVE, API_CONFIG };
+static const size_t API_MAX_PENDING = 8;  // Waiting long-polls included; more get 503
+static const uint32_t API_MAX_WAIT_S = 30;
+struct ApiRequestSlot {
+    AsyncWebServerRequestPtr request;
+    ApiResource resource;
+    uint32_t receivedMs;
+    uint32_t waitMs;
+    char ifNoneMatch[64]; // Empty when absent or too long to name one of our ETags
+    std::atomic<bool> used;
+};
+static ApiRequestSlot apiSlots[API_MAX_PENDING];
+static uint32_t apiBootId = 0; // Part of the status ETag, since seq starts over with every boot
+static volatile uint32_t apiResponses = 0;
+static volatile uint32_t apiNotModified = 0;
+static volatile uint32_t apiRejected = 0;
+static bool apiStatusWaiting = false; // networkTask only
+
+// Server-Sent Events (/events): the telemetry stream for read-only clients. Events are "config" (on connect
+// and change), "full" (snapshot) and "delta", the last two with id = telemetry seq. A client gets at most
+// one telemetry event per SSE_CLIENT_MIN_INTERVAL_MS; deltas it misses to the rate cap or a full queue are
+// replaced by a snapshot once it may send again. A client with SSE_CLIENT_MAX_QUEUED messages waiting in
+// AsyncTCP gets nothing more, and is closed after SSE_CLIENT_STALL_DROP_MS without draining.
+// AsyncEventSource deletes a client right after onDisconnect, so the slots and every use of their client
+// pointer are under sseLock (recursive: a close() may disconnect the client on the spot, and the library
+// then takes its client list lock). onConnect runs under that list lock, so it must never wait for sseLock:
+// it only drops the client into ssePending, which networkTask moves into a slot under sseLock.
+static const size_t SSE_SLOT_COUNT = SSE_MAX_CLIENTS + 4; // Extra slots hold refused clients until closed
+struct SseClientSlot {
+    AsyncEventSourceClient* client; // nullptr: free
+    uint32_t seq;                   // Telemetry seq the client is at (valid once synced)
+    uint32_t configVersion;         // wsConfigVersion it last got; 0: none yet
+    unsigned long lastSendMs;       // Last telemetry event
+    unsigned long stalledSinceMs;   // 0 while its queue has room
+    uint32_t queued;                // Messages waiting, as of the last check
+    bool synced;                    // Has a snapshot, so deltas apply
+    bool refused;                   // Over SSE_MAX_CLIENTS: closed by networkTask
+    bool closing;
+};
+static SseClientSlot sseClients[SSE_SLOT_COUNT];
+static SemaphoreHandle_t sseLock = nullptr;
+static std::atomic<AsyncEventSourceClient*> ssePending[SSE_SLOT_COUNT]; // Set by onConnect, taken under sseLock
+static std::atomic<uint32_t> ssePendingOverflow(0); // Connects that found ssePending full (never served)
+static uint32_t sseRefused = 0; // sseLock
+static EventStreamStats sseStats;
+
+// FNV-1a
+static uint32_t hashBytes(uint32_t hash, const void* data, size_t length) {
+    const uint8_t* bytes = (const uint8_t*)data;
+    for (size_t i = 0; i < length; i++) {
+        hash ^= bytes[i];
+        hash *= 16777619u;
     }
-    jsonDoc["tempSensorFound"] = tempSensorFound; 
-    jsonDoc["fanSpeed"] = fanSpeedPercentage;
-    jsonDoc["isAutoMode"] = isAutoMode;
-    jsonDoc["manualFanSpeed"] = manualFanSpeedPercentage;
-    jsonDoc["fanRpm"] = fanRpm;
-    jsonDoc["isWiFiEnabled"] = isWiFiEnabled; 
-    jsonDoc["serialDebugEnabled"] = serialDebugEnabled; 
-    jsonDoc["firmwareVersion"] = FIRMWARE_VERSION; // Send current firmware version
+    return hash;
+}
 
-    // OTA Status
-    jsonDoc["otaInProgress"] = ota_in_progress;
-    jsonDoc["otaStatusMessage"] = ota_status_message;
+static uint32_t hashString(uint32_t hash, const char* text) {
+    return hashBytes(hash, text, strlen(text) + 1);
+}
 
+static uint32_t curveFingerprint(const ControllerState& state) {
+    return controllerStateCurveFingerprint(&state, NUM_FAN_CHANNELS);
+}
 
-    ArduinoJson::JsonArray curveArray = jsonDoc["fanCurve"].to<ArduinoJson::JsonArray>();
-    for (int i = 0; i < numCurvePoints; i++) {
+// Covers every input of fillConfigDocument() except constants
+static uint32_t configFingerprint(const ControllerState& state) {
+    uint32_t hash = 2166136261u;
+    const bool flags[] = {isWiFiEnabled, serialDebugEnabled, isMqttEnabled, isMqttDiscoveryEnabled};
+    hash = hashBytes(hash, flags, sizeof(flags));
+    const float settings[] = {state.pidSetpointC, state.pidKp, state.pidKi, state.pidKd,
+                              state.rampUpPercentPerS, state.rampDownPercentPerS, state.hysteresisC};
+    hash = hashBytes(hash, settings, sizeof(settings));
+    hash = hashBytes(hash, &mqttPort, sizeof(mqttPort));
+    hash = hashString(hash, mqttServer);
+    hash = hashString(hash, mqttUser);
+    hash = hashString(hash, mqttBaseTopic);
+    hash = hashString(hash, mqttDiscoveryPrefix);
+    for (int ch = 0; ch < NUM_FAN_CHANNELS; ch++) {
+        const ControllerChannelSnapshot& fan = state.channels[ch];
+        hash = hashBytes(hash, &fan.hasTach, sizeof(fan.hasTach));
+        hash = hashBytes(hash, &fan.curveNumPoints, sizeof(fan.curveNumPoints));
+        hash = hashBytes(hash, fan.curveTemp, fan.curveNumPoints);
+        hash = hashBytes(hash, fan.curvePwm, fan.curveNumPoints);
+    }
+    return hash;
+}
+
+static void fillCurveArray(ArduinoJson::JsonArray curveArray, const ControllerChannelSnapshot& fan) {
+    for (int i = 0; i < fan.curveNumPoints; i++) {
         ArduinoJson::JsonObject point = curveArray.add<ArduinoJson::JsonObject>();
-        point["temp"] = tempPoints[i];
-        point["pwmPercent"] = pwmPercentagePoints[i];
+        point["temp"] = fan.curveTemp[i];
+        point["pwmPercent"] = fan.curvePwm[i];
+    }
+}
+
+// {"channels":[{"fanCurve":[...]},...]}, the curves as the config document carries them (/api/curve)
+static void fillCurveDocument(ArduinoJson::JsonDocument& jsonDoc, const ControllerState& state) {
+    ArduinoJson::JsonArray channelsArray = jsonDoc["channels"].to<ArduinoJson::JsonArray>();
+    for (int ch = 0; ch < NUM_FAN_CHANNELS; ch++) {
+        ArduinoJson::JsonObject channel = channelsArray.add<ArduinoJson::JsonObject>();
+        fillCurveArray(channel["fanCurve"].to<ArduinoJson::JsonArray>(), state.channels[ch]);
+    }
+}
+
+static void fillConfigDocument(ArduinoJson::JsonDocument& jsonDoc, const ControllerState& state) {
+    jsonDoc["type"] = "config";
+    jsonDoc["firmwareVersion"] = FIRMWARE_VERSION; // Send current firmware version
+    jsonDoc["isWiFiEnabled"] = isWiFiEnabled; 
+    jsonDoc["serialDebugEnabled"] = serialDebugEnabled; 
+    jsonDoc["numFanChannels"] = NUM_FAN_CHANNELS;
+    ArduinoJson::JsonArray channelsArray = jsonDoc["channels"].to<ArduinoJson::JsonArray>();
+    for (int ch = 0; ch < NUM_FAN_CHANNELS; ch++) {
+        const ControllerChannelSnapshot& fan = state.channels[ch];
+        ArduinoJson::JsonObject channel = channelsArray.add<ArduinoJson::JsonObject>();
+        channel["hasTach"] = fan.hasTach;
+        fillCurveArray(channel["fanCurve"].to<ArduinoJson::JsonArray>(), fan);
     }
 
+    jsonDoc["pidSetpoint"] = state.pidSetpointC;
+    jsonDoc["pidKp"] = state.pidKp;
+    jsonDoc["pidKi"] = state.pidKi;
+    jsonDoc["pidKd"] = state.pidKd;
+
+    jsonDoc["rampUpPercentPerS"] = state.rampUpPercentPerS;
+    jsonDoc["rampDownPercentPerS"] = state.rampDownPercentPerS;
+    jsonDoc["hysteresisC"] = state.hysteresisC;
+
     jsonDoc["isMqttEnabled"] = isMqttEnabled;
     jsonDoc["mqttServer"] = mqttServer;
     jsonDoc["mqttPort"] = mqttPort;
@@ -43,39 +213,406 @@ void broadcastWebSocketData() {
     jsonDoc["mqttBaseTopic"] = mqttBaseTopic;
     jsonDoc["isMqttDiscoveryEnabled"] = isMqttDiscoveryEnabled;
     jsonDoc["mqttDiscoveryPrefix"] = mqttDiscoveryPrefix;
+}
 
+static void fillTelemetryDocument(ArduinoJson::JsonDocument& jsonDoc, const ControllerState& state) {
+    if (state.tempSensorFound) {
+        jsonDoc["temperature"] = state.temperature;
+    } else {
+        jsonDoc["temperature"] = nullptr; 
+    }
+    jsonDoc["tempSensorFound"] = state.tempSensorFound; 
 
-    String jsonString;
-    serializeJson(jsonDoc, jsonString);
-    webSocket.broadcastTXT(jsonString);
+    // OTA Status
+    char otaMessage[96];
+    copyOtaStatusMessage(otaMessage, sizeof(otaMessage));
+    jsonDoc["otaInProgress"] = ota_in_progress;
+    jsonDoc["otaStatusMessage"] = otaMessage;
+    if (ota_in_progress) {
+        jsonDoc["otaBytes"] = otaProgress.bytesDone;
+        jsonDoc["otaTotalBytes"] = otaProgress.bytesTotal;
+        jsonDoc["otaPercent"] = otaProgressPercent(&otaProgress);
+        jsonDoc["otaBytesPerS"] = otaProgress.bytesPerSec;
+        if (otaProgress.etaS != OTA_PROGRESS_ETA_UNKNOWN) jsonDoc["otaEtaS"] = otaProgress.etaS;
+    }
+
+    ArduinoJson::JsonArray channelsArray = jsonDoc["channels"].to<ArduinoJson::JsonArray>();
+    for (int ch = 0; ch < NUM_FAN_CHANNELS; ch++) {
+        const ControllerChannelSnapshot& fan = state.channels[ch];
+        ArduinoJson::JsonObject channel = channelsArray.add<ArduinoJson::JsonObject>();
+        channel["fanSpeed"] = fan.speedPercent;
+        channel["isAutoMode"] = fan.isAutoMode;
+        channel["isPidMode"] = fan.isPidMode;
+        channel["isRpmMode"] = fan.isRpmMode;
+        channel["targetRpm"] = fan.targetRpm;
+        channel["rpmModelPoints"] = fan.rpmModelPoints;
+        channel["calStatus"] = fan.calibrationStatus;
+        channel["calStartDuty"] = fan.calStartDuty;
+        channel["calStallDuty"] = fan.calStallDuty;
+        channel["calMaxRpm"] = fan.calMaxRpm;
+        channel["manualFanSpeed"] = fan.manualSpeedPercent;
+        channel["fanRpm"] = fan.rpm;
+    }
+
+    jsonDoc["fanOutputWrites"] = state.outputWrites;
+    jsonDoc["suppressedOutputChanges"] = state.suppressedOutputChanges;
+    jsonDoc["suppressedBroadcasts"] = state.suppressedBroadcasts;
+    jsonDoc["cmdApplied"] = state.commandsApplied;
+    jsonDoc["cmdDropped"] = state.commandsDropped;
+    jsonDoc["cmdQueueMaxDepth"] = state.commandQueueMaxDepth;
+    jsonDoc["cmdLatencyAvgUs"] = state.commandLatencyAvgUs;
+    jsonDoc["cmdLatencyMaxUs"] = state.commandLatencyMaxUs;
+    jsonDoc["cmdToPwmP50Us"] = state.commandToOutputP50Us;
+    jsonDoc["cmdToPwmP99Us"] = state.commandToOutputP99Us;
+    jsonDoc["cmdToPwmMaxUs"] = state.commandToOutputMaxUs;
+    jsonDoc["ctlPeriodMinUs"] = state.controlPeriodMinUs;
+    jsonDoc["ctlPeriodMaxUs"] = state.controlPeriodMaxUs;
+    jsonDoc["ctlJitterP99Us"] = state.controlJitterP99Us;
+    jsonDoc["ctlJitterMaxUs"] = state.controlJitterMaxUs;
+    jsonDoc["ctlExecMaxUs"] = state.controlExecMaxUs;
+    jsonDoc["ctlOverruns"] = state.controlOverruns;
+    jsonDoc["nvsWrites"] = state.nvsWrites;
+    jsonDoc["nvsWritesAvoided"] = state.nvsWritesAvoided;
+    jsonDoc["nvsBytesWritten"] = state.nvsBytesWritten;
+    jsonDoc["nvsPending"] = state.nvsPending;
+    const WifiLink* wifiLink = getWifiLink();
+    jsonDoc["wifiBootOnlineMs"] = wifiLink->firstOnlineMs;
+    jsonDoc["wifiLastConnectMs"] = wifiLink->lastConnectMs;
+    jsonDoc["wifiFastJoin"] = wifiLink->attemptIsFast != 0;
+    jsonDoc["wifiDrops"] = wifiLink->drops;
+    jsonDoc["wsBytesPerMin"] = byteRatePerMinute(&wsSentRate, millis());
+    jsonDoc["wsFullBytesPerMin"] = byteRatePerMinute(&wsFullRate, millis());
+    jsonDoc["wsBroadcastAvgUs"] = wsBroadcastAvgUs;
+    StatusMemoryStats memory;
+    getStatusMemoryStats(&memory);
+    jsonDoc["heapFree"] = memory.heapFree;
+    jsonDoc["heapMinFree"] = memory.heapMinFree;
+    jsonDoc["heapLargestBlock"] = memory.heapLargestBlock;
+    jsonDoc["heapFragPct"] = memory.heapFragPercent;
+    jsonDoc["jsonArenaPeak"] = memory.arenaPeakBytes;
+    jsonDoc["jsonArenaSize"] = memory.arenaCapacity;
+    jsonDoc["statusDropped"] = memory.dropped;
+    jsonDoc["sseClients"] = sseStats.clients;
+    jsonDoc["sseQueueMax"] = sseStats.queueMax;
+    jsonDoc["sseDropped"] = sseStats.dropped;
+    jsonDoc["sseSkipped"] = sseStats.skipped;
+}
+
+// Copies into delta the fields of current that differ from wsBaseline; returns false when nothing changed
+static bool buildWebSocketDelta(ArduinoJson::JsonDocument& delta, const ArduinoJson::JsonDocument& current) {
+    bool changed = false;
+    ArduinoJson::JsonObjectConst now = current.as<ArduinoJson::JsonObjectConst>();
+    ArduinoJson::JsonObjectConst before = wsBaseline.as<ArduinoJson::JsonObjectConst>();
+    for (ArduinoJson::JsonPairConst field : now) {
+        ArduinoJson::JsonVariantConst old = before[field.key()];
+        if (strcmp(field.key().c_str(), "channels") == 0) {
+            ArduinoJson::JsonArrayConst nowChannels = field.value();
+            ArduinoJson::JsonArrayConst oldChannels = old;
+            if (nowChannels.size() != oldChannels.size()) { // Layout changed: send the channels whole
+                delta["channels"] = field.value();
+                changed = true;
+                continue;
+            }
+            ArduinoJson::JsonArray outChannels = delta["channels"].to<ArduinoJson::JsonArray>();
+            bool channelsChanged = false;
+            for (size_t ch = 0; ch < nowChannels.size(); ch++) {
+                ArduinoJson::JsonObject outChannel = outChannels.add<ArduinoJson::JsonObject>();
+                for (ArduinoJson::JsonPairConst channelField : nowChannels[ch].as<ArduinoJson::JsonObjectConst>()) {
+                    if (oldChannels[ch][channelField.key()] != channelField.value()) {
+                        outChannel[channelField.key()] = channelField.value();
+                        channelsChanged = true;
+                    }
+                }
+            }
+            if (channelsChanged) changed = true;
+            else delta.remove("channels");
+        } else if (old != field.value()) {
+            delta[field.key()] = field.value();
+            changed = true;
+        }
+    }
+    for (ArduinoJson::JsonPairConst field : before) { // e.g. the OTA progress fields once an update ends
+        if (now[field.key()].isNull() && !field.value().isNull()) {
+            delta[field.key()] = nullptr;
+            changed = true;
+        }
+    }
+    return changed;
+}
+
+static WsClientSlot* findWsClient(uint32_t id) {
+    for (WsClientSlot& slot : wsClients) {
+        if (slot.used && slot.id == id) return &slot;
+    }
+    return nullptr;
+}
+
+static bool isBinaryClient(uint32_t id) {
+    WsClientSlot* slot = findWsClient(id);
+    return slot && slot->binary;
+}
+
+static void setWebSocketBinary(uint32_t id, bool binary) {
+    WsClientSlot* slot = findWsClient(id);
+    if (!slot || slot->binary == binary) return;
+    slot->binary = binary;
+    if (binary) wsBinaryCount++;
+    else wsBinaryCount--;
+}
+
+static bool isWebSocketGroup(uint32_t target) {
+    return target == WS_TO_ALL || target == WS_TO_JSON || target == WS_TO_BINARY;
+}
+
+static bool inWebSocketGroup(uint32_t target, const WsClientSlot& slot) {
+    return slot.used && (target == WS_TO_ALL || slot.binary == (target == WS_TO_BINARY));
+}
+
+// Sends to one client (by id) or a WS_TO_* group and counts the bytes; returns the receivers.
+// AsyncWebSocket queues the message and the AsyncTCP task writes it out.
+static uint32_t sendWebSocketText(uint32_t target, const char* message, size_t length) {
+    if (length == 0) return 0;
+    uint32_t receivers = 0;
+    if (!isWebSocketGroup(target)) {
+        if (webSocket.text(target, message, length)) receivers = 1;
+    } else if (target == WS_TO_ALL || (target == WS_TO_JSON && wsBinaryCount == 0)) {
+        webSocket.textAll(message, length); // One shared copy for every client
+        receivers = webSocket.count();
+    } else {
+        for (const WsClientSlot& slot : wsClients) {
+            if (inWebSocketGroup(target, slot) && webSocket.text(slot.id, message, length)) receivers++;
+        }
+    }
+    byteRateAdd(&wsSentRate, length * receivers, millis());
     if (serialDebugEnabled && millis() % 60000 < 100) { 
         // Avoid printing very long JSON strings too often if they become large
-        if (jsonString.length() < 256) {
-             Serial.print("[WS_BCAST] "); Serial.println(jsonString);
+        if (length < 256) {
+             Serial.print("[WS_BCAST] "); Serial.println(message);
         } else {
-             Serial.print("[WS_BCAST] Sent (length: "); Serial.print(jsonString.length()); Serial.println(")");
+             Serial.print("[WS_BCAST] Sent (length: "); Serial.print(length); Serial.println(")");
         }
     }
+    return receivers;
 }
 
-void webSocketEvent(uint8_t num, WStype_t type, uint8_t * payload, size_t length) {
+static void sendWebSocketFrame(uint32_t target) {
+    if (wsFrameLength == 0) return;
+    uint32_t receivers = 0;
+    if (!isWebSocketGroup(target)) {
+        if (webSocket.binary(target, wsFrame, wsFrameLength)) receivers = 1;
+    } else {
+        for (const WsClientSlot& slot : wsClients) {
+            if (inWebSocketGroup(target, slot) && webSocket.binary(slot.id, wsFrame, wsFrameLength)) receivers++;
+        }
+    }
+    byteRateAdd(&wsSentRate, wsFrameLength * receivers, millis());
+}
+
+// Encodes the telemetry frame for state; returns false when its content (seq aside) matches the last one
+static bool updateWebSocketFrame(const ControllerState& state) {
+    uint8_t frame[TELEMETRY_FRAME_MAX_SIZE];
+    size_t length = telemetryFrameEncode(&state, NUM_FAN_CHANNELS, wsSeq, ota_in_progress,
+                                         ota_in_progress ? otaProgressPercent(&otaProgress) : 0, frame, sizeof(frame));
+    if (length == 0) return false;
+    bool changed = length != wsFrameLength || memcmp(frame, wsFrame, 4) != 0 || memcmp(frame + 8, wsFrame + 8, length - 8) != 0;
+    memcpy(wsFrame, frame, length);
+    wsFrameLength = length;
+    return changed;
+}
+
+// {"type":"full","seq":n,...} from wsBaseline into the status text buffer; 0 if it did not fit
+static size_t serializeTelemetrySnapshot() {
+    ArduinoJson::JsonDocument snapshot(statusScratchAllocator());
+    snapshot["type"] = "full";
+    snapshot["seq"] = wsSeq;
+    for (ArduinoJson::JsonPairConst field : wsBaseline.as<ArduinoJson::JsonObjectConst>()) snapshot[field.key()] = field.value();
+    return serializeStatusJson(snapshot, statusTextBuffer(), STATUS_TEXT_BUFFER_SIZE);
+}
+
+static void sendWebSocketSnapshot(uint32_t target) {
+    size_t length = serializeTelemetrySnapshot();
+    uint32_t receivers = sendWebSocketText(target, statusTextBuffer(), length);
+    byteRateAdd(&wsFullRate, (length + wsConfigLength) * receivers, millis());
+}
+
+// What a client needs before any delta: the config document, then a telemetry snapshot
+static void sendWebSocketWelcome(uint32_t id) {
+    sendWebSocketText(id, wsConfigMessage, wsConfigLength);
+    if (wsHaveBaseline) sendWebSocketSnapshot(id);
+    if (isBinaryClient(id)) sendWebSocketFrame(id);
+}
+
+static void addWebSocketClient(uint32_t id, bool binary) {
+    for (WsClientSlot& slot : wsClients) {
+        if (slot.used) continue;
+        slot.id = id;
+        slot.used = true;
+        slot.binary = false;
+        setWebSocketBinary(id, binary);
+        return;
+    }
+    if(serialDebugEnabled) Serial.printf("[WS_ERR] Client table full, client %lu gets JSON broadcasts only.\n", (unsigned long)id);
+}
+
+static void removeWebSocketClient(uint32_t id) {
+    setWebSocketBinary(id, false);
+    WsClientSlot* slot = findWsClient(id);
+    if (slot) slot->used = false;
+}
+
+// sseLock held: whether slot may get another message now. Tracks its queue, and closes it once it has
+// been full for SSE_CLIENT_STALL_DROP_MS (slot.client may be cleared by that).
+static bool sseClientReady(SseClientSlot& slot, unsigned long now) {
+    if (slot.closing) return false;
+    slot.queued = slot.client->packetsWaiting();
+    if (slot.queued < SSE_CLIENT_MAX_QUEUED) {
+        slot.stalledSinceMs = 0;
+        return true;
+    }
+    if (slot.stalledSinceMs == 0) {
+        slot.stalledSinceMs = now ? now : 1;
+    } else if (now - slot.stalledSinceMs >= SSE_CLIENT_STALL_DROP_MS) {
+        if(serialDebugEnabled) Serial.printf("[SSE] Client stalled with %lu messages queued, closing it.\n", (unsigned long)slot.queued);
+        sseStats.dropped++;
+        slot.closing = true;
+        slot.client->close();
+    }
+    return false;
+}
+
+// networkTask, from the broadcast: message is the delta for seq wsSeq, sent to clients that are at wsSeq - 1
+static void sendEventDelta(const char* message, size_t length) {
+    if (!sseLock) return;
+    unsigned long now = millis();
+    xSemaphoreTakeRecursive(sseLock, portMAX_DELAY);
+    for (SseClientSlot& slot : sseClients) {
+        if (!slot.client || slot.refused || !slot.synced || slot.seq != wsSeq - 1) continue;
+        if (length == 0 || now - slot.lastSendMs < SSE_CLIENT_MIN_INTERVAL_MS || !sseClientReady(slot, now)) {
+            sseStats.skipped++; // Left behind; serviceEventClients() catches it up with a snapshot
+            continue;
+        }
+        slot.client->send(message, "delta", wsSeq);
+        slot.seq = wsSeq;
+        slot.lastSendMs = now;
+    }
+    xSemaphoreGiveRecursive(sseLock);
+}
+
+void broadcastWebSocketData(const ControllerState& state) {
+    if (!isWiFiEnabled || WiFi.status() != WL_CONNECTED) return;
+    unsigned long broadcastStartUs = micros();
+
+    uint32_t fingerprint = configFingerprint(state);
+    if (wsConfigLength == 0 || fingerprint != wsConfigFingerprint) {
+        ArduinoJson::JsonDocument config(statusScratchAllocator());
+        fillConfigDocument(config, state);
+        wsConfigLength = serializeStatusJson(config, wsConfigMessage, sizeof(wsConfigMessage));
+        wsConfigFingerprint = fingerprint; // Retried on the next broadcast if it did not fit
+        if (wsConfigLength) wsConfigVersion++;
+        sendWebSocketText(WS_TO_ALL, wsConfigMessage, wsConfigLength);
+    }
+
+    ArduinoJson::JsonDocument current(statusScratchAllocator());
+    fillTelemetryDocument(current, state);
+    uint32_t receivers = webSocket.count();
+    if (!wsHaveBaseline) {
+        wsBaseline.set(current); // Not operator=, which would move the copy into the scratch arena
+        wsHaveBaseline = true;
+        sendWebSocketSnapshot(WS_TO_ALL);
+        updateWebSocketFrame(state);
+        sendWebSocketFrame(WS_TO_BINARY);
+        wsBinarySnapshotMs = millis();
+    } else {
+        ArduinoJson::JsonDocument delta(statusScratchAllocator());
+        if (buildWebSocketDelta(delta, current)) { // Otherwise nothing a client shows changed
+            delta["type"] = "delta";
+            delta["seq"] = ++wsSeq;
+            char* message = statusTextBuffer();
+            size_t length = serializeStatusJson(delta, message, STATUS_TEXT_BUFFER_SIZE);
+            sendWebSocketText(WS_TO_JSON, message, length);
+            sendEventDelta(message, length);
+            if (updateWebSocketFrame(state)) sendWebSocketFrame(WS_TO_BINARY);
+            byteRateAdd(&wsFullRate, (measureJson(current) + wsConfigLength) * receivers, millis());
+            wsBaseline.set(current);
+        }
+        if (wsBinaryCount != 0 && millis() - wsBinarySnapshotMs >= WS_BINARY_SNAPSHOT_INTERVAL_MS) {
+            sendWebSocketSnapshot(WS_TO_BINARY);
+            wsBinarySnapshotMs = millis();
+        }
+    }
+    uint32_t broadcastUs = micros() - broadcastStartUs;
+    wsBroadcastAvgUs = wsBroadcastAvgUs == 0 ? broadcastUs : wsBroadcastAvgUs + ((int32_t)(broadcastUs - wsBroadcastAvgUs)) / 8;
+}
+
+uint32_t getWebSocketBroadcastAvgUs() {
+    return wsBroadcastAvgUs;
+}
+
+void getWebSocketWireRates(uint32_t* sentBytesPerMin, uint32_t* fullBytesPerMin) {
+    *sentBytesPerMin = byteRatePerMinute(&wsSentRate, millis());
+    *fullBytesPerMin = byteRatePerMinute(&wsFullRate, millis());
+}
+
+// AsyncTCP task: copy and hand over, nothing else
+void webSocketEvent(AsyncWebSocket* socket, AsyncWebSocketClient* client, AwsEventType type, void* arg, uint8_t* data, size_t length) {
+    static WsInboxEvent event; // Only the AsyncTCP task calls this
+    event.clientId = client->id();
+    event.binary = false;
+    event.length = 0;
+    if (type == WS_EVT_CONNECT) {
+        event.type = WS_INBOX_CONNECT;
+        AsyncWebServerRequest* request = (AsyncWebServerRequest*)arg; // The upgrade request
+        const AsyncWebParameter* format = request ? request->getParam("format") : nullptr;
+        event.binary = format && format->value() == "binary";
+    } else if (type == WS_EVT_DISCONNECT) {
+        event.type = WS_INBOX_DISCONNECT;
+    } else if (type == WS_EVT_DATA) {
+        AwsFrameInfo* info = (AwsFrameInfo*)arg;
+        // Commands are small single-frame text messages
+        if (!info->final || info->index != 0 || info->len != length || info->opcode != WS_TEXT) return;
+        if (length >= sizeof(event.text)) {
+            if(serialDebugEnabled) Serial.printf("[WS_ERR] Message from client %lu too long (%u bytes), ignored.\n", (unsigned long)event.clientId, (unsigned)length);
+            return;
+        }
+        event.type = WS_INBOX_TEXT;
+        memcpy(event.text, data, length);
+        event.text[length] = '\0';
+        event.length = length;
+    } else {
+        return;
+    }
+    if (!wsInbox || xQueueSend(wsInbox, &event, 0) != pdTRUE) {
+        if(serialDebugEnabled) Serial.printf("[WS_ERR] Inbox full, event from client %lu dropped.\n", (unsigned long)event.clientId);
+        if (type == WS_EVT_CONNECT) client->close(); // It reconnects and is welcomed then
+        return;
+    }
+    wakeNetworkTask(NETWORK_TASK_WAKE_WEBSOCKET);
+}
+
+static void handleWebSocketEvent(const WsInboxEvent& event) {
     if (!isWiFiEnabled) return; 
+    uint32_t id = event.clientId;
 
-    switch(type) {
-        case WStype_DISCONNECTED:
-            if(serialDebugEnabled) Serial.printf("[WS][%u] Client Disconnected!\n", num);
+    switch(event.type) {
+        case WS_INBOX_DISCONNECT:
+            if(serialDebugEnabled) Serial.printf("[WS][%lu] Client Disconnected!\n", (unsigned long)id);
+            removeWebSocketClient(id);
             break;
-        case WStype_CONNECTED: {
-            IPAddress ip = webSocket.remoteIP(num);
-            if(serialDebugEnabled) Serial.printf("[WS][%u] Client Connected from %s, URL: %s\n", num, ip.toString().c_str(), (char *)payload);
+        case WS_INBOX_CONNECT: {
+            AsyncWebSocketClient* client = webSocket.client(id);
+            if (!client) break; // Already gone again
+            if(serialDebugEnabled) Serial.printf("[WS][%lu] Client Connected from %s%s\n", (unsigned long)id, client->remoteIP().toString().c_str(),
+                                                 event.binary ? " (binary telemetry)" : "");
+            addWebSocketClient(id, event.binary);
+            sendWebSocketWelcome(id); // Deltas from the next broadcast on apply to this client too
             needsImmediateBroadcast = true; 
             break;
         }
-        case WStype_TEXT: {
-            if(serialDebugEnabled) Serial.printf("[WS][%u] Received Text: %s\n", num, (char *)payload);
+        case WS_INBOX_TEXT: {
+            if(serialDebugEnabled) Serial.printf("[WS][%lu] Received Text: %s\n", (unsigned long)id, event.text);
             ArduinoJson::JsonDocument doc; 
             
-            DeserializationError error = deserializeJson(doc, payload, length);
+            DeserializationError error = deserializeJson(doc, event.text, event.length);
 
             if (error) {
                 if(serialDebugEnabled) Serial.print(F("[WS_ERR] deserializeJson() failed: "));
@@ -85,21 +622,46 @@ void webSocketEvent(uint8_t num, WStype_t type, uint8_t * payload, size_t length
             const char* action = doc["action"];
             if (action) {
                 if(serialDebugEnabled) Serial.printf("[WS] Action received: %s\n", action);
-                if (strcmp(action, "setModeAuto") == 0) {
-                    isAutoMode = true;
-                    needsImmediateBroadcast = true; 
-                    if(serialDebugEnabled) Serial.println("[SYSTEM] Mode changed to AUTO via WebSocket.");
+                // Fan actions take an optional 0-based "channel"; without it they apply to every channel.
+                // Control changes are queued as commands and applied by controlTask on its next tick.
+                int channel = doc["channel"] | ALL_FAN_CHANNELS;
+                bool isFanAction = strcmp(action, "setModeAuto") == 0 || strcmp(action, "setModeManual") == 0 || strcmp(action, "setModePid") == 0 ||
+                                   strcmp(action, "setManualSpeed") == 0 || strcmp(action, "setCurve") == 0 ||
+                                   strcmp(action, "setModeRpm") == 0 || strcmp(action, "resetRpmModel") == 0 ||
+                                   strcmp(action, "startCalibration") == 0 || strcmp(action, "cancelCalibration") == 0 || strcmp(action, "clearCalibration") == 0;
+                if (isFanAction && channel != ALL_FAN_CHANNELS && !isValidFanChannel(channel)) {
+                    if(serialDebugEnabled) Serial.printf("[WS_ERR] Invalid fan channel %d for action %s.\n", channel, action);
+                }
+                else if (strcmp(action, "setModeAuto") == 0) {
+                    enqueueControlCommand(makeControlCommand(CMD_SET_MODE_AUTO, channel, CMD_SOURCE_WEBSOCKET));
+                } else if (strcmp(action, "setModePid") == 0) {
+                    enqueueControlCommand(makeControlCommand(CMD_SET_MODE_PID, channel, CMD_SOURCE_WEBSOCKET));
+                } else if (strcmp(action, "setModeRpm") == 0) {
+                    ControlCommand cmd = makeControlCommand(CMD_SET_RPM_TARGET, channel, CMD_SOURCE_WEBSOCKET);
+                    cmd.value = doc["targetRpm"] | CONTROL_COMMAND_KEEP; // Missing: keep each fan's last target
+                    if (cmd.value > FAN_RPM_TARGET_MAX || cmd.value < CONTROL_COMMAND_KEEP) {
+                        if(serialDebugEnabled) Serial.printf("[WS_ERR] 'setModeRpm' rejected, target %d out of range.\n", (int)cmd.value);
+                    } else {
+                        enqueueControlCommand(cmd);
+                    }
+                } else if (strcmp(action, "resetRpmModel") == 0) {
+                    enqueueControlCommand(makeControlCommand(CMD_RESET_RPM_MODEL, channel, CMD_SOURCE_WEBSOCKET));
+                } else if (strcmp(action, "startCalibration") == 0) {
+                    enqueueControlCommand(makeControlCommand(CMD_CALIBRATION_START, channel, CMD_SOURCE_WEBSOCKET));
+                } else if (strcmp(action, "cancelCalibration") == 0) {
+                    enqueueControlCommand(makeControlCommand(CMD_CALIBRATION_CANCEL, channel, CMD_SOURCE_WEBSOCKET));
+                } else if (strcmp(action, "clearCalibration") == 0) {
+                    enqueueControlCommand(makeControlCommand(CMD_CALIBRATION_CLEAR, channel, CMD_SOURCE_WEBSOCKET));
                 } else if (strcmp(action, "setModeManual") == 0) {
-                    isAutoMode = false;
-                    needsImmediateBroadcast = true; 
-                    if(serialDebugEnabled) Serial.println("[SYSTEM] Mode changed to MANUAL via WebSocket.");
+                    enqueueControlCommand(makeControlCommand(CMD_SET_MODE_MANUAL, channel, CMD_SOURCE_WEBSOCKET));
                 } else if (strcmp(action, "setManualSpeed") == 0) {
-                    if (!isAutoMode) { 
-                        manualFanSpeedPercentage = doc["value"]; 
-                        needsImmediateBroadcast = true; 
-                        if(serialDebugEnabled) Serial.printf("[SYSTEM] Manual speed target set to %d%% via WebSocket.\n", manualFanSpeedPercentage);
+                    int value = doc["value"];
+                    if (value < 0 || value > 100) {
+                        if(serialDebugEnabled) Serial.printf("[WS_ERR] 'setManualSpeed' rejected, %d%% out of range.\n", value);
                     } else {
-                        if(serialDebugEnabled) Serial.println("[WS_WARN] Ignored setManualSpeed, not in manual mode.");
+                        ControlCommand cmd = makeControlCommand(CMD_SET_MANUAL_SPEED, channel, CMD_SOURCE_WEBSOCKET);
+                        cmd.value = value;
+                        enqueueControlCommand(cmd);
                     }
                 } else if (strcmp(action, "setCurve") == 0) {
                     if (!tempSensorFound) {
@@ -111,8 +673,7 @@ void webSocketEvent(uint8_t num, WStype_t type, uint8_t * payload, size_t length
                         if(serialDebugEnabled) Serial.println("[WS] Received new fan curve data.");
                         bool curveValid = true;
                         int lastTemp = -100; 
-                        int tempTempPointsValidation[MAX_CURVE_POINTS];
-                        int tempPwmPercentagePointsValidation[MAX_CURVE_POINTS]; 
+                        ControlCommand cmd = makeControlCommand(CMD_SET_CURVE, channel, CMD_SOURCE_WEBSOCKET);
                         int newNumPoints = newCurve.size();
 
                         for(int k=0; k < newNumPoints; ++k) { // Changed i to k
@@ -130,21 +691,14 @@ void webSocketEvent(uint8_t num, WStype_t type, uint8_t * payload, size_t length
                                 if(serialDebugEnabled) Serial.printf("[WS_ERR] Invalid curve point %d received: Temp=%d, PWM=%d. LastTemp=%d\n", k, t, p, lastTemp);
                                 break;
                             }
-                            tempTempPointsValidation[k] = t;
-                            tempPwmPercentagePointsValidation[k] = p; 
+                            cmd.curveTemp[k] = t;
+                            cmd.curvePwm[k] = p; 
                             lastTemp = t;
                         }
 
                         if (curveValid) {
-                            numCurvePoints = newNumPoints;
-                            for(int k=0; k < numCurvePoints; ++k) { // Changed i to k
-                                tempPoints[k] = tempTempPointsValidation[k];
-                                pwmPercentagePoints[k] = tempPwmPercentagePointsValidation[k]; 
-                            }
-                            if(serialDebugEnabled) Serial.println("[SYSTEM] Fan curve updated and validated via WebSocket.");
-                            saveFanCurveToNVS(); 
-                            fanCurveChanged = true; // Signal MQTT to publish new curve
-                            needsImmediateBroadcast = true; 
+                            cmd.curveNumPoints = newNumPoints;
+                            enqueueControlCommand(cmd);
                         } else {
                             if(serialDebugEnabled) Serial.println("[SYSTEM_ERR] New fan curve from web rejected due to invalid data.");
                         }
@@ -152,6 +706,23 @@ void webSocketEvent(uint8_t num, WStype_t type, uint8_t * payload, size_t length
                          if(serialDebugEnabled) Serial.printf("[WS_ERR] 'setCurve' action received, but 'curve' array missing, invalid, or wrong size (got %d points).\n", newCurve.size());
                     }
                 } 
+                else if (strcmp(action, "setPidConfig") == 0) {
+                    // Missing fields keep their current value (range checked when applied)
+                    ControlCommand cmd = makeControlCommand(CMD_SET_PID, ALL_FAN_CHANNELS, CMD_SOURCE_WEBSOCKET);
+                    cmd.params[0] = doc["setpoint"] | NAN;
+                    cmd.params[1] = doc["kp"] | NAN;
+                    cmd.params[2] = doc["ki"] | NAN;
+                    cmd.params[3] = doc["kd"] | NAN;
+                    enqueueControlCommand(cmd);
+                }
+                else if (strcmp(action, "setOutputConfig") == 0) {
+                    // Missing fields keep their current value (range checked when applied)
+                    ControlCommand cmd = makeControlCommand(CMD_SET_OUTPUT_CONFIG, ALL_FAN_CHANNELS, CMD_SOURCE_WEBSOCKET);
+                    cmd.params[0] = doc["rampUp"] | NAN;
+                    cmd.params[1] = doc["rampDown"] | NAN;
+                    cmd.params[2] = doc["hysteresis"] | NAN;
+                    enqueueControlCommand(cmd);
+                }
                 else if (strcmp(action, "setMqttConfig") == 0) {
                     if (serialDebugEnabled) Serial.println("[WS] Received MQTT configuration update.");
                     
@@ -196,7 +767,7 @@ void webSocketEvent(uint8_t num, WStype_t type, uint8_t * payload, size_t length
 
                     if (changed) {
                         if (serialDebugEnabled) Serial.println("[SYSTEM] MQTT configuration updated via WebSocket. Reboot needed.");
-                        saveMqttConfig();
+                        requestNvsSave(NVS_SECTION_MQTT);
                         rebootNeeded = true; 
                         needsImmediateBroadcast = true; 
                     } else {
@@ -229,7 +800,7 @@ void webSocketEvent(uint8_t num, WStype_t type, uint8_t * payload, size_t length
                     
                     if (changed) {
                         if (serialDebugEnabled) Serial.println("[SYSTEM] MQTT Discovery configuration updated via WebSocket. Reboot needed.");
-                        saveMqttDiscoveryConfig();
+                        requestNvsSave(NVS_SECTION_MQTT_DISCOVERY);
                         rebootNeeded = true;
                         needsImmediateBroadcast = true;
                     } else {
@@ -239,20 +810,36 @@ void webSocketEvent(uint8_t num, WStype_t type, uint8_t * payload, size_t length
                 else if (strcmp(action, "triggerOtaUpdate") == 0) { 
                     if (serialDebugEnabled) Serial.println("[WS] Received OTA Update trigger.");
                     if (ota_in_progress) {
-                        ota_status_message = "OTA already in progress.";
+                        setOtaStatusMessage("OTA already in progress.");
                         needsImmediateBroadcast = true;
-                         if(serialDebugEnabled) Serial.println("[WS_OTA] " + ota_status_message);
+                         if(serialDebugEnabled) Serial.println("[WS_OTA] " + getOtaStatusMessage());
                     } else if (!isWiFiEnabled || WiFi.status() != WL_CONNECTED) {
-                        ota_status_message = "Error: WiFi not connected for OTA.";
+                        setOtaStatusMessage("Error: WiFi not connected for OTA.");
                         needsImmediateBroadcast = true;
-                        if(serialDebugEnabled) Serial.println("[WS_OTA] " + ota_status_message);
+                        if(serialDebugEnabled) Serial.println("[WS_OTA] " + getOtaStatusMessage());
                     } else {
-                        // This function call is blocking. It will run in the networkTask context.
-                        // UI updates for ota_status_message will happen via broadcastWebSocketData
-                        // which is called by needsImmediateBroadcast = true; within ota_updater functions.
+                        // Starts OtaTask and returns; progress reaches the clients through needsImmediateBroadcast
                         triggerOTAUpdateCheck();
                     }
                 }
+                else if (strcmp(action, "resync") == 0) { // Client missed a telemetry delta
+                    if (wsHaveBaseline) sendWebSocketSnapshot(id);
+                    else needsImmediateBroadcast = true;
+                }
+                else if (strcmp(action, "hello") == 0) { // Telemetry format: "binary" or "json" (the default)
+                    const char* format = doc["format"] | "json";
+                    bool binary = strcmp(format, "binary") == 0;
+                    if (binary != isBinaryClient(id)) {
+                        setWebSocketBinary(id, binary);
+                        if (binary) sendWebSocketFrame(id);
+                        else if (wsHaveBaseline) sendWebSocketSnapshot(id); // Deltas resume from here
+                    }
+                }
+                else if (strcmp(action, "ping") == 0) { // Round trip through the AsyncTCP task and networkTask
+                    char pong[48];
+                    int length = snprintf(pong, sizeof(pong), "{\"type\":\"pong\",\"t\":%lu}", (unsigned long)(doc["t"] | 0UL));
+                    sendWebSocketText(id, pong, length);
+                }
                 else {
                     if(serialDebugEnabled) Serial.printf("[WS_ERR] Unknown action received: %s\n", action);
                 }
@@ -261,41 +848,245 @@ void webSocketEvent(uint8_t num, WStype_t type, uint8_t * payload, size_t length
             }
             break;
         }
-        default: 
-            if(serialDebugEnabled) Serial.printf("[WS][%u] Received unhandled WStype: %d\n", num, type);
-            break;
     }
 }
 
-void setupWebServerRoutes() {
-    server.on("/", HTTP_GET, [](AsyncWebServerRequest *request){
-        if(!SPIFFS.exists("/index.html")){
-            if(serialDebugEnabled) Serial.println("SPIFFS: index.html not found!");
-            request->send(404, "text/plain", "index.html not found. Make sure to upload SPIFFS data.");
-            return;
+// Current ETag of resource (unquoted); false while the document does not exist yet
+static bool apiEtag(ApiResource resource, const ControllerState& state, char* out, size_t size) {
+    if (resource == API_STATUS) {
+        if (!wsHaveBaseline) return false;
+        snprintf(out, size, "%08lx-%lu", (unsigned long)apiBootId, (unsigned long)wsSeq);
+    } else if (resource == API_CURVE) {
+        snprintf(out, size, "k%08lx", (unsigned long)curveFingerprint(state));
+    } else {
+        if (wsConfigLength == 0) return false;
+        snprintf(out, size, "c%08lx", (unsigned long)wsConfigFingerprint);
+    }
+    return true;
+}
+
+// The body for resource, null-terminated; nullptr if it did not fit the status text buffer
+static const char* apiDocument(ApiResource resource, const ControllerState& state) {
+    if (resource == API_CONFIG) return wsConfigMessage; // Rebuilt by broadcastWebSocketData() on change
+    size_t length;
+    if (resource == API_STATUS) {
+        length = serializeTelemetrySnapshot();
+    } else {
+        ArduinoJson::JsonDocument curve(statusScratchAllocator());
+        fillCurveDocument(curve, state);
+        length = serializeStatusJson(curve, statusTextBuffer(), STATUS_TEXT_BUFFER_SIZE);
+    }
+    return length ? statusTextBuffer() : nullptr;
+}
+
+static void answerApiRequest(AsyncWebServerRequest* request, HttpPollResult result, ApiResource resource,
+                             const ControllerState& state, const char* etag) {
+    const char* body = result == HTTP_POLL_SEND ? apiDocument(resource, state) : nullptr;
+    if (result == HTTP_POLL_UNAVAILABLE || (result == HTTP_POLL_SEND && !body)) {
+        AsyncWebServerResponse* response = request->beginResponse(503, "application/json", "{\"error\":\"status not available yet\"}");
+        response->addHeader("Retry-After", "1");
+        request->send(response);
+        return;
+    }
+    // The response keeps its own copy of the body, so the buffer is free again once this returns
+    AsyncWebServerResponse* response = body ? request->beginResponse(200, "application/json", body) : request->beginResponse(304);
+    char quoted[32];
+    snprintf(quoted, sizeof(quoted), "\"%s\"", etag);
+    response->addHeader("ETag", quoted);
+    response->addHeader("Cache-Control", "no-cache");
+    request->send(response);
+    if (body) apiResponses++;
+    else apiNotModified++;
+}
+
+void serviceApiRequests(const ControllerState& state) {
+    uint32_t now = millis();
+    char etag[24];
+    apiStatusWaiting = false;
+    for (ApiRequestSlot& slot : apiSlots) {
+        if (!slot.used.load(std::memory_order_acquire)) continue;
+        std::shared_ptr<AsyncWebServerRequest> request = slot.request.lock(); // Empty once the client went away
+        if (request) {
+            bool ready = apiEtag(slot.resource, state, etag, sizeof(etag));
+            bool unchanged = ready && slot.ifNoneMatch[0] != '\0' && etagMatches(slot.ifNoneMatch, etag);
+            HttpPollResult result = httpPollDecide(ready, unchanged, now - slot.receivedMs, slot.waitMs);
+            if (result == HTTP_POLL_WAIT) {
+                if (slot.resource == API_STATUS) apiStatusWaiting = true;
+                continue;
+            }
+            answerApiRequest(request.get(), result, slot.resource, state, etag);
+            request.reset();
         }
-        request->send(SPIFFS, "/index.html", "text/html");
-    });
-    server.on("/style.css", HTTP_GET, [](AsyncWebServerRequest *request){
-        if(!SPIFFS.exists("/style.css")){
-            if(serialDebugEnabled) Serial.println("SPIFFS: style.css not found!");
-            request->send(404, "text/plain", "style.css not found.");
+        slot.request.reset();
+        slot.used.store(false, std::memory_order_release);
+    }
+}
+
+// The status ETag only moves when a broadcast builds a delta, so while someone waits on it networkTask
+// broadcasts every NETWORK_LONG_POLL_BROADCAST_MS instead of every 5 s
+bool apiStatusLongPollWaiting() {
+    return apiStatusWaiting;
+}
+
+// AsyncTCP task: park the request for networkTask
+static void queueApiRequest(AsyncWebServerRequest* request, ApiResource resource) {
+    for (ApiRequestSlot& slot : apiSlots) {
+        if (slot.used.load(std::memory_order_acquire)) continue;
+        slot.resource = resource;
+        slot.receivedMs = millis();
+        const AsyncWebParameter* wait = request->getParam("wait");
+        slot.waitMs = (wait ? parseWaitSeconds(wait->value().c_str(), API_MAX_WAIT_S) : 0) * 1000;
+        const AsyncWebHeader* ifNoneMatch = request->getHeader("If-None-Match");
+        slot.ifNoneMatch[0] = '\0';
+        if (ifNoneMatch && ifNoneMatch->value().length() < sizeof(slot.ifNoneMatch)) strcpy(slot.ifNoneMatch, ifNoneMatch->value().c_str());
+        slot.request = request->pause();
+        slot.used.store(true, std::memory_order_release);
+        wakeNetworkTask(NETWORK_TASK_WAKE_HTTP);
+        return;
+    }
+    apiRejected++;
+    AsyncWebServerResponse* response = request->beginResponse(503, "application/json", "{\"error\":\"too many pending requests\"}");
+    response->addHeader("Retry-After", "1");
+    request->send(response);
+}
+
+void getApiStats(uint32_t* responses, uint32_t* notModified, uint32_t* rejected) {
+    *responses = apiResponses;
+    *notModified = apiNotModified;
+    *rejected = apiRejected;
+}
+
+// AsyncTCP task. AsyncEventSource holds its client list lock here, so a refused client is only marked
+// and networkTask closes it.
+static void onEventClientConnect(AsyncEventSourceClient* client) {
+    for (std::atomic<AsyncEventSourceClient*>& pending : ssePending) {
+        AsyncEventSourceClient* empty = nullptr;
+        if (pending.compare_exchange_strong(empty, client)) {
+            wakeNetworkTask(NETWORK_TASK_WAKE_HTTP);
             return;
         }
-        request->send(SPIFFS, "/style.css", "text/css");
-    });
-    server.on("/script.js", HTTP_GET, [](AsyncWebServerRequest *request){
-            if(!SPIFFS.exists("/script.js")){
-            if(serialDebugEnabled) Serial.println("SPIFFS: script.js not found!");
-            request->send(404, "text/plain", "script.js not found.");
-            return;
+    }
+    ssePendingOverflow++;
+}
+
+// sseLock held: moves the clients onConnect handed over into slots; those over SSE_MAX_CLIENTS are refused
+static void adoptPendingEventClients() {
+    for (std::atomic<AsyncEventSourceClient*>& pending : ssePending) {
+        AsyncEventSourceClient* client = pending.exchange(nullptr);
+        if (!client) continue;
+        size_t active = 0;
+        SseClientSlot* free = nullptr;
+        for (SseClientSlot& slot : sseClients) {
+            if (slot.client && !slot.refused) active++;
+            if (!slot.client && !free) free = &slot;
         }
-        request->send(SPIFFS, "/script.js", "application/javascript");
-    });
-    
+        if (!free) { // Only refused clients still closing: refuse this one on the spot
+            sseRefused++;
+            client->close();
+            continue;
+        }
+        memset(free, 0, sizeof(*free));
+        free->client = client;
+        free->refused = active >= SSE_MAX_CLIENTS;
+        if (free->refused) sseRefused++;
+    }
+}
+
+// AsyncTCP task (or networkTask inside a close()): the client is deleted once this returns
+static void onEventClientDisconnect(AsyncEventSourceClient* client) {
+    xSemaphoreTakeRecursive(sseLock, portMAX_DELAY);
+    for (std::atomic<AsyncEventSourceClient*>& pending : ssePending) {
+        AsyncEventSourceClient* expected = client;
+        pending.compare_exchange_strong(expected, nullptr); // Gone before networkTask took it over
+    }
+    for (SseClientSlot& slot : sseClients) {
+        if (slot.client == client) slot.client = nullptr;
+    }
+    xSemaphoreGiveRecursive(sseLock);
+}
+
+void serviceEventClients() {
+    if (!sseLock) return;
+    unsigned long now = millis();
+    size_t snapshotLength = 0;
+    EventStreamStats stats = {};
+    xSemaphoreTakeRecursive(sseLock, portMAX_DELAY);
+    adoptPendingEventClients();
+    for (SseClientSlot& slot : sseClients) {
+        if (!slot.client) continue;
+        if (slot.refused) {
+            if (!slot.closing) {
+                slot.closing = true;
+                slot.client->close();
+            }
+            continue;
+        }
+        bool ready = sseClientReady(slot, now);
+        if (!slot.client) continue; // Dropped just now
+        if (stats.clients < SSE_MAX_CLIENTS) stats.queueDepth[stats.clients] = slot.queued;
+        stats.clients++;
+        if (slot.queued > stats.queueMax) stats.queueMax = slot.queued;
+        if (!ready) continue;
+        if (wsConfigLength && slot.configVersion != wsConfigVersion) {
+            slot.client->send(wsConfigMessage, "config");
+            slot.configVersion = wsConfigVersion;
+        }
+        if (!wsHaveBaseline || (slot.synced && slot.seq == wsSeq)) continue;
+        if (slot.synced && now - slot.lastSendMs < SSE_CLIENT_MIN_INTERVAL_MS) continue; // The first snapshot goes at once
+        if (snapshotLength == 0) snapshotLength = serializeTelemetrySnapshot(); // Once per pass, for every client behind
+        if (snapshotLength == 0) break;
+        slot.client->send(statusTextBuffer(), "full", wsSeq);
+        slot.seq = wsSeq;
+        slot.synced = true;
+        slot.lastSendMs = now;
+    }
+    stats.dropped = sseStats.dropped;
+    stats.skipped = sseStats.skipped;
+    stats.refused = sseRefused + ssePendingOverflow.load();
+    sseStats = stats;
+    xSemaphoreGiveRecursive(sseLock);
+}
+
+void getEventStreamStats(EventStreamStats* stats) {
+    if (!sseLock) {
+        memset(stats, 0, sizeof(*stats));
+        return;
+    }
+    xSemaphoreTakeRecursive(sseLock, portMAX_DELAY);
+    *stats = sseStats;
+    xSemaphoreGiveRecursive(sseLock);
+}
+
+void serviceWebSocketInbox() {
+    static WsInboxEvent event;
+    while (wsInbox && xQueueReceive(wsInbox, &event, 0) == pdTRUE) handleWebSocketEvent(event);
+    if (millis() - wsCleanupMs >= 1000) { // Drops clients beyond WS_MAX_CLIENTS and frees closed ones
+        webSocket.cleanupClients(WS_MAX_CLIENTS);
+        wsCleanupMs = millis();
+    }
+}
+
+void setupWebServerRoutes() {
+    wsInbox = xQueueCreateStatic(WS_INBOX_DEPTH, sizeof(WsInboxEvent), wsInboxStorage, &wsInboxQueue);
+    webSocket.onEvent(webSocketEvent);
+    server.addHandler(&webSocket);
+
+    setupWebAssetRoutes(); // Embedded gzipped UI files with ETags (web_assets.h)
+
+    sseLock = xSemaphoreCreateRecursiveMutex();
+    events.onConnect(onEventClientConnect);
+    events.onDisconnect(onEventClientDisconnect);
+    server.addHandler(&events);
+
+    apiBootId = esp_random();
+    server.on("/api/status", HTTP_GET, [](AsyncWebServerRequest *request){ queueApiRequest(request, API_STATUS); });
+    server.on("/api/curve", HTTP_GET, [](AsyncWebServerRequest *request){ queueApiRequest(request, API_CURVE); });
+    server.on("/api/config", HTTP_GET, [](AsyncWebServerRequest *request){ queueApiRequest(request, API_CONFIG); });
+
     server.on("/reboot", HTTP_GET, [](AsyncWebServerRequest *request){
         if(serialDebugEnabled) Serial.println("[HTTP] Reboot requested via /reboot endpoint.");
         request->send(200, "text/plain", "Rebooting device...");
+        flushNvsSaves();
         delay(1000); 
         ESP.restart();
     });
@@ -3,8 +3,26 @@
 
 #include "config.h"
 
-void webSocketEvent(uint8_t num, WStype_t type, uint8_t* payload, size_t length);
-void broadcastWebSocketData();
-void setupWebServerRoutes(); // For SPIFFS
+void webSocketEvent(AsyncWebSocket* socket, AsyncWebSocketClient* client, AwsEventType type, void* arg, uint8_t* data, size_t length); // AsyncTCP task
+void serviceWebSocketInbox(); // networkTask: handles the events webSocketEvent() queued
+void broadcastWebSocketData(const ControllerState& state); // Config on change, telemetry deltas (networkTask)
+void getWebSocketWireRates(uint32_t* sentBytesPerMin, uint32_t* fullBytesPerMin); // Any task
+uint32_t getWebSocketBroadcastAvgUs(); // Any task
+void serviceApiRequests(const ControllerState& state); // networkTask: answers the parked /api/* requests
+bool apiStatusLongPollWaiting(); // networkTask: a /api/status long-poll was still waiting after the last service pass
+void getApiStats(uint32_t* responses, uint32_t* notModified, uint32_t* rejected); // Any task
+void serviceEventClients(); // networkTask: /events welcome, config and catch-up snapshots, slow-client drops
+
+const size_t SSE_MAX_CLIENTS = 4; // /events clients served at once; more are closed
+struct EventStreamStats {
+    uint32_t clients;
+    uint32_t queueDepth[SSE_MAX_CLIENTS]; // Messages waiting per client, as of networkTask's last pass
+    uint32_t queueMax;
+    uint32_t dropped;  // Closed after SSE_CLIENT_STALL_DROP_MS with a full queue
+    uint32_t skipped;  // Telemetry events held back by the rate cap or a full queue (caught up by a snapshot)
+    uint32_t refused;  // Connects beyond SSE_MAX_CLIENTS
+};
+void getEventStreamStats(EventStreamStats* stats); // Any task
+void setupWebServerRoutes(); // WebSocket, web UI and /api/* routes
 
 #endif // NETWORK_HANDLER_H
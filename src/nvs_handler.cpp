@@ -1,19 +1,82 @@
 #include "nvs_handler.h"
 #include "config.h" 
 #include "fan_control.h" 
+#include "nvs_save_scheduler.h"
+#include "tasks.h"
+
+static_assert(NVS_SECTION_COUNT <= NVS_SAVE_MAX_SECTIONS, "NVS sections must fit the scheduler's dirty mask");
+
+// Held while a section is written, so flushNvsSaves() from another task never interleaves with nvsPersistenceTask
+static SemaphoreHandle_t nvsWriteMutex = NULL;
+
+void setupNvsPersistence() {
+    nvsSaveSchedulerInit(&nvsSaveScheduler, NVS_SAVE_DEBOUNCE_MS, NVS_SAVE_MAX_DELAY_MS);
+    nvsWriteMutex = xSemaphoreCreateMutex();
+}
+
+void requestNvsSave(NvsSection section, int channel) {
+    nvsSaveSchedulerRequest(&nvsSaveScheduler, section + channel, millis());
+    wakeNvsPersistenceTask();
+}
+
+static size_t writeNvsSection(int section) {
+    if (section == NVS_SECTION_WIFI) return saveWiFiConfig();
+    if (section == NVS_SECTION_PID) return savePidConfig();
+    if (section == NVS_SECTION_FAN_OUTPUT) return saveFanOutputConfig();
+    if (section == NVS_SECTION_MQTT) return saveMqttConfig();
+    if (section == NVS_SECTION_MQTT_DISCOVERY) return saveMqttDiscoveryConfig();
+    if (section == NVS_SECTION_WIFI_JOIN) return saveWiFiJoinCache();
+    if (section < NVS_SECTION_FAN_RPM_MODEL) return saveFanCurveToNVS(section - NVS_SECTION_FAN_CURVE);
+    if (section < NVS_SECTION_FAN_CALIBRATION) return saveFanRpmModelToNVS(section - NVS_SECTION_FAN_RPM_MODEL);
+    return saveFanCalibrationToNVS(section - NVS_SECTION_FAN_CALIBRATION);
+}
+
+void writeDueNvsSections(bool flushAll) {
+    if (nvsWriteMutex == NULL) return;
+    xSemaphoreTake(nvsWriteMutex, portMAX_DELAY);
+    uint32_t due = nvsSaveSchedulerTakeDue(&nvsSaveScheduler, millis(), flushAll);
+    for (int section = 0; section < NVS_SECTION_COUNT; section++) {
+        if (due & (1UL << section)) nvsSaveSchedulerRecordWrite(&nvsSaveScheduler, writeNvsSection(section));
+    }
+    xSemaphoreGive(nvsWriteMutex);
+}
+
+void flushNvsSaves() {
+    if (nvsSaveSchedulerPending(&nvsSaveScheduler) > 0 && serialDebugEnabled) Serial.println("[NVS] Writing pending settings now.");
+    writeDueNvsSections(true);
+}
 
 // NVS Helper Functions for WiFi
-void saveWiFiConfig() {
+size_t saveWiFiConfig() {
+    size_t bytes = 0;
     if (preferences.begin("wifi-cfg", false)) {
-        preferences.putString("ssid", current_ssid);
-        preferences.putString("password", current_password);
+        bytes += preferences.putString("ssid", current_ssid);
+        bytes += preferences.putString("password", current_password);
         if(serialDebugEnabled) Serial.printf("[NVS_SAVE] Saving 'wifiEn' as: %s\n", isWiFiEnabled ? "true" : "false");
-        preferences.putBool("wifiEn", isWiFiEnabled);
+        bytes += preferences.putBool("wifiEn", isWiFiEnabled);
+        bytes += preferences.putBool("staticEn", wifiStaticIp.enabled);
+        bytes += preferences.putUInt("staticIp", wifiStaticIp.ip);
+        bytes += preferences.putUInt("staticGw", wifiStaticIp.gateway);
+        bytes += preferences.putUInt("staticMask", wifiStaticIp.subnet);
+        bytes += preferences.putUInt("staticDns", wifiStaticIp.dns);
         preferences.end();
         if(serialDebugEnabled) Serial.println("[NVS] WiFi configuration saved.");
     } else {
         if(serialDebugEnabled) Serial.println("[NVS_SAVE_ERR] Failed to open 'wifi-cfg' for writing.");
     }
+    return bytes;
+}
+
+size_t saveWiFiJoinCache() {
+    size_t bytes = 0;
+    if (preferences.begin("wifi-cfg", false)) {
+        bytes = preferences.putBytes("join", &wifiJoinCache, sizeof(wifiJoinCache));
+        preferences.end();
+        if(serialDebugEnabled) Serial.printf("[NVS] WiFi join cache saved (channel %u).\n", wifiJoinCache.channel);
+    } else {
+        if(serialDebugEnabled) Serial.println("[NVS_SAVE_ERR] Failed to open 'wifi-cfg' for writing.");
+    }
+    return bytes;
 }
 
 void loadWiFiConfig() {
@@ -40,8 +103,19 @@ void loadWiFiConfig() {
                 strcpy(current_password, stored_password.c_str());
             }
         }
+        wifiStaticIp.ip = preferences.getUInt("staticIp", 0);
+        wifiStaticIp.gateway = preferences.getUInt("staticGw", 0);
+        wifiStaticIp.subnet = preferences.getUInt("staticMask", 0);
+        wifiStaticIp.dns = preferences.getUInt("staticDns", 0);
+        wifiStaticIp.enabled = preferences.getBool("staticEn", false) && wifiStaticIp.ip != 0 && wifiStaticIp.subnet != 0;
+        // A blob of another size is from an older layout: start without a cache
+        if (preferences.getBytesLength("join") != sizeof(wifiJoinCache) ||
+            preferences.getBytes("join", &wifiJoinCache, sizeof(wifiJoinCache)) != sizeof(wifiJoinCache)) {
+            memset(&wifiJoinCache, 0, sizeof(wifiJoinCache));
+        }
         preferences.end();
-        if(serialDebugEnabled) Serial.printf("[NVS] Effective WiFi Config after load: SSID='%s', Enabled=%s\n", current_ssid, isWiFiEnabled ? "Yes" : "No");
+        if(serialDebugEnabled) Serial.printf("[NVS] Effective WiFi Config after load: SSID='%s', Enabled=%s, Static IP=%s, Join cache=%s\n", current_ssid,
+                                             isWiFiEnabled ? "Yes" : "No", wifiStaticIp.enabled ? "Yes" : "No", wifiJoinCacheUsable(&wifiJoinCache, current_ssid) ? "Yes" : "No");
 
     } else {
         if(serialDebugEnabled) Serial.println("[NVS_LOAD_ERR] Failed to open 'wifi-cfg' for reading. isWiFiEnabled defaults to false.");
@@ -53,32 +127,46 @@ void loadWiFiConfig() {
 }
 
 // NVS Helper Functions for Fan Curve
-void saveFanCurveToNVS() {
+// Channel 0 keeps the original single-fan key names so existing curves survive the upgrade.
+// Other channels prefix their keys with "c<N>" (NVS keys are limited to 15 characters).
+static String fanCurveKey(int channel, const char* name) {
+    if (channel == 0) return String(name);
+    return "c" + String(channel) + name;
+}
+
+static String fanCurvePointKey(int channel, const char* prefix, int point) {
+    return fanCurveKey(channel, prefix) + String(point);
+}
+
+size_t saveFanCurveToNVS(int channel) {
+  size_t bytes = 0;
   if (preferences.begin("fan-curve", false)) {
-    preferences.putInt("numPoints", numCurvePoints);
-    if(serialDebugEnabled) Serial.printf("[NVS] Saving fan curve with %d points:\n", numCurvePoints);
-    for (int i = 0; i < numCurvePoints; i++) {
-        String tempKey = "tP" + String(i);
-        String pwmKey = "pP" + String(i);
-        preferences.putInt(tempKey.c_str(), tempPoints[i]);
-        preferences.putInt(pwmKey.c_str(), pwmPercentagePoints[i]);
-        if(serialDebugEnabled) Serial.printf("  Point %d: Temp=%d, PWM=%d\n", i, tempPoints[i], pwmPercentagePoints[i]);
+    int numPoints = fanChannels.curveNumPoints[channel];
+    bytes += preferences.putInt(fanCurveKey(channel, "numPoints").c_str(), numPoints);
+    if(serialDebugEnabled) Serial.printf("[NVS] Saving fan %d curve with %d points:\n", channel + 1, numPoints);
+    for (int i = 0; i < numPoints; i++) {
+        String tempKey = fanCurvePointKey(channel, "tP", i);
+        String pwmKey = fanCurvePointKey(channel, "pP", i);
+        bytes += preferences.putInt(tempKey.c_str(), fanChannels.curveTempPoints[channel][i]);
+        bytes += preferences.putInt(pwmKey.c_str(), fanChannels.curvePwmPoints[channel][i]);
+        if(serialDebugEnabled) Serial.printf("  Point %d: Temp=%d, PWM=%d\n", i, fanChannels.curveTempPoints[channel][i], fanChannels.curvePwmPoints[channel][i]);
     }
     preferences.end();
     if(serialDebugEnabled) Serial.println("[NVS] Fan curve saved.");
   } else {
     if(serialDebugEnabled) Serial.println("[NVS_SAVE_ERR] Failed to open 'fan-curve' for writing.");
   }
+  return bytes;
 }
 
-void loadFanCurveFromNVS() {
+void loadFanCurveFromNVS(int channel) {
   if(!preferences.begin("fan-curve", true)) { // Open read-only
     if(serialDebugEnabled) Serial.println("[NVS_LOAD_ERR] Failed to open 'fan-curve' for reading. Using default curve.");
-    setDefaultFanCurve(); 
+    setDefaultFanCurve(channel); 
     return;
   }
-  int savedNumPoints = preferences.getInt("numPoints", 0); // Default to 0 if not found
-  if(serialDebugEnabled) Serial.printf("[NVS] Attempting to load fan curve. Found %d points in NVS.\n", savedNumPoints);
+  int savedNumPoints = preferences.getInt(fanCurveKey(channel, "numPoints").c_str(), 0); // Default to 0 if not found
+  if(serialDebugEnabled) Serial.printf("[NVS] Attempting to load fan %d curve. Found %d points in NVS.\n", channel + 1, savedNumPoints);
 
   if (savedNumPoints >= 2 && savedNumPoints <= MAX_CURVE_POINTS) {
     bool success = true;
@@ -86,8 +174,8 @@ void loadFanCurveFromNVS() {
     int tempPwmPercentagePointsValidation[MAX_CURVE_POINTS];
 
     for (int i = 0; i < savedNumPoints; i++) {
-      String tempKey = "tP" + String(i);
-      String pwmKey = "pP" + String(i);
+      String tempKey = fanCurvePointKey(channel, "tP", i);
+      String pwmKey = fanCurvePointKey(channel, "pP", i);
       tempTempPointsValidation[i] = preferences.getInt(tempKey.c_str(), -1000); // Use a sentinel for not found/error
       tempPwmPercentagePointsValidation[i] = preferences.getInt(pwmKey.c_str(), -1000);
       
@@ -103,39 +191,185 @@ void loadFanCurveFromNVS() {
     }
     
     if (success) {
-        numCurvePoints = savedNumPoints;
-        for(int i=0; i < numCurvePoints; ++i) {
-            tempPoints[i] = tempTempPointsValidation[i];
-            pwmPercentagePoints[i] = tempPwmPercentagePointsValidation[i];
-            if(serialDebugEnabled) Serial.printf("  Loaded Point %d: Temp=%d, PWM=%d\n", i, tempPoints[i], pwmPercentagePoints[i]);
+        fanChannels.curveNumPoints[channel] = savedNumPoints;
+        for(int i=0; i < savedNumPoints; ++i) {
+            fanChannels.curveTempPoints[channel][i] = tempTempPointsValidation[i];
+            fanChannels.curvePwmPoints[channel][i] = tempPwmPercentagePointsValidation[i];
+            if(serialDebugEnabled) Serial.printf("  Loaded Point %d: Temp=%d, PWM=%d\n", i, tempTempPointsValidation[i], tempPwmPercentagePointsValidation[i]);
         }
+        invalidateFanCurveLut(channel);
         if(serialDebugEnabled) Serial.println("[NVS] Fan curve successfully loaded from NVS.");
     } else {
         if(serialDebugEnabled) Serial.println("[NVS_LOAD_ERR] Error/Invalid data in NVS fan curve, using default curve.");
-        setDefaultFanCurve(); 
+        setDefaultFanCurve(channel); 
     }
   } else {
     if(serialDebugEnabled) Serial.printf("[NVS] No valid fan curve in NVS (points: %d), using default curve.\n", savedNumPoints);
-    setDefaultFanCurve(); 
+    setDefaultFanCurve(channel); 
   }
   preferences.end();
 }
 
 
+// --- NVS Helper Functions for PID ---
+bool isValidPidConfig(float setpointC, float kp, float ki, float kd) {
+    return !isnan(setpointC) && !isnan(kp) && !isnan(ki) && !isnan(kd) &&
+           setpointC >= 0.0f && setpointC <= 120.0f && // Same range as curve point temperatures
+           kp >= 0.0f && kp <= 100.0f && ki >= 0.0f && ki <= 10.0f && kd >= 0.0f && kd <= 500.0f;
+}
+
+size_t savePidConfig() {
+    size_t bytes = 0;
+    if (preferences.begin("pid-cfg", false)) {
+        bytes += preferences.putFloat("sp", pidSetpointC);
+        bytes += preferences.putFloat("kp", pidKp);
+        bytes += preferences.putFloat("ki", pidKi);
+        bytes += preferences.putFloat("kd", pidKd);
+        preferences.end();
+        if (serialDebugEnabled) Serial.println("[NVS] PID configuration saved.");
+    } else {
+        if (serialDebugEnabled) Serial.println("[NVS_SAVE_ERR] Failed to open 'pid-cfg' for writing.");
+    }
+    return bytes;
+}
+
+void loadPidConfig() {
+    if (preferences.begin("pid-cfg", true)) { // Open read-only
+        float sp = preferences.getFloat("sp", pidSetpointC); // Defaults from main.cpp
+        float kp = preferences.getFloat("kp", pidKp);
+        float ki = preferences.getFloat("ki", pidKi);
+        float kd = preferences.getFloat("kd", pidKd);
+        preferences.end();
+        if (isValidPidConfig(sp, kp, ki, kd)) {
+            pidSetpointC = sp; pidKp = kp; pidKi = ki; pidKd = kd;
+        } else {
+            if (serialDebugEnabled) Serial.println("[NVS_VALIDATE_ERR] Invalid PID configuration in NVS, using defaults.");
+        }
+        if (serialDebugEnabled) Serial.printf("[NVS] PID configuration: Setpoint=%.1f C, Kp=%.3f, Ki=%.3f, Kd=%.3f\n", pidSetpointC, pidKp, pidKi, pidKd);
+    } else {
+        if (serialDebugEnabled) Serial.println("[NVS_LOAD_ERR] Failed to open 'pid-cfg' for reading. Using default PID values.");
+    }
+}
+
+// --- NVS Helper Functions for the Learned PWM -> RPM Tables ---
+size_t saveFanRpmModelToNVS(int channel) {
+    size_t bytes = 0;
+    if (preferences.begin("fan-rpm", false)) {
+        String key = "m" + String(channel);
+        bytes = preferences.putBytes(key.c_str(), getFanRpmModel(channel)->rpm, sizeof(getFanRpmModel(channel)->rpm));
+        preferences.end();
+        if (serialDebugEnabled) Serial.printf("[NVS] Fan %d RPM table saved (%d points).\n", channel + 1, fanRpmModelLearnedPoints(getFanRpmModel(channel)));
+    } else {
+        if (serialDebugEnabled) Serial.println("[NVS_SAVE_ERR] Failed to open 'fan-rpm' for writing.");
+    }
+    return bytes;
+}
+
+void loadFanRpmModelFromNVS(int channel) {
+    FanRpmModel* model = getFanRpmModel(channel);
+    fanRpmModelReset(model);
+    if (!preferences.begin("fan-rpm", true)) { // Open read-only
+        if (serialDebugEnabled) Serial.println("[NVS_LOAD_ERR] Failed to open 'fan-rpm' for reading. RPM table starts empty.");
+        return;
+    }
+    String key = "m" + String(channel);
+    if (preferences.getBytesLength(key.c_str()) == sizeof(model->rpm)) {
+        preferences.getBytes(key.c_str(), model->rpm, sizeof(model->rpm));
+    }
+    preferences.end();
+    if (serialDebugEnabled) Serial.printf("[NVS] Fan %d RPM table loaded (%d points).\n", channel + 1, fanRpmModelLearnedPoints(model));
+}
+
+// --- NVS Helper Functions for the Fan Calibration Results ---
+size_t saveFanCalibrationToNVS(int channel) {
+    size_t bytes = 0;
+    if (preferences.begin("fan-cal", false)) {
+        String key = "r" + String(channel);
+        FanCalibrationResult* result = getFanCalibrationResult(channel);
+        if (result->valid) bytes = preferences.putBytes(key.c_str(), result, sizeof(*result));
+        else preferences.remove(key.c_str());
+        preferences.end();
+        if (serialDebugEnabled) Serial.printf("[NVS] Fan %d calibration %s.\n", channel + 1, result->valid ? "saved" : "cleared");
+    } else {
+        if (serialDebugEnabled) Serial.println("[NVS_SAVE_ERR] Failed to open 'fan-cal' for writing.");
+    }
+    return bytes;
+}
+
+void loadFanCalibrationFromNVS(int channel) {
+    FanCalibrationResult* result = getFanCalibrationResult(channel);
+    *result = FanCalibrationResult{};
+    if (!preferences.begin("fan-cal", true)) { // Open read-only
+        if (serialDebugEnabled) Serial.println("[NVS_LOAD_ERR] Failed to open 'fan-cal' for reading. Fans start uncalibrated.");
+        return;
+    }
+    String key = "r" + String(channel);
+    if (preferences.getBytesLength(key.c_str()) == sizeof(*result)) {
+        preferences.getBytes(key.c_str(), result, sizeof(*result));
+        if (result->stallDuty > 100 || result->startDuty > 100) *result = FanCalibrationResult{}; // Corrupt entry
+    }
+    preferences.end();
+    if (serialDebugEnabled) {
+        if (result->valid) Serial.printf("[NVS] Fan %d calibration loaded: start %d%%, stall %d%%, max %d RPM.\n", channel + 1, result->startDuty, result->stallDuty, result->maxRpm);
+        else Serial.printf("[NVS] Fan %d not calibrated.\n", channel + 1);
+    }
+}
+
+// --- NVS Helper Functions for Output Conditioning ---
+bool isValidFanOutputConfig(float rampUpPercentPerS, float rampDownPercentPerS, float hysteresisC) {
+    return !isnan(rampUpPercentPerS) && !isnan(rampDownPercentPerS) && !isnan(hysteresisC) &&
+           rampUpPercentPerS >= 0.0f && rampUpPercentPerS <= 1000.0f &&
+           rampDownPercentPerS >= 0.0f && rampDownPercentPerS <= 1000.0f &&
+           hysteresisC >= 0.0f && hysteresisC <= 10.0f;
+}
+
+size_t saveFanOutputConfig() {
+    size_t bytes = 0;
+    if (preferences.begin("fan-out-cfg", false)) {
+        bytes += preferences.putFloat("rampUp", fanRampUpPercentPerS);
+        bytes += preferences.putFloat("rampDn", fanRampDownPercentPerS);
+        bytes += preferences.putFloat("hyst", fanHysteresisC);
+        preferences.end();
+        if (serialDebugEnabled) Serial.println("[NVS] Output conditioning configuration saved.");
+    } else {
+        if (serialDebugEnabled) Serial.println("[NVS_SAVE_ERR] Failed to open 'fan-out-cfg' for writing.");
+    }
+    return bytes;
+}
+
+void loadFanOutputConfig() {
+    if (preferences.begin("fan-out-cfg", true)) { // Open read-only
+        float up = preferences.getFloat("rampUp", fanRampUpPercentPerS); // Defaults from main.cpp
+        float down = preferences.getFloat("rampDn", fanRampDownPercentPerS);
+        float hyst = preferences.getFloat("hyst", fanHysteresisC);
+        preferences.end();
+        if (isValidFanOutputConfig(up, down, hyst)) {
+            fanRampUpPercentPerS = up; fanRampDownPercentPerS = down; fanHysteresisC = hyst;
+        } else {
+            if (serialDebugEnabled) Serial.println("[NVS_VALIDATE_ERR] Invalid output conditioning configuration in NVS, using defaults.");
+        }
+        if (serialDebugEnabled) Serial.printf("[NVS] Output conditioning: Ramp up %.1f %%/s, Ramp down %.1f %%/s, Hysteresis %.1f C\n", fanRampUpPercentPerS, fanRampDownPercentPerS, fanHysteresisC);
+    } else {
+        if (serialDebugEnabled) Serial.println("[NVS_LOAD_ERR] Failed to open 'fan-out-cfg' for reading. Using default output conditioning values.");
+    }
+}
+
 // --- NVS Helper Functions for MQTT ---
-void saveMqttConfig() {
+size_t saveMqttConfig() {
+    size_t bytes = 0;
     if (preferences.begin("mqtt-cfg", false)) { // Open for writing
-        preferences.putBool("mqttEn", isMqttEnabled);
-        preferences.putString("mqttSrv", mqttServer);
-        preferences.putInt("mqttPrt", mqttPort);
-        preferences.putString("mqttUsr", mqttUser);
-        preferences.putString("mqttPwd", mqttPassword);
-        preferences.putString("mqttTop", mqttBaseTopic);
+        bytes += preferences.putBool("mqttEn", isMqttEnabled);
+        bytes += preferences.putString("mqttSrv", mqttServer);
+        bytes += preferences.putInt("mqttPrt", mqttPort);
+        bytes += preferences.putString("mqttUsr", mqttUser);
+        bytes += preferences.putString("mqttPwd", mqttPassword);
+        bytes += preferences.putString("mqttTop", mqttBaseTopic);
         preferences.end();
         if (serialDebugEnabled) Serial.println("[NVS] MQTT configuration saved.");
     } else {
         if (serialDebugEnabled) Serial.println("[NVS_SAVE_ERR] Failed to open 'mqtt-cfg' for writing.");
     }
+    return bytes;
 }
 
 void loadMqttConfig() {
@@ -177,15 +411,17 @@ void loadMqttConfig() {
 }
 
 // --- NVS Helper Functions for MQTT Discovery --- ADDED
-void saveMqttDiscoveryConfig() {
+size_t saveMqttDiscoveryConfig() {
+    size_t bytes = 0;
     if (preferences.begin("mqtt-disc-cfg", false)) { // Open for writing
-        preferences.putBool("discEn", isMqttDiscoveryEnabled);
-        preferences.putString("discPfx", mqttDiscoveryPrefix);
+        bytes += preferences.putBool("discEn", isMqttDiscoveryEnabled);
+        bytes += preferences.putString("discPfx", mqttDiscoveryPrefix);
         preferences.end();
         if (serialDebugEnabled) Serial.println("[NVS] MQTT Discovery configuration saved.");
     } else {
         if (serialDebugEnabled) Serial.println("[NVS_SAVE_ERR] Failed to open 'mqtt-disc-cfg' for writing.");
     }
+    return bytes;
 }
 
 void loadMqttDiscoveryConfig() {
@@ -3,17 +3,55 @@
 
 #include "config.h"
 
-void saveWiFiConfig();
+// --- Deferred Saves ---
+// Handlers change a setting in RAM and call requestNvsSave(); nvsPersistenceTask writes the section once it
+// has been quiet for NVS_SAVE_DEBOUNCE_MS (at most NVS_SAVE_MAX_DELAY_MS after the first change), so a burst
+// of updates costs one flash write and no handler blocks on flash. Loads still happen in setup().
+enum NvsSection : uint8_t {
+    NVS_SECTION_WIFI,
+    NVS_SECTION_PID,
+    NVS_SECTION_FAN_OUTPUT,
+    NVS_SECTION_MQTT,
+    NVS_SECTION_MQTT_DISCOVERY,
+    NVS_SECTION_WIFI_JOIN,                                            // Join cache only (wifi-cfg/join)
+    NVS_SECTION_FAN_CURVE,                                            // + channel
+    NVS_SECTION_FAN_RPM_MODEL = NVS_SECTION_FAN_CURVE + MAX_FAN_CHANNELS,  // + channel
+    NVS_SECTION_FAN_CALIBRATION = NVS_SECTION_FAN_RPM_MODEL + MAX_FAN_CHANNELS, // + channel
+    NVS_SECTION_COUNT = NVS_SECTION_FAN_CALIBRATION + MAX_FAN_CHANNELS
+};
+
+void setupNvsPersistence(); // In setup(), before the tasks start
+void requestNvsSave(NvsSection section, int channel = 0); // Any task
+void writeDueNvsSections(bool flushAll); // nvsPersistenceTask
+void flushNvsSaves(); // Writes every pending section now, e.g. before ESP.restart()
+
+// The save functions return the payload bytes handed to NVS. Call them only through the deferred path.
+size_t saveWiFiConfig();
 void loadWiFiConfig();
-void saveFanCurveToNVS();
-void loadFanCurveFromNVS();
+size_t saveWiFiJoinCache();
+size_t saveFanCurveToNVS(int channel);
+void loadFanCurveFromNVS(int channel);
+size_t saveFanRpmModelToNVS(int channel);
+void loadFanRpmModelFromNVS(int channel);
+size_t saveFanCalibrationToNVS(int channel);
+void loadFanCalibrationFromNVS(int channel);
+
+// PID NVS Functions
+size_t savePidConfig();
+void loadPidConfig();
+bool isValidPidConfig(float setpointC, float kp, float ki, float kd);
+
+// Output Conditioning NVS Functions
+size_t saveFanOutputConfig();
+void loadFanOutputConfig();
+bool isValidFanOutputConfig(float rampUpPercentPerS, float rampDownPercentPerS, float hysteresisC);
 
 // MQTT NVS Functions
-void saveMqttConfig();
+size_t saveMqttConfig();
 void loadMqttConfig();
 
 // MQTT Discovery NVS Functions - ADDED
-void saveMqttDiscoveryConfig();
+size_t saveMqttDiscoveryConfig();
 void loadMqttDiscoveryConfig();
 
 #endif // NVS_HANDLER_H
@@ -0,0 +1,76 @@
+#include "nvs_save_scheduler.h"
+
+void nvsSaveSchedulerInit(NvsSaveScheduler* scheduler, uint32_t debounceMs, uint32_t maxDelayMs) {
+    scheduler->debounceMs = debounceMs;
+    scheduler->maxDelayMs = maxDelayMs;
+    scheduler->dirtyMask.store(0);
+    for (int i = 0; i < NVS_SAVE_MAX_SECTIONS; i++) {
+        scheduler->firstRequestMs[i].store(0);
+        scheduler->lastRequestMs[i].store(0);
+    }
+    scheduler->requests.store(0);
+    scheduler->writes.store(0);
+    scheduler->bytesWritten.store(0);
+}
+
+void nvsSaveSchedulerRequest(NvsSaveScheduler* scheduler, int section, uint32_t nowMs) {
+    if (section < 0 || section >= NVS_SAVE_MAX_SECTIONS) return;
+    uint32_t bit = 1UL << section;
+    scheduler->lastRequestMs[section].store(nowMs, std::memory_order_relaxed);
+    // A stale firstRequestMs seen by the writer in between can only make the write come early, never get lost
+    if ((scheduler->dirtyMask.fetch_or(bit, std::memory_order_acq_rel) & bit) == 0) {
+        scheduler->firstRequestMs[section].store(nowMs, std::memory_order_relaxed);
+    }
+    scheduler->requests.fetch_add(1, std::memory_order_relaxed);
+}
+
+static bool sectionDue(const NvsSaveScheduler* scheduler, int section, uint32_t nowMs) {
+    uint32_t sinceLast = nowMs - scheduler->lastRequestMs[section].load(std::memory_order_relaxed);
+    uint32_t sinceFirst = nowMs - scheduler->firstRequestMs[section].load(std::memory_order_relaxed);
+    return sinceLast >= scheduler->debounceMs || sinceFirst >= scheduler->maxDelayMs;
+}
+
+uint32_t nvsSaveSchedulerTakeDue(NvsSaveScheduler* scheduler, uint32_t nowMs, bool flushAll) {
+    uint32_t dirty = scheduler->dirtyMask.load(std::memory_order_acquire);
+    uint32_t due = 0;
+    for (int i = 0; i < NVS_SAVE_MAX_SECTIONS; i++) {
+        uint32_t bit = 1UL << i;
+        if ((dirty & bit) && (flushAll || sectionDue(scheduler, i, nowMs))) due |= bit;
+    }
+    // A request racing with this clear set the bit again (its value is then written now and once more later)
+    if (due) scheduler->dirtyMask.fetch_and(~due, std::memory_order_acq_rel);
+    return due;
+}
+
+void nvsSaveSchedulerRecordWrite(NvsSaveScheduler* scheduler, uint32_t bytes) {
+    scheduler->writes.fetch_add(1, std::memory_order_relaxed);
+    scheduler->bytesWritten.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+uint32_t nvsSaveSchedulerNextDueMs(const NvsSaveScheduler* scheduler, uint32_t nowMs) {
+    uint32_t dirty = scheduler->dirtyMask.load(std::memory_order_acquire);
+    uint32_t next = NVS_SAVE_NOTHING_PENDING;
+    for (int i = 0; i < NVS_SAVE_MAX_SECTIONS; i++) {
+        if (!(dirty & (1UL << i))) continue;
+        if (sectionDue(scheduler, i, nowMs)) return 0;
+        uint32_t sinceLast = nowMs - scheduler->lastRequestMs[i].load(std::memory_order_relaxed);
+        uint32_t sinceFirst = nowMs - scheduler->firstRequestMs[i].load(std::memory_order_relaxed);
+        uint32_t wait = scheduler->debounceMs - sinceLast;
+        if (scheduler->maxDelayMs - sinceFirst < wait) wait = scheduler->maxDelayMs - sinceFirst;
+        if (wait < next) next = wait;
+    }
+    return next;
+}
+
+int nvsSaveSchedulerPending(const NvsSaveScheduler* scheduler) {
+    uint32_t dirty = scheduler->dirtyMask.load(std::memory_order_relaxed);
+    int count = 0;
+    for (; dirty; dirty &= dirty - 1) count++;
+    return count;
+}
+
+uint32_t nvsSaveSchedulerWritesAvoided(const NvsSaveScheduler* scheduler) {
+    uint32_t requests = scheduler->requests.load(std::memory_order_relaxed);
+    uint32_t settled = scheduler->writes.load(std::memory_order_relaxed) + (uint32_t)nvsSaveSchedulerPending(scheduler);
+    return requests > settled ? requests - settled : 0;
+}
@@ -0,0 +1,43 @@
+#ifndef NVS_SAVE_SCHEDULER_H
+#define NVS_SAVE_SCHEDULER_H
+
+#include <stdint.h>
+#include <atomic>
+
+// Dirty tracking and write coalescing for the NVS persistence task. Any task marks a config section dirty
+// after changing it in RAM; the section is written once it has been quiet for the debounce window, or once
+// it has been dirty for maxDelay (a setting changed continuously is still saved). Every request that lands
+// while its section is already dirty is folded into the pending write.
+// Sections are numbered 0..31 (one bit each); the numbering is up to the caller.
+
+const int NVS_SAVE_MAX_SECTIONS = 32;
+const uint32_t NVS_SAVE_NOTHING_PENDING = UINT32_MAX;
+
+struct NvsSaveScheduler {
+    uint32_t debounceMs;
+    uint32_t maxDelayMs;
+    std::atomic<uint32_t> dirtyMask;
+    std::atomic<uint32_t> firstRequestMs[NVS_SAVE_MAX_SECTIONS]; // Request that made the section dirty
+    std::atomic<uint32_t> lastRequestMs[NVS_SAVE_MAX_SECTIONS];
+    std::atomic<uint32_t> requests;     // All save requests
+    std::atomic<uint32_t> writes;       // Sections written (writer side)
+    std::atomic<uint32_t> bytesWritten; // Payload bytes handed to NVS (writer side)
+};
+
+void nvsSaveSchedulerInit(NvsSaveScheduler* scheduler, uint32_t debounceMs, uint32_t maxDelayMs);
+
+// Any task. The new value must already be in RAM: the writer reads it only after taking the section.
+void nvsSaveSchedulerRequest(NvsSaveScheduler* scheduler, int section, uint32_t nowMs);
+
+// Single writer. Clears and returns the sections due at nowMs (all dirty ones if flushAll); write each of
+// them, then report it with nvsSaveSchedulerRecordWrite.
+uint32_t nvsSaveSchedulerTakeDue(NvsSaveScheduler* scheduler, uint32_t nowMs, bool flushAll);
+void nvsSaveSchedulerRecordWrite(NvsSaveScheduler* scheduler, uint32_t bytes);
+
+// Milliseconds until the next section falls due (0 if one is due now), NVS_SAVE_NOTHING_PENDING if none is dirty.
+uint32_t nvsSaveSchedulerNextDueMs(const NvsSaveScheduler* scheduler, uint32_t nowMs);
+
+int nvsSaveSchedulerPending(const NvsSaveScheduler* scheduler); // Dirty sections
+uint32_t nvsSaveSchedulerWritesAvoided(const NvsSaveScheduler* scheduler); // Requests folded into another write
+
+#endif // NVS_SAVE_SCHEDULER_H
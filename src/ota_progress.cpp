@@ -0,0 +1,37 @@
+#include "ota_progress.h"
+
+void otaProgressStart(OtaProgress* progress, uint32_t nowMs) {
+    progress->bytesDone = 0;
+    progress->bytesTotal = 0;
+    progress->bytesPerSec = 0;
+    progress->etaS = OTA_PROGRESS_ETA_UNKNOWN;
+    progress->startMs = nowMs;
+    progress->lastReportMs = nowMs;
+    progress->lastReportBytes = 0;
+}
+
+bool otaProgressUpdate(OtaProgress* progress, uint32_t bytesDone, uint32_t bytesTotal, uint32_t nowMs, uint32_t reportIntervalMs) {
+    progress->bytesDone = bytesDone;
+    progress->bytesTotal = bytesTotal;
+    uint32_t elapsedMs = nowMs - progress->lastReportMs;
+    bool complete = bytesTotal > 0 && bytesDone >= bytesTotal;
+    if (elapsedMs < reportIntervalMs && !complete) return false;
+
+    if (elapsedMs > 0 && bytesDone >= progress->lastReportBytes) {
+        uint32_t rate = (uint32_t)((uint64_t)(bytesDone - progress->lastReportBytes) * 1000 / elapsedMs);
+        // 1/4 weight for the newest interval: steady enough for an ETA, quick to follow a slower link
+        progress->bytesPerSec = progress->bytesPerSec == 0 ? rate : (progress->bytesPerSec * 3 + rate) / 4;
+    }
+    if (complete) progress->etaS = 0;
+    else if (bytesTotal > bytesDone && progress->bytesPerSec > 0) progress->etaS = (bytesTotal - bytesDone + progress->bytesPerSec - 1) / progress->bytesPerSec;
+    else progress->etaS = OTA_PROGRESS_ETA_UNKNOWN;
+    progress->lastReportMs = nowMs;
+    progress->lastReportBytes = bytesDone;
+    return true;
+}
+
+uint8_t otaProgressPercent(const OtaProgress* progress) {
+    if (progress->bytesTotal == 0) return 0;
+    if (progress->bytesDone >= progress->bytesTotal) return 100;
+    return (uint8_t)((uint64_t)progress->bytesDone * 100 / progress->bytesTotal);
+}
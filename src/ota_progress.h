@@ -0,0 +1,27 @@
+#ifndef OTA_PROGRESS_H
+#define OTA_PROGRESS_H
+
+#include <stdint.h>
+
+// Download progress of an OTA image: bytes, smoothed throughput and ETA. Fed from HTTPUpdate's progress
+// callback, which fires for every chunk; otaProgressUpdate says when enough time passed to report again.
+// One writer (the OTA task); readers on other tasks only read whole 32-bit fields.
+
+const uint32_t OTA_PROGRESS_ETA_UNKNOWN = UINT32_MAX;
+
+struct OtaProgress {
+    uint32_t bytesDone;
+    uint32_t bytesTotal;   // 0 until the server sent a length
+    uint32_t bytesPerSec;  // Smoothed over report intervals, 0 until the first interval ended
+    uint32_t etaS;         // OTA_PROGRESS_ETA_UNKNOWN without a length or a rate
+    uint32_t startMs;
+    uint32_t lastReportMs;
+    uint32_t lastReportBytes;
+};
+
+void otaProgressStart(OtaProgress* progress, uint32_t nowMs); // Before each image
+// Returns true when a report is due: reportIntervalMs since the last one, or the image is complete.
+bool otaProgressUpdate(OtaProgress* progress, uint32_t bytesDone, uint32_t bytesTotal, uint32_t nowMs, uint32_t reportIntervalMs);
+uint8_t otaProgressPercent(const OtaProgress* progress);
+
+#endif // OTA_PROGRESS_H
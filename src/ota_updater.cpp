@@ -1,12 +1,45 @@
 #include "ota_updater.h"
-#include "config.h"        // For FIRMWARE_VERSION, GITHUB defines, ota_status_message etc.
-#include "display_handler.h" // For displayMenu()
+#include "config.h"        // For FIRMWARE_VERSION, GITHUB defines, ota_in_progress etc.
+#include "nvs_handler.h"     // For flushNvsSaves()
 #include <WiFiClientSecure.h> 
 #include <HTTPClient.h>
 #include <HTTPUpdate.h>
 #include <ArduinoJson.h>
 // SPIFFS is already included via config.h if needed here, but direct file ops are in main.cpp
 
+const uint32_t OTA_TASK_STACK_SIZE = 12288; // TLS handshake + JSON parse of the release listing
+
+static char otaStatusMessage[96] = "OTA Idle";
+static portMUX_TYPE otaStatusMux = portMUX_INITIALIZER_UNLOCKED;
+
+void setOtaStatusMessage(const String& message) {
+    portENTER_CRITICAL(&otaStatusMux);
+    strncpy(otaStatusMessage, message.c_str(), sizeof(otaStatusMessage) - 1);
+    otaStatusMessage[sizeof(otaStatusMessage) - 1] = '\0';
+    portEXIT_CRITICAL(&otaStatusMux);
+}
+
+String getOtaStatusMessage() {
+    char copy[sizeof(otaStatusMessage)];
+    copyOtaStatusMessage(copy, sizeof(copy));
+    return String(copy);
+}
+
+void copyOtaStatusMessage(char* out, size_t size) {
+    if (size == 0) return;
+    portENTER_CRITICAL(&otaStatusMux);
+    strncpy(out, otaStatusMessage, size - 1);
+    portEXIT_CRITICAL(&otaStatusMux);
+    out[size - 1] = '\0';
+}
+
+// HTTPUpdate calls this for every chunk written; a report is broadcast (WebSocket, MQTT, LCD) at most once per OTA_PROGRESS_REPORT_MS
+static void onOtaDownloadProgress(int bytesDone, int bytesTotal) {
+    if (!otaProgressUpdate(&otaProgress, bytesDone, bytesTotal > 0 ? bytesTotal : 0, millis(), OTA_PROGRESS_REPORT_MS)) return;
+    needsImmediateBroadcast = true;
+    if(serialDebugEnabled) Serial.printf("[OTA] %u / %u bytes (%u%%), %u B/s\n", otaProgress.bytesDone, otaProgress.bytesTotal, otaProgressPercent(&otaProgress), otaProgress.bytesPerSec);
+}
+
 bool isVersionNewer(const String& currentVersionStr, const String& latestVersionStr) {
     String current = currentVersionStr;
     String latest = latestVersionStr;
@@ -19,16 +52,14 @@ GithubReleaseInfo getLatestGithubReleaseInfo() {
     GithubReleaseInfo info;
     info.isValid = false;
     
-    ota_status_message = "Fetching release info...";
+    setOtaStatusMessage("Fetching release info...");
     needsImmediateBroadcast = true;
-    if(isInMenuMode) displayMenu();
 
 
     if (WiFi.status() != WL_CONNECTED) {
-        ota_status_message = "Error: WiFi not connected.";
+        setOtaStatusMessage("Error: WiFi not connected.");
         needsImmediateBroadcast = true;
-        if(serialDebugEnabled) Serial.println("[OTA] " + ota_status_message);
-        if(isInMenuMode) displayMenu();
+        if(serialDebugEnabled) Serial.println("[OTA] " + getOtaStatusMessage());
         return info;
     }
 
@@ -37,10 +68,9 @@ GithubReleaseInfo getLatestGithubReleaseInfo() {
 
     // Use the GITHUB_API_ROOT_CA_STRING loaded from SPIFFS
     if (GITHUB_API_ROOT_CA_STRING.isEmpty()) { 
-        ota_status_message = "Error: No Root CA loaded for secure OTA.";
+        setOtaStatusMessage("Error: No Root CA loaded for secure OTA.");
         needsImmediateBroadcast = true;
-        if(serialDebugEnabled) Serial.println("[OTA_ERR] " + ota_status_message + " Check " + GITHUB_ROOT_CA_FILENAME + " on SPIFFS.");
-        if(isInMenuMode) displayMenu();
+        if(serialDebugEnabled) Serial.println("[OTA_ERR] " + getOtaStatusMessage() + " Check " + GITHUB_ROOT_CA_FILENAME + " on SPIFFS.");
         return info;
     }
     
@@ -58,13 +88,13 @@ GithubReleaseInfo getLatestGithubReleaseInfo() {
             DeserializationError error = deserializeJson(doc, payload);
 
             if (error) {
-                ota_status_message = "Error: Parse API JSON failed.";
+                setOtaStatusMessage("Error: Parse API JSON failed.");
                 if(serialDebugEnabled) Serial.printf("[OTA] deserializeJson() failed: %s\n", error.c_str());
             } else {
                 info.tagName = doc["tag_name"].as<String>();
                 if (info.tagName.isEmpty()) {
-                    ota_status_message = "Error: No tag_name in release.";
-                     if(serialDebugEnabled) Serial.println("[OTA] " + ota_status_message);
+                    setOtaStatusMessage("Error: No tag_name in release.");
+                     if(serialDebugEnabled) Serial.println("[OTA] " + getOtaStatusMessage());
                 } else {
                     JsonArray assets = doc["assets"].as<JsonArray>();
                     String expectedFirmwareName = "firmware_" PIO_BUILD_ENV_NAME "_" + info.tagName + ".bin";
@@ -81,177 +111,186 @@ GithubReleaseInfo getLatestGithubReleaseInfo() {
 
                     if (!info.firmwareAssetURL.isEmpty()) { 
                         info.isValid = true;
-                        ota_status_message = "Latest release: " + info.tagName;
+                        setOtaStatusMessage("Latest release: " + info.tagName);
                         if(serialDebugEnabled) Serial.println("[OTA] Found: " + info.tagName + ", FW: " + info.firmwareAssetURL + ", FS: " + info.spiffsAssetURL);
                     } else {
-                        ota_status_message = "Error: FW asset missing for " + info.tagName;
-                        if(serialDebugEnabled) Serial.println("[OTA] " + ota_status_message);
+                        setOtaStatusMessage("Error: FW asset missing for " + info.tagName);
+                        if(serialDebugEnabled) Serial.println("[OTA] " + getOtaStatusMessage());
                         if(serialDebugEnabled) Serial.println("[OTA] Expected FW: " + expectedFirmwareName);
                     }
                 }
             }
         } else { 
-            ota_status_message = "Error: API request failed. Code: " + String(httpCode);
+            setOtaStatusMessage("Error: API request failed. Code: " + String(httpCode));
             if(serialDebugEnabled) Serial.printf("[OTA_ERR] Secure GitHub API request failed. HTTP Code: %d, Error: %s\n", httpCode, http.errorToString(httpCode).c_str());
         }
         http.end();
     } else { 
-        ota_status_message = "Error: Connect to GitHub API failed.";
+        setOtaStatusMessage("Error: Connect to GitHub API failed.");
         if(serialDebugEnabled) Serial.println("[OTA_ERR] http.begin (secure) failed for GitHub API.");
     }
     
     needsImmediateBroadcast = true;
-    if(isInMenuMode) displayMenu();
     return info;
 }
 
 
 void performOTAUpdateProcess(const String& latestVersionTag, const String& firmwareURL, const String& spiffsURL) {
     ota_in_progress = true;
-    ota_status_message = "Starting update to " + latestVersionTag + "...";
+    setOtaStatusMessage("Starting update to " + latestVersionTag + "...");
     needsImmediateBroadcast = true;
-    if(serialDebugEnabled) Serial.println("[OTA] " + ota_status_message);
-    if(isInMenuMode) displayMenu(); 
+    if(serialDebugEnabled) Serial.println("[OTA] " + getOtaStatusMessage());
 
     vTaskDelay(pdMS_TO_TICKS(200)); 
 
     t_httpUpdate_return ret;
+    httpUpdate.rebootOnUpdate(false); // Reboot ourselves below, after pending settings are written
+    httpUpdate.onProgress(onOtaDownloadProgress);
 
     // Use the GITHUB_API_ROOT_CA_STRING loaded from SPIFFS
     if (GITHUB_API_ROOT_CA_STRING.isEmpty()) { 
-        ota_status_message = "Error: No Root CA loaded for secure OTA.";
+        setOtaStatusMessage("Error: No Root CA loaded for secure OTA.");
         needsImmediateBroadcast = true;
-        if(serialDebugEnabled) Serial.println("[OTA_ERR] " + ota_status_message + " Firmware/SPIFFS update aborted.");
-        if(isInMenuMode) displayMenu();
+        if(serialDebugEnabled) Serial.println("[OTA_ERR] " + getOtaStatusMessage() + " Firmware/SPIFFS update aborted.");
         ota_in_progress = false;
         return;
     }
 
     // --- Firmware Update ---
     if (!firmwareURL.isEmpty()) {
-        ota_status_message = "Updating FW: " + latestVersionTag;
+        setOtaStatusMessage("Updating FW: " + latestVersionTag);
         needsImmediateBroadcast = true;
-        if(serialDebugEnabled) Serial.println("[OTA] " + ota_status_message);
-        if(isInMenuMode) displayMenu();
+        if(serialDebugEnabled) Serial.println("[OTA] " + getOtaStatusMessage());
         vTaskDelay(pdMS_TO_TICKS(100));
 
         WiFiClientSecure fwClient; 
         fwClient.setCACert(GITHUB_API_ROOT_CA_STRING.c_str()); // Use loaded CA string
         if(serialDebugEnabled) Serial.println("[OTA_FW] Attempting secure FW update...");
+        otaProgressStart(&otaProgress, millis());
         
         httpUpdate.setFollowRedirects(HTTPC_FORCE_FOLLOW_REDIRECTS); 
         ret = httpUpdate.update(fwClient, firmwareURL);
         
         switch (ret) {
             case HTTP_UPDATE_FAILED:
-                ota_status_message = "FW update failed: " + httpUpdate.getLastErrorString();
+                setOtaStatusMessage("FW update failed: " + httpUpdate.getLastErrorString());
                 if(serialDebugEnabled) Serial.printf("[OTA_FW_ERR] Secure Error (%d): %s\n", httpUpdate.getLastError(), httpUpdate.getLastErrorString().c_str());
                 break;
             case HTTP_UPDATE_NO_UPDATES: 
-                ota_status_message = "FW: No updates (server).";
+                setOtaStatusMessage("FW: No updates (server).");
                 if(serialDebugEnabled) Serial.println("[OTA_FW] No firmware updates.");
                 break;
             case HTTP_UPDATE_OK:
-                ota_status_message = "FW update OK! Rebooting...";
+                setOtaStatusMessage("FW update OK! Rebooting...");
                 if(serialDebugEnabled) Serial.println("[OTA_FW] Firmware update OK.");
                 needsImmediateBroadcast = true;
-                if(isInMenuMode) displayMenu();
+                flushNvsSaves();
                 delay(1000); 
                 ESP.restart(); 
                 return; 
         }
     } else {
-        ota_status_message = "FW URL missing. Skip FW.";
-        if(serialDebugEnabled) Serial.println("[OTA] " + ota_status_message);
+        setOtaStatusMessage("FW URL missing. Skip FW.");
+        if(serialDebugEnabled) Serial.println("[OTA] " + getOtaStatusMessage());
     }
     needsImmediateBroadcast = true;
-    if(isInMenuMode) displayMenu();
 
     // --- SPIFFS Update ---
     if (!spiffsURL.isEmpty()) {
-        ota_status_message = "Updating FS: " + latestVersionTag;
+        setOtaStatusMessage("Updating FS: " + latestVersionTag);
         needsImmediateBroadcast = true;
-        if(serialDebugEnabled) Serial.println("[OTA] " + ota_status_message);
-        if(isInMenuMode) displayMenu();
+        if(serialDebugEnabled) Serial.println("[OTA] " + getOtaStatusMessage());
         vTaskDelay(pdMS_TO_TICKS(100));
 
         WiFiClientSecure fsClient; 
         fsClient.setCACert(GITHUB_API_ROOT_CA_STRING.c_str()); // Use loaded CA string
         if(serialDebugEnabled) Serial.println("[OTA_FS] Attempting secure FS update...");
+        otaProgressStart(&otaProgress, millis());
 
         httpUpdate.setFollowRedirects(HTTPC_FORCE_FOLLOW_REDIRECTS);
         ret = httpUpdate.updateSpiffs(fsClient, spiffsURL);
 
         switch (ret) {
             case HTTP_UPDATE_FAILED:
-                ota_status_message = "FS update failed: " + httpUpdate.getLastErrorString();
+                setOtaStatusMessage("FS update failed: " + httpUpdate.getLastErrorString());
                 if(serialDebugEnabled) Serial.printf("[OTA_FS_ERR] Secure Error (%d): %s\n", httpUpdate.getLastError(), httpUpdate.getLastErrorString().c_str());
                 break;
             case HTTP_UPDATE_NO_UPDATES:
-                ota_status_message = "FS: No updates (server).";
+                setOtaStatusMessage("FS: No updates (server).");
                 if(serialDebugEnabled) Serial.println("[OTA_FS] No SPIFFS updates.");
                 break;
             case HTTP_UPDATE_OK:
-                ota_status_message = "FS update OK! Rebooting...";
+                setOtaStatusMessage("FS update OK! Rebooting...");
                 if(serialDebugEnabled) Serial.println("[OTA_FS] SPIFFS update OK.");
                 needsImmediateBroadcast = true;
-                if(isInMenuMode) displayMenu();
+                flushNvsSaves();
                 delay(1000);
                 ESP.restart();
                 return; 
         }
     } else {
-        ota_status_message = "FS URL missing. Skip FS.";
-         if(serialDebugEnabled) Serial.println("[OTA] " + ota_status_message);
+        setOtaStatusMessage("FS URL missing. Skip FS.");
+         if(serialDebugEnabled) Serial.println("[OTA] " + getOtaStatusMessage());
     }
 
     ota_in_progress = false; 
     needsImmediateBroadcast = true;
-    if(isInMenuMode) displayMenu();
 }
 
 
-void triggerOTAUpdateCheck() {
-    if (ota_in_progress) {
-        ota_status_message = "OTA update already in progress.";
-        needsImmediateBroadcast = true;
-        if(serialDebugEnabled) Serial.println("[OTA] " + ota_status_message);
-        if(isInMenuMode) displayMenu();
-        return;
-    }
-
-    ota_in_progress = true; 
-    ota_status_message = "Checking for updates...";
-    needsImmediateBroadcast = true;
-    if(serialDebugEnabled) Serial.println("[OTA] " + ota_status_message);
-    if(isInMenuMode) displayMenu(); 
-
+// Check and update, in OtaTask (ota_in_progress is already set)
+static void runOTAUpdateCheck() {
     GithubReleaseInfo releaseInfo = getLatestGithubReleaseInfo();
 
     if (!releaseInfo.isValid) {
         ota_in_progress = false; 
         needsImmediateBroadcast = true;
-        if(isInMenuMode) displayMenu();
         return;
     }
 
     if (isVersionNewer(FIRMWARE_VERSION, releaseInfo.tagName)) {
-        ota_status_message = "New: " + releaseInfo.tagName + " Curr: " FIRMWARE_VERSION;
+        setOtaStatusMessage("New: " + releaseInfo.tagName + " Curr: " FIRMWARE_VERSION);
         needsImmediateBroadcast = true;
-        if(serialDebugEnabled) Serial.println("[OTA] " + ota_status_message);
-        if(isInMenuMode) displayMenu();
+        if(serialDebugEnabled) Serial.println("[OTA] " + getOtaStatusMessage());
         
-        ota_status_message = "Preparing to update...";
+        setOtaStatusMessage("Preparing to update...");
         needsImmediateBroadcast = true;
-        if(isInMenuMode) displayMenu();
         vTaskDelay(pdMS_TO_TICKS(2000)); 
 
         performOTAUpdateProcess(releaseInfo.tagName, releaseInfo.firmwareAssetURL, releaseInfo.spiffsAssetURL);
     } else {
-        ota_status_message = "Firmware is up to date (" FIRMWARE_VERSION ").";
+        setOtaStatusMessage("Firmware is up to date (" FIRMWARE_VERSION ").");
         needsImmediateBroadcast = true;
-        if(serialDebugEnabled) Serial.println("[OTA] " + ota_status_message);
+        if(serialDebugEnabled) Serial.println("[OTA] " + getOtaStatusMessage());
         ota_in_progress = false; 
     }
-    if(isInMenuMode) displayMenu(); 
+}
+
+static void otaUpdateTask(void *pvParameters) {
+    runOTAUpdateCheck();
+    vTaskDelete(NULL);
+}
+
+void triggerOTAUpdateCheck() {
+    if (ota_in_progress) {
+        setOtaStatusMessage("OTA update already in progress.");
+        needsImmediateBroadcast = true;
+        if(serialDebugEnabled) Serial.println("[OTA] " + getOtaStatusMessage());
+        return;
+    }
+
+    ota_in_progress = true; 
+    otaProgressStart(&otaProgress, millis());
+    setOtaStatusMessage("Checking for updates...");
+    needsImmediateBroadcast = true;
+    if(serialDebugEnabled) Serial.println("[OTA] " + getOtaStatusMessage());
+
+    // Core 1 below mainAppTask and controlTask: the download only gets time they leave over, and core 0
+    // stays with networkTask and the WiFi stack, so WebSocket, ElegantOTA and MQTT keepalives keep running.
+    if (xTaskCreatePinnedToCore(otaUpdateTask, "OtaTask", OTA_TASK_STACK_SIZE, NULL, 1, NULL, 1) != pdPASS) {
+        setOtaStatusMessage("Error: Could not start OTA task.");
+        needsImmediateBroadcast = true;
+        if(serialDebugEnabled) Serial.println("[OTA_ERR] " + getOtaStatusMessage());
+        ota_in_progress = false;
+    }
 }
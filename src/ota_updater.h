@@ -4,11 +4,16 @@
 #include "config.h"
 
 // Call this function to check for updates and start the process if one is available.
-// It will update the global ota_status_message and ota_in_progress flags.
+// The check and download run in their own task (OtaTask) and this returns at once, so the caller's task
+// (network, UI) keeps running. Status and download progress are pushed out through needsImmediateBroadcast.
 void triggerOTAUpdateCheck();
 
-// Function to be called in a task to perform the actual update process
-// This is separated to allow UI updates before this blocking operation starts.
+// Status line shown on the LCD, the web UI and in MQTT status. Safe to call from any task.
+void setOtaStatusMessage(const String& message);
+String getOtaStatusMessage();
+void copyOtaStatusMessage(char* out, size_t size); // Same, without a String (status serialization)
+
+// Runs in OtaTask. Reboots on success; otherwise clears ota_in_progress when done.
 void performOTAUpdateProcess(const String& latestVersionTag, const String& firmwareURL, const String& spiffsURL);
 
 // Helper to compare versions. Returns true if latestVersionStr is newer than currentVersionStr.
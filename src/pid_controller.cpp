@@ -0,0 +1,40 @@
+#include "pid_controller.h"
+
+static float clampFloat(float value, float lo, float hi) {
+    if (value < lo) return lo;
+    if (value > hi) return hi;
+    return value;
+}
+
+void pidReset(PidState* state, const PidGains& gains, float setpoint, float currentOutput, float measurement,
+              float outMin, float outMax) {
+    state->integral = clampFloat(currentOutput - gains.kp * (measurement - setpoint), outMin, outMax);
+    state->prevMeasurement = measurement;
+    state->filteredDerivative = 0.0f;
+    state->output = currentOutput;
+}
+
+float pidUpdate(PidState* state, const PidGains& gains, float setpoint, float measurement,
+                float dtSeconds, float outMin, float outMax) {
+    if (dtSeconds <= 0.0f) return state->output;
+
+    const float error = measurement - setpoint; // Positive when too hot
+
+    const float rawDerivative = (measurement - state->prevMeasurement) / dtSeconds;
+    state->prevMeasurement = measurement;
+    state->filteredDerivative += (rawDerivative - state->filteredDerivative) * (dtSeconds / (PID_DERIVATIVE_FILTER_TAU_S + dtSeconds));
+
+    const float proportional = gains.kp * error;
+    const float derivative = gains.kd * state->filteredDerivative;
+
+    float integral = clampFloat(state->integral + gains.ki * error * dtSeconds, outMin, outMax);
+    const float unclamped = proportional + integral + derivative;
+    // Conditional integration: keep the old integrator if this step would push further into saturation
+    if ((unclamped > outMax && error > 0.0f) || (unclamped < outMin && error < 0.0f)) {
+        integral = state->integral;
+    }
+    state->integral = integral;
+
+    state->output = clampFloat(proportional + integral + derivative, outMin, outMax);
+    return state->output;
+}
@@ -0,0 +1,35 @@
+#ifndef PID_CONTROLLER_H
+#define PID_CONTROLLER_H
+
+// Reverse-acting PID for fan control: output (fan %) rises when the measured temperature is above the setpoint.
+
+// Time constant of the first-order low-pass on the derivative term. The BMP280 is read every 2 s,
+// so the raw derivative is a train of spikes; a few seconds of smoothing turns it into a usable trend.
+const float PID_DERIVATIVE_FILTER_TAU_S = 4.0f;
+
+struct PidGains {
+    float kp; // % per C
+    float ki; // % per C per second
+    float kd; // % per C/s
+};
+
+struct PidState {
+    float integral;           // Integral term, already scaled by ki (output units)
+    float prevMeasurement;
+    float filteredDerivative; // d(measurement)/dt after the low-pass, C/s
+    float output;             // Last clamped output
+};
+
+// Bumpless start: seeds the integrator with currentOutput minus the proportional term for the current
+// error, so the first update continues from currentOutput. The seed is clamped to [outMin, outMax]; if
+// that clamp bites, the first output still moves by the part of kp * error that did not fit.
+void pidReset(PidState* state, const PidGains& gains, float setpoint, float currentOutput, float measurement,
+              float outMin, float outMax);
+
+// One controller step. The derivative acts on the measurement (no kick on setpoint changes).
+// Anti-windup: integration is held while the output is saturated in the direction of the error,
+// and the integrator itself is clamped to [outMin, outMax].
+float pidUpdate(PidState* state, const PidGains& gains, float setpoint, float measurement,
+                float dtSeconds, float outMin, float outMax);
+
+#endif // PID_CONTROLLER_H
@@ -0,0 +1,92 @@
+#include "static_arena.h"
+#include <string.h>
+
+// Each block is preceded by its size; 8-byte alignment covers doubles and pointers on the ESP32 and host
+static const size_t ARENA_ALIGN = 8;
+static const size_t ARENA_HEADER = 8;
+
+static size_t alignUp(size_t size) {
+    return (size + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1);
+}
+
+static size_t blockOffset(const StaticArena* arena, const void* block) {
+    return (size_t)((const uint8_t*)block - arena->buffer) - ARENA_HEADER;
+}
+
+static size_t blockSize(const StaticArena* arena, size_t offset) {
+    uint32_t size;
+    memcpy(&size, arena->buffer + offset, sizeof(size));
+    return size;
+}
+
+static void setBlockSize(StaticArena* arena, size_t offset, size_t size) {
+    uint32_t stored = (uint32_t)size;
+    memcpy(arena->buffer + offset, &stored, sizeof(stored));
+}
+
+void staticArenaInit(StaticArena* arena, void* buffer, size_t capacity) {
+    memset(arena, 0, sizeof(*arena));
+    // Start on an aligned address, whatever the caller's buffer
+    size_t skew = (ARENA_ALIGN - ((uintptr_t)buffer & (ARENA_ALIGN - 1))) & (ARENA_ALIGN - 1);
+    arena->buffer = (uint8_t*)buffer + skew;
+    arena->capacity = capacity > skew ? (capacity - skew) & ~(ARENA_ALIGN - 1) : 0;
+}
+
+void* staticArenaAllocate(StaticArena* arena, size_t size) {
+    size_t need = ARENA_HEADER + alignUp(size);
+    if (size == 0 || need > arena->capacity - arena->used) {
+        arena->failures++;
+        return nullptr;
+    }
+    size_t offset = arena->used;
+    setBlockSize(arena, offset, size);
+    arena->lastBlock = offset;
+    arena->used += need;
+    arena->liveBlocks++;
+    if (arena->used > arena->highWater) arena->highWater = arena->used;
+    return arena->buffer + offset + ARENA_HEADER;
+}
+
+void staticArenaFree(StaticArena* arena, void* block) {
+    if (!block || arena->liveBlocks == 0) return;
+    size_t offset = blockOffset(arena, block);
+    arena->liveBlocks--;
+    if (arena->liveBlocks == 0) {
+        arena->used = 0;
+        arena->lastBlock = 0;
+    } else if (offset == arena->lastBlock && offset + ARENA_HEADER + alignUp(blockSize(arena, offset)) == arena->used) {
+        arena->used = offset; // Newest block: give its space back now (the one before it stays unknown)
+        arena->lastBlock = (size_t)-1;
+    }
+}
+
+void* staticArenaReallocate(StaticArena* arena, void* block, size_t size) {
+    if (!block) return staticArenaAllocate(arena, size);
+    size_t offset = blockOffset(arena, block);
+    size_t oldSize = blockSize(arena, offset);
+    if (offset == arena->lastBlock) { // Grow or shrink in place
+        size_t need = ARENA_HEADER + alignUp(size);
+        if (size == 0 || need > arena->capacity - offset) {
+            arena->failures++;
+            return nullptr;
+        }
+        setBlockSize(arena, offset, size);
+        arena->used = offset + need;
+        if (arena->used > arena->highWater) arena->highWater = arena->used;
+        return block;
+    }
+    if (size <= oldSize) {
+        setBlockSize(arena, offset, size);
+        return block;
+    }
+    void* moved = staticArenaAllocate(arena, size);
+    if (!moved) return nullptr;
+    memcpy(moved, block, oldSize);
+    staticArenaFree(arena, block);
+    return moved;
+}
+
+uint8_t heapFragmentationPercent(uint32_t freeBytes, uint32_t largestFreeBlock) {
+    if (freeBytes == 0 || largestFreeBlock >= freeBytes) return 0;
+    return (uint8_t)(100 - (uint64_t)largestFreeBlock * 100 / freeBytes);
+}
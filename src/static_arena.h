@@ -0,0 +1,29 @@
+#ifndef STATIC_ARENA_H
+#define STATIC_ARENA_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Bump allocator over a caller-owned buffer, so repeated serialization never touches the heap. Blocks are
+// freed individually but the space only comes back when the last live block goes (or, for the newest block,
+// at once), which is how a JSON document built and dropped per message uses it. Single task only.
+
+struct StaticArena {
+    uint8_t* buffer;
+    size_t capacity;
+    size_t used;
+    size_t highWater;    // Most bytes ever in use, block headers included
+    size_t lastBlock;    // Offset of the newest block's header, for in-place growth
+    uint32_t liveBlocks;
+    uint32_t failures;   // Requests that did not fit
+};
+
+void staticArenaInit(StaticArena* arena, void* buffer, size_t capacity);
+void* staticArenaAllocate(StaticArena* arena, size_t size);       // nullptr when it does not fit
+void staticArenaFree(StaticArena* arena, void* block);
+void* staticArenaReallocate(StaticArena* arena, void* block, size_t size); // nullptr (block kept) when it does not fit
+
+// 0 = all free heap in one block, 100 = badly split. For heap statistics; 0 when nothing is free.
+uint8_t heapFragmentationPercent(uint32_t freeBytes, uint32_t largestFreeBlock);
+
+#endif // STATIC_ARENA_H
@@ -0,0 +1,82 @@
+#include "status_memory.h"
+
+const size_t STATUS_SCRATCH_ARENA_SIZE = 16384; // Telemetry document, its delta and a snapshot at once
+const size_t STATUS_BASELINE_ARENA_SIZE = 6144;
+
+// ArduinoJson allocator on top of a StaticArena
+class ArenaJsonAllocator : public ArduinoJson::Allocator {
+public:
+    explicit ArenaJsonAllocator(StaticArena* arena) : arena(arena) {}
+    void* allocate(size_t size) override { return staticArenaAllocate(arena, size); }
+    void deallocate(void* block) override { staticArenaFree(arena, block); }
+    void* reallocate(void* block, size_t size) override { return staticArenaReallocate(arena, block, size); }
+private:
+    StaticArena* arena;
+};
+
+static uint8_t scratchMemory[STATUS_SCRATCH_ARENA_SIZE] __attribute__((aligned(8)));
+static uint8_t baselineMemory[STATUS_BASELINE_ARENA_SIZE] __attribute__((aligned(8)));
+static char textBuffer[STATUS_TEXT_BUFFER_SIZE];
+static StaticArena scratchArena;
+static StaticArena baselineArena;
+static bool arenasReady = false;
+static volatile uint32_t droppedMessages = 0;
+static volatile uint32_t scratchLeaks = 0;
+
+static void initArenas() {
+    if (arenasReady) return;
+    staticArenaInit(&scratchArena, scratchMemory, sizeof(scratchMemory));
+    staticArenaInit(&baselineArena, baselineMemory, sizeof(baselineMemory));
+    arenasReady = true;
+}
+
+// Constructed on first use: documents with static storage (the WebSocket baseline) ask during startup
+ArduinoJson::Allocator* statusScratchAllocator() {
+    static ArenaJsonAllocator allocator(&scratchArena);
+    initArenas();
+    return &allocator;
+}
+
+ArduinoJson::Allocator* statusBaselineAllocator() {
+    static ArenaJsonAllocator allocator(&baselineArena);
+    initArenas();
+    return &allocator;
+}
+
+char* statusTextBuffer() {
+    return textBuffer;
+}
+
+size_t serializeStatusJson(const ArduinoJson::JsonDocument& doc, char* out, size_t size) {
+    size_t length = doc.overflowed() ? 0 : serializeJson(doc, out, size);
+    if (length == 0 || length >= size - 1) { // Full buffer: assume the message was cut
+        droppedMessages++;
+        if(serialDebugEnabled) Serial.printf("[MEM_ERR] Status message dropped (%s).\n", doc.overflowed() ? "JSON arena full" : "text buffer full");
+        return 0;
+    }
+    return length;
+}
+
+void countDroppedStatusMessage() {
+    droppedMessages++;
+}
+
+void checkStatusScratchReleased() {
+    if (scratchArena.used == 0) return;
+    if(serialDebugEnabled && scratchLeaks == 0) {
+        Serial.printf("[MEM_ERR] Status scratch arena not released: %u bytes in %lu blocks.\n",
+                      (unsigned)scratchArena.used, (unsigned long)scratchArena.liveBlocks);
+    }
+    scratchLeaks++;
+}
+
+void getStatusMemoryStats(StatusMemoryStats* stats) {
+    stats->heapFree = ESP.getFreeHeap();
+    stats->heapMinFree = ESP.getMinFreeHeap();
+    stats->heapLargestBlock = ESP.getMaxAllocHeap();
+    stats->heapFragPercent = heapFragmentationPercent(stats->heapFree, stats->heapLargestBlock);
+    stats->arenaPeakBytes = scratchArena.highWater + baselineArena.highWater;
+    stats->arenaCapacity = STATUS_SCRATCH_ARENA_SIZE + STATUS_BASELINE_ARENA_SIZE;
+    stats->dropped = droppedMessages;
+    stats->scratchLeaks = scratchLeaks;
+}
@@ -0,0 +1,44 @@
+#ifndef STATUS_MEMORY_H
+#define STATUS_MEMORY_H
+
+#include "config.h"
+#include <ArduinoJson.h>
+#include "static_arena.h"
+
+// Fixed memory for the status documents networkTask builds on every broadcast and publish (WebSocket
+// telemetry/config, MQTT status), so they never allocate from the heap: JsonDocuments take one of the
+// allocators below and are serialized into a char buffer, not a String. networkTask only.
+
+const size_t STATUS_TEXT_BUFFER_SIZE = 4096; // Largest serialized status message
+
+// Documents created and dropped within one broadcast/publish
+ArduinoJson::Allocator* statusScratchAllocator();
+// The WebSocket telemetry baseline, which lives from one broadcast to the next
+ArduinoJson::Allocator* statusBaselineAllocator();
+
+// networkTask, between passes: counts and reports a scratch document still alive, which would keep the
+// scratch arena from ever resetting (every later status message would then be dropped)
+void checkStatusScratchReleased();
+
+// Shared scratch text buffer, STATUS_TEXT_BUFFER_SIZE bytes
+char* statusTextBuffer();
+// Serializes into out; returns the length, or 0 (and counts it) if the message did not fit or the
+// document ran out of arena space, in which case nothing should be sent
+size_t serializeStatusJson(const ArduinoJson::JsonDocument& doc, char* out, size_t size);
+// Counts a serialized message the transport refused (e.g. an MQTT publish that failed)
+void countDroppedStatusMessage();
+
+struct StatusMemoryStats {
+    uint32_t heapFree;
+    uint32_t heapMinFree;       // Lowest free heap since boot
+    uint32_t heapLargestBlock;  // Largest single allocation possible now
+    uint8_t heapFragPercent;    // heapFragmentationPercent(heapFree, heapLargestBlock)
+    uint32_t arenaPeakBytes;    // Most arena space the status documents have needed
+    uint32_t arenaCapacity;
+    uint32_t dropped;           // Status messages not sent: arena or text buffer too small, or publish failed
+    uint32_t scratchLeaks;      // Passes that ended with scratch arena space still in use (should stay 0)
+};
+
+void getStatusMemoryStats(StatusMemoryStats* stats); // Any task (counters may be one message behind)
+
+#endif // STATUS_MEMORY_H
@@ -0,0 +1,86 @@
+#include "tach_counter.h"
+
+unsigned long tachCounterDelta(int previousCount, int currentCount, int wrapLimit) {
+    int delta = currentCount - previousCount;
+    if (delta < 0) delta += wrapLimit;
+    return (unsigned long)delta;
+}
+
+int tachPulsesToRpm(unsigned long pulses, unsigned long elapsedMillis, int pulsesPerRevolution) {
+    if (elapsedMillis == 0 || pulsesPerRevolution <= 0) return 0;
+    return (pulses / (float)pulsesPerRevolution) * (60000.0f / elapsedMillis);
+}
+
+static int periodToRpm(uint32_t periodMicros, int pulsesPerRevolution) {
+    if (periodMicros == 0) return 0;
+    return (int)((60000000.0f / pulsesPerRevolution) / periodMicros + 0.5f);
+}
+
+int tachPeriodRpm(const uint32_t* edgeMicros, int numEdges, uint32_t nowMicros, int pulsesPerRevolution, uint32_t stallTimeoutMicros) {
+    if (numEdges < 3 || pulsesPerRevolution <= 0) return -1;
+    if (numEdges > TACH_EDGE_HISTORY) numEdges = TACH_EDGE_HISTORY;
+
+    // Insertion sort of at most TACH_EDGE_HISTORY - 1 periods (unsigned subtraction handles micros() wrap)
+    uint32_t periods[TACH_EDGE_HISTORY - 1];
+    int numPeriods = numEdges - 1;
+    for (int i = 0; i < numPeriods; i++) {
+        uint32_t p = edgeMicros[i + 1] - edgeMicros[i];
+        int j = i;
+        while (j > 0 && periods[j - 1] > p) { periods[j] = periods[j - 1]; j--; }
+        periods[j] = p;
+    }
+    uint32_t medianPeriod = periods[numPeriods / 2];
+
+    uint32_t sinceLastEdge = nowMicros - edgeMicros[numEdges - 1];
+    if (sinceLastEdge >= stallTimeoutMicros) return 0;
+    if (sinceLastEdge > medianPeriod) return periodToRpm(sinceLastEdge, pulsesPerRevolution);
+    return periodToRpm(medianPeriod, pulsesPerRevolution);
+}
+
+void tachWindowReset(TachWindow* window) {
+    window->head = 0;
+    window->size = 0;
+}
+
+void tachWindowPush(TachWindow* window, unsigned long totalPulses, unsigned long nowMillis, unsigned long windowMillis) {
+    if (window->size == TACH_WINDOW_SLOTS) {
+        window->head = (window->head + 1) % TACH_WINDOW_SLOTS;
+        window->size--;
+    }
+    int slot = (window->head + window->size) % TACH_WINDOW_SLOTS;
+    window->totalPulses[slot] = totalPulses;
+    window->sampleMillis[slot] = nowMillis;
+    window->size++;
+    // Drop the oldest sample while the next one still spans the whole window
+    while (window->size > 2) {
+        int next = (window->head + 1) % TACH_WINDOW_SLOTS;
+        if (nowMillis - window->sampleMillis[next] < windowMillis) break;
+        window->head = next;
+        window->size--;
+    }
+}
+
+int tachWindowRpm(const TachWindow* window, int pulsesPerRevolution, unsigned long stallCheckMillis) {
+    if (window->size < 2) return 0;
+    int newest = (window->head + window->size - 1) % TACH_WINDOW_SLOTS;
+    unsigned long pulses = window->totalPulses[newest] - window->totalPulses[window->head];
+    unsigned long elapsed = window->sampleMillis[newest] - window->sampleMillis[window->head];
+    int rpm = tachPulsesToRpm(pulses, elapsed, pulsesPerRevolution);
+
+    // Latest sample at least stallCheckMillis before the newest one
+    for (int i = window->size - 2; i >= 0; i--) {
+        int slot = (window->head + i) % TACH_WINDOW_SLOTS;
+        unsigned long span = window->sampleMillis[newest] - window->sampleMillis[slot];
+        if (span < stallCheckMillis) continue;
+        bool noRecentPulses = window->totalPulses[newest] == window->totalPulses[slot];
+        float expectedPulses = (float)rpm * pulsesPerRevolution * span / 60000.0f;
+        if (noRecentPulses && expectedPulses >= 4.0f) return 0;
+        break;
+    }
+    return rpm;
+}
+
+int tachSelectRpm(int periodRpm, int windowRpm, int periodMaxRpm) {
+    if (periodRpm >= 0 && periodRpm <= periodMaxRpm) return periodRpm;
+    return windowRpm;
+}
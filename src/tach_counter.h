@@ -0,0 +1,49 @@
+#ifndef TACH_COUNTER_H
+#define TACH_COUNTER_H
+
+#include <stdint.h>
+
+// Tachometer pulse -> RPM math shared by both counting paths:
+//  - PCNT: the hardware pulse counter free-runs and wraps to 0 at TACH_PCNT_WRAP_LIMIT; each read takes
+//    the modular difference from the previous read, so the counter is never cleared (no lost edges)
+//  - ISR: countPulse() increments pulseCount, which is snapshotted and zeroed under noInterrupts()
+// Two estimators run on top of the counts:
+//  - period: median of the last inter-edge periods (edge timestamps), precise at low RPM
+//  - window: pulses over a sliding window of per-tick samples, used at high RPM
+
+const int TACH_PCNT_WRAP_LIMIT = 32767; // PCNT counters are 16-bit signed; counter resets to 0 at this value
+const int TACH_EDGE_HISTORY = 8;        // Edge timestamps kept per channel (power of two), 7 periods for the median
+const int TACH_WINDOW_SLOTS = 32;       // Per-tick samples kept by the sliding window
+
+// Pulses counted since the previous read of a counter that wraps to 0 at wrapLimit.
+// Valid while fewer than wrapLimit pulses arrive between reads (~5 min at 6000 pulses/min).
+unsigned long tachCounterDelta(int previousCount, int currentCount, int wrapLimit);
+
+// RPM over a counting window. 0 when elapsedMillis or pulsesPerRevolution is 0.
+int tachPulsesToRpm(unsigned long pulses, unsigned long elapsedMillis, int pulsesPerRevolution);
+
+// RPM from the median period between consecutive edges (edgeMicros oldest first).
+// -1 if fewer than 3 edges are known. If the newest edge is older than the median period the result is
+// capped by the time since that edge (a slowing fan shows at once), and 0 once it is older than stallTimeoutMicros.
+int tachPeriodRpm(const uint32_t* edgeMicros, int numEdges, uint32_t nowMicros, int pulsesPerRevolution, uint32_t stallTimeoutMicros);
+
+struct TachWindow {
+    unsigned long totalPulses[TACH_WINDOW_SLOTS];
+    unsigned long sampleMillis[TACH_WINDOW_SLOTS];
+    int head; // Index of the oldest sample
+    int size;
+};
+
+void tachWindowReset(TachWindow* window);
+
+// Adds a sample of the channel's running pulse total and drops samples older than windowMillis (keeps at least 2).
+void tachWindowPush(TachWindow* window, unsigned long totalPulses, unsigned long nowMillis, unsigned long windowMillis);
+
+// RPM over the samples in the window. 0 if no pulse arrived in the last stallCheckMillis although the
+// window rate predicts at least 4 there (fan stopped). 0 with fewer than 2 samples.
+int tachWindowRpm(const TachWindow* window, int pulsesPerRevolution, unsigned long stallCheckMillis);
+
+// Period estimate at or below periodMaxRpm, otherwise (or with no period data) the window estimate.
+int tachSelectRpm(int periodRpm, int windowRpm, int periodMaxRpm);
+
+#endif // TACH_COUNTER_H
@@ -3,10 +3,100 @@
 #include "network_handler.h" 
 #include "input_handler.h"   
 #include "fan_control.h"     
+#include "fan_curve_lut.h"
 #include "display_handler.h" 
+#include "nvs_handler.h"
 #include "mqtt_handler.h"    // Added for MQTT
+#include "control_commands.h"
+#include "status_memory.h" // checkStatusScratchReleased
+#include "control_loop_timing.h"
+#include "wifi_manager.h"
 #include <ElegantOTA.h>      // Added for OTA Updates
-#include <WiFi.h>            // Ensure WiFi is included for MAC address and hostname
+
+void wakeControlTask(uint32_t reason) {
+    if (controlTaskHandle) xTaskNotify(controlTaskHandle, reason, eSetBits);
+}
+
+void wakeMainAppTask(uint32_t reason) {
+    if (mainAppTaskHandle) xTaskNotify(mainAppTaskHandle, reason, eSetBits);
+}
+
+void IRAM_ATTR wakeMainAppTaskFromISR(uint32_t reason) {
+    if (!mainAppTaskHandle) return;
+    BaseType_t higherPriorityTaskWoken = pdFALSE;
+    xTaskNotifyFromISR(mainAppTaskHandle, reason, eSetBits, &higherPriorityTaskWoken);
+    if (higherPriorityTaskWoken) portYIELD_FROM_ISR();
+}
+
+void wakeNetworkTask(uint32_t reason) {
+    if (networkTaskHandle) xTaskNotify(networkTaskHandle, reason, eSetBits);
+}
+
+void wakeNvsPersistenceTask() {
+    if (nvsPersistenceTaskHandle) xTaskNotify(nvsPersistenceTaskHandle, NVS_TASK_WAKE_REQUEST, eSetBits);
+}
+
+// Fills a snapshot of the control state for the network side (controlTask only)
+static void captureControllerState(ControllerState* state) {
+    controllerStateClear(state);
+    state->temperature = currentTemperature;
+    state->tempSensorFound = tempSensorFound;
+    state->pidSetpointC = pidSetpointC;
+    state->pidKp = pidKp;
+    state->pidKi = pidKi;
+    state->pidKd = pidKd;
+    state->rampUpPercentPerS = fanRampUpPercentPerS;
+    state->rampDownPercentPerS = fanRampDownPercentPerS;
+    state->hysteresisC = fanHysteresisC;
+    state->outputWrites = fanOutputWrites;
+    state->suppressedOutputChanges = fanSuppressedOutputChanges;
+    state->suppressedBroadcasts = fanSuppressedBroadcasts;
+    ControlCommandQueueStats commandStats;
+    controlCommandQueueGetStats(&controlCommandQueue, &commandStats);
+    state->commandsApplied = commandStats.applied;
+    state->commandsDropped = commandStats.dropped;
+    state->commandQueueMaxDepth = commandStats.maxDepth;
+    state->commandLatencyAvgUs = commandStats.latencyAvgUs;
+    state->commandLatencyMaxUs = commandStats.latencyMaxUs;
+    const LatencyHistogram* outputLatency = getControlCommandOutputLatency();
+    state->commandToOutputP50Us = latencyHistogramPercentile(outputLatency, 50);
+    state->commandToOutputP99Us = latencyHistogramPercentile(outputLatency, 99);
+    state->commandToOutputMaxUs = outputLatency->maxUs;
+    const ControlLoopTiming* timing = getControlLoopTiming();
+    state->controlPeriodMinUs = timing->minPeriodUs;
+    state->controlPeriodMaxUs = timing->maxPeriodUs;
+    state->controlJitterP99Us = latencyHistogramPercentile(&timing->jitter, 99);
+    state->controlJitterMaxUs = timing->jitter.maxUs;
+    state->controlExecMaxUs = timing->maxExecUs;
+    state->controlOverruns = timing->overruns;
+    state->nvsWrites = nvsSaveScheduler.writes.load(std::memory_order_relaxed);
+    state->nvsWritesAvoided = nvsSaveSchedulerWritesAvoided(&nvsSaveScheduler);
+    state->nvsBytesWritten = nvsSaveScheduler.bytesWritten.load(std::memory_order_relaxed);
+    state->nvsPending = nvsSaveSchedulerPending(&nvsSaveScheduler);
+    for (int ch = 0; ch < NUM_FAN_CHANNELS; ch++) {
+        ControllerChannelSnapshot& fan = state->channels[ch];
+        const FanCalibrationResult* calibration = getFanCalibrationResult(ch);
+        fan.modeName = getFanModeName(ch);
+        fan.calibrationStatus = getFanCalibrationStatus(ch);
+        fan.rpm = fanChannels.rpm[ch];
+        fan.targetRpm = fanChannels.targetRpm[ch];
+        fan.speedPercent = fanChannels.speedPercentage[ch];
+        fan.manualSpeedPercent = fanChannels.manualSpeedPercentage[ch];
+        fan.calMaxRpm = calibration->maxRpm;
+        fan.calStartDuty = calibration->startDuty;
+        fan.calStallDuty = calibration->stallDuty;
+        fan.rpmModelPoints = fanRpmModelLearnedPoints(getFanRpmModel(ch));
+        fan.isAutoMode = fanChannels.isAutoMode[ch];
+        fan.isPidMode = fanChannels.isPidMode[ch];
+        fan.isRpmMode = fanChannels.isRpmMode[ch];
+        fan.hasTach = fanHasTach(ch);
+        fan.curveNumPoints = fanChannels.curveNumPoints[ch];
+        for (int i = 0; i < fanChannels.curveNumPoints[ch]; i++) {
+            fan.curveTemp[i] = fanChannels.curveTempPoints[ch][i];
+            fan.curvePwm[i] = fanChannels.curvePwmPoints[ch][i];
+        }
+    }
+}
 
 // --- Network Task (Core 0) ---
 void networkTask(void *pvParameters) {
@@ -14,102 +104,58 @@ void networkTask(void *pvParameters) {
     unsigned long lastPeriodicBroadcastTime = 0;
     unsigned long lastMqttStatusPublishTime = 0;
     unsigned long lastMqttCurvePublishTime = 0; // ADDED: For periodic curve publish
+    static ControllerState snapshot; // Latest consistent copy of controllerState
+    static ControllerState readBuffer;
+    uint32_t lastBroadcastSeq = 0;
+    uint32_t lastWebSocketVersion = 0;
+    uint32_t lastMqttVersion = 0;
+    uint32_t lastMqttCurveFingerprint = 0;
 
     // --- WiFi Connection Handling ---
-    if (isWiFiEnabled) {
-        // Generate and set hostname before WiFi.begin()
-        uint8_t mac[6];
-        char hostname[32]; // "fancontrol-" is 11 chars, MAC is 12 chars, plus null terminator
-        WiFi.macAddress(mac);
-        sprintf(hostname, "fancontrol-%02x%02x%02x%02x%02x%02x", mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
-        
-        if(serialDebugEnabled) Serial.printf("[WiFi] Setting hostname to: %s\n", hostname);
-        if (!WiFi.setHostname(hostname)) {
-            if(serialDebugEnabled) Serial.println("[WiFi_ERR] Failed to set hostname.");
-        }
-
-        if(serialDebugEnabled) { Serial.print("[WiFi] NetworkTask: Attempting connection to SSID: '"); Serial.print(current_ssid); Serial.println("'");}
-        
-        if (strlen(current_ssid) > 0 && strcmp(current_ssid, "YOUR_WIFI_SSID") != 0 && strcmp(current_ssid, "") != 0 ) {
-            WiFi.mode(WIFI_STA); 
-            WiFi.begin(current_ssid, current_password);
-            int wifiTimeout = 0;
-            // Wait for connection, but don't block indefinitely if WiFi settings are bad
-            while (WiFi.status() != WL_CONNECTED && wifiTimeout < 30) { // Approx 15 seconds timeout
-                vTaskDelay(pdMS_TO_TICKS(500)); 
-                if(serialDebugEnabled) Serial.print("."); 
-                wifiTimeout++;
-            }
-        } else {
-            if(serialDebugEnabled) Serial.println("[WiFi] NetworkTask: SSID not configured or is default. Skipping WiFi connection attempt.");
-        }
-    } else {
-         if(serialDebugEnabled) Serial.println("[WiFi] NetworkTask: WiFi is disabled by NVS config. Skipping WiFi connection.");
-    }
-
-
-    // --- Service Initialization (Websocket, MQTT, OTA) if WiFi is connected ---
-    if (isWiFiEnabled && WiFi.status() == WL_CONNECTED) {
-        if(serialDebugEnabled) { 
-            Serial.println("\n[WiFi] NetworkTask: Connected successfully!");
-            Serial.print("[WiFi] NetworkTask: IP Address: "); Serial.println(WiFi.localIP());
-            Serial.print("[WiFi] NetworkTask: Hostname: "); Serial.println(WiFi.getHostname()); // Log the effective hostname
-        }
-        
-        // Setup WebSockets
-        setupWebServerRoutes(); 
-        webSocket.begin();
-        webSocket.onEvent(webSocketEvent);
-        
-        // Start AsyncWebServer
-        server.begin(); 
-        if(serialDebugEnabled) Serial.println("[SYSTEM] HTTP server and WebSocket started on Core 0.");
-
-        // Initialize ElegantOTA
-        ElegantOTA.begin(&server);
-        // You can also set a custom ID for ElegantOTA if desired, which could include the hostname
-        // ElegantOTA.setID(hostname); // Optional: If you want ElegantOTA to display this ID
-        if(serialDebugEnabled) Serial.println("[SYSTEM] ElegantOTA started. Update endpoint: /update");
-
-
-        // Setup MQTT if enabled
-        if (isMqttEnabled) {
-            setupMQTT(); // Initialize MQTT client, topics, server etc.
-        } else {
-            if(serialDebugEnabled) Serial.println("[MQTT] MQTT is disabled. Skipping MQTT setup in NetworkTask.");
-        }
+    // Connects, retries and service start/stop run from wifiManagerLoop() below, so nothing here blocks
+    setupWiFiManager();
 
-    } else { 
-        if(isWiFiEnabled && serialDebugEnabled) Serial.println("\n[WiFi] NetworkTask: WiFi Connection Failed or not attempted. Web/MQTT/OTA services may not be available.");
-    }
-    
     // --- Main Loop for Network Task ---
     for(;;) {
-        if (isWiFiEnabled && WiFi.status() == WL_CONNECTED) { 
-            webSocket.loop();
+        wifiManagerLoop();
+        if (wifiServicesRunning()) {
+            serviceWebSocketInbox(); // WebSocket events queued by the AsyncTCP task
             ElegantOTA.loop(); // Handles OTA requests, important for some versions/modes
             unsigned long currentTime = millis();
+            // One consistent copy per pass; after a failed read the previous copy is reused, which sends nothing new
+            if (controllerStateRead(&controllerState, &readBuffer, 8)) snapshot = readBuffer;
 
-            // Combined broadcast/publish logic for immediate updates
-            if (needsImmediateBroadcast) { 
-                broadcastWebSocketData(); // Send data to web clients
+            // Combined broadcast/publish logic for immediate updates (requested through needsImmediateBroadcast,
+            // which controlTask folds into the snapshot so the broadcast already carries the change)
+            if (snapshot.broadcastSeq != lastBroadcastSeq) { 
+                lastBroadcastSeq = snapshot.broadcastSeq;
+                broadcastWebSocketData(snapshot); // Send data to web clients
+                lastWebSocketVersion = snapshot.version;
                 if (isMqttEnabled && mqttClient.connected()) {
-                    publishStatusMQTT(); 
-                    if (fanCurveChanged) { // Only publish curve if it actually changed
-                        publishFanCurveMQTT();
-                        fanCurveChanged = false; // Reset flag
+                    publishStatusMQTT(snapshot); 
+                    lastMqttVersion = snapshot.version;
+                    // Only publish the curve if the snapshot's curve changed (a flag could fire before the
+                    // snapshot that carries the new curve arrives)
+                    uint32_t curveFingerprint = controllerStateCurveFingerprint(&snapshot, NUM_FAN_CHANNELS);
+                    if (curveFingerprint != lastMqttCurveFingerprint) {
+                        publishFanCurveMQTT(snapshot);
+                        lastMqttCurveFingerprint = curveFingerprint;
                         lastMqttCurvePublishTime = currentTime; // Update time of last curve publish
                     }
                 }
-                needsImmediateBroadcast = false; 
                 lastPeriodicBroadcastTime = currentTime; // Reset periodic timer
                 if (isMqttEnabled) lastMqttStatusPublishTime = currentTime; // Reset MQTT periodic timer
             }
-            // Periodic WebSocket broadcast
-            else if (currentTime - lastPeriodicBroadcastTime > 5000) {
-                 broadcastWebSocketData();
+            // Periodic WebSocket broadcast, skipped while nothing changed; faster while a status long-poll waits
+            else if (currentTime - lastPeriodicBroadcastTime > (apiStatusLongPollWaiting() ? NETWORK_LONG_POLL_BROADCAST_MS : 5000)) {
+                 if (snapshot.version != lastWebSocketVersion) {
+                     broadcastWebSocketData(snapshot);
+                     lastWebSocketVersion = snapshot.version;
+                 }
                  lastPeriodicBroadcastTime = currentTime;
             }
+            serviceApiRequests(snapshot); // After the broadcast, so waiting long-polls see its changes
+            serviceEventClients();
 
 
             // MQTT Loop and Periodic Publishing
@@ -118,34 +164,121 @@ void networkTask(void *pvParameters) {
                 
                 // Periodic status publish if not covered by needsImmediateBroadcast
                 if (mqttClient.connected() && (currentTime - lastMqttStatusPublishTime > 30000)) { // e.g., every 30 seconds
-                     publishStatusMQTT();
+                     if (snapshot.version != lastMqttVersion) {
+                         publishStatusMQTT(snapshot);
+                         lastMqttVersion = snapshot.version;
+                     }
                      lastMqttStatusPublishTime = currentTime;
                 }
                 // ADDED: Periodic fan curve publish (less frequent)
                 if (mqttClient.connected() && (currentTime - lastMqttCurvePublishTime > 300000)) { // e.g., every 5 minutes
-                     publishFanCurveMQTT();
+                     publishFanCurveMQTT(snapshot);
+                     lastMqttCurveFingerprint = controllerStateCurveFingerprint(&snapshot, NUM_FAN_CHANNELS);
                      lastMqttCurvePublishTime = currentTime;
                 }
             }
-        } else if (isWiFiEnabled && WiFi.status() != WL_CONNECTED) {
-            // Optional: Attempt to reconnect WiFi if it drops
-            // For now, MQTT will also disconnect if WiFi drops (handled in loopMQTT).
-            // ElegantOTA also requires WiFi.
-            if (serialDebugEnabled && millis() % 15000 < 50) { // Log occasionally
-                 Serial.println("[WiFi] NetworkTask: WiFi disconnected. Waiting for reconnection or config change. OTA/Web/MQTT unavailable.");
+            checkStatusScratchReleased(); // Every document of this pass is gone, so the scratch arena must be empty
+        }
+        // The MQTT client is polled, so with MQTT on wake at least every NETWORK_TASK_POLL_MS. WebSocket traffic,
+        // REST requests, an immediate broadcast published by controlTask and WiFi events wake the task at once.
+        uint32_t wakeReasons = 0;
+        xTaskNotifyWait(0, UINT32_MAX, &wakeReasons, pdMS_TO_TICKS(isMqttEnabled ? NETWORK_TASK_POLL_MS : NETWORK_TASK_IDLE_MS));
+    }
+}
+
+// --- Control Task (Core 1, highest application priority) ---
+static ControlLoopTiming controlLoopTiming;
+static volatile bool controlLoopTimingResetPending = false;
+
+const ControlLoopTiming* getControlLoopTiming() {
+    return &controlLoopTiming;
+}
+
+void requestControlLoopTimingReset() {
+    controlLoopTimingResetPending = true;
+}
+
+// Publishes the control state for networkTask and the LCD (controlTask is the only publisher)
+static void publishControllerState() {
+    static ControllerState nextState;
+    captureControllerState(&nextState);
+    bool immediateBroadcast = needsImmediateBroadcast.exchange(false);
+    controllerStatePublish(&controllerState, &nextState, immediateBroadcast);
+    if (immediateBroadcast) {
+        wakeNetworkTask(NETWORK_TASK_WAKE_BROADCAST);
+        wakeMainAppTask(MAIN_TASK_WAKE_DISPLAY);
+    }
+}
+
+void controlTask(void *pvParameters) {
+    if(serialDebugEnabled) Serial.println("[TASK] Control Task started on Core 1.");
+    const TickType_t period = pdMS_TO_TICKS(CONTROL_TASK_PERIOD_MS);
+    controlLoopTimingInit(&controlLoopTiming, CONTROL_TASK_PERIOD_MS * 1000UL);
+    unsigned long lastRpmBroadcastTime = 0;
+    bool rpmChangedSinceBroadcast = false;
+    unsigned long lastPidTickTime = millis();
+    unsigned long lastOutputTime = millis(); // Last runFanControlTick, periodic or command pass
+    TickType_t nextWakeTick = xTaskGetTickCount();
+
+    for(;;) {
+        // --- Periodic pass: sampling and control on a fixed schedule, UI work runs in mainAppTask ---
+        if (controlLoopTimingResetPending) {
+            controlLoopTimingResetPending = false;
+            controlLoopTimingInit(&controlLoopTiming, CONTROL_TASK_PERIOD_MS * 1000UL);
+        }
+        controlLoopTimingPassStart(&controlLoopTiming, micros());
+        unsigned long currentTime = millis();
+        drainControlCommands();
+
+        // Estimate RPM every pass (a stall is broadcast at once by updateFanRpm, other changes once a second)
+        if (updateFanRpm(currentTime)) rpmChangedSinceBroadcast = true;
+        if (rpmChangedSinceBroadcast && currentTime - lastRpmBroadcastTime >= 1000) {
+            lastRpmBroadcastTime = currentTime;
+            rpmChangedSinceBroadcast = false;
+            needsImmediateBroadcast = true; // RPM changed
+        }
+
+        // PID tick on a fixed period (dt is always PID_CONTROL_PERIOD_MS; if we fell behind,
+        // resynchronise instead of running a burst of catch-up ticks)
+        if (currentTime - lastPidTickTime >= PID_CONTROL_PERIOD_MS) {
+            lastPidTickTime += PID_CONTROL_PERIOD_MS;
+            if (currentTime - lastPidTickTime >= PID_CONTROL_PERIOD_MS) lastPidTickTime = currentTime;
+            if (tempSensorFound && currentTemperature > -990.0) {
+                runFanPidTick(currentTemperature, PID_CONTROL_PERIOD_MS / 1000.0f);
             }
         }
-        vTaskDelay(pdMS_TO_TICKS(50)); // Standard delay for cooperative multitasking
+
+        // Fan Control Logic (all channels in one pass)
+        runFanControlTick(temperatureToDeciC(currentTemperature), (currentTime - lastOutputTime) / 1000.0f);
+        lastOutputTime = currentTime;
+        recordControlCommandOutputLatency(); // Commands drained above reach the PWM in this pass
+        publishControllerState();
+        controlLoopTimingPassEnd(&controlLoopTiming, micros());
+
+        // --- Wait for the next period (delay-until); a queued command wakes the task for an output-only pass ---
+        nextWakeTick += period;
+        if ((int32_t)(xTaskGetTickCount() - nextWakeTick) >= (int32_t)period) nextWakeTick = xTaskGetTickCount(); // Overran, resynchronise
+        for (;;) {
+            TickType_t remaining = nextWakeTick - xTaskGetTickCount();
+            if ((int32_t)remaining <= 0) break;
+            uint32_t wakeReasons = 0;
+            if (xTaskNotifyWait(0, UINT32_MAX, &wakeReasons, remaining) != pdTRUE || !(wakeReasons & CONTROL_TASK_WAKE_COMMAND)) continue;
+            unsigned long now = millis();
+            drainControlCommands();
+            runFanControlTick(temperatureToDeciC(currentTemperature), (now - lastOutputTime) / 1000.0f);
+            lastOutputTime = now;
+            recordControlCommandOutputLatency();
+            publishControllerState();
+        }
     }
 }
 
-// --- Main Application Task (Core 1) ---
+// --- Main Application Task (Core 1): UI, serial, sensor and NVS housekeeping ---
 void mainAppTask(void *pvParameters) {
     if(serialDebugEnabled) Serial.println("[TASK] Main Application Task started on Core 1.");
     unsigned long lastTempReadTime = 0;
-    unsigned long lastRpmCalculationTime = 0;
     unsigned long lastLcdUpdateTime = 0;
-    lastRpmReadTime_Task = millis(); // Initialize for RPM calculation
+    unsigned long lastRpmModelSaveTime = millis();
 
     if (isInMenuMode) displayMenu(); else updateLCD_NormalMode();
 
@@ -157,78 +290,64 @@ void mainAppTask(void *pvParameters) {
         }
         handleMenuInput();      
 
-        if (!isInMenuMode) { // Only perform these actions if not in menu
-            // Read Temperature
-            if (tempSensorFound) {
-                if (currentTime - lastTempReadTime > 2000) { // Read every 2 seconds
-                    lastTempReadTime = currentTime;
-                    float newTemp = bmp.readTemperature();
-                    if (!isnan(newTemp)) { 
-                        if (abs(newTemp - currentTemperature) > 0.05 || currentTemperature <= -990.0) { // Update if changed significantly or first read
-                           currentTemperature = newTemp;
-                           needsImmediateBroadcast = true; // Temperature changed, signal update
-                        }
-                    } else {
-                        if(serialDebugEnabled) Serial.println("[SENSOR_ERR] Failed to read from BMP280 sensor!");
-                        if (currentTemperature > -990.0) needsImmediateBroadcast = true; // Was valid, now not
-                        currentTemperature = -999.0; 
+        // Read Temperature (here rather than in controlTask: the BMP280 shares the I2C bus with the LCD).
+        // Also in menu mode, since fan control keeps running there.
+        if (tempSensorFound) {
+            if (currentTime - lastTempReadTime > 2000) { // Read every 2 seconds
+                lastTempReadTime = currentTime;
+                float newTemp = bmp.readTemperature();
+                if (!isnan(newTemp)) { 
+                    if (abs(newTemp - currentTemperature) > 0.05 || currentTemperature <= -990.0) { // Update if changed significantly or first read
+                       currentTemperature = newTemp;
+                       needsImmediateBroadcast = true; // Temperature changed, signal update
                     }
+                } else {
+                    if(serialDebugEnabled) Serial.println("[SENSOR_ERR] Failed to read from BMP280 sensor!");
+                    if (currentTemperature > -990.0) needsImmediateBroadcast = true; // Was valid, now not
+                    currentTemperature = -999.0; 
                 }
-            } else { // Sensor not found
-                if (currentTemperature > -990.0) needsImmediateBroadcast = true; // Was valid, now not
-                currentTemperature = -999.0; 
             }
+        } else { // Sensor not found
+            if (currentTemperature > -990.0) needsImmediateBroadcast = true; // Was valid, now not
+            currentTemperature = -999.0; 
+        }
 
-            // Calculate RPM
-            if (currentTime - lastRpmCalculationTime > 1000) { // Calculate every 1 second
-                lastRpmCalculationTime = currentTime;
-                noInterrupts(); 
-                unsigned long currentPulses = pulseCount;
-                pulseCount = 0; 
-                interrupts(); 
-                
-                unsigned long elapsedMillis = currentTime - lastRpmReadTime_Task;
-                lastRpmReadTime_Task = currentTime; 
-
-                int newRpm = 0;
-                if (elapsedMillis > 0 && PULSES_PER_REVOLUTION > 0) {
-                    newRpm = (currentPulses / (float)PULSES_PER_REVOLUTION) * (60000.0f / elapsedMillis);
-                }
-                if (newRpm != fanRpm) {
-                    fanRpm = newRpm;
-                    needsImmediateBroadcast = true; // RPM changed
-                }
+        // Learned PWM -> RPM tables change continuously; hand them to the NVS task at a wear-friendly interval
+        if (currentTime - lastRpmModelSaveTime >= FAN_RPM_MODEL_SAVE_INTERVAL_MS) {
+            lastRpmModelSaveTime = currentTime;
+            for (int ch = 0; ch < NUM_FAN_CHANNELS; ch++) {
+                if (takeFanRpmModelDirty(ch)) requestNvsSave(NVS_SECTION_FAN_RPM_MODEL, ch);
             }
+        }
+        // Calibration results are rare and worth keeping at once
+        for (int ch = 0; ch < NUM_FAN_CHANNELS; ch++) {
+            if (takeFanCalibrationDirty(ch)) requestNvsSave(NVS_SECTION_FAN_CALIBRATION, ch);
+        }
 
-            // Fan Control Logic
-            int oldFanSpeedPercentage = fanSpeedPercentage; 
+        // Sleep until the next poll of serial and buttons; a button edge or a published change wakes the task early
+        uint32_t wakeReasons = 0;
+        xTaskNotifyWait(0, UINT32_MAX, &wakeReasons, pdMS_TO_TICKS(MAIN_APP_TASK_PERIOD_MS));
 
-            if (isAutoMode) {
-                if (tempSensorFound) {
-                    int autoPwmPerc = calculateAutoFanPWMPercentage(currentTemperature);
-                    if (autoPwmPerc != fanSpeedPercentage) {
-                        setFanSpeed(autoPwmPerc); // setFanSpeed sets needsImmediateBroadcast
-                    }
-                } else { // Auto mode but no sensor
-                    if (AUTO_MODE_NO_SENSOR_FAN_PERCENTAGE != fanSpeedPercentage) {
-                        setFanSpeed(AUTO_MODE_NO_SENSOR_FAN_PERCENTAGE);
-                    }
-                }
-            } else { // Manual mode
-                if (manualFanSpeedPercentage != fanSpeedPercentage) {
-                    setFanSpeed(manualFanSpeedPercentage);
-                }
-            }
-            
-            // Update LCD
-            // Update more frequently if something changed, or every second regardless
-            if (currentTime - lastLcdUpdateTime > 1000 || needsImmediateBroadcast) { 
-                updateLCD_NormalMode();
-                lastLcdUpdateTime = currentTime;
-            }
-        } 
-        // If in menu mode, displayMenu() is called by handleMenuInput() when changes occur.
-        
-        vTaskDelay(pdMS_TO_TICKS(50)); // Standard delay for cooperative multitasking
+        // Update LCD every second, or at once when controlTask published a change
+        if (!isInMenuMode && (millis() - lastLcdUpdateTime > 1000 || (wakeReasons & MAIN_TASK_WAKE_DISPLAY))) { 
+            updateLCD_NormalMode();
+            lastLcdUpdateTime = millis();
+        } else if (isInMenuMode && currentMenuScreen == OTA_UPDATE_SCREEN && (wakeReasons & MAIN_TASK_WAKE_DISPLAY)) {
+            displayMenu(); // OTA status/progress published by OtaTask
+        }
+        // Otherwise in menu mode, displayMenu() is called by handleMenuInput() when changes occur.
+    }
+}
+
+// --- NVS Persistence Task (Core 0, lowest priority) ---
+// The only writer of settings to flash after setup(). Sleeps until the earliest dirty section falls due;
+// a new request wakes it to recompute that time.
+void nvsPersistenceTask(void *pvParameters) {
+    if(serialDebugEnabled) Serial.println("[TASK] NVS Persistence Task started on Core 0.");
+    for (;;) {
+        writeDueNvsSections(false);
+        uint32_t waitMs = nvsSaveSchedulerNextDueMs(&nvsSaveScheduler, millis());
+        TickType_t waitTicks = waitMs == NVS_SAVE_NOTHING_PENDING ? portMAX_DELAY : pdMS_TO_TICKS(waitMs) + 1;
+        xTaskNotifyWait(0, UINT32_MAX, NULL, waitTicks);
     }
 }
@@ -2,11 +2,37 @@
 #define TASKS_H
 
 #include "config.h"
+#include "control_loop_timing.h"
 
 extern TaskHandle_t networkTaskHandle;
 extern TaskHandle_t mainAppTaskHandle;
+extern TaskHandle_t controlTaskHandle;
+extern TaskHandle_t nvsPersistenceTaskHandle;
+
+// Task notification bits (eSetBits). A notification only ends the task's wait early; the work itself is
+// still found by checking queues, flags and timers, so a lost or merged notification costs nothing.
+const uint32_t CONTROL_TASK_WAKE_COMMAND = 1UL << 0; // Control command queued
+const uint32_t MAIN_TASK_WAKE_BUTTON = 1UL << 0;  // Button edge (ISR)
+const uint32_t MAIN_TASK_WAKE_DISPLAY = 1UL << 1; // Snapshot published with an immediate broadcast (LCD refresh)
+const uint32_t NETWORK_TASK_WAKE_BROADCAST = 1UL << 0; // Snapshot published with an immediate broadcast
+const uint32_t NETWORK_TASK_WAKE_WIFI = 1UL << 1;      // WiFi event or connect/disconnect request (wifi_manager.h)
+const uint32_t NETWORK_TASK_WAKE_WEBSOCKET = 1UL << 2; // WebSocket connect, disconnect or message queued (network_handler.h)
+const uint32_t NETWORK_TASK_WAKE_HTTP = 1UL << 3;      // REST API request parked or /events client connected (network_handler.h)
+const uint32_t NVS_TASK_WAKE_REQUEST = 1UL << 0; // Save requested (recomputes the next write time)
+
+void wakeControlTask(uint32_t reason);
+void wakeMainAppTask(uint32_t reason);
+void IRAM_ATTR wakeMainAppTaskFromISR(uint32_t reason);
+void wakeNetworkTask(uint32_t reason);
+void wakeNvsPersistenceTask();
+
+// Period jitter / overrun statistics of controlTask (written by controlTask; a reset is applied on its next pass)
+const ControlLoopTiming* getControlLoopTiming();
+void requestControlLoopTimingReset();
 
 void networkTask(void *pvParameters);
+void controlTask(void *pvParameters);
 void mainAppTask(void *pvParameters);
+void nvsPersistenceTask(void *pvParameters);
 
 #endif // TASKS_H
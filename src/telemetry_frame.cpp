@@ -0,0 +1,93 @@
+#include "telemetry_frame.h"
+#include <string.h>
+
+static void putU16(uint8_t* out, uint16_t value) {
+    out[0] = (uint8_t)value;
+    out[1] = (uint8_t)(value >> 8);
+}
+
+static void putU32(uint8_t* out, uint32_t value) {
+    putU16(out, (uint16_t)value);
+    putU16(out + 2, (uint16_t)(value >> 16));
+}
+
+static uint16_t getU16(const uint8_t* data) {
+    return (uint16_t)(data[0] | (data[1] << 8));
+}
+
+static uint16_t clampU16(int32_t value) {
+    if (value < 0) return 0;
+    return value > 65535 ? 65535 : (uint16_t)value;
+}
+
+static uint8_t clampPercent(int16_t value) {
+    if (value < 0) return 0;
+    return value > 100 ? 100 : (uint8_t)value;
+}
+
+static uint8_t calibrationCode(const char* status) {
+    if (!status) return TELEMETRY_CAL_NONE;
+    if (strcmp(status, "RUNNING") == 0) return TELEMETRY_CAL_RUNNING;
+    if (strcmp(status, "FAILED") == 0) return TELEMETRY_CAL_FAILED;
+    if (strcmp(status, "DONE") == 0) return TELEMETRY_CAL_DONE;
+    return TELEMETRY_CAL_NONE;
+}
+
+size_t telemetryFrameEncode(const ControllerState* state, int numChannels, uint32_t seq, bool otaInProgress,
+                            uint8_t otaPercent, uint8_t* out, size_t outSize) {
+    if (numChannels < 0) numChannels = 0;
+    if (numChannels > CONTROLLER_STATE_MAX_CHANNELS) numChannels = CONTROLLER_STATE_MAX_CHANNELS;
+    size_t length = TELEMETRY_FRAME_HEADER_SIZE + TELEMETRY_FRAME_CHANNEL_SIZE * numChannels;
+    if (outSize < length) return 0;
+
+    int16_t temperature = TELEMETRY_FRAME_NO_TEMPERATURE;
+    if (state->tempSensorFound) {
+        float deci = state->temperature * 10.0f;
+        deci += deci < 0 ? -0.5f : 0.5f;
+        if (deci < -32767.0f) deci = -32767.0f;
+        if (deci > 32767.0f) deci = 32767.0f;
+        temperature = (int16_t)deci;
+    }
+    out[0] = TELEMETRY_FRAME_MAGIC;
+    out[1] = TELEMETRY_FRAME_VERSION;
+    out[2] = (uint8_t)numChannels;
+    out[3] = (state->tempSensorFound ? TELEMETRY_FLAG_SENSOR : 0) | (otaInProgress ? TELEMETRY_FLAG_OTA : 0);
+    putU32(out + 4, seq);
+    putU16(out + 8, (uint16_t)temperature);
+    out[10] = otaPercent;
+    out[11] = 0;
+
+    uint8_t* channel = out + TELEMETRY_FRAME_HEADER_SIZE;
+    for (int ch = 0; ch < numChannels; ch++, channel += TELEMETRY_FRAME_CHANNEL_SIZE) {
+        const ControllerChannelSnapshot& fan = state->channels[ch];
+        channel[0] = clampPercent(fan.speedPercent);
+        channel[1] = clampPercent(fan.manualSpeedPercent);
+        channel[2] = (fan.isAutoMode ? TELEMETRY_MODE_AUTO : 0) | (fan.isPidMode ? TELEMETRY_MODE_PID : 0) |
+                     (fan.isRpmMode ? TELEMETRY_MODE_RPM : 0) | (fan.hasTach ? TELEMETRY_MODE_TACH : 0);
+        channel[3] = calibrationCode(fan.calibrationStatus);
+        putU16(channel + 4, clampU16(fan.rpm));
+        putU16(channel + 6, clampU16(fan.targetRpm));
+    }
+    return length;
+}
+
+bool telemetryFrameDecode(const uint8_t* data, size_t length, TelemetryFrame* frame) {
+    if (length < TELEMETRY_FRAME_HEADER_SIZE || data[0] != TELEMETRY_FRAME_MAGIC || data[1] != TELEMETRY_FRAME_VERSION) return false;
+    uint8_t channelCount = data[2];
+    if (channelCount > CONTROLLER_STATE_MAX_CHANNELS || length < TELEMETRY_FRAME_HEADER_SIZE + TELEMETRY_FRAME_CHANNEL_SIZE * channelCount) return false;
+    frame->channelCount = channelCount;
+    frame->flags = data[3];
+    frame->seq = getU16(data + 4) | ((uint32_t)getU16(data + 6) << 16);
+    frame->temperatureDeciC = (int16_t)getU16(data + 8);
+    frame->otaPercent = data[10];
+    const uint8_t* channel = data + TELEMETRY_FRAME_HEADER_SIZE;
+    for (int ch = 0; ch < channelCount; ch++, channel += TELEMETRY_FRAME_CHANNEL_SIZE) {
+        frame->channels[ch].speedPercent = channel[0];
+        frame->channels[ch].manualSpeedPercent = channel[1];
+        frame->channels[ch].modeFlags = channel[2];
+        frame->channels[ch].calibration = channel[3];
+        frame->channels[ch].rpm = getU16(channel + 4);
+        frame->channels[ch].targetRpm = getU16(channel + 6);
+    }
+    return true;
+}
@@ -0,0 +1,57 @@
+#ifndef TELEMETRY_FRAME_H
+#define TELEMETRY_FRAME_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "controller_state.h"
+
+// Compact binary WebSocket telemetry, for clients that opt in (JSON stays the default). Fixed layout,
+// little-endian, no padding; data/script.js decodes the same layout:
+//   0  u8  magic 'F'          1  u8  version (1)     2  u8  channel count    3  u8  flags (TELEMETRY_FLAG_*)
+//   4  u32 sequence           8  i16 temperature, 0.1 C (TELEMETRY_FRAME_NO_TEMPERATURE without a sensor)
+//   10 u8  OTA percent        11 u8  reserved
+//   then per channel, 8 bytes: u8 duty %, u8 manual duty %, u8 mode flags (TELEMETRY_MODE_*),
+//   u8 calibration (TELEMETRY_CAL_*), u16 RPM, u16 target RPM (both clamped to 65535)
+
+const uint8_t TELEMETRY_FRAME_MAGIC = 'F';
+const uint8_t TELEMETRY_FRAME_VERSION = 1;
+const size_t TELEMETRY_FRAME_HEADER_SIZE = 12;
+const size_t TELEMETRY_FRAME_CHANNEL_SIZE = 8;
+const size_t TELEMETRY_FRAME_MAX_SIZE = TELEMETRY_FRAME_HEADER_SIZE + TELEMETRY_FRAME_CHANNEL_SIZE * CONTROLLER_STATE_MAX_CHANNELS;
+const int16_t TELEMETRY_FRAME_NO_TEMPERATURE = INT16_MIN;
+
+const uint8_t TELEMETRY_FLAG_SENSOR = 1 << 0;
+const uint8_t TELEMETRY_FLAG_OTA = 1 << 1;
+
+const uint8_t TELEMETRY_MODE_AUTO = 1 << 0;
+const uint8_t TELEMETRY_MODE_PID = 1 << 1;
+const uint8_t TELEMETRY_MODE_RPM = 1 << 2;
+const uint8_t TELEMETRY_MODE_TACH = 1 << 3;
+
+enum TelemetryCalibration : uint8_t { TELEMETRY_CAL_NONE, TELEMETRY_CAL_RUNNING, TELEMETRY_CAL_FAILED, TELEMETRY_CAL_DONE };
+
+struct TelemetryFrameChannel {
+    uint8_t speedPercent;
+    uint8_t manualSpeedPercent;
+    uint8_t modeFlags;
+    uint8_t calibration;
+    uint16_t rpm;
+    uint16_t targetRpm;
+};
+
+struct TelemetryFrame {
+    uint8_t channelCount;
+    uint8_t flags;
+    uint32_t seq;
+    int16_t temperatureDeciC;
+    uint8_t otaPercent;
+    TelemetryFrameChannel channels[CONTROLLER_STATE_MAX_CHANNELS];
+};
+
+// Returns the frame length, or 0 if out is smaller than TELEMETRY_FRAME_HEADER_SIZE + channels * 8.
+size_t telemetryFrameEncode(const ControllerState* state, int numChannels, uint32_t seq, bool otaInProgress,
+                            uint8_t otaPercent, uint8_t* out, size_t outSize);
+// For tests and tools: false on a short, foreign or newer frame.
+bool telemetryFrameDecode(const uint8_t* data, size_t length, TelemetryFrame* frame);
+
+#endif // TELEMETRY_FRAME_H
@@ -0,0 +1,81 @@
+#include "web_assets.h"
+#include "http_cache.h"
+#include "web_assets_embedded.h" // Generated into .pio/web_embedded by tools/build_web_assets.py
+#include <SPIFFS.h>
+
+static const char* WEB_ASSET_MANIFEST = "/assets.txt";
+static const char* CACHE_IMMUTABLE = "public, max-age=31536000, immutable";
+static const char* CACHE_REVALIDATE = "no-cache"; // Kept by the browser, but checked with If-None-Match on each use
+
+static const size_t WEB_ROUTE_COUNT = sizeof(EMBEDDED_WEB_ASSETS) / sizeof(EMBEDDED_WEB_ASSETS[0]);
+static char spiffsEtags[WEB_ROUTE_COUNT][20]; // From /assets.txt, used only when the SPIFFS copy is complete
+static bool spiffsOverride = false;
+static volatile uint32_t webAssetFullResponses = 0;
+static volatile uint32_t webAssetNotModified = 0;
+
+static const char* filePathOf(const EmbeddedWebAsset& asset) {
+    return strcmp(asset.url, "/") == 0 ? "/index.html" : asset.url;
+}
+
+// The override is all or nothing: index.html links the other files by their ETags, so a mix of
+// embedded and SPIFFS files could pin a browser to a stale copy for a year
+static void loadSpiffsOverride() {
+    File manifest = SPIFFS.open(WEB_ASSET_MANIFEST, "r");
+    if (!manifest) return; // The usual case: the UI is only in the firmware
+    char url[24];
+    char etag[sizeof(spiffsEtags[0])];
+    while (manifest.available()) {
+        String line = manifest.readStringUntil('\n');
+        if (!parseAssetManifestLine(line.c_str(), url, sizeof(url), etag, sizeof(etag))) continue;
+        for (size_t i = 0; i < WEB_ROUTE_COUNT; i++) {
+            if (strcmp(filePathOf(EMBEDDED_WEB_ASSETS[i]), url) == 0) strcpy(spiffsEtags[i], etag);
+        }
+    }
+    manifest.close();
+    bool complete = true;
+    for (size_t i = 0; i < WEB_ROUTE_COUNT; i++) {
+        if (spiffsEtags[i][0] == '\0' || !SPIFFS.exists(String(filePathOf(EMBEDDED_WEB_ASSETS[i])) + ".gz")) complete = false;
+    }
+    spiffsOverride = complete;
+    if(serialDebugEnabled) Serial.println(complete ? "[HTTP] Serving the web UI from SPIFFS (override)."
+                                                   : "[HTTP] Incomplete web UI on SPIFFS, serving the embedded copy.");
+}
+
+static void serveWebAsset(AsyncWebServerRequest* request, size_t route) {
+    const EmbeddedWebAsset& asset = EMBEDDED_WEB_ASSETS[route];
+    const char* assetEtag = spiffsOverride ? spiffsEtags[route] : asset.etag;
+    AsyncWebServerResponse* response;
+    const AsyncWebHeader* ifNoneMatch = request->getHeader("If-None-Match");
+    if (ifNoneMatch && etagMatches(ifNoneMatch->value().c_str(), assetEtag)) {
+        response = request->beginResponse(304);
+        webAssetNotModified++;
+    } else if (spiffsOverride) {
+        // Only <file>.gz is on SPIFFS, which the file response sends with Content-Encoding: gzip
+        response = request->beginResponse(SPIFFS, filePathOf(asset), asset.contentType);
+        webAssetFullResponses++;
+    } else {
+        response = request->beginResponse(200, asset.contentType, asset.data, asset.length); // Streamed from flash
+        response->addHeader("Content-Encoding", "gzip");
+        webAssetFullResponses++;
+    }
+    char etag[sizeof(spiffsEtags[0]) + 2];
+    snprintf(etag, sizeof(etag), "\"%s\"", assetEtag);
+    response->addHeader("ETag", etag);
+    response->addHeader("Cache-Control", asset.immutable ? CACHE_IMMUTABLE : CACHE_REVALIDATE);
+    request->send(response);
+}
+
+void setupWebAssetRoutes() {
+    loadSpiffsOverride();
+    for (size_t i = 0; i < WEB_ROUTE_COUNT; i++) {
+        server.on(EMBEDDED_WEB_ASSETS[i].url, HTTP_GET, [i](AsyncWebServerRequest *request){
+            serveWebAsset(request, i);
+        });
+    }
+}
+
+void getWebAssetStats(uint32_t* fullResponses, uint32_t* notModified, bool* fromSpiffs) {
+    *fullResponses = webAssetFullResponses;
+    *notModified = webAssetNotModified;
+    *fromSpiffs = spiffsOverride;
+}
@@ -0,0 +1,25 @@
+#ifndef WEB_ASSETS_H
+#define WEB_ASSETS_H
+
+#include "config.h"
+
+// The web UI (index.html, style.css, script.js) is compiled into the firmware: tools/build_web_assets.py
+// generates web_assets_embedded.h with the gzipped files as constexpr arrays (flash, served without copying)
+// and a route table. Responses carry Content-Encoding: gzip, a strong ETag and Cache-Control; a matching
+// If-None-Match gets a 304. No filesystem is needed, so the UI works even if SPIFFS fails to mount.
+// A filesystem image built with custom_web_ui_on_fs = yes (the .gz files plus /assets.txt) overrides the
+// embedded copy as a whole, so the UI can be updated with an uploadfs alone.
+
+struct EmbeddedWebAsset {
+    const char* url;
+    const char* contentType;
+    bool immutable;       // Linked as <url>?v=<etag> by index.html, so a new build changes the link
+    const char* etag;
+    const uint8_t* data;  // gzip
+    size_t length;
+};
+
+void setupWebAssetRoutes(); // Registers the generated routes (/, /index.html, /style.css, /script.js) on server
+void getWebAssetStats(uint32_t* fullResponses, uint32_t* notModified, bool* fromSpiffs); // Any task
+
+#endif // WEB_ASSETS_H
@@ -0,0 +1,101 @@
+#include "wifi_link.h"
+
+static void enterState(WifiLink* link, WifiLinkState state, uint32_t nowMs) {
+    link->state = state;
+    link->stateSinceMs = nowMs;
+}
+
+static WifiLinkAction beginAttempt(WifiLink* link, uint32_t nowMs) {
+    enterState(link, WIFI_LINK_CONNECTING, nowMs);
+    link->attemptStartMs = nowMs;
+    link->attempts++;
+    link->attemptIsFast = link->fastJoinAvailable;
+    if (link->attemptIsFast) link->fastAttempts++;
+    return WIFI_LINK_ACTION_BEGIN;
+}
+
+static void attemptFailed(WifiLink* link, uint32_t nowMs) {
+    if (link->attemptIsFast) { // Stale cache: fall back to a full join without waiting
+        link->fastFailures++;
+        link->fastJoinAvailable = 0;
+        link->backoffMs = 0;
+        enterState(link, WIFI_LINK_BACKOFF, nowMs);
+        return;
+    }
+    link->failures++;
+    if (link->consecutiveFailures < 31) link->consecutiveFailures++;
+    uint32_t backoff = link->backoffMinMs;
+    for (int i = 1; i < link->consecutiveFailures && backoff < link->backoffMaxMs; i++) backoff *= 2;
+    link->backoffMs = backoff < link->backoffMaxMs ? backoff : link->backoffMaxMs;
+    enterState(link, WIFI_LINK_BACKOFF, nowMs);
+}
+
+void wifiLinkInit(WifiLink* link, uint32_t connectTimeoutMs, uint32_t fastConnectTimeoutMs, uint32_t backoffMinMs, uint32_t backoffMaxMs) {
+    *link = WifiLink{};
+    link->connectTimeoutMs = connectTimeoutMs;
+    link->fastConnectTimeoutMs = fastConnectTimeoutMs;
+    link->backoffMinMs = backoffMinMs;
+    link->backoffMaxMs = backoffMaxMs;
+    link->state = WIFI_LINK_OFF;
+}
+
+void wifiLinkSetFastJoin(WifiLink* link, bool available) {
+    link->fastJoinAvailable = available;
+}
+
+WifiLinkAction wifiLinkStart(WifiLink* link, uint32_t nowMs) {
+    link->consecutiveFailures = 0;
+    return beginAttempt(link, nowMs);
+}
+
+WifiLinkAction wifiLinkStop(WifiLink* link, uint32_t nowMs) {
+    if (link->state == WIFI_LINK_OFF) return WIFI_LINK_ACTION_NONE;
+    enterState(link, WIFI_LINK_OFF, nowMs);
+    return WIFI_LINK_ACTION_DISCONNECT;
+}
+
+void wifiLinkOnConnected(WifiLink* link, uint32_t nowMs) {
+    if (link->state == WIFI_LINK_CONNECTED || link->state == WIFI_LINK_OFF) return;
+    link->lastConnectMs = nowMs - link->attemptStartMs;
+    if (link->firstOnlineMs == 0) link->firstOnlineMs = nowMs;
+    link->consecutiveFailures = 0;
+    enterState(link, WIFI_LINK_CONNECTED, nowMs);
+}
+
+WifiLinkAction wifiLinkOnDisconnected(WifiLink* link, uint32_t nowMs) {
+    if (link->state == WIFI_LINK_CONNECTED) { // Fast reconnect: the AP was there a moment ago
+        link->drops++;
+        return beginAttempt(link, nowMs);
+    }
+    if (link->state == WIFI_LINK_CONNECTING) attemptFailed(link, nowMs);
+    return WIFI_LINK_ACTION_NONE; // Repeated events while backing off or off change nothing
+}
+
+WifiLinkAction wifiLinkTick(WifiLink* link, uint32_t nowMs) {
+    uint32_t elapsed = nowMs - link->stateSinceMs;
+    uint32_t timeoutMs = link->attemptIsFast ? link->fastConnectTimeoutMs : link->connectTimeoutMs;
+    if (link->state == WIFI_LINK_CONNECTING && elapsed >= timeoutMs) {
+        attemptFailed(link, nowMs);
+        return WIFI_LINK_ACTION_DISCONNECT; // Abandon the attempt before the next WiFi.begin()
+    }
+    if (link->state == WIFI_LINK_BACKOFF && elapsed >= link->backoffMs) return beginAttempt(link, nowMs);
+    return WIFI_LINK_ACTION_NONE;
+}
+
+const char* wifiLinkStateName(uint8_t state) {
+    switch (state) {
+        case WIFI_LINK_CONNECTING: return "Connecting";
+        case WIFI_LINK_CONNECTED: return "Connected";
+        case WIFI_LINK_BACKOFF: return "Retry Wait";
+        default: return "Off";
+    }
+}
+
+bool wifiJoinCacheUsable(const WifiJoinCache* cache, const char* ssid) {
+    if (!cache->valid || cache->channel == 0) return false;
+    for (int i = 0; i < (int)sizeof(cache->ssid); i++) {
+        if (cache->ssid[i] != ssid[i]) return false;
+        if (ssid[i] == '\0') return true;
+    }
+    return false; // Unterminated cache entry
+}
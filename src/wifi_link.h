@@ -0,0 +1,65 @@
+#ifndef WIFI_LINK_H
+#define WIFI_LINK_H
+
+#include <stdint.h>
+
+// Station link state machine for the WiFi manager: when to call WiFi.begin(), how long an attempt may
+// take, and how long to back off after failures (exponential, capped). A link that drops after being up
+// is retried at once; only failed attempts back off. Nothing here blocks or touches the radio: callers
+// feed it link events and act on the returned action.
+// With a join cache available, attempts are "fast": directed at the cached BSSID/channel, under a shorter
+// timeout. The address still comes from DHCP (or the static config), never from an old lease. A failed
+// fast attempt drops the cache and retries at once with a full scan, so a stale cache costs at most one
+// short attempt.
+
+enum WifiLinkState : uint8_t { WIFI_LINK_OFF, WIFI_LINK_CONNECTING, WIFI_LINK_CONNECTED, WIFI_LINK_BACKOFF };
+enum WifiLinkAction : uint8_t { WIFI_LINK_ACTION_NONE, WIFI_LINK_ACTION_BEGIN, WIFI_LINK_ACTION_DISCONNECT };
+
+// Last successful join, persisted so the next boot can skip the scan
+struct WifiJoinCache {
+    uint8_t valid;
+    uint8_t channel;
+    uint8_t bssid[6];
+    char ssid[33];      // The cache only applies to this network
+};
+
+struct WifiStaticIpConfig {
+    uint8_t enabled;
+    uint32_t ip;
+    uint32_t gateway;
+    uint32_t subnet;
+    uint32_t dns;       // 0 = use the gateway
+};
+
+struct WifiLink {
+    uint32_t connectTimeoutMs;   // An attempt without an IP after this long counts as failed
+    uint32_t fastConnectTimeoutMs; // Same for a fast (cached BSSID/channel) attempt
+    uint32_t backoffMinMs;       // Wait after the first failed attempt, doubled per further failure
+    uint32_t backoffMaxMs;
+    uint8_t state;               // WifiLinkState
+    uint8_t consecutiveFailures;
+    uint32_t stateSinceMs;
+    uint32_t backoffMs;          // Wait of the current BACKOFF state
+    uint32_t attemptStartMs;
+    uint32_t attempts;           // WiFi.begin() calls
+    uint32_t failures;           // Attempts that failed or timed out
+    uint32_t drops;              // Established links that went down
+    uint32_t lastConnectMs;      // Duration of the last successful attempt
+    uint32_t firstOnlineMs;      // Clock value at the first successful attempt (boot-to-online with millis())
+    uint8_t fastJoinAvailable;   // Set by the caller when a usable join cache exists
+    uint8_t attemptIsFast;       // Current attempt uses the join cache
+    uint32_t fastAttempts;
+    uint32_t fastFailures;       // Fast attempts that fell back to a full join
+};
+
+void wifiLinkInit(WifiLink* link, uint32_t connectTimeoutMs, uint32_t fastConnectTimeoutMs, uint32_t backoffMinMs, uint32_t backoffMaxMs);
+void wifiLinkSetFastJoin(WifiLink* link, bool available); // Applies from the next attempt
+WifiLinkAction wifiLinkStart(WifiLink* link, uint32_t nowMs);  // From OFF (or to restart with new credentials)
+WifiLinkAction wifiLinkStop(WifiLink* link, uint32_t nowMs);
+void wifiLinkOnConnected(WifiLink* link, uint32_t nowMs);      // Got an IP
+WifiLinkAction wifiLinkOnDisconnected(WifiLink* link, uint32_t nowMs); // Link lost or attempt rejected
+WifiLinkAction wifiLinkTick(WifiLink* link, uint32_t nowMs);   // Attempt timeouts and backoff expiry
+const char* wifiLinkStateName(uint8_t state);
+bool wifiJoinCacheUsable(const WifiJoinCache* cache, const char* ssid);
+
+#endif // WIFI_LINK_H
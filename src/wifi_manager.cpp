@@ -0,0 +1,199 @@
+#include "wifi_manager.h"
+#include "tasks.h"
+#include "network_handler.h"
+#include "mqtt_handler.h"
+#include "nvs_handler.h"
+#include <ElegantOTA.h>
+#include <WiFi.h>
+#include <atomic>
+
+static WifiLink wifiLink;
+static bool wifiHeld = false;          // Manual disconnect, cleared by a reconnect request
+static bool radioConfigured = false;   // Mode, hostname and auto-reconnect set up once before the first begin
+static bool servicesInitialized = false;
+static bool servicesRunning = false;
+static std::atomic<bool> reconnectRequested(false);
+static std::atomic<bool> disconnectRequested(false);
+static std::atomic<bool> attemptFailed(false); // Set by the event handler, consumed by wifiManagerLoop()
+static uint32_t seenFastFailures = 0;
+
+// Runs in the WiFi event task: record and wake networkTask, nothing else
+static void onWiFiEvent(WiFiEvent_t event, WiFiEventInfo_t info) {
+    if (event == ARDUINO_EVENT_WIFI_STA_DISCONNECTED) {
+        // Reason 8 (ASSOC_LEAVE) is our own WiFi.disconnect()
+        if (info.wifi_sta_disconnected.reason != 8) attemptFailed = true;
+        wakeNetworkTask(NETWORK_TASK_WAKE_WIFI);
+    } else if (event == ARDUINO_EVENT_WIFI_STA_GOT_IP) {
+        wakeNetworkTask(NETWORK_TASK_WAKE_WIFI);
+    }
+}
+
+static bool ssidConfigured() {
+    return strlen(current_ssid) > 0 && strcmp(current_ssid, "YOUR_WIFI_SSID") != 0;
+}
+
+static void configureRadio() {
+    if (radioConfigured) return;
+    uint8_t mac[6];
+    char hostname[32]; // "fancontrol-" is 11 chars, MAC is 12 chars, plus null terminator
+    WiFi.macAddress(mac);
+    sprintf(hostname, "fancontrol-%02x%02x%02x%02x%02x%02x", mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+    if(serialDebugEnabled) Serial.printf("[WiFi] Setting hostname to: %s\n", hostname);
+    if (!WiFi.setHostname(hostname)) {
+        if(serialDebugEnabled) Serial.println("[WiFi_ERR] Failed to set hostname.");
+    }
+    WiFi.mode(WIFI_STA);
+    WiFi.setAutoReconnect(false); // Retries are paced by wifiLink
+    radioConfigured = true;
+}
+
+static void refreshFastJoin() {
+    wifiLinkSetFastJoin(&wifiLink, wifiJoinCacheUsable(&wifiJoinCache, current_ssid));
+}
+
+// Stores the BSSID and channel of the link that just came up; saved only when something changed
+static void rememberJoin() {
+    WifiJoinCache fresh;
+    memset(&fresh, 0, sizeof(fresh)); // Padding included, so memcmp() compares only real changes
+    fresh.valid = 1;
+    fresh.channel = (uint8_t)WiFi.channel();
+    const uint8_t* bssid = WiFi.BSSID();
+    if (bssid) memcpy(fresh.bssid, bssid, sizeof(fresh.bssid));
+    strncpy(fresh.ssid, current_ssid, sizeof(fresh.ssid) - 1);
+    if (memcmp(&fresh, &wifiJoinCache, sizeof(fresh)) != 0) {
+        memcpy(&wifiJoinCache, &fresh, sizeof(fresh));
+        requestNvsSave(NVS_SECTION_WIFI_JOIN);
+    }
+    refreshFastJoin();
+}
+
+static void forgetJoin() {
+    if(serialDebugEnabled) Serial.println("[WiFi] Cached join failed, falling back to a full scan.");
+    wifiJoinCache.valid = 0;
+    requestNvsSave(NVS_SECTION_WIFI_JOIN);
+}
+
+static void startNetworkServices() {
+    if (!servicesInitialized) {
+        setupWebServerRoutes(); // Includes the /ws WebSocket
+        ElegantOTA.begin(&server);
+        if (isMqttEnabled) {
+            setupMQTT(); // Initialize MQTT client, topics, server etc.
+        } else {
+            if(serialDebugEnabled) Serial.println("[MQTT] MQTT is disabled. Skipping MQTT setup.");
+        }
+        servicesInitialized = true;
+    }
+    server.begin();
+    servicesRunning = true;
+    if(serialDebugEnabled) Serial.println("[SYSTEM] HTTP server, WebSocket (/ws) and ElegantOTA (/update) started on Core 0.");
+}
+
+static void stopNetworkServices() {
+    servicesRunning = false;
+    webSocket.closeAll();
+    events.close();
+    server.end();
+    if (isMqttEnabled && mqttClient.connected()) mqttClient.disconnect();
+    if(serialDebugEnabled) Serial.println("[SYSTEM] Network services stopped (WiFi down).");
+}
+
+static void applyAction(WifiLinkAction action) {
+    if (action == WIFI_LINK_ACTION_BEGIN) {
+        configureRadio();
+        attemptFailed = false;
+        if(serialDebugEnabled) Serial.printf("[WiFi] Connecting to SSID '%s' (attempt %lu, %s)\n", current_ssid, (unsigned long)wifiLink.attempts,
+                                             wifiLink.attemptIsFast ? "cached BSSID/channel" : "scan");
+        if (wifiStaticIp.enabled) {
+            WiFi.config(IPAddress(wifiStaticIp.ip), IPAddress(wifiStaticIp.gateway), IPAddress(wifiStaticIp.subnet),
+                        IPAddress(wifiStaticIp.dns ? wifiStaticIp.dns : wifiStaticIp.gateway));
+        } else {
+            WiFi.config(IPAddress((uint32_t)0), IPAddress((uint32_t)0), IPAddress((uint32_t)0)); // DHCP, fast join or not
+        }
+        if (wifiLink.attemptIsFast) WiFi.begin(current_ssid, current_password, wifiJoinCache.channel, wifiJoinCache.bssid);
+        else WiFi.begin(current_ssid, current_password);
+    } else if (action == WIFI_LINK_ACTION_DISCONNECT) {
+        WiFi.disconnect(wifiLink.state == WIFI_LINK_OFF); // Radio off only when the link is not wanted
+    }
+}
+
+void setupWiFiManager() {
+    wifiLinkInit(&wifiLink, WIFI_CONNECT_TIMEOUT_MS, WIFI_FAST_CONNECT_TIMEOUT_MS, WIFI_BACKOFF_MIN_MS, WIFI_BACKOFF_MAX_MS);
+    WiFi.onEvent(onWiFiEvent);
+    if(serialDebugEnabled) {
+        if (!isWiFiEnabled) Serial.println("[WiFi] WiFi is disabled by NVS config. Skipping WiFi connection.");
+        else if (!ssidConfigured()) Serial.println("[WiFi] SSID not configured or is default. Skipping WiFi connection.");
+    }
+}
+
+void wifiManagerLoop() {
+    uint32_t now = millis();
+
+    if (disconnectRequested.exchange(false)) {
+        wifiHeld = true;
+        applyAction(wifiLinkStop(&wifiLink, now));
+    }
+    if (reconnectRequested.exchange(false)) {
+        wifiHeld = false;
+        if (isWiFiEnabled && ssidConfigured()) {
+            if (wifiLink.state != WIFI_LINK_OFF) WiFi.disconnect();
+            refreshFastJoin(); // The credentials may have changed
+            applyAction(wifiLinkStart(&wifiLink, now)); // Restarts with the current credentials
+        }
+    }
+
+    bool wanted = isWiFiEnabled && !wifiHeld && ssidConfigured();
+    if (wanted && wifiLink.state == WIFI_LINK_OFF) {
+        refreshFastJoin();
+        applyAction(wifiLinkStart(&wifiLink, now));
+    } else if (!wanted && wifiLink.state != WIFI_LINK_OFF) {
+        applyAction(wifiLinkStop(&wifiLink, now));
+    }
+
+    bool linkUp = WiFi.status() == WL_CONNECTED;
+    if (wifiLink.state == WIFI_LINK_CONNECTING) {
+        if (linkUp) {
+            bool firstOnline = wifiLink.firstOnlineMs == 0;
+            wifiLinkOnConnected(&wifiLink, now);
+            rememberJoin();
+            if(serialDebugEnabled && firstOnline) Serial.printf("[WiFi] Online %lu ms after boot.\n", (unsigned long)wifiLink.firstOnlineMs);
+            if(serialDebugEnabled) {
+                Serial.printf("[WiFi] Connected in %lu ms. IP Address: ", (unsigned long)wifiLink.lastConnectMs); Serial.println(WiFi.localIP());
+                Serial.print("[WiFi] Hostname: "); Serial.println(WiFi.getHostname());
+            }
+        } else if (attemptFailed.exchange(false)) {
+            applyAction(wifiLinkOnDisconnected(&wifiLink, now));
+            if(serialDebugEnabled) Serial.printf("[WiFi] Attempt failed, retrying in %lu ms.\n", (unsigned long)wifiLink.backoffMs);
+        }
+    } else if (wifiLink.state == WIFI_LINK_CONNECTED && !linkUp) {
+        if(serialDebugEnabled) Serial.println("[WiFi] Link lost, reconnecting.");
+        applyAction(wifiLinkOnDisconnected(&wifiLink, now));
+    }
+    applyAction(wifiLinkTick(&wifiLink, now));
+    if (wifiLink.fastFailures != seenFastFailures) {
+        seenFastFailures = wifiLink.fastFailures;
+        forgetJoin();
+    }
+
+    bool servicesWanted = wifiLink.state == WIFI_LINK_CONNECTED;
+    if (servicesWanted && !servicesRunning) startNetworkServices();
+    else if (!servicesWanted && servicesRunning) stopNetworkServices();
+}
+
+bool wifiServicesRunning() {
+    return servicesRunning;
+}
+
+void requestWiFiReconnect() {
+    reconnectRequested = true;
+    wakeNetworkTask(NETWORK_TASK_WAKE_WIFI);
+}
+
+void requestWiFiDisconnect() {
+    disconnectRequested = true;
+    wakeNetworkTask(NETWORK_TASK_WAKE_WIFI);
+}
+
+const WifiLink* getWifiLink() {
+    return &wifiLink;
+}
@@ -0,0 +1,20 @@
+#ifndef WIFI_MANAGER_H
+#define WIFI_MANAGER_H
+
+#include "config.h"
+#include "wifi_link.h"
+
+// Station connection manager, driven by networkTask. WiFi events only wake the task; connects, retries
+// (exponential backoff, see wifi_link.h) and the start/stop of the web server, WebSocket, OTA and MQTT
+// services happen in wifiManagerLoop(), which never blocks.
+void setupWiFiManager();
+void wifiManagerLoop();
+bool wifiServicesRunning(); // Web/WebSocket/MQTT may be serviced (networkTask only)
+
+// Callable from any task; applied by networkTask on its next pass
+void requestWiFiReconnect();  // Reconnect with the current credentials, clears a manual disconnect
+void requestWiFiDisconnect(); // Drop the link and stay off until requestWiFiReconnect()
+
+const WifiLink* getWifiLink(); // Written by networkTask only
+
+#endif // WIFI_MANAGER_H
@@ -21,11 +21,13 @@ void setUp(void) {
     // Initialize or reset the state of global variables (defined in main.cpp) here
     // if your tests require a specific starting state.
     // These variables are declared 'extern' in config.h and defined in main.cpp.
-    numCurvePoints = 0;
+    // The single-fan tests below exercise channel 0.
+    fanChannels.curveNumPoints[0] = 0;
+    invalidateFanCurveLut(0); // Some tests write the curve arrays directly
     tempSensorFound = true;
-    isAutoMode = true;
-    fanSpeedPercentage = 0;
-    fanSpeedPWM_Raw = 0;
+    fanChannels.isAutoMode[0] = true;
+    fanChannels.speedPercentage[0] = 0;
+    fanChannels.pwmRaw[0] = 0;
     needsImmediateBroadcast = false;
     currentTemperature = 25.0f; // Default for tests if needed
     // Initialize other globals from main.cpp as needed for consistent test states
@@ -38,74 +40,74 @@ void tearDown(void) {
 
 // --- Test Cases for setDefaultFanCurve ---
 void test_setDefaultFanCurve_values(void) {
-    setDefaultFanCurve(); // This function is in fan_control.cpp
-    TEST_ASSERT_EQUAL_INT(5, numCurvePoints);
-    TEST_ASSERT_EQUAL_INT(25, tempPoints[0]);
-    TEST_ASSERT_EQUAL_INT(0, pwmPercentagePoints[0]);
-    TEST_ASSERT_EQUAL_INT(35, tempPoints[1]);
-    TEST_ASSERT_EQUAL_INT(20, pwmPercentagePoints[1]);
-    TEST_ASSERT_EQUAL_INT(45, tempPoints[2]);
-    TEST_ASSERT_EQUAL_INT(50, pwmPercentagePoints[2]);
-    TEST_ASSERT_EQUAL_INT(55, tempPoints[3]);
-    TEST_ASSERT_EQUAL_INT(80, pwmPercentagePoints[3]);
-    TEST_ASSERT_EQUAL_INT(60, tempPoints[4]);
-    TEST_ASSERT_EQUAL_INT(100, pwmPercentagePoints[4]);
+    setDefaultFanCurve(0); // This function is in fan_control.cpp
+    TEST_ASSERT_EQUAL_INT(5, fanChannels.curveNumPoints[0]);
+    TEST_ASSERT_EQUAL_INT(25, fanChannels.curveTempPoints[0][0]);
+    TEST_ASSERT_EQUAL_INT(0, fanChannels.curvePwmPoints[0][0]);
+    TEST_ASSERT_EQUAL_INT(35, fanChannels.curveTempPoints[0][1]);
+    TEST_ASSERT_EQUAL_INT(20, fanChannels.curvePwmPoints[0][1]);
+    TEST_ASSERT_EQUAL_INT(45, fanChannels.curveTempPoints[0][2]);
+    TEST_ASSERT_EQUAL_INT(50, fanChannels.curvePwmPoints[0][2]);
+    TEST_ASSERT_EQUAL_INT(55, fanChannels.curveTempPoints[0][3]);
+    TEST_ASSERT_EQUAL_INT(80, fanChannels.curvePwmPoints[0][3]);
+    TEST_ASSERT_EQUAL_INT(60, fanChannels.curveTempPoints[0][4]);
+    TEST_ASSERT_EQUAL_INT(100, fanChannels.curvePwmPoints[0][4]);
 }
 
 // --- Test Cases for calculateAutoFanPWMPercentage ---
 void test_calculate_pwm_no_sensor(void) {
     tempSensorFound = false; // Global variable from main.cpp
-    setDefaultFanCurve();
+    setDefaultFanCurve(0);
     // AUTO_MODE_NO_SENSOR_FAN_PERCENTAGE is a const int defined in main.cpp
-    int pwm = calculateAutoFanPWMPercentage(30.0f);
+    int pwm = calculateAutoFanPWMPercentage(0, 30.0f);
     TEST_ASSERT_EQUAL_INT(AUTO_MODE_NO_SENSOR_FAN_PERCENTAGE, pwm);
 }
 
 void test_calculate_pwm_no_curve_points(void) {
     tempSensorFound = true;
-    numCurvePoints = 0; // Global variable from main.cpp
-    int pwm = calculateAutoFanPWMPercentage(30.0f);
+    fanChannels.curveNumPoints[0] = 0; // Global variable from main.cpp
+    int pwm = calculateAutoFanPWMPercentage(0, 30.0f);
     TEST_ASSERT_EQUAL_INT(0, pwm);
 }
 
 void test_calculate_pwm_temp_below_first_point(void) {
-    setDefaultFanCurve();
-    int pwm = calculateAutoFanPWMPercentage(20.0f);
-    TEST_ASSERT_EQUAL_INT(pwmPercentagePoints[0], pwm); // Global array from main.cpp
+    setDefaultFanCurve(0);
+    int pwm = calculateAutoFanPWMPercentage(0, 20.0f);
+    TEST_ASSERT_EQUAL_INT(fanChannels.curvePwmPoints[0][0], pwm); // Global array from main.cpp
 }
 
 void test_calculate_pwm_temp_above_last_point(void) {
-    setDefaultFanCurve();
-    int pwm = calculateAutoFanPWMPercentage(70.0f);
-    TEST_ASSERT_EQUAL_INT(pwmPercentagePoints[numCurvePoints - 1], pwm);
+    setDefaultFanCurve(0);
+    int pwm = calculateAutoFanPWMPercentage(0, 70.0f);
+    TEST_ASSERT_EQUAL_INT(fanChannels.curvePwmPoints[0][fanChannels.curveNumPoints[0] - 1], pwm);
 }
 
 void test_calculate_pwm_temp_exactly_on_point(void) {
-    setDefaultFanCurve();
-    int pwm = calculateAutoFanPWMPercentage((float)tempPoints[1]); // Global array from main.cpp
-    TEST_ASSERT_EQUAL_INT(pwmPercentagePoints[1], pwm);
-    pwm = calculateAutoFanPWMPercentage((float)tempPoints[2]);
-    TEST_ASSERT_EQUAL_INT(pwmPercentagePoints[2], pwm);
+    setDefaultFanCurve(0);
+    int pwm = calculateAutoFanPWMPercentage(0, (float)fanChannels.curveTempPoints[0][1]); // Global array from main.cpp
+    TEST_ASSERT_EQUAL_INT(fanChannels.curvePwmPoints[0][1], pwm);
+    pwm = calculateAutoFanPWMPercentage(0, (float)fanChannels.curveTempPoints[0][2]);
+    TEST_ASSERT_EQUAL_INT(fanChannels.curvePwmPoints[0][2], pwm);
 }
 
 void test_calculate_pwm_temp_between_points_linear_interpolation(void) {
-    setDefaultFanCurve();
-    int pwm = calculateAutoFanPWMPercentage(40.0f);
+    setDefaultFanCurve(0);
+    int pwm = calculateAutoFanPWMPercentage(0, 40.0f);
     TEST_ASSERT_EQUAL_INT(35, pwm);
-    pwm = calculateAutoFanPWMPercentage(37.0f);
+    pwm = calculateAutoFanPWMPercentage(0, 37.0f);
     TEST_ASSERT_EQUAL_INT(26, pwm);
 }
 
 void test_calculate_pwm_with_flat_segment_in_curve(void) {
     // Setup a custom curve using global arrays
-    numCurvePoints = 4;
-    tempPoints[0] = 20; pwmPercentagePoints[0] = 10;
-    tempPoints[1] = 30; pwmPercentagePoints[1] = 40;
-    tempPoints[2] = 30; pwmPercentagePoints[2] = 60; // tempPoints[1] == tempPoints[2]
-    tempPoints[3] = 40; pwmPercentagePoints[3] = 80;
-
-    int pwm = calculateAutoFanPWMPercentage(30.0f);
-    TEST_ASSERT_EQUAL_INT(40, pwm); // Expects pwmPercentagePoints[1] due to tempRange = 0 logic
+    fanChannels.curveNumPoints[0] = 4;
+    fanChannels.curveTempPoints[0][0] = 20; fanChannels.curvePwmPoints[0][0] = 10;
+    fanChannels.curveTempPoints[0][1] = 30; fanChannels.curvePwmPoints[0][1] = 40;
+    fanChannels.curveTempPoints[0][2] = 30; fanChannels.curvePwmPoints[0][2] = 60; // point 1 and point 2 share a temperature
+    fanChannels.curveTempPoints[0][3] = 40; fanChannels.curvePwmPoints[0][3] = 80;
+
+    int pwm = calculateAutoFanPWMPercentage(0, 30.0f);
+    TEST_ASSERT_EQUAL_INT(40, pwm); // Expects point 1 PWM due to tempRange = 0 logic
 }
 
 // --- Test Cases for setFanSpeed ---
@@ -113,27 +115,27 @@ void test_calculate_pwm_with_flat_segment_in_curve(void) {
 // without more advanced mocking frameworks or running on target.
 // We test the effect on global variables.
 void test_setFanSpeed_updates_globals(void) {
-    setFanSpeed(75); // This function is in fan_control.cpp
-    TEST_ASSERT_EQUAL_INT(75, fanSpeedPercentage); // Global variable from main.cpp
+    setFanSpeed(0, 75); // This function is in fan_control.cpp
+    TEST_ASSERT_EQUAL_INT(75, fanChannels.speedPercentage[0]); // Global variable from main.cpp
     // PWM_RESOLUTION_BITS is a const int defined in main.cpp (via config.h)
     // Expected raw PWM: map(75, 0, 100, 0, (1 << PWM_RESOLUTION_BITS) - 1)
     // If PWM_RESOLUTION_BITS = 8, max_duty = 255. (75 * 255) / 100 = 191.25 -> 191
-    TEST_ASSERT_EQUAL_INT(191, fanSpeedPWM_Raw); // Global variable from main.cpp
+    TEST_ASSERT_EQUAL_INT(191, fanChannels.pwmRaw[0]); // Global variable from main.cpp
     TEST_ASSERT_TRUE(needsImmediateBroadcast); // Global variable from main.cpp
 }
 
 void test_setFanSpeed_clamps_percentage_low(void) {
-    setFanSpeed(-10);
-    TEST_ASSERT_EQUAL_INT(0, fanSpeedPercentage);
-    TEST_ASSERT_EQUAL_INT(0, fanSpeedPWM_Raw);
+    setFanSpeed(0, -10);
+    TEST_ASSERT_EQUAL_INT(0, fanChannels.speedPercentage[0]);
+    TEST_ASSERT_EQUAL_INT(0, fanChannels.pwmRaw[0]);
     TEST_ASSERT_TRUE(needsImmediateBroadcast);
 }
 
 void test_setFanSpeed_clamps_percentage_high(void) {
-    setFanSpeed(110);
-    TEST_ASSERT_EQUAL_INT(100, fanSpeedPercentage);
+    setFanSpeed(0, 110);
+    TEST_ASSERT_EQUAL_INT(100, fanChannels.speedPercentage[0]);
     // If PWM_RESOLUTION_BITS = 8, max_duty = 255.
-    TEST_ASSERT_EQUAL_INT(255, fanSpeedPWM_Raw);
+    TEST_ASSERT_EQUAL_INT(255, fanChannels.pwmRaw[0]);
     TEST_ASSERT_TRUE(needsImmediateBroadcast);
 }
 
@@ -0,0 +1,64 @@
+/**
+ * @file test_byte_rate.cpp
+ * @brief Host-side tests for the sliding bytes-per-minute window used for WebSocket traffic stats.
+ * Run with `pio test -e native`.
+ */
+#include <unity.h>
+#include "byte_rate.h"
+
+static ByteRate rate;
+
+void setUp(void) {
+    rate = ByteRate{};
+}
+
+void tearDown(void) {}
+
+void test_sums_bytes_within_a_minute(void) {
+    byteRateAdd(&rate, 100, 0);
+    byteRateAdd(&rate, 200, 15000);
+    byteRateAdd(&rate, 300, 59999);
+    TEST_ASSERT_EQUAL_UINT32(600, byteRatePerMinute(&rate, 59999));
+    TEST_ASSERT_EQUAL_UINT32(600, rate.total);
+}
+
+void test_old_buckets_expire(void) {
+    byteRateAdd(&rate, 100, 0);
+    byteRateAdd(&rate, 200, 15000);
+    TEST_ASSERT_EQUAL_UINT32(300, byteRatePerMinute(&rate, 59999));
+    TEST_ASSERT_EQUAL_UINT32(200, byteRatePerMinute(&rate, 60000)); // Bucket 0-10 s dropped
+    TEST_ASSERT_EQUAL_UINT32(0, byteRatePerMinute(&rate, 80000));
+}
+
+void test_long_idle_clears_everything(void) {
+    byteRateAdd(&rate, 500, 5000);
+    byteRateAdd(&rate, 40, 3600000);
+    TEST_ASSERT_EQUAL_UINT32(40, byteRatePerMinute(&rate, 3600000));
+    TEST_ASSERT_EQUAL_UINT32(540, rate.total);
+}
+
+void test_reading_does_not_change_the_window(void) {
+    byteRateAdd(&rate, 100, 0);
+    TEST_ASSERT_EQUAL_UINT32(0, byteRatePerMinute(&rate, 120000));
+    TEST_ASSERT_EQUAL_UINT32(100, byteRatePerMinute(&rate, 1000)); // An older clock reading still sees it
+}
+
+void test_steady_traffic_rate(void) {
+    uint32_t now = 0;
+    for (int i = 0; i < 600; i++) { // 120 bytes per second for 10 minutes
+        byteRateAdd(&rate, 120, now);
+        now += 1000;
+    }
+    uint32_t perMinute = byteRatePerMinute(&rate, now - 1000);
+    TEST_ASSERT_INT_WITHIN(1200, 7200, perMinute); // Within one bucket of 60 s worth
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_sums_bytes_within_a_minute);
+    RUN_TEST(test_old_buckets_expire);
+    RUN_TEST(test_long_idle_clears_everything);
+    RUN_TEST(test_reading_does_not_change_the_window);
+    RUN_TEST(test_steady_traffic_rate);
+    return UNITY_END();
+}
@@ -0,0 +1,136 @@
+/**
+ * @file test_control_command_queue.cpp
+ * @brief Host-side tests for the MPSC control command ring: FIFO order, full-queue drops, counters, and
+ * several producer threads racing one consumer. Run with `pio test -e native`.
+ */
+#include <unity.h>
+#include <stdio.h>
+#include <math.h>
+#include <thread>
+#include <vector>
+#include "control_command_queue.h"
+
+static ControlCommandQueue queue;
+
+void setUp(void) {
+    controlCommandQueueInit(&queue);
+}
+
+void tearDown(void) {}
+
+void test_make_command_defaults(void) {
+    ControlCommand c = makeControlCommand(CMD_SET_PID, 2, CMD_SOURCE_MQTT);
+    TEST_ASSERT_EQUAL_INT(CMD_SET_PID, c.type);
+    TEST_ASSERT_EQUAL_INT(CMD_SOURCE_MQTT, c.source);
+    TEST_ASSERT_EQUAL_INT(2, c.channel);
+    TEST_ASSERT_EQUAL_INT(CONTROL_COMMAND_KEEP, c.value);
+    TEST_ASSERT_TRUE(isnan(c.params[0]) && isnan(c.params[3]));
+    TEST_ASSERT_EQUAL_INT(0, c.curveNumPoints);
+    TEST_ASSERT_EQUAL_INT(CONTROL_COMMAND_ALL_CHANNELS, makeControlCommand(CMD_FAN_ON, CONTROL_COMMAND_ALL_CHANNELS, CMD_SOURCE_SERIAL).channel);
+}
+
+void test_fifo_order_and_empty(void) {
+    ControlCommand out;
+    TEST_ASSERT_FALSE(controlCommandQueuePop(&queue, &out, 0));
+    for (int i = 0; i < 5; i++) {
+        ControlCommand c = makeControlCommand(CMD_SET_MANUAL_SPEED, 0, CMD_SOURCE_WEBSOCKET);
+        c.value = i * 10;
+        TEST_ASSERT_TRUE(controlCommandQueuePush(&queue, c, 1000 + i));
+    }
+    for (int i = 0; i < 5; i++) {
+        TEST_ASSERT_TRUE(controlCommandQueuePop(&queue, &out, 2000));
+        TEST_ASSERT_EQUAL_INT(i * 10, out.value);
+        TEST_ASSERT_EQUAL_UINT32(1000 + i, out.enqueuedMicros);
+    }
+    TEST_ASSERT_FALSE(controlCommandQueuePop(&queue, &out, 2000));
+
+    ControlCommandQueueStats stats;
+    controlCommandQueueGetStats(&queue, &stats);
+    TEST_ASSERT_EQUAL_UINT32(0, stats.depth);
+    TEST_ASSERT_EQUAL_UINT32(5, stats.maxDepth);
+    TEST_ASSERT_EQUAL_UINT32(5, stats.enqueued);
+    TEST_ASSERT_EQUAL_UINT32(5, stats.applied);
+    TEST_ASSERT_EQUAL_UINT32(0, stats.dropped);
+    TEST_ASSERT_EQUAL_UINT32(1000, stats.latencyMaxUs);
+    TEST_ASSERT_EQUAL_UINT32(998, stats.latencyAvgUs);
+}
+
+void test_full_queue_drops_new_commands(void) {
+    ControlCommand c = makeControlCommand(CMD_FAN_OFF, 0, CMD_SOURCE_SERIAL);
+    for (uint32_t i = 0; i < CONTROL_COMMAND_QUEUE_SIZE; i++) {
+        c.value = (int32_t)i;
+        TEST_ASSERT_TRUE(controlCommandQueuePush(&queue, c, 0));
+    }
+    TEST_ASSERT_FALSE(controlCommandQueuePush(&queue, c, 0));
+    TEST_ASSERT_FALSE(controlCommandQueuePush(&queue, c, 0));
+
+    ControlCommandQueueStats stats;
+    controlCommandQueueGetStats(&queue, &stats);
+    TEST_ASSERT_EQUAL_UINT32(CONTROL_COMMAND_QUEUE_SIZE, stats.depth);
+    TEST_ASSERT_EQUAL_UINT32(2, stats.dropped);
+
+    ControlCommand out;
+    TEST_ASSERT_TRUE(controlCommandQueuePop(&queue, &out, 0));
+    TEST_ASSERT_EQUAL_INT(0, out.value); // Oldest kept, newest dropped
+    TEST_ASSERT_TRUE(controlCommandQueuePush(&queue, c, 0)); // Room again
+}
+
+void test_wraps_many_laps(void) {
+    ControlCommand out;
+    for (int i = 0; i < 1000; i++) {
+        ControlCommand c = makeControlCommand(CMD_SET_RPM_TARGET, 0, CMD_SOURCE_MQTT);
+        c.value = i;
+        TEST_ASSERT_TRUE(controlCommandQueuePush(&queue, c, 0));
+        if (i % 3 == 0) continue; // Let the depth vary
+        while (controlCommandQueuePop(&queue, &out, 0)) {}
+        TEST_ASSERT_EQUAL_INT(i, out.value);
+    }
+}
+
+void test_concurrent_producers(void) {
+    const int producers = 4;
+    const int perProducer = 50000;
+    std::vector<std::thread> threads;
+    std::atomic<int> rejected(0);
+    for (int p = 0; p < producers; p++) {
+        threads.emplace_back([p, &rejected]() {
+            for (int i = 0; i < perProducer; i++) {
+                ControlCommand c = makeControlCommand(CMD_SET_MANUAL_SPEED, p, CMD_SOURCE_WEBSOCKET);
+                c.value = i;
+                while (!controlCommandQueuePush(&queue, c, 0)) { rejected++; std::this_thread::yield(); } // Retry on full
+            }
+        });
+    }
+    int next[producers] = {0};
+    int received = 0, outOfOrder = 0;
+    ControlCommand out;
+    while (received < producers * perProducer) {
+        if (!controlCommandQueuePop(&queue, &out, 0)) continue;
+        if (out.value != next[out.channel]) outOfOrder++;
+        next[out.channel] = out.value + 1;
+        received++;
+    }
+    for (auto& t : threads) t.join();
+
+    ControlCommandQueueStats stats;
+    controlCommandQueueGetStats(&queue, &stats);
+    char msg[160];
+    snprintf(msg, sizeof(msg), "%d commands from %d producers, max depth %u, %d pushes hit a full queue",
+             received, producers, stats.maxDepth, rejected.load());
+    TEST_MESSAGE(msg);
+    TEST_ASSERT_EQUAL_INT(0, outOfOrder); // Per-producer FIFO, nothing lost or duplicated
+    for (int p = 0; p < producers; p++) TEST_ASSERT_EQUAL_INT(perProducer, next[p]);
+    TEST_ASSERT_FALSE(controlCommandQueuePop(&queue, &out, 0));
+    TEST_ASSERT_EQUAL_UINT32((uint32_t)rejected.load(), stats.dropped);
+    TEST_ASSERT_TRUE(stats.maxDepth <= CONTROL_COMMAND_QUEUE_SIZE);
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_make_command_defaults);
+    RUN_TEST(test_fifo_order_and_empty);
+    RUN_TEST(test_full_queue_drops_new_commands);
+    RUN_TEST(test_wraps_many_laps);
+    RUN_TEST(test_concurrent_producers);
+    return UNITY_END();
+}
@@ -0,0 +1,76 @@
+/**
+ * @file test_control_loop_timing.cpp
+ * @brief Host-side tests for the control loop jitter / overrun bookkeeping. Run with `pio test -e native`.
+ */
+#include <unity.h>
+#include "control_loop_timing.h"
+
+static ControlLoopTiming timing;
+
+void setUp(void) {
+    controlLoopTimingInit(&timing, 50000);
+}
+
+void tearDown(void) {}
+
+static void runPass(uint32_t startUs, uint32_t execUs) {
+    controlLoopTimingPassStart(&timing, startUs);
+    controlLoopTimingPassEnd(&timing, startUs + execUs);
+}
+
+void test_first_pass_has_no_period(void) {
+    runPass(1000, 300);
+    TEST_ASSERT_EQUAL_UINT32(1, timing.passes);
+    TEST_ASSERT_EQUAL_UINT32(0, timing.jitter.total);
+    TEST_ASSERT_EQUAL_UINT32(0, timing.minPeriodUs);
+    TEST_ASSERT_EQUAL_UINT32(300, timing.maxExecUs);
+}
+
+void test_period_jitter_both_directions(void) {
+    runPass(0, 100);
+    runPass(50000, 100);  // On time
+    runPass(100400, 100); // 400 us late
+    runPass(149900, 100); // 500 us early relative to the previous start
+    TEST_ASSERT_EQUAL_UINT32(3, timing.jitter.total);
+    TEST_ASSERT_EQUAL_UINT32(49500, timing.minPeriodUs);
+    TEST_ASSERT_EQUAL_UINT32(50400, timing.maxPeriodUs);
+    TEST_ASSERT_EQUAL_UINT32(500, timing.jitter.maxUs);
+    TEST_ASSERT_EQUAL_UINT32(1, timing.jitter.counts[0]); // 0 us
+    TEST_ASSERT_EQUAL_UINT32(2, timing.jitter.counts[2]); // 400 and 500 us (<= 500)
+    TEST_ASSERT_EQUAL_UINT32(0, timing.overruns);
+}
+
+void test_overrun_counted_when_work_exceeds_period(void) {
+    runPass(0, 20000);
+    runPass(50000, 50001);
+    runPass(101000, 50000); // Exactly one period is not an overrun
+    TEST_ASSERT_EQUAL_UINT32(1, timing.overruns);
+    TEST_ASSERT_EQUAL_UINT32(50001, timing.maxExecUs);
+}
+
+void test_micros_wraparound(void) {
+    runPass(0xFFFFFFFFu - 10000, 100);
+    runPass(39999, 100); // Wrapped, exactly one period later
+    TEST_ASSERT_EQUAL_UINT32(50000, timing.maxPeriodUs);
+    TEST_ASSERT_EQUAL_UINT32(0, timing.jitter.maxUs);
+}
+
+void test_init_clears_statistics(void) {
+    runPass(0, 60000);
+    runPass(70000, 100);
+    controlLoopTimingInit(&timing, 50000);
+    TEST_ASSERT_EQUAL_UINT32(0, timing.passes);
+    TEST_ASSERT_EQUAL_UINT32(0, timing.overruns);
+    TEST_ASSERT_EQUAL_UINT32(0, timing.jitter.total);
+    TEST_ASSERT_EQUAL_UINT32(50000, timing.periodUs);
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_first_pass_has_no_period);
+    RUN_TEST(test_period_jitter_both_directions);
+    RUN_TEST(test_overrun_counted_when_work_exceeds_period);
+    RUN_TEST(test_micros_wraparound);
+    RUN_TEST(test_init_clears_statistics);
+    return UNITY_END();
+}
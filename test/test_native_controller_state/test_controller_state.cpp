@@ -0,0 +1,167 @@
+/**
+ * @file test_controller_state.cpp
+ * @brief Host-side tests and benchmark for the seqlock-published controller snapshot: version / broadcast
+ * bookkeeping, and a writer thread racing reader threads to check that no copy mixes two publishes.
+ * Run with `pio test -e native`.
+ */
+#include <unity.h>
+#include <stdio.h>
+#include <chrono>
+#include <thread>
+#include "controller_state.h"
+
+static ControllerStateSeqlock lock;
+static const char* MODE_A = "AUTO";
+static const char* MODE_B = "MANUAL";
+
+// Every field derived from k, so a torn copy shows up as fields that disagree
+static void fillState(ControllerState* s, uint32_t k) {
+    controllerStateClear(s);
+    s->temperature = (float)k;
+    s->tempSensorFound = (k & 1) != 0;
+    s->pidSetpointC = (float)k;
+    s->pidKp = s->pidKi = s->pidKd = (float)k;
+    s->rampUpPercentPerS = s->rampDownPercentPerS = s->hysteresisC = (float)k;
+    s->outputWrites = s->suppressedOutputChanges = s->suppressedBroadcasts = k;
+    for (int ch = 0; ch < CONTROLLER_STATE_MAX_CHANNELS; ch++) {
+        ControllerChannelSnapshot& c = s->channels[ch];
+        c.modeName = (k & 1) ? MODE_A : MODE_B;
+        c.calibrationStatus = c.modeName;
+        c.rpm = c.targetRpm = (int32_t)k;
+        c.speedPercent = c.manualSpeedPercent = (int16_t)k;
+        c.calMaxRpm = (uint16_t)k;
+        c.calStartDuty = c.calStallDuty = c.rpmModelPoints = c.curveNumPoints = (uint8_t)k;
+        c.isAutoMode = c.isPidMode = c.isRpmMode = c.hasTach = (k & 1) != 0;
+        for (int i = 0; i < CONTROLLER_STATE_MAX_CURVE_POINTS; i++) c.curveTemp[i] = c.curvePwm[i] = (uint8_t)k;
+    }
+}
+
+static bool isConsistent(const ControllerState& s) {
+    uint32_t k = s.outputWrites;
+    ControllerState expected;
+    fillState(&expected, k);
+    expected.version = s.version;
+    expected.broadcastSeq = s.broadcastSeq;
+    return memcmp(&expected, &s, sizeof(s)) == 0;
+}
+
+void setUp(void) {
+    lock.sequence.store(0);
+    controllerStateClear(&lock.state);
+}
+
+void tearDown(void) {}
+
+void test_version_moves_only_on_change(void) {
+    ControllerState next, out;
+    fillState(&next, 5);
+    TEST_ASSERT_TRUE(controllerStatePublish(&lock, &next, false));
+    TEST_ASSERT_TRUE(controllerStateRead(&lock, &out, 4));
+    TEST_ASSERT_EQUAL_UINT32(1, out.version);
+    TEST_ASSERT_EQUAL_UINT32(0, out.broadcastSeq);
+
+    fillState(&next, 5);
+    TEST_ASSERT_FALSE(controllerStatePublish(&lock, &next, false)); // Same content: nothing written
+    TEST_ASSERT_EQUAL_UINT32(2, lock.sequence.load());
+
+    fillState(&next, 5);
+    TEST_ASSERT_TRUE(controllerStatePublish(&lock, &next, true)); // Broadcast request alone
+    TEST_ASSERT_TRUE(controllerStateRead(&lock, &out, 4));
+    TEST_ASSERT_EQUAL_UINT32(1, out.version);
+    TEST_ASSERT_EQUAL_UINT32(1, out.broadcastSeq);
+
+    fillState(&next, 6);
+    TEST_ASSERT_TRUE(controllerStatePublish(&lock, &next, false));
+    TEST_ASSERT_TRUE(controllerStateRead(&lock, &out, 4));
+    TEST_ASSERT_EQUAL_UINT32(2, out.version);
+    TEST_ASSERT_EQUAL_UINT32(1, out.broadcastSeq);
+    TEST_ASSERT_TRUE(isConsistent(out));
+}
+
+void test_curve_fingerprint_tracks_used_points_only(void) {
+    ControllerState s;
+    fillState(&s, 3); // 3 points per channel
+    uint32_t base = controllerStateCurveFingerprint(&s, 2);
+    s.channels[2].curvePwm[0] = 99; // Channel beyond numChannels
+    s.channels[0].curveTemp[5] = 99; // Point beyond curveNumPoints
+    TEST_ASSERT_EQUAL_UINT32(base, controllerStateCurveFingerprint(&s, 2));
+    s.channels[1].curvePwm[2] = 99;
+    TEST_ASSERT_TRUE(controllerStateCurveFingerprint(&s, 2) != base);
+    s.channels[1].curvePwm[2] = 3;
+    s.channels[0].curveNumPoints = 2;
+    TEST_ASSERT_TRUE(controllerStateCurveFingerprint(&s, 2) != base);
+}
+
+void test_read_gives_up_while_writer_busy(void) {
+    lock.sequence.store(7); // Writer stuck mid-copy
+    ControllerState out;
+    TEST_ASSERT_FALSE(controllerStateRead(&lock, &out, 10));
+}
+
+void test_concurrent_readers_never_see_torn_state(void) {
+    const uint32_t publishes = 200000;
+    std::atomic<bool> done(false);
+    std::atomic<long> reads(0), torn(0), failed(0);
+    auto reader = [&]() {
+        ControllerState out;
+        uint32_t lastVersion = 0;
+        while (!done.load()) {
+            if (!controllerStateRead(&lock, &out, 1000)) { failed++; continue; }
+            if (out.version == 0) continue; // Nothing published yet
+            reads++;
+            if (!isConsistent(out) || out.version < lastVersion) torn++;
+            lastVersion = out.version;
+        }
+    };
+    std::thread r1(reader), r2(reader);
+    ControllerState next;
+    for (uint32_t k = 1; k <= publishes; k++) {
+        fillState(&next, k);
+        controllerStatePublish(&lock, &next, (k % 16) == 0);
+    }
+    done.store(true);
+    r1.join();
+    r2.join();
+    char msg[128];
+    snprintf(msg, sizeof(msg), "%u publishes, %ld reads, %ld torn, %ld gave up", publishes, reads.load(), torn.load(), failed.load());
+    TEST_MESSAGE(msg);
+    TEST_ASSERT_EQUAL_INT(0, torn.load());
+    TEST_ASSERT_EQUAL_UINT32(publishes, lock.state.version);
+    TEST_ASSERT_EQUAL_UINT32(publishes / 16, lock.state.broadcastSeq);
+}
+
+void test_benchmark_snapshot_copy(void) {
+    ControllerState next, out;
+    fillState(&next, 3);
+    controllerStatePublish(&lock, &next, false);
+    const int rounds = 1000000;
+    volatile uint32_t sink = 0;
+    auto t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < rounds; i++) {
+        controllerStateRead(&lock, &out, 4);
+        sink += out.version;
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    for (int i = 0; i < rounds; i++) {
+        fillState(&next, 3);
+        sink += controllerStatePublish(&lock, &next, false); // Unchanged: compare only
+    }
+    auto t2 = std::chrono::steady_clock::now();
+    char msg[160];
+    snprintf(msg, sizeof(msg), "snapshot %u bytes: read %.1f ns, unchanged publish (fill + compare) %.1f ns",
+             (unsigned)sizeof(ControllerState),
+             std::chrono::duration<double, std::nano>(t1 - t0).count() / rounds,
+             std::chrono::duration<double, std::nano>(t2 - t1).count() / rounds);
+    TEST_MESSAGE(msg);
+    TEST_ASSERT_TRUE(sink != 0);
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_version_moves_only_on_change);
+    RUN_TEST(test_curve_fingerprint_tracks_used_points_only);
+    RUN_TEST(test_read_gives_up_while_writer_busy);
+    RUN_TEST(test_concurrent_readers_never_see_torn_state);
+    RUN_TEST(test_benchmark_snapshot_copy);
+    return UNITY_END();
+}
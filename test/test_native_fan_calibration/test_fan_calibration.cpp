@@ -0,0 +1,142 @@
+/**
+ * @file test_fan_calibration.cpp
+ * @brief Host-side tests for the fan characterization sweep and the start limits (stall floor + kick),
+ * run against a simulated fan with start/stall hysteresis. Run with `pio test -e native`.
+ */
+#include <unity.h>
+#include <stdio.h>
+#include "fan_calibration.h"
+
+// Simulated fan: needs 30 % to start from rest, keeps turning down to 18 %, 0.8 s lag
+struct SimFan {
+    bool spinning;
+    float rpm;
+    int startDuty;
+    int stallDuty;
+};
+
+static int simSteadyRpm(const SimFan& fan, int duty) {
+    return 300 + 30 * (duty - fan.stallDuty);
+}
+
+static void simStep(SimFan& fan, int duty, float dt) {
+    if (!fan.spinning && duty >= fan.startDuty) fan.spinning = true;
+    if (fan.spinning && duty < fan.stallDuty) fan.spinning = false;
+    float target = fan.spinning ? (float)simSteadyRpm(fan, duty) : 0.0f;
+    fan.rpm += (target - fan.rpm) * (dt / 0.8f);
+    if (!fan.spinning && fan.rpm < 30.0f) fan.rpm = 0.0f;
+}
+
+static FanCalibration cal;
+
+static unsigned long runCalibration(SimFan& fan, int* steps) {
+    unsigned long now = 1000;
+    fanCalibrationStart(&cal, now);
+    int duty = 0;
+    *steps = 0;
+    while (fanCalibrationRunning(&cal) && now < 1000000) {
+        simStep(fan, duty, 0.05f);
+        now += 50;
+        int settledDuty, settledRpm;
+        duty = fanCalibrationUpdate(&cal, (int)fan.rpm, now, &settledDuty, &settledRpm);
+        if (settledDuty >= 0) (*steps)++;
+    }
+    return now - 1000;
+}
+
+void setUp(void) {
+    cal.phase = FAN_CAL_IDLE;
+}
+
+void tearDown(void) {}
+
+void test_sweep_finds_start_stall_and_max(void) {
+    SimFan fan = {true, 1500.0f, 30, 18}; // Running when the sweep starts
+    int steps;
+    unsigned long ms = runCalibration(fan, &steps);
+    char msg[128];
+    snprintf(msg, sizeof(msg), "sweep: %lu ms, %d steps, start %d%%, stall %d%%, max %d RPM, settle %d ms",
+             ms, steps, cal.result.startDuty, cal.result.stallDuty, cal.result.maxRpm, cal.result.settleMs);
+    TEST_MESSAGE(msg);
+    TEST_ASSERT_EQUAL_INT(FAN_CAL_DONE, cal.phase);
+    TEST_ASSERT_TRUE(cal.result.valid);
+    TEST_ASSERT_EQUAL_INT(30, cal.result.startDuty);
+    TEST_ASSERT_EQUAL_INT(18, cal.result.stallDuty);
+    TEST_ASSERT_INT_WITHIN(60, simSteadyRpm(fan, 100), cal.result.maxRpm);
+    TEST_ASSERT_TRUE(cal.result.settleMs >= FAN_CAL_STABLE_MS / 2 && cal.result.settleMs < FAN_CAL_STEP_TIMEOUT_MS);
+}
+
+void test_sweep_fails_for_dead_fan(void) {
+    SimFan fan = {false, 0.0f, 200, 150}; // Never starts
+    int steps;
+    runCalibration(fan, &steps);
+    TEST_ASSERT_EQUAL_INT(FAN_CAL_FAILED, cal.phase);
+    TEST_ASSERT_FALSE(cal.result.valid);
+}
+
+void test_sweep_can_be_cancelled(void) {
+    fanCalibrationStart(&cal, 0);
+    TEST_ASSERT_TRUE(fanCalibrationRunning(&cal));
+    fanCalibrationCancel(&cal);
+    TEST_ASSERT_FALSE(fanCalibrationRunning(&cal));
+    int d, r;
+    TEST_ASSERT_EQUAL_INT(0, fanCalibrationUpdate(&cal, 1000, 100, &d, &r));
+}
+
+static const FanCalibrationResult CAL = {1, 30, 18, 2760, 1200};
+
+void test_start_limits_without_calibration_pass_through(void) {
+    FanCalibrationResult none = {0, 0, 0, 0, 0};
+    FanStartState start = {false, 0};
+    TEST_ASSERT_EQUAL_INT(5, fanApplyStartLimits(none, &start, 5, 0, 0, 500, 5000, 100));
+}
+
+void test_start_limits_raise_sub_stall_duty(void) {
+    FanStartState start = {false, 0};
+    TEST_ASSERT_EQUAL_INT(0, fanApplyStartLimits(CAL, &start, 0, 900, 0, 500, 5000, 100));
+    TEST_ASSERT_EQUAL_INT(18, fanApplyStartLimits(CAL, &start, 5, 900, 0, 500, 5000, 100));
+    TEST_ASSERT_EQUAL_INT(40, fanApplyStartLimits(CAL, &start, 40, 900, 0, 500, 5000, 100));
+}
+
+void test_kick_from_standstill(void) {
+    FanStartState start = {false, 0};
+    TEST_ASSERT_EQUAL_INT(100, fanApplyStartLimits(CAL, &start, 20, 0, 1000, 500, 5000, 100));
+    TEST_ASSERT_EQUAL_INT(100, fanApplyStartLimits(CAL, &start, 20, 0, 1400, 500, 5000, 100));
+    TEST_ASSERT_EQUAL_INT(20, fanApplyStartLimits(CAL, &start, 20, 800, 1550, 500, 5000, 100));
+    // A target that starts the fan on its own needs no kick
+    FanStartState start2 = {false, 0};
+    TEST_ASSERT_EQUAL_INT(35, fanApplyStartLimits(CAL, &start2, 35, 0, 1000, 500, 5000, 100));
+}
+
+void test_kick_retry_is_rate_limited(void) {
+    FanStartState start = {false, 0};
+    fanApplyStartLimits(CAL, &start, 20, 0, 1000, 500, 5000, 100);
+    TEST_ASSERT_EQUAL_INT(20, fanApplyStartLimits(CAL, &start, 20, 0, 1600, 500, 5000, 100)); // Still stopped, no new kick yet
+    TEST_ASSERT_EQUAL_INT(100, fanApplyStartLimits(CAL, &start, 20, 0, 6600, 500, 5000, 100));
+}
+
+void test_kicked_fan_holds_at_stall_floor(void) {
+    SimFan fan = {false, 0.0f, 30, 18};
+    FanStartState start = {false, 0};
+    unsigned long now = 0;
+    for (int i = 0; i < 200; i++) { // 10 s at a 10 % target
+        int duty = fanApplyStartLimits(CAL, &start, 10, (int)fan.rpm, now, 500, 5000, 100);
+        simStep(fan, duty, 0.05f);
+        now += 50;
+    }
+    TEST_ASSERT_TRUE(fan.spinning);
+    TEST_ASSERT_INT_WITHIN(30, simSteadyRpm(fan, 18), (int)fan.rpm);
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_sweep_finds_start_stall_and_max);
+    RUN_TEST(test_sweep_fails_for_dead_fan);
+    RUN_TEST(test_sweep_can_be_cancelled);
+    RUN_TEST(test_start_limits_without_calibration_pass_through);
+    RUN_TEST(test_start_limits_raise_sub_stall_duty);
+    RUN_TEST(test_kick_from_standstill);
+    RUN_TEST(test_kick_retry_is_rate_limited);
+    RUN_TEST(test_kicked_fan_holds_at_stall_floor);
+    return UNITY_END();
+}
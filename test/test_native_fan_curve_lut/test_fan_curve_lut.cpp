@@ -0,0 +1,160 @@
+/**
+ * @file test_fan_curve_lut.cpp
+ * @brief Host-side tests and benchmark for the fixed-point fan curve table.
+ * Run with `pio test -e native`. Only src/fan_curve_lut.cpp is linked (see env:native),
+ * so no Arduino framework is needed.
+ */
+#include <unity.h>
+#include <stdio.h>
+#include <chrono>
+#include "fan_curve_lut.h"
+
+static const int MAX_POINTS = 8;
+static int temps[MAX_POINTS];
+static int pwms[MAX_POINTS];
+static int numPoints = 0;
+static uint8_t lut[FAN_CURVE_LUT_SIZE];
+
+// Verbatim copy of the float interpolation calculateAutoFanPWMPercentage() used before the table
+// (sensor-present path only). Kept here as the reference the table must reproduce.
+static int legacyCurvePercentage(float temp) {
+    if (numPoints == 0) return 0;
+    if (temp <= temps[0]) return pwms[0];
+    if (temp >= temps[numPoints - 1]) return pwms[numPoints - 1];
+
+    for (int i = 0; i < numPoints - 1; i++) {
+        if (temp >= temps[i] && temp < temps[i+1]) {
+            float tempRange = temps[i+1] - temps[i];
+            float pwmRange = pwms[i+1] - pwms[i];
+            if (tempRange <= 0) return pwms[i];
+            float tempOffset = temp - temps[i];
+            int calculatedPwm = pwms[i] + (tempOffset / tempRange) * pwmRange;
+            return calculatedPwm;
+        }
+    }
+    return pwms[numPoints - 1];
+}
+
+static void setDefaultCurve() {
+    numPoints = 5;
+    temps[0] = 25; pwms[0] = 0;
+    temps[1] = 35; pwms[1] = 20;
+    temps[2] = 45; pwms[2] = 50;
+    temps[3] = 55; pwms[3] = 80;
+    temps[4] = 60; pwms[4] = 100;
+}
+
+// Deterministic pseudo-random curves (valid per the WebSocket/MQTT validation rules)
+static uint32_t lcgState = 12345;
+static int nextRand(int bound) {
+    lcgState = lcgState * 1103515245u + 12345u;
+    return (int)((lcgState >> 16) % (uint32_t)bound);
+}
+
+static void setRandomCurve() {
+    numPoints = 2 + nextRand(MAX_POINTS - 1);
+    int t = nextRand(40);
+    for (int i = 0; i < numPoints; i++) {
+        temps[i] = t;
+        pwms[i] = nextRand(101);
+        t += 1 + nextRand(15);
+        if (t > 120) t = 120;
+        if (i + 1 < numPoints && t <= temps[i]) { numPoints = i + 1; break; }
+    }
+}
+
+static int countMismatches() {
+    int mismatches = 0;
+    for (int d = 0; d < FAN_CURVE_LUT_SIZE; d++) {
+        int expected = legacyCurvePercentage(d / 10.0f);
+        int actual = lookupFanCurveLut(lut, d);
+        if (expected != actual) {
+            if (mismatches < 5) printf("  mismatch at %d.%d C: legacy=%d lut=%d\n", d / 10, d % 10, expected, actual);
+            mismatches++;
+        }
+    }
+    return mismatches;
+}
+
+void setUp(void) {
+    numPoints = 0;
+}
+
+void tearDown(void) {}
+
+void test_lut_matches_legacy_default_curve(void) {
+    setDefaultCurve();
+    buildFanCurveLut(lut, temps, pwms, numPoints);
+    TEST_ASSERT_EQUAL_INT(0, countMismatches());
+}
+
+void test_lut_matches_legacy_random_curves(void) {
+    for (int n = 0; n < 500; n++) {
+        setRandomCurve();
+        buildFanCurveLut(lut, temps, pwms, numPoints);
+        TEST_ASSERT_EQUAL_INT(0, countMismatches());
+    }
+}
+
+void test_lut_empty_curve_is_zero(void) {
+    numPoints = 0;
+    buildFanCurveLut(lut, temps, pwms, numPoints);
+    TEST_ASSERT_EQUAL_INT(0, lookupFanCurveLut(lut, 0));
+    TEST_ASSERT_EQUAL_INT(0, lookupFanCurveLut(lut, 450));
+    TEST_ASSERT_EQUAL_INT(0, lookupFanCurveLut(lut, FAN_CURVE_LUT_MAX_DECI_C));
+}
+
+void test_lut_clamps_out_of_range_temperatures(void) {
+    setDefaultCurve();
+    buildFanCurveLut(lut, temps, pwms, numPoints);
+    TEST_ASSERT_EQUAL_INT(legacyCurvePercentage(-40.0f), lookupFanCurveLut(lut, -400));
+    TEST_ASSERT_EQUAL_INT(legacyCurvePercentage(150.0f), lookupFanCurveLut(lut, 1500));
+}
+
+void test_temperature_to_deci_rounds_to_nearest(void) {
+    TEST_ASSERT_EQUAL_INT(373, temperatureToDeciC(37.3f));
+    TEST_ASSERT_EQUAL_INT(373, temperatureToDeciC(37.26f));
+    TEST_ASSERT_EQUAL_INT(372, temperatureToDeciC(37.24f));
+    TEST_ASSERT_EQUAL_INT(-15, temperatureToDeciC(-1.5f));
+}
+
+void test_benchmark_legacy_vs_lut(void) {
+    setDefaultCurve();
+    buildFanCurveLut(lut, temps, pwms, numPoints);
+    const int rounds = 2000;
+    volatile int sink = 0;
+
+    auto t0 = std::chrono::steady_clock::now();
+    for (int r = 0; r < rounds; r++) {
+        for (int d = 0; d < FAN_CURVE_LUT_SIZE; d++) sink += legacyCurvePercentage(d / 10.0f);
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    for (int r = 0; r < rounds; r++) {
+        for (int d = 0; d < FAN_CURVE_LUT_SIZE; d++) sink += lookupFanCurveLut(lut, d);
+    }
+    auto t2 = std::chrono::steady_clock::now();
+    for (int r = 0; r < rounds; r++) buildFanCurveLut(lut, temps, pwms, numPoints);
+    auto t3 = std::chrono::steady_clock::now();
+
+    const double evals = (double)rounds * FAN_CURVE_LUT_SIZE;
+    double legacyNs = std::chrono::duration<double, std::nano>(t1 - t0).count() / evals;
+    double lutNs = std::chrono::duration<double, std::nano>(t2 - t1).count() / evals;
+    double buildUs = std::chrono::duration<double, std::micro>(t3 - t2).count() / rounds;
+
+    char msg[160];
+    snprintf(msg, sizeof(msg), "legacy: %.2f ns/eval, lut: %.2f ns/eval (%.1fx), rebuild: %.2f us",
+             legacyNs, lutNs, lutNs > 0 ? legacyNs / lutNs : 0.0, buildUs);
+    TEST_MESSAGE(msg);
+    TEST_ASSERT_TRUE(sink != 0);
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_lut_matches_legacy_default_curve);
+    RUN_TEST(test_lut_matches_legacy_random_curves);
+    RUN_TEST(test_lut_empty_curve_is_zero);
+    RUN_TEST(test_lut_clamps_out_of_range_temperatures);
+    RUN_TEST(test_temperature_to_deci_rounds_to_nearest);
+    RUN_TEST(test_benchmark_legacy_vs_lut);
+    return UNITY_END();
+}
@@ -0,0 +1,122 @@
+/**
+ * @file test_fan_output_conditioner.cpp
+ * @brief Host-side tests for the hysteresis / slew-rate stage between the auto target and setFanSpeed().
+ * Run with `pio test -e native`. Only the pure modules are linked (see env:native).
+ */
+#include <unity.h>
+#include <stdio.h>
+#include "fan_output_conditioner.h"
+#include "fan_curve_lut.h"
+
+static FanOutputConditionerState state;
+static const FanOutputConditionerConfig noConditioning = {0.0f, 0.0f, 0};
+
+void setUp(void) {
+    resetFanOutputConditioner(&state, 0, 250);
+}
+
+void tearDown(void) {}
+
+void test_disabled_config_passes_target_through(void) {
+    TEST_ASSERT_EQUAL_INT(60, conditionFanOutput(&state, noConditioning, 60, 450, true, 0.05f));
+    TEST_ASSERT_EQUAL_INT(10, conditionFanOutput(&state, noConditioning, 10, 300, true, 0.05f));
+}
+
+void test_hysteresis_holds_lower_target_until_temperature_drops(void) {
+    FanOutputConditionerConfig cfg = {0.0f, 0.0f, 10}; // 1.0 C
+    TEST_ASSERT_EQUAL_INT(50, conditionFanOutput(&state, cfg, 50, 450, true, 0.05f));
+    TEST_ASSERT_EQUAL_INT(50, conditionFanOutput(&state, cfg, 49, 447, true, 0.05f)); // 0.3 C below peak
+    TEST_ASSERT_EQUAL_INT(50, conditionFanOutput(&state, cfg, 48, 441, true, 0.05f)); // 0.9 C below peak
+    TEST_ASSERT_EQUAL_INT(47, conditionFanOutput(&state, cfg, 47, 440, true, 0.05f)); // 1.0 C below peak
+}
+
+void test_hysteresis_tracks_peak_at_same_level(void) {
+    FanOutputConditionerConfig cfg = {0.0f, 0.0f, 10};
+    conditionFanOutput(&state, cfg, 50, 450, true, 0.05f);
+    conditionFanOutput(&state, cfg, 50, 455, true, 0.05f); // Same target, warmer
+    TEST_ASSERT_EQUAL_INT(50, conditionFanOutput(&state, cfg, 48, 446, true, 0.05f)); // 0.9 C below the new peak
+    TEST_ASSERT_EQUAL_INT(48, conditionFanOutput(&state, cfg, 48, 445, true, 0.05f));
+}
+
+void test_rising_target_is_accepted_immediately(void) {
+    FanOutputConditionerConfig cfg = {0.0f, 0.0f, 20};
+    conditionFanOutput(&state, cfg, 40, 400, true, 0.05f);
+    TEST_ASSERT_EQUAL_INT(41, conditionFanOutput(&state, cfg, 41, 401, true, 0.05f));
+}
+
+void test_hysteresis_skipped_when_not_requested(void) {
+    FanOutputConditionerConfig cfg = {0.0f, 0.0f, 20};
+    conditionFanOutput(&state, cfg, 40, 400, false, 0.05f);
+    TEST_ASSERT_EQUAL_INT(39, conditionFanOutput(&state, cfg, 39, 399, false, 0.05f));
+}
+
+void test_ramp_limits_step_per_second(void) {
+    FanOutputConditionerConfig cfg = {20.0f, 5.0f, 0};
+    TEST_ASSERT_EQUAL_INT(1, conditionFanOutput(&state, cfg, 100, 450, false, 0.05f)); // 20 %/s * 50 ms
+    for (int i = 0; i < 19; i++) conditionFanOutput(&state, cfg, 100, 450, false, 0.05f);
+    TEST_ASSERT_EQUAL_INT(20, (int)(state.output + 0.5f)); // One second in
+    TEST_ASSERT_EQUAL_INT(40, conditionFanOutput(&state, cfg, 100, 450, false, 1.0f));
+    TEST_ASSERT_EQUAL_INT(35, conditionFanOutput(&state, cfg, 0, 300, false, 1.0f)); // Down at 5 %/s
+}
+
+void test_ramp_stops_exactly_on_target(void) {
+    FanOutputConditionerConfig cfg = {20.0f, 20.0f, 0};
+    TEST_ASSERT_EQUAL_INT(10, conditionFanOutput(&state, cfg, 10, 450, false, 1.0f));
+    TEST_ASSERT_EQUAL_INT(10, conditionFanOutput(&state, cfg, 10, 450, false, 1.0f));
+}
+
+void test_zero_dt_holds_output(void) {
+    FanOutputConditionerConfig cfg = {20.0f, 20.0f, 0};
+    TEST_ASSERT_EQUAL_INT(0, conditionFanOutput(&state, cfg, 80, 450, false, 0.0f));
+}
+
+void test_reset_drops_pending_ramp(void) {
+    FanOutputConditionerConfig cfg = {1.0f, 1.0f, 10};
+    conditionFanOutput(&state, cfg, 100, 450, true, 1.0f);
+    resetFanOutputConditioner(&state, 70, 500);
+    TEST_ASSERT_EQUAL_INT(70, conditionFanOutput(&state, cfg, 70, 500, true, 1.0f));
+}
+
+// Sensor noise around a curve knee: count how often the raw and the conditioned output change.
+void test_noisy_knee_write_reduction(void) {
+    int temps[] = {25, 35, 45, 55, 60};
+    int pwms[] = {0, 20, 50, 80, 100};
+    uint8_t lut[FAN_CURVE_LUT_SIZE];
+    buildFanCurveLut(lut, temps, pwms, 5);
+
+    FanOutputConditionerConfig cfg = {20.0f, 5.0f, 10};
+    resetFanOutputConditioner(&state, lookupFanCurveLut(lut, 450), 450);
+    uint32_t lcg = 4321;
+    int rawWrites = 0, conditionedWrites = 0;
+    int lastRaw = lookupFanCurveLut(lut, 450), lastOut = lastRaw;
+    int tempDeciC = 450;
+    for (int tick = 0; tick < 2000; tick++) { // 100 s of 50 ms ticks, new reading every 2 s
+        if (tick % 40 == 0) {
+            lcg = lcg * 1103515245u + 12345u;
+            tempDeciC = 450 + (int)((lcg >> 16) % 9) - 4; // +-0.4 C noise
+        }
+        int raw = lookupFanCurveLut(lut, tempDeciC);
+        int out = conditionFanOutput(&state, cfg, raw, tempDeciC, true, 0.05f);
+        if (raw != lastRaw) { rawWrites++; lastRaw = raw; }
+        if (out != lastOut) { conditionedWrites++; lastOut = out; }
+    }
+    char msg[96];
+    snprintf(msg, sizeof(msg), "noisy knee: raw writes %d, conditioned writes %d", rawWrites, conditionedWrites);
+    TEST_MESSAGE(msg);
+    TEST_ASSERT_TRUE(conditionedWrites < rawWrites);
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_disabled_config_passes_target_through);
+    RUN_TEST(test_hysteresis_holds_lower_target_until_temperature_drops);
+    RUN_TEST(test_hysteresis_tracks_peak_at_same_level);
+    RUN_TEST(test_rising_target_is_accepted_immediately);
+    RUN_TEST(test_hysteresis_skipped_when_not_requested);
+    RUN_TEST(test_ramp_limits_step_per_second);
+    RUN_TEST(test_ramp_stops_exactly_on_target);
+    RUN_TEST(test_zero_dt_holds_output);
+    RUN_TEST(test_reset_drops_pending_ramp);
+    RUN_TEST(test_noisy_knee_write_reduction);
+    return UNITY_END();
+}
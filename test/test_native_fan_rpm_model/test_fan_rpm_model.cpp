@@ -0,0 +1,162 @@
+/**
+ * @file test_fan_rpm_model.cpp
+ * @brief Host-side tests for the learned PWM -> RPM model and the RPM target controller, including a
+ * closed-loop run against a simulated fan. Run with `pio test -e native`.
+ */
+#include <unity.h>
+#include <stdio.h>
+#include <stdint.h>
+#include "fan_rpm_model.h"
+
+static FanRpmModel model;
+static FanRpmControlState ctrl;
+static const FanRpmControlGains GAINS = {0.01f, 0.02f};
+
+// Simulated fan: stalls below 20 %, then 300 RPM + 30 RPM per % duty, first-order lag of 0.8 s
+static int plantSteadyRpm(float duty) {
+    if (duty < 20.0f) return 0;
+    return (int)(300.0f + (duty - 20.0f) * 30.0f);
+}
+
+static void learnWholePlant(float scale) {
+    for (int d = 1; d <= 100; d++) fanRpmModelLearn(&model, d, (int)(plantSteadyRpm(d) * scale));
+}
+
+// Runs RPM target mode from rest; returns ms until the fan stays within 3 % of the target, -1 if never
+static int simulateSettleMs(bool useModel, int targetRpm) {
+    float rpm = 0.0f, duty = 0.0f;
+    uint32_t lcg = 99;
+    fanRpmControlReset(&ctrl, 0.0f, useModel ? fanRpmModelDutyFor(&model, targetRpm) : -1.0f);
+    int settledSince = -1;
+    for (int ms = 0; ms < 60000; ms += 50) {
+        lcg = lcg * 1103515245u + 12345u;
+        int measured = (int)rpm + (int)((lcg >> 16) % 21) - 10;
+        float ff = useModel ? fanRpmModelDutyFor(&model, targetRpm) : -1.0f;
+        duty = fanRpmControlUpdate(&ctrl, GAINS, ff, targetRpm, measured, 0.05f, 0.0f, 100.0f);
+        rpm += (plantSteadyRpm(duty) - rpm) * (0.05f / 0.8f);
+        bool inBand = rpm > targetRpm * 0.97f && rpm < targetRpm * 1.03f;
+        if (!inBand) settledSince = -1;
+        else if (settledSince < 0) settledSince = ms;
+    }
+    return settledSince;
+}
+
+void setUp(void) {
+    fanRpmModelReset(&model);
+}
+
+void tearDown(void) {}
+
+void test_model_needs_two_points(void) {
+    TEST_ASSERT_TRUE(fanRpmModelDutyFor(&model, 1000) < 0.0f);
+    fanRpmModelLearn(&model, 50, 1200);
+    TEST_ASSERT_TRUE(fanRpmModelDutyFor(&model, 1000) < 0.0f);
+    fanRpmModelLearn(&model, 70, 1800);
+    TEST_ASSERT_TRUE(fanRpmModelDutyFor(&model, 1000) >= 0.0f);
+}
+
+void test_model_interpolates_between_points(void) {
+    fanRpmModelLearn(&model, 40, 1000);
+    fanRpmModelLearn(&model, 60, 2000);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 50.0f, fanRpmModelDutyFor(&model, 1500));
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 40.0f, fanRpmModelDutyFor(&model, 500)); // Below the slowest point
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 70.0f, fanRpmModelDutyFor(&model, 2500)); // Extrapolated
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 100.0f, fanRpmModelDutyFor(&model, 9000));
+}
+
+void test_model_envelope_ignores_dip(void) {
+    fanRpmModelLearn(&model, 40, 1000);
+    fanRpmModelLearn(&model, 50, 900); // Noisy reading below its neighbour
+    fanRpmModelLearn(&model, 60, 2000);
+    float duty = fanRpmModelDutyFor(&model, 1500);
+    TEST_ASSERT_TRUE(duty > 50.0f && duty < 60.0f);
+}
+
+void test_learn_blends_and_reports_changes(void) {
+    TEST_ASSERT_TRUE(fanRpmModelLearn(&model, 50, 1200));
+    TEST_ASSERT_FALSE(fanRpmModelLearn(&model, 50, 1201)); // Below 1 %: not worth a save
+    TEST_ASSERT_TRUE(fanRpmModelLearn(&model, 50, 1600));
+    TEST_ASSERT_EQUAL_INT(1300, model.rpm[50]);
+    TEST_ASSERT_FALSE(fanRpmModelLearn(&model, 0, 500)); // Duty 0 is never learned
+    TEST_ASSERT_FALSE(fanRpmModelLearn(&model, 30, 0));
+    TEST_ASSERT_EQUAL_INT(1, fanRpmModelLearnedPoints(&model));
+}
+
+void test_control_reset_without_model_is_bumpless(void) {
+    fanRpmControlReset(&ctrl, 45.0f, -1.0f);
+    float out = fanRpmControlUpdate(&ctrl, GAINS, -1.0f, 1500, 1500, 0.05f, 0.0f, 100.0f);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 45.0f, out);
+}
+
+void test_control_reset_with_model_jumps_to_feedforward(void) {
+    fanRpmControlReset(&ctrl, 10.0f, 40.0f);
+    float out = fanRpmControlUpdate(&ctrl, GAINS, 40.0f, 1500, 1500, 0.05f, 0.0f, 100.0f);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 40.0f, out);
+}
+
+void test_control_rebase_keeps_output(void) {
+    fanRpmControlReset(&ctrl, 45.0f, -1.0f);
+    fanRpmControlRebase(&ctrl, -1.0f, 43.0f); // Model became usable mid-run
+    float out = fanRpmControlUpdate(&ctrl, GAINS, 43.0f, 1500, 1500, 0.05f, 0.0f, 100.0f);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 45.0f, out);
+}
+
+void test_control_anti_windup(void) {
+    fanRpmControlReset(&ctrl, 0.0f, -1.0f);
+    for (int i = 0; i < 2000; i++) fanRpmControlUpdate(&ctrl, GAINS, -1.0f, 3000, 0, 0.05f, 0.0f, 100.0f); // Stalled fan
+    TEST_ASSERT_TRUE(ctrl.integral <= 100.0f);
+    float out = fanRpmControlUpdate(&ctrl, GAINS, -1.0f, 1000, 1200, 0.05f, 0.0f, 100.0f);
+    TEST_ASSERT_TRUE(out < 100.0f);
+}
+
+void test_closed_loop_settles_and_feedforward_is_faster(void) {
+    learnWholePlant(1.0f);
+    const int targets[] = {800, 1500, 2400};
+    for (int t : targets) {
+        int withModel = simulateSettleMs(true, t);
+        int feedbackOnly = simulateSettleMs(false, t);
+        char msg[96];
+        snprintf(msg, sizeof(msg), "target %d RPM: settles in %d ms with model, %d ms feedback only", t, withModel, feedbackOnly);
+        TEST_MESSAGE(msg);
+        TEST_ASSERT_TRUE(withModel >= 0);
+        TEST_ASSERT_TRUE(feedbackOnly < 0 || withModel < feedbackOnly);
+    }
+}
+
+void test_closed_loop_corrects_stale_model(void) {
+    learnWholePlant(0.85f); // Model learned before the fan got 15 % faster (e.g. cleaned)
+    TEST_ASSERT_TRUE(simulateSettleMs(true, 1500) >= 0);
+}
+
+void test_parse_rpm_target_rejects_non_numeric(void) {
+    int rpm = -1;
+    TEST_ASSERT_TRUE(parseFanRpmTarget("1200", 20000, &rpm));
+    TEST_ASSERT_EQUAL_INT(1200, rpm);
+    TEST_ASSERT_TRUE(parseFanRpmTarget("0", 20000, &rpm)); // An explicit 0 is a real target
+    TEST_ASSERT_EQUAL_INT(0, rpm);
+    rpm = 777;
+    TEST_ASSERT_FALSE(parseFanRpmTarget("", 20000, &rpm));
+    TEST_ASSERT_FALSE(parseFanRpmTarget("fast", 20000, &rpm));
+    TEST_ASSERT_FALSE(parseFanRpmTarget("12a", 20000, &rpm));
+    TEST_ASSERT_FALSE(parseFanRpmTarget("-5", 20000, &rpm));
+    TEST_ASSERT_FALSE(parseFanRpmTarget("20001", 20000, &rpm));
+    TEST_ASSERT_FALSE(parseFanRpmTarget("99999999999", 20000, &rpm)); // No overflow into range
+    TEST_ASSERT_FALSE(parseFanRpmTarget(nullptr, 20000, &rpm));
+    TEST_ASSERT_EQUAL_INT(777, rpm); // Untouched on failure
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_model_needs_two_points);
+    RUN_TEST(test_model_interpolates_between_points);
+    RUN_TEST(test_model_envelope_ignores_dip);
+    RUN_TEST(test_learn_blends_and_reports_changes);
+    RUN_TEST(test_control_reset_without_model_is_bumpless);
+    RUN_TEST(test_control_reset_with_model_jumps_to_feedforward);
+    RUN_TEST(test_control_rebase_keeps_output);
+    RUN_TEST(test_control_anti_windup);
+    RUN_TEST(test_closed_loop_settles_and_feedforward_is_faster);
+    RUN_TEST(test_closed_loop_corrects_stale_model);
+    RUN_TEST(test_parse_rpm_target_rejects_non_numeric);
+    return UNITY_END();
+}
@@ -0,0 +1,88 @@
+/**
+ * @file test_http_cache.cpp
+ * @brief Host-side tests for If-None-Match matching, the web asset manifest and the REST long-poll decision.
+ * Run with `pio test -e native`.
+ */
+#include <unity.h>
+#include "http_cache.h"
+
+static char url[24];
+static char etag[20];
+
+void setUp(void) {
+    url[0] = '\0';
+    etag[0] = '\0';
+}
+
+void tearDown(void) {}
+
+void test_etag_matches_single_and_weak_tags(void) {
+    TEST_ASSERT_TRUE(etagMatches("\"c146dd7f4b59fc84\"", "c146dd7f4b59fc84"));
+    TEST_ASSERT_TRUE(etagMatches("W/\"c146dd7f4b59fc84\"", "c146dd7f4b59fc84"));
+    TEST_ASSERT_FALSE(etagMatches("\"c146dd7f4b59fc8\"", "c146dd7f4b59fc84"));  // Prefix only
+    TEST_ASSERT_FALSE(etagMatches("\"c146dd7f4b59fc845\"", "c146dd7f4b59fc84"));
+}
+
+void test_etag_matches_lists_and_wildcard(void) {
+    TEST_ASSERT_TRUE(etagMatches("\"aaaa\", W/\"bbbb\" ,\"c146\"", "c146"));
+    TEST_ASSERT_FALSE(etagMatches("\"aaaa\", \"bbbb\"", "c146"));
+    TEST_ASSERT_TRUE(etagMatches("*", "c146"));
+}
+
+void test_etag_rejects_malformed_headers(void) {
+    TEST_ASSERT_FALSE(etagMatches("", "c146"));
+    TEST_ASSERT_FALSE(etagMatches("c146", "c146"));       // Unquoted
+    TEST_ASSERT_FALSE(etagMatches("\"c146", "c146"));     // Unterminated
+    TEST_ASSERT_FALSE(etagMatches(nullptr, "c146"));
+}
+
+void test_manifest_line_parses(void) {
+    TEST_ASSERT_TRUE(parseAssetManifestLine("/script.js 26e76f90237bc596\r\n", url, sizeof(url), etag, sizeof(etag)));
+    TEST_ASSERT_EQUAL_STRING("/script.js", url);
+    TEST_ASSERT_EQUAL_STRING("26e76f90237bc596", etag);
+}
+
+void test_manifest_rejects_bad_lines(void) {
+    TEST_ASSERT_FALSE(parseAssetManifestLine("", url, sizeof(url), etag, sizeof(etag)));
+    TEST_ASSERT_FALSE(parseAssetManifestLine("script.js 26e7", url, sizeof(url), etag, sizeof(etag)));       // No leading slash
+    TEST_ASSERT_FALSE(parseAssetManifestLine("/script.js", url, sizeof(url), etag, sizeof(etag)));           // No ETag
+    TEST_ASSERT_FALSE(parseAssetManifestLine("/script.js 26e7 extra", url, sizeof(url), etag, sizeof(etag)));
+    TEST_ASSERT_FALSE(parseAssetManifestLine("/a-very-long-asset-name-that-overflows.js 26e7", url, sizeof(url), etag, sizeof(etag)));
+}
+
+void test_poll_answers_at_once_without_wait(void) {
+    TEST_ASSERT_EQUAL_INT(HTTP_POLL_SEND, httpPollDecide(true, false, 0, 0));
+    TEST_ASSERT_EQUAL_INT(HTTP_POLL_NOT_MODIFIED, httpPollDecide(true, true, 0, 0));
+    TEST_ASSERT_EQUAL_INT(HTTP_POLL_UNAVAILABLE, httpPollDecide(false, false, 0, 0));
+}
+
+void test_poll_waits_until_change_or_timeout(void) {
+    TEST_ASSERT_EQUAL_INT(HTTP_POLL_WAIT, httpPollDecide(true, true, 100, 25000));
+    TEST_ASSERT_EQUAL_INT(HTTP_POLL_SEND, httpPollDecide(true, false, 100, 25000));
+    TEST_ASSERT_EQUAL_INT(HTTP_POLL_NOT_MODIFIED, httpPollDecide(true, true, 25000, 25000));
+    TEST_ASSERT_EQUAL_INT(HTTP_POLL_WAIT, httpPollDecide(false, false, 100, 25000));
+    TEST_ASSERT_EQUAL_INT(HTTP_POLL_UNAVAILABLE, httpPollDecide(false, false, 25001, 25000));
+}
+
+void test_wait_seconds_parse_and_clamp(void) {
+    TEST_ASSERT_EQUAL_UINT32(25, parseWaitSeconds("25", 30));
+    TEST_ASSERT_EQUAL_UINT32(30, parseWaitSeconds("600", 30));
+    TEST_ASSERT_EQUAL_UINT32(30, parseWaitSeconds("99999999999999999999", 30));
+    TEST_ASSERT_EQUAL_UINT32(0, parseWaitSeconds("", 30));
+    TEST_ASSERT_EQUAL_UINT32(0, parseWaitSeconds("-5", 30));
+    TEST_ASSERT_EQUAL_UINT32(0, parseWaitSeconds("5s", 30));
+    TEST_ASSERT_EQUAL_UINT32(0, parseWaitSeconds(nullptr, 30));
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_etag_matches_single_and_weak_tags);
+    RUN_TEST(test_etag_matches_lists_and_wildcard);
+    RUN_TEST(test_etag_rejects_malformed_headers);
+    RUN_TEST(test_manifest_line_parses);
+    RUN_TEST(test_manifest_rejects_bad_lines);
+    RUN_TEST(test_poll_answers_at_once_without_wait);
+    RUN_TEST(test_poll_waits_until_change_or_timeout);
+    RUN_TEST(test_wait_seconds_parse_and_clamp);
+    return UNITY_END();
+}
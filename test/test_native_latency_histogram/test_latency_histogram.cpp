@@ -0,0 +1,62 @@
+/**
+ * @file test_latency_histogram.cpp
+ * @brief Host-side tests for the fixed-bucket latency histogram. Run with `pio test -e native`.
+ */
+#include <unity.h>
+#include "latency_histogram.h"
+
+static LatencyHistogram histogram;
+
+void setUp(void) {
+    latencyHistogramReset(&histogram);
+}
+
+void tearDown(void) {}
+
+void test_empty_histogram_reports_zero(void) {
+    TEST_ASSERT_EQUAL_UINT32(0, latencyHistogramPercentile(&histogram, 50));
+    TEST_ASSERT_EQUAL_UINT32(0, latencyHistogramPercentile(&histogram, 99));
+    TEST_ASSERT_EQUAL_UINT32(0, latencyHistogramAverage(&histogram));
+}
+
+void test_values_land_in_inclusive_buckets(void) {
+    latencyHistogramRecord(&histogram, 0);
+    latencyHistogramRecord(&histogram, 100);    // Bucket 0 (<= 100)
+    latencyHistogramRecord(&histogram, 101);    // Bucket 1 (<= 200)
+    latencyHistogramRecord(&histogram, 200000); // Last bounded bucket
+    latencyHistogramRecord(&histogram, 900000); // Overflow
+    TEST_ASSERT_EQUAL_UINT32(2, histogram.counts[0]);
+    TEST_ASSERT_EQUAL_UINT32(1, histogram.counts[1]);
+    TEST_ASSERT_EQUAL_UINT32(1, histogram.counts[LATENCY_HISTOGRAM_BUCKETS - 2]);
+    TEST_ASSERT_EQUAL_UINT32(1, histogram.counts[LATENCY_HISTOGRAM_BUCKETS - 1]);
+    TEST_ASSERT_EQUAL_UINT32(5, histogram.total);
+    TEST_ASSERT_EQUAL_UINT32(900000, histogram.maxUs);
+}
+
+void test_percentiles_use_bucket_bounds(void) {
+    for (int i = 0; i < 90; i++) latencyHistogramRecord(&histogram, 150);  // <= 200
+    for (int i = 0; i < 9; i++) latencyHistogramRecord(&histogram, 4000);  // <= 5000
+    latencyHistogramRecord(&histogram, 30000);                             // <= 50000
+    TEST_ASSERT_EQUAL_UINT32(200, latencyHistogramPercentile(&histogram, 50));
+    TEST_ASSERT_EQUAL_UINT32(200, latencyHistogramPercentile(&histogram, 90));
+    TEST_ASSERT_EQUAL_UINT32(5000, latencyHistogramPercentile(&histogram, 99));
+    TEST_ASSERT_EQUAL_UINT32(30000, latencyHistogramPercentile(&histogram, 100)); // Capped at the max seen
+    TEST_ASSERT_EQUAL_UINT32((90 * 150 + 9 * 4000 + 30000) / 100, latencyHistogramAverage(&histogram));
+}
+
+void test_percentile_capped_at_max_and_overflow(void) {
+    latencyHistogramRecord(&histogram, 120);
+    TEST_ASSERT_EQUAL_UINT32(120, latencyHistogramPercentile(&histogram, 50));
+    latencyHistogramReset(&histogram);
+    latencyHistogramRecord(&histogram, 5000000);
+    TEST_ASSERT_EQUAL_UINT32(5000000, latencyHistogramPercentile(&histogram, 50));
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_empty_histogram_reports_zero);
+    RUN_TEST(test_values_land_in_inclusive_buckets);
+    RUN_TEST(test_percentiles_use_bucket_bounds);
+    RUN_TEST(test_percentile_capped_at_max_and_overflow);
+    return UNITY_END();
+}
@@ -0,0 +1,129 @@
+/**
+ * @file test_nvs_save_scheduler.cpp
+ * @brief Host-side tests for the NVS write coalescing (debounce / max delay). Run with `pio test -e native`.
+ */
+#include <unity.h>
+#include <thread>
+#include "nvs_save_scheduler.h"
+
+static NvsSaveScheduler scheduler;
+
+void setUp(void) {
+    nvsSaveSchedulerInit(&scheduler, 2000, 10000);
+}
+
+void tearDown(void) {}
+
+void test_nothing_pending_after_init(void) {
+    TEST_ASSERT_EQUAL_UINT32(0, nvsSaveSchedulerTakeDue(&scheduler, 123456, false));
+    TEST_ASSERT_EQUAL_UINT32(NVS_SAVE_NOTHING_PENDING, nvsSaveSchedulerNextDueMs(&scheduler, 123456));
+    TEST_ASSERT_EQUAL_INT(0, nvsSaveSchedulerPending(&scheduler));
+}
+
+void test_section_waits_for_debounce(void) {
+    nvsSaveSchedulerRequest(&scheduler, 3, 1000);
+    TEST_ASSERT_EQUAL_INT(1, nvsSaveSchedulerPending(&scheduler));
+    TEST_ASSERT_EQUAL_UINT32(0, nvsSaveSchedulerTakeDue(&scheduler, 2999, false));
+    TEST_ASSERT_EQUAL_UINT32(1, nvsSaveSchedulerNextDueMs(&scheduler, 2999));
+    TEST_ASSERT_EQUAL_UINT32(1UL << 3, nvsSaveSchedulerTakeDue(&scheduler, 3000, false));
+    TEST_ASSERT_EQUAL_INT(0, nvsSaveSchedulerPending(&scheduler));
+    TEST_ASSERT_EQUAL_UINT32(0, nvsSaveSchedulerTakeDue(&scheduler, 5000, false));
+}
+
+void test_burst_coalesces_into_one_write(void) {
+    // A slider dragged for a second: 20 requests, one write
+    for (uint32_t t = 0; t < 1000; t += 50) nvsSaveSchedulerRequest(&scheduler, 0, t);
+    TEST_ASSERT_EQUAL_UINT32(0, nvsSaveSchedulerTakeDue(&scheduler, 2900, false));
+    TEST_ASSERT_EQUAL_UINT32(1, nvsSaveSchedulerTakeDue(&scheduler, 2950, false));
+    nvsSaveSchedulerRecordWrite(&scheduler, 36);
+    TEST_ASSERT_EQUAL_UINT32(20, scheduler.requests.load());
+    TEST_ASSERT_EQUAL_UINT32(1, scheduler.writes.load());
+    TEST_ASSERT_EQUAL_UINT32(36, scheduler.bytesWritten.load());
+    TEST_ASSERT_EQUAL_UINT32(19, nvsSaveSchedulerWritesAvoided(&scheduler));
+}
+
+void test_continuous_changes_written_after_max_delay(void) {
+    uint32_t t = 0;
+    for (; t < 10000; t += 500) {
+        nvsSaveSchedulerRequest(&scheduler, 5, t);
+        TEST_ASSERT_EQUAL_UINT32(0, nvsSaveSchedulerTakeDue(&scheduler, t, false));
+    }
+    TEST_ASSERT_EQUAL_UINT32(0, nvsSaveSchedulerNextDueMs(&scheduler, t));
+    TEST_ASSERT_EQUAL_UINT32(1UL << 5, nvsSaveSchedulerTakeDue(&scheduler, t, false));
+    // The next change starts a new max delay window
+    nvsSaveSchedulerRequest(&scheduler, 5, t + 100);
+    TEST_ASSERT_EQUAL_UINT32(2000, nvsSaveSchedulerNextDueMs(&scheduler, t + 100));
+}
+
+void test_next_due_is_earliest_section(void) {
+    nvsSaveSchedulerRequest(&scheduler, 1, 0);
+    nvsSaveSchedulerRequest(&scheduler, 2, 1500);
+    TEST_ASSERT_EQUAL_UINT32(400, nvsSaveSchedulerNextDueMs(&scheduler, 1600));
+    TEST_ASSERT_EQUAL_UINT32(1UL << 1, nvsSaveSchedulerTakeDue(&scheduler, 2000, false));
+    TEST_ASSERT_EQUAL_UINT32(1500, nvsSaveSchedulerNextDueMs(&scheduler, 2000));
+}
+
+void test_flush_takes_everything_dirty(void) {
+    nvsSaveSchedulerRequest(&scheduler, 0, 100);
+    nvsSaveSchedulerRequest(&scheduler, 31, 100);
+    TEST_ASSERT_EQUAL_UINT32(0, nvsSaveSchedulerTakeDue(&scheduler, 200, false));
+    TEST_ASSERT_EQUAL_UINT32(1UL | (1UL << 31), nvsSaveSchedulerTakeDue(&scheduler, 200, true));
+    TEST_ASSERT_EQUAL_INT(0, nvsSaveSchedulerPending(&scheduler));
+}
+
+void test_out_of_range_section_ignored(void) {
+    nvsSaveSchedulerRequest(&scheduler, -1, 0);
+    nvsSaveSchedulerRequest(&scheduler, NVS_SAVE_MAX_SECTIONS, 0);
+    TEST_ASSERT_EQUAL_INT(0, nvsSaveSchedulerPending(&scheduler));
+    TEST_ASSERT_EQUAL_UINT32(0, scheduler.requests.load());
+}
+
+void test_millis_wraparound(void) {
+    nvsSaveSchedulerRequest(&scheduler, 4, 0xFFFFFF00u);
+    TEST_ASSERT_EQUAL_UINT32(0, nvsSaveSchedulerTakeDue(&scheduler, 0x00000100u, false));
+    TEST_ASSERT_EQUAL_UINT32(1UL << 4, nvsSaveSchedulerTakeDue(&scheduler, 0xFFFFFF00u + 2000, false));
+}
+
+// Requests from several threads racing with the writer: every section that got a request after the
+// writer's last take is still dirty, and nothing is written without a request.
+void test_concurrent_requests_are_never_lost(void) {
+    nvsSaveSchedulerInit(&scheduler, 0, 0); // Everything is due at once
+    const int producers = 4;
+    const int perProducer = 50000;
+    std::atomic<int> running(producers);
+    std::thread threads[producers];
+    for (int p = 0; p < producers; p++) {
+        threads[p] = std::thread([p, &running]() {
+            for (int i = 0; i < perProducer; i++) nvsSaveSchedulerRequest(&scheduler, (p * 8) + (i % 8), (uint32_t)i);
+            running--;
+        });
+    }
+    uint32_t written = 0;
+    while (running.load() > 0) {
+        uint32_t due = nvsSaveSchedulerTakeDue(&scheduler, 0, true);
+        for (; due; due &= due - 1) { nvsSaveSchedulerRecordWrite(&scheduler, 4); written++; }
+    }
+    for (int p = 0; p < producers; p++) threads[p].join();
+    uint32_t due = nvsSaveSchedulerTakeDue(&scheduler, 0, true);
+    for (; due; due &= due - 1) { nvsSaveSchedulerRecordWrite(&scheduler, 4); written++; }
+
+    TEST_ASSERT_EQUAL_UINT32((uint32_t)(producers * perProducer), scheduler.requests.load());
+    TEST_ASSERT_EQUAL_UINT32(written, scheduler.writes.load());
+    TEST_ASSERT_TRUE(written <= (uint32_t)(producers * perProducer));
+    TEST_ASSERT_EQUAL_UINT32(scheduler.requests.load() - written, nvsSaveSchedulerWritesAvoided(&scheduler));
+    TEST_ASSERT_EQUAL_INT(0, nvsSaveSchedulerPending(&scheduler));
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_nothing_pending_after_init);
+    RUN_TEST(test_section_waits_for_debounce);
+    RUN_TEST(test_burst_coalesces_into_one_write);
+    RUN_TEST(test_continuous_changes_written_after_max_delay);
+    RUN_TEST(test_next_due_is_earliest_section);
+    RUN_TEST(test_flush_takes_everything_dirty);
+    RUN_TEST(test_out_of_range_section_ignored);
+    RUN_TEST(test_millis_wraparound);
+    RUN_TEST(test_concurrent_requests_are_never_lost);
+    return UNITY_END();
+}
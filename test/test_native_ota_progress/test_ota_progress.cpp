@@ -0,0 +1,76 @@
+/**
+ * @file test_ota_progress.cpp
+ * @brief Host-side tests for the OTA download progress (throughput, ETA, report pacing). Run with `pio test -e native`.
+ */
+#include <unity.h>
+#include "ota_progress.h"
+
+static OtaProgress progress;
+
+void setUp(void) {
+    otaProgressStart(&progress, 1000);
+}
+
+void tearDown(void) {}
+
+void test_start_has_no_rate_or_eta(void) {
+    TEST_ASSERT_EQUAL_UINT32(0, progress.bytesDone);
+    TEST_ASSERT_EQUAL_UINT32(0, progress.bytesPerSec);
+    TEST_ASSERT_EQUAL_UINT32(OTA_PROGRESS_ETA_UNKNOWN, progress.etaS);
+    TEST_ASSERT_EQUAL_INT(0, otaProgressPercent(&progress));
+}
+
+void test_reports_are_paced(void) {
+    TEST_ASSERT_FALSE(otaProgressUpdate(&progress, 4096, 1000000, 1200, 1000));
+    TEST_ASSERT_EQUAL_UINT32(4096, progress.bytesDone); // Bytes are tracked between reports
+    TEST_ASSERT_FALSE(otaProgressUpdate(&progress, 8192, 1000000, 1999, 1000));
+    TEST_ASSERT_TRUE(otaProgressUpdate(&progress, 100000, 1000000, 2000, 1000));
+    TEST_ASSERT_FALSE(otaProgressUpdate(&progress, 110000, 1000000, 2500, 1000));
+}
+
+void test_rate_and_eta_steady_link(void) {
+    // 100 kB/s for 3 s of a 1 MB image
+    for (uint32_t s = 1; s <= 3; s++) otaProgressUpdate(&progress, s * 100000, 1000000, 1000 + s * 1000, 1000);
+    TEST_ASSERT_EQUAL_UINT32(100000, progress.bytesPerSec);
+    TEST_ASSERT_EQUAL_UINT32(7, progress.etaS);
+    TEST_ASSERT_EQUAL_INT(30, otaProgressPercent(&progress));
+}
+
+void test_rate_follows_slowdown_smoothly(void) {
+    otaProgressUpdate(&progress, 100000, 1000000, 2000, 1000); // 100 kB/s
+    otaProgressUpdate(&progress, 120000, 1000000, 3000, 1000); // 20 kB/s
+    TEST_ASSERT_EQUAL_UINT32(80000, progress.bytesPerSec);
+    for (uint32_t s = 4; s < 20; s++) otaProgressUpdate(&progress, 120000 + (s - 3) * 20000, 1000000, s * 1000, 1000);
+    TEST_ASSERT_UINT32_WITHIN(1000, 20000, progress.bytesPerSec);
+}
+
+void test_complete_reports_at_once(void) {
+    otaProgressUpdate(&progress, 500000, 1000000, 2000, 1000);
+    TEST_ASSERT_TRUE(otaProgressUpdate(&progress, 1000000, 1000000, 2100, 1000));
+    TEST_ASSERT_EQUAL_UINT32(0, progress.etaS);
+    TEST_ASSERT_EQUAL_INT(100, otaProgressPercent(&progress));
+}
+
+void test_unknown_length_has_no_eta(void) {
+    TEST_ASSERT_TRUE(otaProgressUpdate(&progress, 50000, 0, 2000, 1000));
+    TEST_ASSERT_EQUAL_UINT32(50000, progress.bytesPerSec);
+    TEST_ASSERT_EQUAL_UINT32(OTA_PROGRESS_ETA_UNKNOWN, progress.etaS);
+    TEST_ASSERT_EQUAL_INT(0, otaProgressPercent(&progress));
+}
+
+void test_large_image_percent_does_not_overflow(void) {
+    otaProgressUpdate(&progress, 3000000000u, 4000000000u, 2000, 1000);
+    TEST_ASSERT_EQUAL_INT(75, otaProgressPercent(&progress));
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_start_has_no_rate_or_eta);
+    RUN_TEST(test_reports_are_paced);
+    RUN_TEST(test_rate_and_eta_steady_link);
+    RUN_TEST(test_rate_follows_slowdown_smoothly);
+    RUN_TEST(test_complete_reports_at_once);
+    RUN_TEST(test_unknown_length_has_no_eta);
+    RUN_TEST(test_large_image_percent_does_not_overflow);
+    return UNITY_END();
+}
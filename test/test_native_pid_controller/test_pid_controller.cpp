@@ -0,0 +1,165 @@
+/**
+ * @file test_pid_controller.cpp
+ * @brief Host-side tests for the PID fan controller, including a closed-loop run against a simple
+ * thermal model. Run with `pio test -e native`.
+ */
+#include <unity.h>
+#include <stdio.h>
+#include <math.h>
+#include "pid_controller.h"
+#include "fan_curve_lut.h"
+
+static const PidGains DEFAULT_GAINS = {8.0f, 0.2f, 20.0f};
+static PidState state;
+
+void setUp(void) {
+    pidReset(&state, DEFAULT_GAINS, 40.0f, 0.0f, 40.0f, 0.0f, 100.0f);
+}
+
+void tearDown(void) {}
+
+void test_pid_output_rises_when_too_hot(void) {
+    float out = pidUpdate(&state, DEFAULT_GAINS, 40.0f, 42.0f, 1.0f, 0.0f, 100.0f);
+    TEST_ASSERT_TRUE(out > 0.0f);
+}
+
+void test_pid_output_clamped_to_limits(void) {
+    float out = pidUpdate(&state, DEFAULT_GAINS, 40.0f, 90.0f, 1.0f, 20.0f, 80.0f);
+    TEST_ASSERT_EQUAL_FLOAT(80.0f, out);
+    pidReset(&state, DEFAULT_GAINS, 40.0f, 50.0f, 40.0f, 20.0f, 80.0f);
+    out = pidUpdate(&state, DEFAULT_GAINS, 40.0f, 10.0f, 1.0f, 20.0f, 80.0f);
+    TEST_ASSERT_EQUAL_FLOAT(20.0f, out);
+}
+
+void test_pid_reset_is_bumpless(void) {
+    pidReset(&state, DEFAULT_GAINS, 40.0f, 55.0f, 40.0f, 0.0f, 100.0f);
+    float out = pidUpdate(&state, DEFAULT_GAINS, 40.0f, 40.0f, 1.0f, 0.0f, 100.0f);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 55.0f, out);
+}
+
+void test_pid_reset_is_bumpless_with_error(void) {
+    // 3 C too hot: the integrator must absorb kp * error, not just copy the current output
+    pidReset(&state, DEFAULT_GAINS, 40.0f, 55.0f, 43.0f, 0.0f, 100.0f);
+    float out = pidUpdate(&state, DEFAULT_GAINS, 40.0f, 43.0f, 1.0f, 0.0f, 100.0f);
+    TEST_ASSERT_FLOAT_WITHIN(DEFAULT_GAINS.ki * 3.0f + 0.01f, 55.0f, out); // Only one step of integration
+    // Too cold: the proportional term is negative, so the integrator starts above the output
+    pidReset(&state, DEFAULT_GAINS, 40.0f, 10.0f, 38.0f, 0.0f, 100.0f);
+    TEST_ASSERT_EQUAL_FLOAT(26.0f, state.integral);
+    // Too hot with a low output: the seed would be negative and is clamped to the limit
+    pidReset(&state, DEFAULT_GAINS, 40.0f, 10.0f, 43.0f, 0.0f, 100.0f);
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, state.integral);
+}
+
+void test_pid_anti_windup_recovers_quickly(void) {
+    // Ten minutes pinned at max with a large error must not wind the integrator past the limit
+    for (int i = 0; i < 600; i++) pidUpdate(&state, DEFAULT_GAINS, 40.0f, 60.0f, 1.0f, 0.0f, 100.0f);
+    TEST_ASSERT_TRUE(state.integral <= 100.0f);
+    // Once the temperature drops below the setpoint the output has to leave saturation within a few steps
+    int steps = 0;
+    float out = 100.0f;
+    while (out >= 100.0f && steps < 10) {
+        out = pidUpdate(&state, DEFAULT_GAINS, 40.0f, 38.0f, 1.0f, 0.0f, 100.0f);
+        steps++;
+    }
+    TEST_ASSERT_TRUE(out < 100.0f);
+    TEST_ASSERT_TRUE(steps <= 3);
+}
+
+void test_pid_derivative_is_filtered(void) {
+    const PidGains dOnly = {0.0f, 0.0f, 20.0f};
+    pidReset(&state, dOnly, 40.0f, 50.0f, 40.0f, 0.0f, 100.0f);
+    // A 1 C measurement step in a 1 s tick would be a 20 % kick unfiltered
+    float out = pidUpdate(&state, dOnly, 40.0f, 41.0f, 1.0f, 0.0f, 100.0f);
+    TEST_ASSERT_TRUE(out - 50.0f < 20.0f * 0.5f);
+    TEST_ASSERT_TRUE(out > 50.0f);
+}
+
+void test_pid_no_kick_on_setpoint_change(void) {
+    const PidGains dOnly = {0.0f, 0.0f, 20.0f};
+    pidReset(&state, DEFAULT_GAINS, 40.0f, 50.0f, 40.0f, 0.0f, 100.0f);
+    float out = pidUpdate(&state, dOnly, 30.0f, 40.0f, 1.0f, 0.0f, 100.0f);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 50.0f, out);
+}
+
+void test_pid_zero_dt_keeps_output(void) {
+    pidReset(&state, DEFAULT_GAINS, 40.0f, 33.0f, 40.0f, 0.0f, 100.0f);
+    TEST_ASSERT_EQUAL_FLOAT(33.0f, pidUpdate(&state, DEFAULT_GAINS, 40.0f, 60.0f, 0.0f, 0.0f, 100.0f));
+}
+
+// --- Closed loop against a first-order thermal model ---
+// dT/dt = heat - (k0 + k1 * duty) * (T - ambient). The sensor is read every 2 s with +-0.2 C noise and
+// the controller ticks every 1 s, like mainAppTask.
+struct SimResult { float avgDuty; float meanAbsError; int outputChanges; };
+
+static uint32_t noiseState = 1;
+static float sensorNoise() {
+    noiseState = noiseState * 1103515245u + 12345u;
+    return ((int)((noiseState >> 16) % 401) - 200) / 1000.0f;
+}
+
+static SimResult simulate(bool usePid, float setpoint) {
+    const int temps[] = {25, 35, 45, 55, 60};
+    const int pwms[] = {0, 20, 50, 80, 100};
+    static uint8_t lut[FAN_CURVE_LUT_SIZE];
+    buildFanCurveLut(lut, temps, pwms, 5);
+
+    const float ambient = 25.0f, heat = 0.5f, k0 = 0.01f, k1 = 0.0004f;
+    const float dt = 0.1f;
+    float temp = 30.0f, measured = temp, duty = 0.0f;
+    int lastPercent = 0;
+    PidState pid;
+    pidReset(&pid, DEFAULT_GAINS, setpoint, 0.0f, measured, 0.0f, 100.0f);
+    noiseState = 1;
+
+    SimResult r = {0, 0, 0};
+    int samples = 0;
+    const int totalSteps = 36000; // 1 hour
+    for (int step = 0; step < totalSteps; step++) {
+        temp += (heat - (k0 + k1 * duty) * (temp - ambient)) * dt;
+        if (step % 20 == 0) measured = temp + sensorNoise();
+        if (step % 10 == 0) {
+            int percent;
+            if (usePid) percent = (int)pidUpdate(&pid, DEFAULT_GAINS, setpoint, measured, 1.0f, 0.0f, 100.0f);
+            else percent = lookupFanCurveLut(lut, temperatureToDeciC(measured));
+            if (percent != lastPercent) r.outputChanges++;
+            lastPercent = percent;
+            duty = (float)percent;
+        }
+        if (step >= totalSteps / 2) { // Second half: settled behaviour only
+            r.avgDuty += duty;
+            r.meanAbsError += fabsf(temp - setpoint);
+            samples++;
+        }
+    }
+    r.avgDuty /= samples;
+    r.meanAbsError /= samples;
+    return r;
+}
+
+void test_pid_holds_setpoint_with_less_duty_than_curve(void) {
+    // 45 C is where the default curve reaches 50 %
+    SimResult curve = simulate(false, 45.0f);
+    SimResult pid = simulate(true, 45.0f);
+
+    char msg[200];
+    snprintf(msg, sizeof(msg), "curve: avg duty %.1f%%, %d output changes | pid: avg duty %.1f%%, |T-45| %.2f C, %d output changes",
+             curve.avgDuty, curve.outputChanges, pid.avgDuty, pid.meanAbsError, pid.outputChanges);
+    TEST_MESSAGE(msg);
+
+    TEST_ASSERT_TRUE(pid.meanAbsError < 0.5f);
+    TEST_ASSERT_TRUE(pid.avgDuty < curve.avgDuty);
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_pid_output_rises_when_too_hot);
+    RUN_TEST(test_pid_output_clamped_to_limits);
+    RUN_TEST(test_pid_reset_is_bumpless);
+    RUN_TEST(test_pid_reset_is_bumpless_with_error);
+    RUN_TEST(test_pid_anti_windup_recovers_quickly);
+    RUN_TEST(test_pid_derivative_is_filtered);
+    RUN_TEST(test_pid_no_kick_on_setpoint_change);
+    RUN_TEST(test_pid_zero_dt_keeps_output);
+    RUN_TEST(test_pid_holds_setpoint_with_less_duty_than_curve);
+    return UNITY_END();
+}
@@ -0,0 +1,98 @@
+/**
+ * @file test_static_arena.cpp
+ * @brief Host-side tests for the fixed-buffer allocator behind the status JSON documents.
+ * Run with `pio test -e native`.
+ */
+#include <unity.h>
+#include <stdint.h>
+#include <string.h>
+#include "static_arena.h"
+
+static uint8_t memory[256 + 8];
+static StaticArena arena;
+
+void setUp(void) {
+    staticArenaInit(&arena, memory, 256);
+}
+
+void tearDown(void) {}
+
+void test_blocks_are_aligned_and_distinct(void) {
+    staticArenaInit(&arena, memory + 3, 256); // Misaligned buffer
+    uint8_t* a = (uint8_t*)staticArenaAllocate(&arena, 5);
+    uint8_t* b = (uint8_t*)staticArenaAllocate(&arena, 12);
+    TEST_ASSERT_NOT_NULL(a);
+    TEST_ASSERT_NOT_NULL(b);
+    TEST_ASSERT_EQUAL_INT(0, (uintptr_t)a % 8);
+    TEST_ASSERT_EQUAL_INT(0, (uintptr_t)b % 8);
+    TEST_ASSERT_TRUE(b >= a + 5);
+    TEST_ASSERT_EQUAL_UINT32(2, arena.liveBlocks);
+}
+
+void test_space_returns_when_the_last_block_goes(void) {
+    void* a = staticArenaAllocate(&arena, 40);
+    void* b = staticArenaAllocate(&arena, 40);
+    void* c = staticArenaAllocate(&arena, 40);
+    size_t peak = arena.used;
+    staticArenaFree(&arena, a);
+    TEST_ASSERT_EQUAL_UINT32(peak, arena.used); // Middle of the arena: held until everything is freed
+    staticArenaFree(&arena, c);
+    TEST_ASSERT_TRUE(arena.used < peak);       // Newest block comes back at once
+    staticArenaFree(&arena, b);
+    TEST_ASSERT_EQUAL_UINT32(0, arena.used);
+    TEST_ASSERT_EQUAL_UINT32(peak, arena.highWater);
+}
+
+void test_reallocate_grows_the_newest_block_in_place(void) {
+    char* a = (char*)staticArenaAllocate(&arena, 16);
+    strcpy(a, "fan");
+    char* grown = (char*)staticArenaReallocate(&arena, a, 64);
+    TEST_ASSERT_TRUE(grown == a);
+    char* b = (char*)staticArenaAllocate(&arena, 8);
+    char* moved = (char*)staticArenaReallocate(&arena, a, 100); // No longer the newest: copied
+    TEST_ASSERT_NOT_NULL(moved);
+    TEST_ASSERT_TRUE(moved > b);
+    TEST_ASSERT_EQUAL_STRING("fan", moved);
+    TEST_ASSERT_EQUAL_UINT32(2, arena.liveBlocks);
+}
+
+void test_exhaustion_fails_without_corrupting(void) {
+    void* a = staticArenaAllocate(&arena, 200);
+    TEST_ASSERT_NOT_NULL(a);
+    TEST_ASSERT_NULL(staticArenaAllocate(&arena, 100));
+    TEST_ASSERT_NULL(staticArenaReallocate(&arena, a, 300));
+    TEST_ASSERT_EQUAL_UINT32(2, arena.failures);
+    TEST_ASSERT_EQUAL_UINT32(1, arena.liveBlocks);
+    staticArenaFree(&arena, a);
+    TEST_ASSERT_NOT_NULL(staticArenaAllocate(&arena, 240)); // Whole arena again
+}
+
+void test_repeated_documents_reuse_the_same_space(void) {
+    for (int round = 0; round < 1000; round++) {
+        void* pool = staticArenaAllocate(&arena, 96);
+        void* text = staticArenaAllocate(&arena, 20);
+        pool = staticArenaReallocate(&arena, pool, 48); // Shrink, as a document does to fit
+        TEST_ASSERT_NOT_NULL(pool);
+        staticArenaFree(&arena, text);
+        staticArenaFree(&arena, pool);
+        TEST_ASSERT_EQUAL_UINT32(0, arena.used);
+    }
+    TEST_ASSERT_EQUAL_UINT32(0, arena.failures);
+}
+
+void test_fragmentation_percent(void) {
+    TEST_ASSERT_EQUAL_INT(0, heapFragmentationPercent(100000, 100000));
+    TEST_ASSERT_EQUAL_INT(75, heapFragmentationPercent(100000, 25000));
+    TEST_ASSERT_EQUAL_INT(0, heapFragmentationPercent(0, 0));
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_blocks_are_aligned_and_distinct);
+    RUN_TEST(test_space_returns_when_the_last_block_goes);
+    RUN_TEST(test_reallocate_grows_the_newest_block_in_place);
+    RUN_TEST(test_exhaustion_fails_without_corrupting);
+    RUN_TEST(test_repeated_documents_reuse_the_same_space);
+    RUN_TEST(test_fragmentation_percent);
+    return UNITY_END();
+}
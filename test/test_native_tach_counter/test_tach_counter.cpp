@@ -0,0 +1,201 @@
+/**
+ * @file test_tach_counter.cpp
+ * @brief Host-side tests for the tachometer RPM math, driven through both counting paths
+ * (wrapping PCNT counter and ISR pulse count), and for the period / window estimators.
+ * Run with `pio test -e native`.
+ */
+#include <unity.h>
+#include <stdint.h>
+#include "tach_counter.h"
+
+static const int PPR = 2;
+
+// Verbatim copy of the conversion updateFanRpm() used before the PCNT path.
+static int legacyRpm(unsigned long pulses, unsigned long elapsedMillis) {
+    int newRpm = 0;
+    if (elapsedMillis > 0 && PPR > 0) {
+        newRpm = (pulses / (float)PPR) * (60000.0f / elapsedMillis);
+    }
+    return newRpm;
+}
+
+// Both paths fed the same pulse train: the ISR path accumulates and zeroes a count per window,
+// the PCNT path free-runs a counter that wraps at TACH_PCNT_WRAP_LIMIT and diffs successive reads.
+struct SimulatedTach {
+    unsigned long isrCount;
+    int pcntCounter;
+    int pcntLastRead;
+};
+
+static void simulatePulses(SimulatedTach& tach, unsigned long pulses) {
+    tach.isrCount += pulses;
+    tach.pcntCounter = (int)((tach.pcntCounter + pulses) % TACH_PCNT_WRAP_LIMIT);
+}
+
+static int readIsrRpm(SimulatedTach& tach, unsigned long elapsedMillis) {
+    unsigned long pulses = tach.isrCount;
+    tach.isrCount = 0;
+    return tachPulsesToRpm(pulses, elapsedMillis, PPR);
+}
+
+static int readPcntRpm(SimulatedTach& tach, unsigned long elapsedMillis) {
+    unsigned long pulses = tachCounterDelta(tach.pcntLastRead, tach.pcntCounter, TACH_PCNT_WRAP_LIMIT);
+    tach.pcntLastRead = tach.pcntCounter;
+    return tachPulsesToRpm(pulses, elapsedMillis, PPR);
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_rpm_matches_legacy_conversion(void) {
+    const unsigned long windows[] = {1, 999, 1000, 1001, 1050, 2000};
+    for (unsigned long w : windows) {
+        for (unsigned long pulses = 0; pulses <= 400; pulses++) {
+            TEST_ASSERT_EQUAL_INT(legacyRpm(pulses, w), tachPulsesToRpm(pulses, w, PPR));
+        }
+    }
+}
+
+void test_rpm_zero_window_or_ppr(void) {
+    TEST_ASSERT_EQUAL_INT(0, tachPulsesToRpm(100, 0, PPR));
+    TEST_ASSERT_EQUAL_INT(0, tachPulsesToRpm(100, 1000, 0));
+}
+
+void test_known_speeds(void) {
+    TEST_ASSERT_EQUAL_INT(3000, tachPulsesToRpm(100, 1000, 2));
+    TEST_ASSERT_EQUAL_INT(1200, tachPulsesToRpm(40, 1000, 2));
+    TEST_ASSERT_EQUAL_INT(30, tachPulsesToRpm(1, 1000, 2)); // One pulse = 30 RPM granularity over 1 s
+}
+
+void test_counter_delta_without_wrap(void) {
+    TEST_ASSERT_EQUAL_UINT32(0, tachCounterDelta(500, 500, TACH_PCNT_WRAP_LIMIT));
+    TEST_ASSERT_EQUAL_UINT32(100, tachCounterDelta(500, 600, TACH_PCNT_WRAP_LIMIT));
+}
+
+void test_counter_delta_across_wrap(void) {
+    TEST_ASSERT_EQUAL_UINT32(100, tachCounterDelta(TACH_PCNT_WRAP_LIMIT - 40, 60, TACH_PCNT_WRAP_LIMIT));
+    TEST_ASSERT_EQUAL_UINT32(1, tachCounterDelta(TACH_PCNT_WRAP_LIMIT - 1, 0, TACH_PCNT_WRAP_LIMIT));
+}
+
+void test_pcnt_and_isr_paths_agree(void) {
+    SimulatedTach tach = {0, TACH_PCNT_WRAP_LIMIT - 1000, TACH_PCNT_WRAP_LIMIT - 1000}; // Start near the wrap
+    uint32_t lcg = 777;
+    for (int second = 0; second < 600; second++) {
+        lcg = lcg * 1103515245u + 12345u;
+        unsigned long pulses = (lcg >> 16) % 400; // 0-12000 RPM
+        unsigned long window = 990 + (lcg >> 8) % 30;
+        simulatePulses(tach, pulses);
+        int isrRpm = readIsrRpm(tach, window);
+        int pcntRpm = readPcntRpm(tach, window);
+        TEST_ASSERT_EQUAL_INT(isrRpm, pcntRpm);
+        TEST_ASSERT_EQUAL_INT(legacyRpm(pulses, window), pcntRpm);
+    }
+}
+
+// Edge timestamps of a fan at a constant speed, oldest first
+static int fillEdges(uint32_t* edges, int count, uint32_t firstMicros, int rpm) {
+    uint32_t period = 60000000u / (rpm * PPR);
+    for (int i = 0; i < count; i++) edges[i] = firstMicros + i * period;
+    return count;
+}
+
+void test_period_rpm_needs_three_edges(void) {
+    uint32_t edges[TACH_EDGE_HISTORY];
+    fillEdges(edges, 2, 0, 600);
+    TEST_ASSERT_EQUAL_INT(-1, tachPeriodRpm(edges, 2, edges[1], PPR, 1000000));
+    fillEdges(edges, 3, 0, 600);
+    TEST_ASSERT_EQUAL_INT(600, tachPeriodRpm(edges, 3, edges[2], PPR, 1000000));
+}
+
+void test_period_rpm_resolves_below_window_granularity(void) {
+    uint32_t edges[TACH_EDGE_HISTORY];
+    int n = fillEdges(edges, TACH_EDGE_HISTORY, 1000, 437); // Window counting over 1 s only gives multiples of 30
+    TEST_ASSERT_INT_WITHIN(1, 437, tachPeriodRpm(edges, n, edges[n - 1] + 10, PPR, 1000000));
+}
+
+void test_period_median_rejects_glitch(void) {
+    uint32_t edges[TACH_EDGE_HISTORY];
+    int n = fillEdges(edges, TACH_EDGE_HISTORY, 0, 600);
+    edges[4] = edges[3] + 200; // Spurious edge 0.2 ms after a real one
+    TEST_ASSERT_INT_WITHIN(1, 600, tachPeriodRpm(edges, n, edges[n - 1], PPR, 1000000));
+}
+
+void test_period_handles_micros_wrap(void) {
+    uint32_t edges[TACH_EDGE_HISTORY];
+    int n = fillEdges(edges, TACH_EDGE_HISTORY, 0xFFFFFFFFu - 150000u, 800);
+    TEST_ASSERT_INT_WITHIN(1, 800, tachPeriodRpm(edges, n, edges[n - 1] + 5, PPR, 1000000));
+}
+
+void test_period_decays_and_stalls_after_last_edge(void) {
+    uint32_t edges[TACH_EDGE_HISTORY];
+    int n = fillEdges(edges, TACH_EDGE_HISTORY, 0, 600); // 50 ms period
+    uint32_t last = edges[n - 1];
+    TEST_ASSERT_EQUAL_INT(600, tachPeriodRpm(edges, n, last + 40000, PPR, 1000000));
+    TEST_ASSERT_EQUAL_INT(300, tachPeriodRpm(edges, n, last + 100000, PPR, 1000000)); // Stopped 100 ms ago: at most 300
+    TEST_ASSERT_EQUAL_INT(0, tachPeriodRpm(edges, n, last + 1000000, PPR, 1000000));
+}
+
+void test_window_rpm_over_sliding_span(void) {
+    TachWindow window;
+    tachWindowReset(&window);
+    TEST_ASSERT_EQUAL_INT(0, tachWindowRpm(&window, PPR, 200));
+    unsigned long total = 0;
+    for (unsigned long t = 0; t <= 3000; t += 50) {
+        tachWindowPush(&window, total, t, 1000);
+        total += 5; // 100 pulses/s = 3000 RPM
+    }
+    TEST_ASSERT_EQUAL_INT(3000, tachWindowRpm(&window, PPR, 200));
+    TEST_ASSERT_TRUE(window.size <= 21);
+}
+
+void test_window_detects_stall_quickly(void) {
+    TachWindow window;
+    tachWindowReset(&window);
+    unsigned long total = 0, t = 0;
+    for (; t <= 2000; t += 50) { tachWindowPush(&window, total, t, 1000); total += 5; }
+    total -= 5; // Last increment never happened
+    int stalledAfterMs = -1;
+    for (unsigned long stopped = 0; stopped <= 1000; stopped += 50, t += 50) {
+        tachWindowPush(&window, total, t, 1000);
+        if (tachWindowRpm(&window, PPR, 200) == 0) { stalledAfterMs = (int)stopped; break; }
+    }
+    TEST_ASSERT_TRUE(stalledAfterMs >= 0 && stalledAfterMs <= 250);
+}
+
+void test_window_does_not_flag_slow_fan_as_stalled(void) {
+    TachWindow window;
+    tachWindowReset(&window);
+    unsigned long total = 0;
+    for (unsigned long t = 0; t <= 3000; t += 50) {
+        if (t % 300 == 0) total++; // 100 RPM: gaps longer than the stall check are normal
+        tachWindowPush(&window, total, t, 1000);
+        if (t >= 1000) TEST_ASSERT_TRUE(tachWindowRpm(&window, PPR, 200) > 0);
+    }
+}
+
+void test_select_prefers_period_at_low_rpm(void) {
+    TEST_ASSERT_EQUAL_INT(437, tachSelectRpm(437, 420, 1500));
+    TEST_ASSERT_EQUAL_INT(0, tachSelectRpm(0, 900, 1500)); // Stall seen by the period estimate first
+    TEST_ASSERT_EQUAL_INT(3000, tachSelectRpm(2990, 3000, 1500));
+    TEST_ASSERT_EQUAL_INT(420, tachSelectRpm(-1, 420, 1500));
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_rpm_matches_legacy_conversion);
+    RUN_TEST(test_rpm_zero_window_or_ppr);
+    RUN_TEST(test_known_speeds);
+    RUN_TEST(test_counter_delta_without_wrap);
+    RUN_TEST(test_counter_delta_across_wrap);
+    RUN_TEST(test_pcnt_and_isr_paths_agree);
+    RUN_TEST(test_period_rpm_needs_three_edges);
+    RUN_TEST(test_period_rpm_resolves_below_window_granularity);
+    RUN_TEST(test_period_median_rejects_glitch);
+    RUN_TEST(test_period_handles_micros_wrap);
+    RUN_TEST(test_period_decays_and_stalls_after_last_edge);
+    RUN_TEST(test_window_rpm_over_sliding_span);
+    RUN_TEST(test_window_detects_stall_quickly);
+    RUN_TEST(test_window_does_not_flag_slow_fan_as_stalled);
+    RUN_TEST(test_select_prefers_period_at_low_rpm);
+    return UNITY_END();
+}
@@ -0,0 +1,142 @@
+/**
+ * @file test_telemetry_frame.cpp
+ * @brief Host-side tests and benchmark for the binary WebSocket telemetry frame.
+ * Run with `pio test -e native`. The JSON side of the benchmark writes the same fields as the telemetry
+ * document with snprintf, since ArduinoJson is not part of env:native.
+ */
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include "telemetry_frame.h"
+
+static ControllerState state;
+static uint8_t frame[TELEMETRY_FRAME_MAX_SIZE];
+
+static void fillState(int channels) {
+    controllerStateClear(&state);
+    state.temperature = 37.46f;
+    state.tempSensorFound = true;
+    for (int ch = 0; ch < channels; ch++) {
+        ControllerChannelSnapshot& fan = state.channels[ch];
+        fan.calibrationStatus = ch == 1 ? "DONE" : "NONE";
+        fan.speedPercent = 40 + ch;
+        fan.manualSpeedPercent = 50;
+        fan.rpm = 1200 + 100 * ch;
+        fan.targetRpm = ch == 1 ? 1500 : 0;
+        fan.isAutoMode = ch != 1;
+        fan.isRpmMode = ch == 1;
+        fan.hasTach = true;
+    }
+}
+
+// Same fields as the JSON telemetry snapshot carries for these values
+static int jsonTelemetry(char* out, size_t size, int channels, uint32_t seq) {
+    int n = snprintf(out, size, "{\"type\":\"full\",\"seq\":%u,\"temperature\":%.2f,\"tempSensorFound\":%s,\"otaInProgress\":false,\"channels\":[",
+                     (unsigned)seq, state.temperature, state.tempSensorFound ? "true" : "false");
+    for (int ch = 0; ch < channels; ch++) {
+        const ControllerChannelSnapshot& fan = state.channels[ch];
+        n += snprintf(out + n, size - n, "%s{\"fanSpeed\":%d,\"isAutoMode\":%s,\"isPidMode\":%s,\"isRpmMode\":%s,\"targetRpm\":%d,"
+                      "\"calStatus\":\"%s\",\"manualFanSpeed\":%d,\"fanRpm\":%d}", ch ? "," : "", fan.speedPercent,
+                      fan.isAutoMode ? "true" : "false", fan.isPidMode ? "true" : "false", fan.isRpmMode ? "true" : "false",
+                      (int)fan.targetRpm, fan.calibrationStatus, fan.manualSpeedPercent, (int)fan.rpm);
+    }
+    n += snprintf(out + n, size - n, "]}");
+    return n;
+}
+
+void setUp(void) {
+    memset(frame, 0, sizeof(frame));
+}
+
+void tearDown(void) {}
+
+void test_round_trip(void) {
+    fillState(2);
+    size_t length = telemetryFrameEncode(&state, 2, 0x01020304, false, 0, frame, sizeof(frame));
+    TEST_ASSERT_EQUAL_UINT32(TELEMETRY_FRAME_HEADER_SIZE + 2 * TELEMETRY_FRAME_CHANNEL_SIZE, length);
+    TelemetryFrame decoded;
+    TEST_ASSERT_TRUE(telemetryFrameDecode(frame, length, &decoded));
+    TEST_ASSERT_EQUAL_INT(2, decoded.channelCount);
+    TEST_ASSERT_EQUAL_UINT32(0x01020304, decoded.seq);
+    TEST_ASSERT_EQUAL_INT(375, decoded.temperatureDeciC);
+    TEST_ASSERT_EQUAL_INT(TELEMETRY_FLAG_SENSOR, decoded.flags);
+    TEST_ASSERT_EQUAL_INT(41, decoded.channels[1].speedPercent);
+    TEST_ASSERT_EQUAL_INT(TELEMETRY_MODE_RPM | TELEMETRY_MODE_TACH, decoded.channels[1].modeFlags);
+    TEST_ASSERT_EQUAL_INT(TELEMETRY_CAL_DONE, decoded.channels[1].calibration);
+    TEST_ASSERT_EQUAL_INT(1300, decoded.channels[1].rpm);
+    TEST_ASSERT_EQUAL_INT(1500, decoded.channels[1].targetRpm);
+    TEST_ASSERT_EQUAL_INT(TELEMETRY_MODE_AUTO | TELEMETRY_MODE_TACH, decoded.channels[0].modeFlags);
+}
+
+void test_layout_is_little_endian(void) {
+    fillState(1);
+    state.channels[0].rpm = 0x1234;
+    telemetryFrameEncode(&state, 1, 0xA1B2C3D4, true, 55, frame, sizeof(frame));
+    const uint8_t header[] = {'F', 1, 1, TELEMETRY_FLAG_SENSOR | TELEMETRY_FLAG_OTA, 0xD4, 0xC3, 0xB2, 0xA1, 0x77, 0x01, 55, 0};
+    TEST_ASSERT_EQUAL_MEMORY(header, frame, sizeof(header));
+    TEST_ASSERT_EQUAL_INT(0x34, frame[12 + 4]);
+    TEST_ASSERT_EQUAL_INT(0x12, frame[12 + 5]);
+}
+
+void test_missing_sensor_and_clamping(void) {
+    fillState(1);
+    state.tempSensorFound = false;
+    state.channels[0].rpm = 90000;
+    state.channels[0].targetRpm = -5;
+    state.channels[0].speedPercent = 130;
+    size_t length = telemetryFrameEncode(&state, 1, 1, false, 0, frame, sizeof(frame));
+    TelemetryFrame decoded;
+    TEST_ASSERT_TRUE(telemetryFrameDecode(frame, length, &decoded));
+    TEST_ASSERT_EQUAL_INT(TELEMETRY_FRAME_NO_TEMPERATURE, decoded.temperatureDeciC);
+    TEST_ASSERT_EQUAL_INT(0, decoded.flags & TELEMETRY_FLAG_SENSOR);
+    TEST_ASSERT_EQUAL_INT(65535, decoded.channels[0].rpm);
+    TEST_ASSERT_EQUAL_INT(0, decoded.channels[0].targetRpm);
+    TEST_ASSERT_EQUAL_INT(100, decoded.channels[0].speedPercent);
+}
+
+void test_rejects_short_buffers_and_frames(void) {
+    fillState(4);
+    TEST_ASSERT_EQUAL_UINT32(0, telemetryFrameEncode(&state, 4, 1, false, 0, frame, TELEMETRY_FRAME_HEADER_SIZE + 3 * TELEMETRY_FRAME_CHANNEL_SIZE));
+    size_t length = telemetryFrameEncode(&state, 4, 1, false, 0, frame, sizeof(frame));
+    TelemetryFrame decoded;
+    TEST_ASSERT_FALSE(telemetryFrameDecode(frame, length - 1, &decoded));
+    frame[1] = TELEMETRY_FRAME_VERSION + 1;
+    TEST_ASSERT_FALSE(telemetryFrameDecode(frame, length, &decoded));
+}
+
+void test_benchmark_json_vs_binary(void) {
+    char json[2048];
+    char msg[200];
+    for (int channels = 1; channels <= CONTROLLER_STATE_MAX_CHANNELS; channels *= 8) {
+        fillState(channels);
+        const int rounds = 20000;
+        volatile size_t sink = 0;
+        auto t0 = std::chrono::steady_clock::now();
+        for (int r = 0; r < rounds; r++) sink += jsonTelemetry(json, sizeof(json), channels, r);
+        auto t1 = std::chrono::steady_clock::now();
+        for (int r = 0; r < rounds; r++) sink += telemetryFrameEncode(&state, channels, r, false, 0, frame, sizeof(frame));
+        auto t2 = std::chrono::steady_clock::now();
+
+        int jsonBytes = jsonTelemetry(json, sizeof(json), channels, 1);
+        size_t binaryBytes = telemetryFrameEncode(&state, channels, 1, false, 0, frame, sizeof(frame));
+        double jsonNs = std::chrono::duration<double, std::nano>(t1 - t0).count() / rounds;
+        double binaryNs = std::chrono::duration<double, std::nano>(t2 - t1).count() / rounds;
+        snprintf(msg, sizeof(msg), "%d channel(s): JSON %d bytes, %.0f ns; binary %u bytes, %.0f ns (%.1fx smaller, %.1fx faster)",
+                 channels, jsonBytes, jsonNs, (unsigned)binaryBytes, binaryNs, (double)jsonBytes / binaryBytes,
+                 binaryNs > 0 ? jsonNs / binaryNs : 0.0);
+        TEST_MESSAGE(msg);
+        TEST_ASSERT_TRUE(binaryBytes < (size_t)jsonBytes);
+        TEST_ASSERT_TRUE(sink != 0);
+    }
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_round_trip);
+    RUN_TEST(test_layout_is_little_endian);
+    RUN_TEST(test_missing_sensor_and_clamping);
+    RUN_TEST(test_rejects_short_buffers_and_frames);
+    RUN_TEST(test_benchmark_json_vs_binary);
+    return UNITY_END();
+}
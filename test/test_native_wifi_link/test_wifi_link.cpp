@@ -0,0 +1,147 @@
+/**
+ * @file test_wifi_link.cpp
+ * @brief Host-side tests for the WiFi link state machine (attempt timeout, backoff, fast reconnect, join cache).
+ * Run with `pio test -e native`.
+ */
+#include <unity.h>
+#include <string.h>
+#include "wifi_link.h"
+
+static WifiLink link;
+
+void setUp(void) {
+    wifiLinkInit(&link, 15000, 3000, 1000, 60000);
+}
+
+void tearDown(void) {}
+
+void test_starts_off_and_begins_on_start(void) {
+    TEST_ASSERT_EQUAL_INT(WIFI_LINK_OFF, link.state);
+    TEST_ASSERT_EQUAL_INT(WIFI_LINK_ACTION_NONE, wifiLinkTick(&link, 100000));
+    TEST_ASSERT_EQUAL_INT(WIFI_LINK_ACTION_BEGIN, wifiLinkStart(&link, 0));
+    TEST_ASSERT_EQUAL_INT(WIFI_LINK_CONNECTING, link.state);
+    TEST_ASSERT_EQUAL_UINT32(1, link.attempts);
+}
+
+void test_connect_records_duration(void) {
+    wifiLinkStart(&link, 1000);
+    TEST_ASSERT_EQUAL_INT(WIFI_LINK_ACTION_NONE, wifiLinkTick(&link, 3000));
+    wifiLinkOnConnected(&link, 3400);
+    TEST_ASSERT_EQUAL_INT(WIFI_LINK_CONNECTED, link.state);
+    TEST_ASSERT_EQUAL_UINT32(2400, link.lastConnectMs);
+    TEST_ASSERT_EQUAL_INT(WIFI_LINK_ACTION_NONE, wifiLinkTick(&link, 100000)); // No timeout once up
+}
+
+void test_timeout_backs_off_exponentially_to_cap(void) {
+    uint32_t now = 0;
+    wifiLinkStart(&link, now);
+    const uint32_t expected[] = {1000, 2000, 4000, 8000, 16000, 32000, 60000, 60000};
+    for (int i = 0; i < 8; i++) {
+        now += 15000;
+        TEST_ASSERT_EQUAL_INT(WIFI_LINK_ACTION_DISCONNECT, wifiLinkTick(&link, now));
+        TEST_ASSERT_EQUAL_INT(WIFI_LINK_BACKOFF, link.state);
+        TEST_ASSERT_EQUAL_UINT32(expected[i], link.backoffMs);
+        TEST_ASSERT_EQUAL_INT(WIFI_LINK_ACTION_NONE, wifiLinkTick(&link, now + expected[i] - 1));
+        now += expected[i];
+        TEST_ASSERT_EQUAL_INT(WIFI_LINK_ACTION_BEGIN, wifiLinkTick(&link, now));
+    }
+    TEST_ASSERT_EQUAL_UINT32(8, link.failures);
+    TEST_ASSERT_EQUAL_UINT32(9, link.attempts);
+}
+
+void test_rejected_attempt_backs_off_once(void) {
+    wifiLinkStart(&link, 0);
+    TEST_ASSERT_EQUAL_INT(WIFI_LINK_ACTION_NONE, wifiLinkOnDisconnected(&link, 500)); // e.g. wrong password
+    TEST_ASSERT_EQUAL_INT(WIFI_LINK_BACKOFF, link.state);
+    wifiLinkOnDisconnected(&link, 600); // Further events for the same attempt
+    TEST_ASSERT_EQUAL_UINT32(1, link.failures);
+    TEST_ASSERT_EQUAL_UINT32(1000, link.backoffMs);
+}
+
+void test_drop_reconnects_at_once_and_success_resets_backoff(void) {
+    wifiLinkStart(&link, 0);
+    wifiLinkTick(&link, 15000);            // Fail once
+    wifiLinkTick(&link, 16000);            // Retry
+    wifiLinkOnConnected(&link, 17000);
+    TEST_ASSERT_EQUAL_INT(WIFI_LINK_ACTION_BEGIN, wifiLinkOnDisconnected(&link, 50000));
+    TEST_ASSERT_EQUAL_UINT32(1, link.drops);
+    TEST_ASSERT_EQUAL_INT(WIFI_LINK_CONNECTING, link.state);
+    wifiLinkOnDisconnected(&link, 50100); // The immediate retry fails: back off from the minimum again
+    TEST_ASSERT_EQUAL_UINT32(1000, link.backoffMs);
+}
+
+void test_stop_is_idempotent_and_ignores_events(void) {
+    wifiLinkStart(&link, 0);
+    TEST_ASSERT_EQUAL_INT(WIFI_LINK_ACTION_DISCONNECT, wifiLinkStop(&link, 10));
+    TEST_ASSERT_EQUAL_INT(WIFI_LINK_ACTION_NONE, wifiLinkStop(&link, 20));
+    wifiLinkOnConnected(&link, 30);
+    TEST_ASSERT_EQUAL_INT(WIFI_LINK_ACTION_NONE, wifiLinkOnDisconnected(&link, 40));
+    TEST_ASSERT_EQUAL_INT(WIFI_LINK_OFF, link.state);
+}
+
+void test_millis_wraparound(void) {
+    wifiLinkStart(&link, 0xFFFFF000u);
+    TEST_ASSERT_EQUAL_INT(WIFI_LINK_ACTION_NONE, wifiLinkTick(&link, 0x00001000u));
+    TEST_ASSERT_EQUAL_INT(WIFI_LINK_ACTION_DISCONNECT, wifiLinkTick(&link, 0xFFFFF000u + 15000));
+}
+
+void test_first_online_is_recorded_once(void) {
+    wifiLinkStart(&link, 800);
+    wifiLinkOnConnected(&link, 1500);
+    TEST_ASSERT_EQUAL_UINT32(1500, link.firstOnlineMs);
+    wifiLinkOnDisconnected(&link, 9000);
+    wifiLinkOnConnected(&link, 9400);
+    TEST_ASSERT_EQUAL_UINT32(1500, link.firstOnlineMs);
+    TEST_ASSERT_EQUAL_UINT32(400, link.lastConnectMs);
+}
+
+void test_fast_attempt_uses_short_timeout(void) {
+    wifiLinkSetFastJoin(&link, true);
+    wifiLinkStart(&link, 0);
+    TEST_ASSERT_TRUE(link.attemptIsFast);
+    TEST_ASSERT_EQUAL_UINT32(1, link.fastAttempts);
+    TEST_ASSERT_EQUAL_INT(WIFI_LINK_ACTION_NONE, wifiLinkTick(&link, 2999));
+    TEST_ASSERT_EQUAL_INT(WIFI_LINK_ACTION_DISCONNECT, wifiLinkTick(&link, 3000));
+}
+
+void test_failed_fast_attempt_falls_back_to_full_join_at_once(void) {
+    wifiLinkSetFastJoin(&link, true);
+    wifiLinkStart(&link, 0);
+    wifiLinkOnDisconnected(&link, 400); // e.g. AP moved to another channel
+    TEST_ASSERT_EQUAL_UINT32(1, link.fastFailures);
+    TEST_ASSERT_EQUAL_UINT32(0, link.failures);
+    TEST_ASSERT_EQUAL_INT(WIFI_LINK_ACTION_BEGIN, wifiLinkTick(&link, 400));
+    TEST_ASSERT_FALSE(link.attemptIsFast);
+    TEST_ASSERT_EQUAL_INT(WIFI_LINK_ACTION_NONE, wifiLinkTick(&link, 400 + 14999)); // Full timeout now
+    TEST_ASSERT_EQUAL_INT(WIFI_LINK_ACTION_DISCONNECT, wifiLinkTick(&link, 400 + 15000));
+    TEST_ASSERT_EQUAL_UINT32(1000, link.backoffMs); // Regular backoff from here on
+}
+
+void test_join_cache_usable_only_for_its_ssid(void) {
+    WifiJoinCache cache = {};
+    strcpy(cache.ssid, "HomeNet");
+    cache.channel = 6;
+    TEST_ASSERT_FALSE(wifiJoinCacheUsable(&cache, "HomeNet"));
+    cache.valid = 1;
+    TEST_ASSERT_TRUE(wifiJoinCacheUsable(&cache, "HomeNet"));
+    TEST_ASSERT_FALSE(wifiJoinCacheUsable(&cache, "HomeNet2"));
+    TEST_ASSERT_FALSE(wifiJoinCacheUsable(&cache, "Home"));
+    cache.channel = 0;
+    TEST_ASSERT_FALSE(wifiJoinCacheUsable(&cache, "HomeNet"));
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_starts_off_and_begins_on_start);
+    RUN_TEST(test_connect_records_duration);
+    RUN_TEST(test_timeout_backs_off_exponentially_to_cap);
+    RUN_TEST(test_rejected_attempt_backs_off_once);
+    RUN_TEST(test_drop_reconnects_at_once_and_success_resets_backoff);
+    RUN_TEST(test_stop_is_idempotent_and_ignores_events);
+    RUN_TEST(test_millis_wraparound);
+    RUN_TEST(test_first_online_is_recorded_once);
+    RUN_TEST(test_fast_attempt_uses_short_timeout);
+    RUN_TEST(test_failed_fast_attempt_falls_back_to_full_join_at_once);
+    RUN_TEST(test_join_cache_usable_only_for_its_ssid);
+    return UNITY_END();
+}
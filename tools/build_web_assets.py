@@ -0,0 +1,152 @@
+"""Packs the web UI from data/ into the firmware and, optionally, the SPIFFS image.
+
+index.html, style.css and script.js are minified (conservatively: comments and indentation only) and
+gzipped. Each gets a content hash used as its ETag, and index.html references the other two with
+?v=<hash> so they can be cached for a year.
+
+The gzipped files are written as constexpr byte arrays, with a route table (URL, content type, cache
+policy, ETag), to .pio/web_embedded/web_assets_embedded.h, which web_assets.cpp compiles into flash.
+The header is only rewritten when its content changes, so unchanged UI files cost no recompile.
+
+.pio/webfs is the data_dir that buildfs/uploadfs use. It always gets the other files in data/ (the root
+CA). The gzipped UI and its manifest /assets.txt ("<url> <etag>" per line) are added only with
+custom_web_ui_on_fs = yes in the environment (or --ui-on-fs when run directly); the firmware then serves
+that copy instead of the embedded one, so the UI can be updated with a filesystem upload alone.
+
+Runs before every PlatformIO build (extra_scripts in platformio.ini). It can also be run directly:
+python tools/build_web_assets.py [--ui-on-fs]
+"""
+import gzip
+import hashlib
+import os
+import re
+import shutil
+import sys
+
+try:
+    Import("env")  # noqa: F821 (provided by PlatformIO/SCons)
+    PROJECT_DIR = env.subst("$PROJECT_DIR")  # noqa: F821
+    UI_ON_FS = env.GetProjectOption("custom_web_ui_on_fs", "no").strip().lower() in ("yes", "true", "1")  # noqa: F821
+except NameError:
+    env = None
+    PROJECT_DIR = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+    UI_ON_FS = "--ui-on-fs" in sys.argv[1:]
+
+SOURCE_DIR = os.path.join(PROJECT_DIR, "data")
+OUTPUT_DIR = os.path.join(PROJECT_DIR, ".pio", "webfs")
+EMBED_DIR = os.path.join(PROJECT_DIR, ".pio", "web_embedded")
+EMBED_HEADER = "web_assets_embedded.h"
+MANIFEST = "assets.txt"
+WEB_ASSETS = ["style.css", "script.js", "index.html"]  # index.html last: it embeds the others' hashes
+# Route table entries: (url, source file, content type, immutable). Only ?v=<etag> links are immutable.
+WEB_ROUTES = [
+    ("/", "index.html", "text/html", False),
+    ("/index.html", "index.html", "text/html", False),
+    ("/style.css", "style.css", "text/css", True),
+    ("/script.js", "script.js", "application/javascript", True),
+]
+
+
+def minify_css(text):
+    text = re.sub(r"/\*.*?\*/", "", text, flags=re.S)
+    text = re.sub(r"\s+", " ", text)
+    return re.sub(r"\s*([{};:,>])\s*", r"\1", text).strip()
+
+
+def minify_js(text):
+    # No parser, so only what cannot change meaning: indentation, blank lines, whole-line // comments
+    lines = []
+    for line in text.splitlines():
+        stripped = line.strip()
+        if stripped and not stripped.startswith("//"):
+            lines.append(stripped)
+    return "\n".join(lines)
+
+
+def minify_html(text):
+    text = re.sub(r"<!--.*?-->", "", text, flags=re.S)
+    return "\n".join(line.strip() for line in text.splitlines() if line.strip())
+
+
+MINIFIERS = {".css": minify_css, ".js": minify_js, ".html": minify_html}
+
+
+def etag_of(data):
+    return hashlib.sha256(data).hexdigest()[:16]
+
+
+def symbol_of(name):
+    return "WEB_ASSET_" + re.sub(r"[^A-Za-z0-9]", "_", name).upper() + "_GZ"
+
+
+def embedded_header(packed, etags):
+    out = ["// Generated by tools/build_web_assets.py from data/. Do not edit.",
+           "#ifndef WEB_ASSETS_EMBEDDED_H", "#define WEB_ASSETS_EMBEDDED_H", ""]
+    for name in WEB_ASSETS:
+        data = packed[name]
+        out.append("static constexpr uint8_t %s[%d] = {" % (symbol_of(name), len(data)))
+        for i in range(0, len(data), 24):
+            out.append("    " + ",".join("0x%02x" % b for b in data[i:i + 24]) + ",")
+        out.append("};")
+    out.append("")
+    out.append("static constexpr EmbeddedWebAsset EMBEDDED_WEB_ASSETS[] = {")
+    for url, name, content_type, immutable in WEB_ROUTES:
+        out.append('    {"%s", "%s", %s, "%s", %s, sizeof(%s)},' % (url, content_type, "true" if immutable else "false",
+                                                               etags[name], symbol_of(name), symbol_of(name)))
+    out.append("};")
+    out.append("")
+    out.append("#endif // WEB_ASSETS_EMBEDDED_H")
+    return "\n".join(out) + "\n"
+
+
+def write_if_changed(path, text):
+    if os.path.isfile(path):
+        with open(path, encoding="ascii") as current:
+            if current.read() == text:
+                return
+    with open(path, "w", encoding="ascii", newline="\n") as out:
+        out.write(text)
+
+
+def build():
+    if os.path.isdir(OUTPUT_DIR):
+        shutil.rmtree(OUTPUT_DIR)
+    os.makedirs(OUTPUT_DIR)
+    os.makedirs(EMBED_DIR, exist_ok=True)
+
+    etags = {}
+    packed = {}
+    for name in WEB_ASSETS:
+        with open(os.path.join(SOURCE_DIR, name), encoding="utf-8") as source:
+            text = source.read()
+        if name == "index.html":
+            for asset, etag in etags.items():
+                text = re.sub(r'(href|src)="%s"' % re.escape(asset), r'\1="%s?v=%s"' % (asset, etag), text)
+        data = MINIFIERS[os.path.splitext(name)[1]](text).encode("utf-8")
+        etags[name] = etag_of(data)
+        # mtime=0 keeps the output byte-identical between builds of the same sources
+        packed[name] = gzip.compress(data, compresslevel=9, mtime=0)
+
+    write_if_changed(os.path.join(EMBED_DIR, EMBED_HEADER), embedded_header(packed, etags))
+
+    for name in sorted(os.listdir(SOURCE_DIR)):
+        if name not in WEB_ASSETS and os.path.isfile(os.path.join(SOURCE_DIR, name)):
+            shutil.copyfile(os.path.join(SOURCE_DIR, name), os.path.join(OUTPUT_DIR, name))
+
+    if UI_ON_FS:
+        for name in WEB_ASSETS:
+            with open(os.path.join(OUTPUT_DIR, name + ".gz"), "wb") as out:
+                out.write(packed[name])
+        with open(os.path.join(OUTPUT_DIR, MANIFEST), "w", encoding="ascii", newline="\n") as manifest:
+            for name in WEB_ASSETS:
+                manifest.write("/%s %s\n" % (name, etags[name]))
+
+    for name in WEB_ASSETS:
+        original = os.path.getsize(os.path.join(SOURCE_DIR, name))
+        print("[web] %-10s %6d -> %5d bytes gzipped, ETag %s" % (name, original, len(packed[name]), etags[name]))
+    print("[web] UI embedded in firmware%s" % (", override copy in filesystem image" if UI_ON_FS else ""))
+
+
+build()
+if env is not None:
+    env.Append(CPPPATH=[EMBED_DIR])